@@ -1,9 +1,12 @@
 #include "logger_app.hpp"
+#include <charconv>
 #include <iostream>
 
 void write_logging_file(const std::string& file,
-  const Logger::Level level, Channel& channel) {
-  Logger::Logging logger(file, level);
+  const Logger::Level level, Channel& channel, const Writer_options& options) {
+  Logger::Logging logger(file, level, options.file);
+  logger.set_suppression(options.suppress_window);
+  if (options.rate_policy) logger.set_rate_policy(options.rate_policy.value());
   if (auto error = logger.open_session()) {
     std::cerr << error.value().get_err_message() << std::endl;
     // уведомляем главный поток об ошибке
@@ -14,13 +17,21 @@ void write_logging_file(const std::string& file,
    * в цикле ожидаем поступление данных в канал
    * выход и цикла возможен только,
    * если главный поток сигнализирует об ошибке.
-   * Если из канала поступили данные но при записи
-   * в лог произошла ошибка - завершаем поток
+   * Раз в flush_interval вызывается flush: закрываются
+   * истёкшие окна подавления повторов.
+   * Если при записи в лог произошла ошибка - завершаем поток
    */
-  while (auto data_channel = channel.receive_wait()) {
-    auto message = data_channel.value().message;
-    auto time = data_channel.value().time;
-    if (auto error = logger.log_write(message, time)) {
+  auto next_flush = std::chrono::steady_clock::now() + options.flush_interval;
+  while (!channel.is_sender_closed()) {
+    auto data_channel = channel.receive_wait_for(next_flush - std::chrono::steady_clock::now());
+    std::optional<Logger::Error> error;
+    if (data_channel) error = logger.log_write(data_channel.value());
+    auto now = std::chrono::steady_clock::now();
+    if (!error && now >= next_flush) {
+      error = logger.flush();
+      next_flush = now + options.flush_interval;
+    }
+    if (error) {
       std::cerr << error.value().get_err_message() << std::endl;
       channel.notify_error_sender();
       return;
@@ -33,86 +44,148 @@ void write_logging_file(const std::string& file,
     *
   */
   while (auto data_channel = channel.receive_not_wait()) {
-    auto message = data_channel.value().message;
-    auto time = data_channel.value().time;
-    if (auto error = logger.log_write(message, time)) {
+    if (auto error = logger.log_write(data_channel.value())) {
       std::cerr << error.value().get_err_message() << std::endl;
       return;
     }
   }
+  print_statistics(logger);
 }
 
 /**
- * @brief Уведомляет получателя об ошибке или завершении отправки
- * После вызова метода receive_wait() будет возвращать пустой optional
+ * @brief Сообщает в stderr об отброшенных сообщениях по уровням
+ * @param logger Журнал
+ * @param prefix Начало строки (имя журнала в режиме нескольких входов)
  */
-void Channel::notify_error_receiver() {
-  close_sender = true;
-  condvar.notify_one();
+void print_statistics(const Logger::Logging& logger, const std::string& prefix) {
+  auto statistics = logger.get_statistics();
+  for (int i = 0; i < 3; ++i) {
+    if (statistics.sampled[i] || statistics.rate_limited[i] || statistics.suppressed[i]) {
+      std::cerr << prefix << Logger::serialization_level(static_cast<Logger::Level>(i)).value() <<
+      " written: " << statistics.written[i] <<
+      " sampled: " << statistics.sampled[i] <<
+      " rate limited: " << statistics.rate_limited[i] <<
+      " suppressed: " << statistics.suppressed[i] << std::endl;
+    }
+  }
 }
 
 /**
- * @brief Уведомляет отправителя об ошибке или завершении получения.
- * После вызова метода send() будет возвращать false.
+ * @brief Разбирает число из всей строки
+ * @return true, если строка целиком является числом
  */
-void Channel::notify_error_sender() {
-  close_receive = true;
+template<typename T>
+static bool parse_number(std::string_view value, T& number) {
+  auto end = value.data() + value.size();
+  auto result = std::from_chars(value.data(), end, number);
+  return result.ec == std::errc() && result.ptr == end;
 }
 
 /**
- * @brief Отправляет сообщение в канал.
- *
- * @param message Указатель на строку с данными.
- * @param time Метка времени сообщения.
- * @return true, если сообщение было добавлено; false, если получатель закрыт.
+ * @brief Разбирает параметр вида <префикс><LEVEL>:<значение>
+ * @return Индекс уровня и значение, либо пустое значение
  */
-bool Channel::send(const std::shared_ptr<std::string> message,const time_t time) {
-  if (close_receive) return false;
-  {
-    std::unique_lock lock(mtx);
-    data.push(Chanel_protocol{message, time});
-  }
-  /// уведомить получателя о наличие данных в очереди
-  condvar.notify_one();
-  return true;
+static std::optional<std::pair<std::size_t, std::string_view>>
+parse_level_option(std::string_view option, std::string_view prefix) {
+  if (option.rfind(prefix, 0) != 0) return {};
+  option.remove_prefix(prefix.size());
+  auto position = option.find(':');
+  if (position == std::string_view::npos) return {};
+  auto level = Logger::deserialization_level(option.substr(0, position));
+  if (!level) return {};
+  return std::pair{static_cast<std::size_t>(level.value()), option.substr(position + 1)};
 }
 
 /**
- * @brief Получает сообщение из канала, ожидая, если очередь пуста.
- *
- * @return optional<Chanel_protocol> Сообщение или пустой optional,
- *         если отправитель закрыл канал.
+ * @brief Возвращает политику отбора, создавая её при первом обращении
  */
-std::optional<Chanel_protocol>
-Channel::receive_wait() {
-  std::unique_lock lock(mtx);
-
-  /* ожидаем сиганала от отправителя:
-     1. поступили данные в канал
-     2. уведомление об ошибке
-  */
-  condvar.wait(lock, [this]{
-    return data.size() > 0 || close_sender;
-  });
-  // если отправитель уведомил об ошибке выходим
-  if (close_sender) return {};
-  auto log_entry = data.front();
-  data.pop();
-  return log_entry;
+static Logger::Rate_policy& rate_policy(Writer_options& options) {
+  if (!options.rate_policy) options.rate_policy.emplace();
+  return options.rate_policy.value();
 }
 
 /**
- * @brief Получает сообщение из канала без ожидания
- * @return optional<Chanel_protocol> Сообщение или пустой optional,
- *         если очередь пуста
- * @note Для ситуации когда отправитель закрыл канал,
- *       и необходимо получить оставшиеся данные из канала
+ * @brief Разбирает необязательные параметры командной строки
+ *
+ * Параметры вида --<имя>=<значение>:
+ * - --suppress=<сек> - окно подавления повторяющихся сообщений;
+ * - --sample=<LEVEL>:<N> - оставлять 1 сообщение уровня из N;
+ * - --rate=<LEVEL>:<в секунду>[:<всплеск>] - ограничение скорости уровня;
+ * - --keep=<LEVEL> - не отбрасывать сообщения уровня;
+ * - --durability=none|periodic[:<мс>]|sync - сохранность записей на диске;
+ * - --format=text|json|logfmt - формат строк журнала;
+ * - --index=<байт> - индекс токенов журнала по сегментам такого размера;
+ * - --writers=<N> - потоков записи в режиме нескольких входов;
+ * - --starvation=<N> - обходов полосы уровня в канале до обслуживания вне очереди.
+ *
+ * @param argc Количество необязательных параметров.
+ * @param argv Необязательные параметры.
+ * @return optional<Writer_options> Настройки или пустое значение при ошибке.
  */
-std::optional<Chanel_protocol>
-Channel::receive_not_wait() {
-  std::unique_lock lock(mtx);
-  if (!data.size()) return {};
-  auto log_entry = data.front();
-  data.pop();
-  return log_entry;
+std::optional<Writer_options> parse_writer_options(int argc, char const *argv[]) {
+  Writer_options options;
+  for (int i = 0; i < argc; ++i) {
+    std::string_view option(argv[i]);
+    if (option.rfind("--suppress=", 0) == 0) {
+      if (!parse_number(option.substr(11), options.suppress_window) ||
+          options.suppress_window < 0) {
+        return {};
+      }
+    } else if (auto policy = parse_level_option(option, "--sample=")) {
+      uint32_t sample{};
+      if (!parse_number(policy->second, sample) || !sample) return {};
+      rate_policy(options).levels[policy->first].sample = sample;
+    } else if (auto policy = parse_level_option(option, "--rate=")) {
+      auto& level = rate_policy(options).levels[policy->first];
+      auto value = policy->second;
+      auto position = value.find(':');
+      if (!parse_number(value.substr(0, position), level.rate) || level.rate <= 0) return {};
+      if (position != std::string_view::npos &&
+          !parse_number(value.substr(position + 1), level.burst)) {
+        return {};
+      }
+    } else if (option.rfind("--keep=", 0) == 0) {
+      auto level = Logger::deserialization_level(option.substr(7));
+      if (!level) return {};
+      rate_policy(options).levels[static_cast<int>(level.value())].always_keep = true;
+    } else if (option.rfind("--durability=", 0) == 0) {
+      auto mode = option.substr(13), interval = std::string_view{};
+      if (auto position = mode.find(':'); position != std::string_view::npos) {
+        interval = mode.substr(position + 1);
+        mode = mode.substr(0, position);
+      }
+      if (mode == "none") {
+        options.file.durability = Logger::Durability::NONE;
+      } else if (mode == "periodic") {
+        options.file.durability = Logger::Durability::PERIODIC;
+      } else if (mode == "sync") {
+        options.file.durability = Logger::Durability::SYNC;
+      } else {
+        return {};
+      }
+      if (interval.data() && (options.file.durability != Logger::Durability::PERIODIC ||
+          !parse_number(interval, options.file.sync_interval_ms) ||
+          options.file.sync_interval_ms <= 0)) {
+        return {};
+      }
+    } else if (option.rfind("--format=", 0) == 0) {
+      auto format = Logger::parse_output_format(option.substr(9));
+      if (!format) return {};
+      options.file.format = format.value();
+    } else if (option.rfind("--index=", 0) == 0) {
+      if (!parse_number(option.substr(8), options.file.index_segment_bytes) ||
+          !options.file.index_segment_bytes) {
+        return {};
+      }
+    } else if (option.rfind("--writers=", 0) == 0) {
+      if (!parse_number(option.substr(10), options.writers) || !options.writers) return {};
+    } else if (option.rfind("--starvation=", 0) == 0) {
+      if (!parse_number(option.substr(13), options.starvation_limit) || !options.starvation_limit) {
+        return {};
+      }
+    } else {
+      return {};
+    }
+  }
+  return options;
 }
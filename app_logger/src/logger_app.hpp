@@ -4,41 +4,206 @@
 #include <queue>
 #include <string>
 #include <atomic>
+#include <chrono>
+#include <istream>
 #include <optional>
+#include <vector>
 
 #include "logger.hpp"
 
 /**
- * @brief Структура, для записи сообщения в канал.
+ * @brief Запись, передаваемая через канал.
+ * Компактная запись протокола: уровень, время и сообщение в одной кэш-линии
  */
-struct Chanel_protocol {
-  std::shared_ptr<std::string> message; ///< Сообщение
-  time_t time; ///< Метка времени сообщения
-};
+using Chanel_protocol = Logger::Logger_protocol::Protocol;
 
 /**
  * @brief Потокобезопасный односторонний канал для передачи сообщений между потоками
  *
- * Channel обеспечивает блокирующую и неблокирующую выборку сообщений из очереди
+ * Channel обеспечивает блокирующую и неблокирующую выборку сообщений из очереди.
+ * Сообщения разных уровней стоят в отдельных очередях (полосах): получатель
+ * берёт сообщение самого высокого уровня, поэтому ERROR не ждёт накопленные
+ * INFO. Порядок внутри уровня сохраняется. Чтобы нижние уровни не голодали,
+ * полоса, которую обошли starvation_limit раз подряд, обслуживается вне очереди:
+ * при непустых полосах каждая получает сообщение не реже, чем раз
+ * в (starvation_limit + 1) * lane_count выборок.
+ * Память очереди и длинных сообщений берётся из Logger::Memory::Buffer_pool:
+ * буферы, освобождённые получателем, повторно используются отправителем
  * Получатель и отправитель могут сигнализировать об ошибках через канал
+ * @tparam T Тип сообщения с методом get_level()
  */
-class Channel {
-  std::queue<Chanel_protocol> data; ///< Очередь сообщений
+template<typename T>
+class Basic_channel {
+  static constexpr std::size_t lane_count = 3; ///< Полос по числу значений Logger::Level
+  /// Очереди сообщений по уровням, блоки очередей выделяются из пула буферов
+  std::queue<T, Logger::Memory::Pool_deque<T>> lanes[lane_count];
+  uint32_t bypassed[lane_count]{}; ///< Выборок подряд, обошедших непустую полосу
+  uint32_t starvation_limit; ///< Обходов, после которых полоса обслуживается вне очереди
+  std::size_t count{}; ///< Сообщений во всех полосах
   std::mutex mtx; ///< Мьютекс для защиты очереди
   std::condition_variable condvar; ///< Условная переменная для ожидания сообщений
   std::atomic<bool> close_sender{false}; ///< Флаг закрытия отправителя
   std::atomic<bool> close_receive{false}; ///< Флаг закрытия получателя
+
+  /**
+   * @brief Извлекает следующее сообщение, очередь не пуста
+   *
+   * Выбирается самая высокая непустая полоса, если ни одна из нижних
+   * не обойдена starvation_limit раз; иначе - самая высокая из обойденных
+   */
+  T pop() {
+    std::size_t lane = lane_count;
+    while (lanes[--lane].empty()) {}
+    for (std::size_t lower = lane; lower-- > 0;) {
+      if (!lanes[lower].empty() && bypassed[lower] >= starvation_limit) {
+        lane = lower;
+        break;
+      }
+    }
+    for (std::size_t lower = 0; lower < lane; ++lower) {
+      if (!lanes[lower].empty()) ++bypassed[lower];
+    }
+    bypassed[lane] = 0;
+    auto entry = std::move(lanes[lane].front());
+    lanes[lane].pop();
+    --count;
+    return entry;
+  }
+
 public:
-  Channel() = default;
-  Channel(const Channel&) = delete;
-  Channel& operator=(const Channel&) = delete;
-
-  void notify_error_receiver();
-  void notify_error_sender();
-  bool send(const std::shared_ptr<std::string>, const time_t);
-  std::optional<Chanel_protocol> receive_wait();
-  std::optional<Chanel_protocol>receive_not_wait();
+  static constexpr uint32_t default_starvation_limit = 16;
+
+  explicit Basic_channel(uint32_t starvation_limit = default_starvation_limit)
+    : starvation_limit(starvation_limit) {}
+  Basic_channel(const Basic_channel&) = delete;
+  Basic_channel& operator=(const Basic_channel&) = delete;
+
+  /**
+   * @brief Уведомляет получателя об ошибке или завершении отправки
+   * После вызова метода receive_wait() будет возвращать пустой optional
+   */
+  void notify_error_receiver() {
+    {
+      std::lock_guard lock(mtx);
+      close_sender = true;
+    }
+    condvar.notify_one();
+  }
+
+  /**
+   * @brief Уведомляет отправителя об ошибке или завершении получения.
+   * После вызова метода send() будет возвращать false.
+   */
+  void notify_error_sender() {
+    close_receive = true;
+  }
+
+  /**
+   * @brief Отправляет запись в канал.
+   *
+   * @param entry Запись, перемещается в полосу своего уровня.
+   * @return true, если сообщение было добавлено; false, если получатель закрыт.
+   */
+  bool send(T&& entry) {
+    if (close_receive) return false;
+    auto lane = static_cast<std::size_t>(entry.get_level()) % lane_count;
+    {
+      std::unique_lock lock(mtx);
+      lanes[lane].push(std::move(entry));
+      ++count;
+    }
+    /// уведомить получателя о наличие данных в очереди
+    condvar.notify_one();
+    return true;
+  }
+
+  /**
+   * @brief Получает сообщение из канала, ожидая, если очередь пуста.
+   *
+   * @return optional<T> Сообщение или пустой optional,
+   *         если отправитель закрыл канал.
+   */
+  std::optional<T> receive_wait() {
+    std::unique_lock lock(mtx);
+
+    /* ожидаем сиганала от отправителя:
+       1. поступили данные в канал
+       2. уведомление об ошибке
+    */
+    condvar.wait(lock, [this]{
+      return count > 0 || close_sender;
+    });
+    // если отправитель уведомил об ошибке выходим
+    if (close_sender) return {};
+    return pop();
+  }
+
+  /**
+   * @brief Получает сообщение из канала, ожидая не дольше timeout.
+   *
+   * @return optional<T> Сообщение или пустой optional, если срок истёк
+   *         или отправитель закрыл канал (is_sender_closed()).
+   */
+  template<typename Rep, typename Period>
+  std::optional<T> receive_wait_for(std::chrono::duration<Rep, Period> timeout) {
+    std::unique_lock lock(mtx);
+    condvar.wait_for(lock, timeout, [this]{
+      return count > 0 || close_sender;
+    });
+    if (close_sender || !count) return {};
+    return pop();
+  }
+
+  /// Отправитель закрыл канал (notify_error_receiver)
+  bool is_sender_closed() const { return close_sender; }
+
+  /**
+   * @brief Получает сообщение из канала без ожидания
+   * @return optional<T> Сообщение или пустой optional,
+   *         если очередь пуста
+   * @note Для ситуации когда отправитель закрыл канал,
+   *       и необходимо получить оставшиеся данные из канала
+   */
+  std::optional<T> receive_not_wait() {
+    std::unique_lock lock(mtx);
+    if (!count) return {};
+    return pop();
+  }
+};
+
+/// Канал записей протокола от потока чтения к потоку записи
+using Channel = Basic_channel<Chanel_protocol>;
+
+/**
+ * @brief Дополнительные настройки потока записи в журнал
+ */
+struct Writer_options {
+  time_t suppress_window{}; ///< Окно подавления повторов в секундах, 0 - выключено
+  std::optional<Logger::Rate_policy> rate_policy; ///< Выборка и ограничение скорости по уровням
+  Logger::File_options file; ///< Гарантия сохранности записей в файле
+  std::size_t writers{}; ///< Потоков записи в режиме нескольких входов, 0 - по числу ядер
+  /// Обходов полосы канала, после которых она обслуживается вне очереди (Basic_channel)
+  uint32_t starvation_limit = Channel::default_starvation_limit;
+  /// Период вызова Logging::flush потоком записи: итоги подавленных повторов
+  /// выводятся по окончании окна, даже если новых записей нет
+  std::chrono::milliseconds flush_interval{1000};
+};
+
+/**
+ * @brief Вход режима нескольких входов: FIFO или файл и журнал, в который он пишется
+ */
+struct Input_config {
+  std::string input; ///< Путь к FIFO или обычному файлу
+  std::string file; ///< Файл журнала, несколько входов могут писать в один
+  Logger::Level level; ///< Уровень записей входа
 };
 
 void write_logging_file(const std::string& file,
-  const Logger::Level level, Channel& channel);
+  const Logger::Level level, Channel& channel, const Writer_options& = {});
+void print_statistics(const Logger::Logging&, const std::string& prefix = {});
+
+std::optional<Writer_options> parse_writer_options(int, char const *[]);
+
+std::optional<std::vector<Input_config>> parse_input_config(std::istream&);
+std::optional<Logger::Error>
+run_inputs(const std::vector<Input_config>&, const Writer_options&, const std::atomic<bool>& stop);
@@ -1,11 +1,56 @@
+#include <csignal>
+#include <fstream>
 #include <iostream>
 #include <string>
 #include <thread>
 #include "logger_app.hpp"
 
+namespace {
+  std::atomic<bool> stop_inputs{false}; ///< Устанавливается SIGINT/SIGTERM
+
+  void on_stop_signal(int) {
+    stop_inputs = true;
+  }
+
+  /**
+   * @brief Режим нескольких входов: logger_app --inputs=<конфигурация> [параметры]
+   */
+  int inputs_main(const int argc, char const *argv[]) {
+    std::string config_path = std::string(argv[1]).substr(9);
+    std::ifstream config(config_path);
+    if (!config.is_open()) {
+      std::cout << "cannot open " << config_path << std::endl;
+      return 1;
+    }
+    auto inputs = parse_input_config(config);
+    if (!inputs) {
+      std::cout << "invalid inputs config: " << config_path << std::endl;
+      return 1;
+    }
+    auto options = parse_writer_options(argc - 2, argv + 2);
+    if (!options) {
+      std::cout << "invalid options" << std::endl;
+      return 1;
+    }
+    struct sigaction action{};
+    action.sa_handler = on_stop_signal;
+    ::sigaction(SIGINT, &action, nullptr);
+    ::sigaction(SIGTERM, &action, nullptr);
+    if (auto error = run_inputs(inputs.value(), options.value(), stop_inputs)) {
+      std::cerr << error->get_err_message() << std::endl;
+      return 1;
+    }
+    return 0;
+  }
+}
+
 int main(const int argc, char const *argv[]) {
+  if (argc > 1 && std::string(argv[1]).rfind("--inputs=", 0) == 0) {
+    return inputs_main(argc, argv);
+  }
   if (argc < 3) {
-    std::cout << "using <file logging> <LEVEL message>";
+    std::cout << "using <file logging> <LEVEL message> [--suppress=<sec>]\n"
+      "using --inputs=<config> [--writers=<N>] [--suppress=<sec>]" << std::endl;
     return 1;
   }
   std::string file(argv[1]);
@@ -16,13 +61,19 @@ int main(const int argc, char const *argv[]) {
     Logger::serialization_level(Logger::Level::INFO).value() << " " <<
     Logger::serialization_level(Logger::Level::WARN).value() << " " <<
     Logger::serialization_level(Logger::Level::ERROR).value() << std::endl;
+    return 1;
   }
-  Channel channel;
+  auto options = parse_writer_options(argc - 3, argv + 3);
+  if (!options) {
+    std::cout << "invalid options" << std::endl;
+    return 1;
+  }
+  Channel channel(options->starvation_limit);
   /* создаем поток и передаем данные для инициализации логирования
      и ссылку на канал для обмена сообщениями
   */
-  std::thread thread_logging([&file, &log_level, &channel]{
-    write_logging_file(file, log_level.value(), channel);
+  std::thread thread_logging([&file, &log_level, &channel, &options]{
+    write_logging_file(file, log_level.value(), channel, options.value());
   });
 
   std::string line;
@@ -33,15 +84,24 @@ int main(const int argc, char const *argv[]) {
       channel.notify_error_receiver();
       break;
     }
+    /* разбираем строку в запись протокола,
+       пустые строки пропускаем */
+    auto entry = Logger::Logger_protocol::Protocol::create_log_entry(
+      std::move(line), log_level.value(), Logger::Clock::now());
+    if (!entry) {
+      line.clear();
+      continue;
+    }
     /* если получатль закрыл канал - выходим из цикла
-       иначе передаем в канал сообщение и текущее время
+       иначе передаем запись в канал
       */
-    if (!channel.send(std::make_shared<std::string>(std::move(line)),
-      std::time(nullptr))) {
+    if (!channel.send(std::move(entry.value()))) {
       break;
     }
     line.clear();
   }
+  // ввод закончился - закрываем канал, получатель допишет остаток очереди
+  channel.notify_error_receiver();
   thread_logging.join();
   return 0;
 }
@@ -0,0 +1,280 @@
+#include "logger_app.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sstream>
+#include <sys/epoll.h>
+#include <sys/stat.h>
+#include <thread>
+
+namespace {
+  constexpr int poll_interval_ms = 100; ///< Период опроса обычных файлов и флага остановки
+  constexpr std::size_t read_size = 64 * 1024;
+  constexpr int reads_per_event = 16; ///< Ограничение чтений FIFO за событие, остальные входы не ждут
+
+  /// Запись с индексом журнала, в который она пишется
+  struct Routed_entry {
+    std::size_t output;
+    Chanel_protocol entry;
+    /// Полоса канала
+    Logger::Level get_level() const { return entry.get_level(); }
+  };
+
+  using Routed_channel = Basic_channel<Routed_entry>;
+
+  /// Открытый вход
+  struct Input_stream {
+    int fd{-1};
+    int keep_fd{-1}; ///< Собственный конец записи FIFO: уход писателей не даёт EOF
+    bool polled{false}; ///< Обычный файл, epoll не поддерживает - опрашивается по таймеру
+    std::string pending; ///< Неполная строка
+    std::size_t output{};
+    Logger::Level level{};
+  };
+
+  /**
+   * @brief Поток записи: владеет журналами с индексами first, first + step, ...
+   *
+   * Журнал пишется только своим потоком, порядок строк входа сохраняется.
+   * После ошибки записи журнал закрывается, его записи отбрасываются
+   * и учитываются, остальные журналы продолжают работу
+   */
+  void write_routed(const std::vector<std::string>& outputs, std::size_t first, std::size_t step,
+      Routed_channel& channel, const Writer_options& options) {
+    std::vector<std::unique_ptr<Logger::Logging>> loggers(outputs.size());
+    std::vector<uint64_t> dropped(outputs.size());
+    for (std::size_t i = first; i < outputs.size(); i += step) {
+      auto logger = std::make_unique<Logger::Logging>(outputs[i], Logger::Level::INFO, options.file);
+      logger->set_suppression(options.suppress_window);
+      if (options.rate_policy) logger->set_rate_policy(options.rate_policy.value());
+      if (auto error = logger->open_session()) {
+        std::cerr << outputs[i] << ": " << error->get_err_message() << std::endl;
+        continue;
+      }
+      loggers[i] = std::move(logger);
+    }
+    auto write = [&](Routed_entry& routed) {
+      auto& logger = loggers[routed.output];
+      if (!logger) {
+        ++dropped[routed.output];
+        return;
+      }
+      if (auto error = logger->log_write(routed.entry)) {
+        std::cerr << outputs[routed.output] << ": " << error->get_err_message() << std::endl;
+        logger.reset();
+        ++dropped[routed.output];
+      }
+    };
+    // flush раз в flush_interval выводит итоги окон подавления повторов без новых записей
+    auto next_flush = std::chrono::steady_clock::now() + options.flush_interval;
+    while (!channel.is_sender_closed()) {
+      if (auto routed = channel.receive_wait_for(next_flush - std::chrono::steady_clock::now())) {
+        write(routed.value());
+      }
+      auto now = std::chrono::steady_clock::now();
+      if (now < next_flush) continue;
+      next_flush = now + options.flush_interval;
+      for (std::size_t i = first; i < outputs.size(); i += step) {
+        if (!loggers[i]) continue;
+        if (auto error = loggers[i]->flush()) {
+          std::cerr << outputs[i] << ": " << error->get_err_message() << std::endl;
+          loggers[i].reset();
+        }
+      }
+    }
+    // отправитель закрыл канал - дописываем остаток очереди
+    while (auto routed = channel.receive_not_wait()) write(routed.value());
+    for (std::size_t i = first; i < outputs.size(); i += step) {
+      if (loggers[i]) print_statistics(*loggers[i], outputs[i] + ": ");
+      if (dropped[i]) std::cerr << outputs[i] << ": dropped: " << dropped[i] << std::endl;
+    }
+  }
+
+  /**
+   * @brief Разбивает прочитанные данные на строки и отправляет записи в канал
+   *
+   * Строка, не завершённая переводом строки, остаётся в pending.
+   * Пустые строки пропускаются, как и при чтении стандартного ввода
+   */
+  void route_lines(Input_stream& stream, std::string_view data, Logger::Timestamp received,
+      Routed_channel& channel) {
+    while (!data.empty()) {
+      auto newline = data.find('\n');
+      if (newline == std::string_view::npos) {
+        stream.pending.append(data);
+        return;
+      }
+      std::string line;
+      if (stream.pending.empty()) {
+        line.assign(data.data(), newline);
+      } else {
+        line = std::move(stream.pending);
+        line.append(data.data(), newline);
+        stream.pending.clear();
+      }
+      data.remove_prefix(newline + 1);
+      if (auto entry = Chanel_protocol::create_log_entry(std::move(line), stream.level, received)) {
+        channel.send(Routed_entry{stream.output, std::move(entry.value())});
+      }
+    }
+  }
+
+  /**
+   * @brief Читает доступные данные входа
+   * @param limit Наибольшее количество чтений, 0 - до конца данных
+   */
+  void read_input(Input_stream& stream, char* buffer, Routed_channel& channel, int limit) {
+    for (int count = 0; !limit || count < limit; ++count) {
+      auto size = ::read(stream.fd, buffer, read_size);
+      if (size <= 0) return;
+      route_lines(stream, std::string_view(buffer, static_cast<std::size_t>(size)),
+        Logger::Clock::now(), channel);
+    }
+  }
+
+  void close_inputs(std::vector<Input_stream>& streams) {
+    for (auto& stream : streams) {
+      if (stream.fd != -1) ::close(stream.fd);
+      if (stream.keep_fd != -1) ::close(stream.keep_fd);
+    }
+  }
+}
+
+/**
+ * @brief Разбирает конфигурацию входов
+ *
+ * Строка: "<вход> <файл_лога> <LEVEL>", пустые строки и строки,
+ * начинающиеся с '#', пропускаются
+ * @param config Поток конфигурации
+ * @return optional<vector<Input_config>> Входы или пустое значение при ошибке
+ */
+std::optional<std::vector<Input_config>> parse_input_config(std::istream& config) {
+  std::vector<Input_config> inputs;
+  std::string line;
+  while (std::getline(config, line)) {
+    auto start = line.find_first_not_of(" \t\r");
+    if (start == std::string::npos || line[start] == '#') continue;
+    std::istringstream fields(line);
+    std::string input, file, level_name, extra;
+    if (!(fields >> input >> file >> level_name) || (fields >> extra)) return {};
+    auto level = Logger::deserialization_level(level_name);
+    if (!level) return {};
+    inputs.push_back({input, file, level.value()});
+  }
+  if (inputs.empty()) return {};
+  return inputs;
+}
+
+/**
+ * @brief Читает несколько входов и пишет их в журналы пулом потоков
+ *
+ * FIFO отслеживаются через epoll, обычные файлы читаются с начала
+ * и дочитываются по таймеру (как tail -f). Строки входа получают его уровень
+ * и передаются в канал потока, владеющего журналом входа; журналы
+ * распределяются между потоками записи по кругу.
+ * FIFO остаются открытыми на запись самим приложением, поэтому писатели
+ * могут отключаться и подключаться снова.
+ *
+ * @param inputs Входы
+ * @param options Настройки журналов и количество потоков записи
+ * @param stop Флаг остановки, проверяется не реже poll_interval_ms
+ * @return optional<Error> Ошибка открытия входа или epoll
+ */
+std::optional<Logger::Error>
+run_inputs(const std::vector<Input_config>& inputs, const Writer_options& options,
+    const std::atomic<bool>& stop) {
+  std::vector<std::string> outputs;
+  std::vector<Input_stream> streams(inputs.size());
+  for (std::size_t i = 0; i < inputs.size(); ++i) {
+    auto found = std::find(outputs.begin(), outputs.end(), inputs[i].file);
+    streams[i].output = static_cast<std::size_t>(found - outputs.begin());
+    streams[i].level = inputs[i].level;
+    if (found == outputs.end()) outputs.push_back(inputs[i].file);
+  }
+
+  int epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+  if (epoll_fd == -1) {
+    return Logger::Error(Logger::Error_code::OPEN_SESSION, std::string("epoll: ") + ::strerror(errno));
+  }
+  auto fail = [&](const std::string& what) {
+    Logger::Error error(Logger::Error_code::OPEN_SESSION, what + ": " + ::strerror(errno));
+    close_inputs(streams);
+    ::close(epoll_fd);
+    return error;
+  };
+  for (std::size_t i = 0; i < inputs.size(); ++i) {
+    auto& stream = streams[i];
+    const auto& path = inputs[i].input;
+    stream.fd = ::open(path.data(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (stream.fd == -1) return fail(path);
+    struct stat info{};
+    if (::fstat(stream.fd, &info)) return fail(path);
+    if (!S_ISFIFO(info.st_mode)) {
+      stream.polled = true;
+      continue;
+    }
+    stream.keep_fd = ::open(path.data(), O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.u64 = i;
+    if (stream.keep_fd == -1 || ::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, stream.fd, &event)) {
+      return fail(path);
+    }
+  }
+
+  auto writers = options.writers ? options.writers :
+    static_cast<std::size_t>(std::max(1u, std::thread::hardware_concurrency()));
+  writers = std::min(writers, outputs.size());
+  std::vector<std::unique_ptr<Routed_channel>> channels;
+  std::vector<std::thread> threads;
+  for (std::size_t i = 0; i < writers; ++i) {
+    channels.push_back(std::make_unique<Routed_channel>(options.starvation_limit));
+  }
+  // вход пишет в канал потока, владеющего его журналом
+  auto channel_of = [&](const Input_stream& stream) -> Routed_channel& {
+    return *channels[stream.output % writers];
+  };
+  for (std::size_t i = 0; i < writers; ++i) {
+    threads.emplace_back(write_routed, std::cref(outputs), i, writers,
+      std::ref(*channels[i]), std::cref(options));
+  }
+
+  std::vector<char> buffer(read_size);
+  std::optional<Logger::Error> result;
+  auto polled_at = std::chrono::steady_clock::time_point{};
+  epoll_event events[64];
+  while (!stop) {
+    int count = ::epoll_wait(epoll_fd, events, static_cast<int>(std::size(events)), poll_interval_ms);
+    if (count == -1 && errno != EINTR) {
+      result = Logger::Error(Logger::Error_code::ERROR, std::string("epoll: ") + ::strerror(errno));
+      break;
+    }
+    for (int i = 0; i < count; ++i) {
+      auto& stream = streams[events[i].data.u64];
+      read_input(stream, buffer.data(), channel_of(stream), reads_per_event);
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (now - polled_at >= std::chrono::milliseconds(poll_interval_ms)) {
+      polled_at = now;
+      for (auto& stream : streams) {
+        if (stream.polled) read_input(stream, buffer.data(), channel_of(stream), 0);
+      }
+    }
+  }
+
+  // дочитываем входы, неполные строки записываются как есть
+  for (auto& stream : streams) {
+    read_input(stream, buffer.data(), channel_of(stream), 0);
+    if (stream.pending.empty()) continue;
+    if (auto entry = Chanel_protocol::create_log_entry(std::move(stream.pending), stream.level,
+        Logger::Clock::now())) {
+      channel_of(stream).send(Routed_entry{stream.output, std::move(entry.value())});
+    }
+  }
+  for (auto& channel : channels) channel->notify_error_receiver();
+  for (auto& thread : threads) thread.join();
+  close_inputs(streams);
+  ::close(epoll_fd);
+  return result;
+}
@@ -1,7 +1,14 @@
 #include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
 #include <string>
 #include <thread>
 #include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "../src/logger_app.hpp"
 
 
@@ -11,8 +18,8 @@ void test_send_receive() {
   int sent_count = data.size();
   auto sender = std::thread([&]{
       for (int i = 0; i < sent_count; ++i) {
-          auto msg = std::make_shared<std::string>(data[i]);
-          bool ok = ch.send(msg, time(nullptr));
+          Chanel_protocol msg(data[i], Logger::Level::INFO, time(nullptr));
+          bool ok = ch.send(std::move(msg));
           assert(ok);
       }
       // закрываем канал - уведомляем получателя
@@ -23,7 +30,7 @@ void test_send_receive() {
           // ожидаем данных либо закрытия канала
           auto msg = ch.receive_wait();
           if (!msg) break; // канал закрыт
-          assert(*msg.value().message == data[i]);
+          assert(msg.value().get_message_view() == data[i]);
       }
   });
   sender.join();
@@ -34,23 +41,256 @@ void test_non_blocking_receive() {
   Channel ch;
   auto msg = ch.receive_not_wait();
   assert(!msg.has_value()); // должно быть пусто
-  bool ok = ch.send(std::make_shared<std::string>("Hi"), time(nullptr));
+  bool ok = ch.send(Chanel_protocol("Hi", Logger::Level::WARN, time(nullptr)));
   assert(ok);
   msg = ch.receive_not_wait();
   assert(msg.has_value());
-  assert(*msg->message == "Hi");
+  assert(msg->get_message_view() == "Hi");
+  assert(msg->get_level() == Logger::Level::WARN);
 }
 
 void test_close_receive() {
   Channel ch;
   // получатель закрыл канал
   ch.notify_error_sender();
-  bool ok = ch.send(std::make_shared<std::string>("This won't be sent"), time(nullptr));
+  bool ok = ch.send(Chanel_protocol("This won't be sent", Logger::Level::INFO, time(nullptr)));
   assert(!ok);
 }
 
+void test_receive_wait_for() {
+  Channel ch;
+  auto start = std::chrono::steady_clock::now();
+  assert(!ch.receive_wait_for(std::chrono::milliseconds(20)));
+  assert(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(20));
+  assert(!ch.is_sender_closed());
+  assert(ch.send(Chanel_protocol("Hi", Logger::Level::INFO, time(nullptr))));
+  assert(ch.receive_wait_for(std::chrono::seconds(1))->get_message_view() == "Hi");
+  ch.notify_error_receiver();
+  assert(!ch.receive_wait_for(std::chrono::seconds(1)) && ch.is_sender_closed());
+}
+
+/// Читает строки файла
+std::vector<std::string> read_lines(const std::string& file) {
+  std::ifstream stream(file);
+  std::vector<std::string> lines;
+  for (std::string line; std::getline(stream, line);) lines.push_back(line);
+  return lines;
+}
+
+void test_idle_flush() {
+  const std::string file{"test_idle_flush.log"};
+  std::remove(file.data());
+  Channel ch;
+  Writer_options options;
+  options.suppress_window = 1;
+  options.flush_interval = std::chrono::milliseconds(50);
+  std::thread writer([&]{ write_logging_file(file, Logger::Level::INFO, ch, options); });
+  /* шторм повторов, затем новых записей нет */
+  for (int i = 0; i < 5; ++i) {
+    assert(ch.send(Chanel_protocol("storm", Logger::Level::ERROR, time(nullptr))));
+  }
+  /* итог окна записывается периодическим flush без следующей записи */
+  std::vector<std::string> lines;
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (lines.size() < 2 && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    lines = read_lines(file);
+  }
+  assert(lines.size() == 2);
+  assert(lines[0].rfind("storm ERROR ", 0) == 0);
+  assert(lines[1].rfind("storm (repeated 4 times) ERROR ", 0) == 0);
+  ch.notify_error_receiver();
+  writer.join();
+  std::remove(file.data());
+}
+
+void test_priority_lanes() {
+  /* накопленные INFO, затем WARN и ERROR: ERROR выбирается первым */
+  Channel ch(4);
+  for (int i = 0; i < 100; ++i) {
+    assert(ch.send(Chanel_protocol("info " + std::to_string(i), Logger::Level::INFO, time(nullptr))));
+  }
+  for (int i = 0; i < 10; ++i) {
+    assert(ch.send(Chanel_protocol("warn " + std::to_string(i), Logger::Level::WARN, time(nullptr))));
+  }
+  assert(ch.send(Chanel_protocol("error", Logger::Level::ERROR, time(nullptr))));
+  assert(ch.receive_wait()->get_level() == Logger::Level::ERROR);
+
+  /* нижняя полоса обслуживается после 4 обходов; порядок внутри уровня сохраняется */
+  std::vector<Logger::Level> order;
+  int next[3]{};
+  while (auto entry = ch.receive_not_wait()) {
+    auto level = static_cast<int>(entry->get_level());
+    auto prefix = level == 0 ? "info " : "warn ";
+    assert(entry->get_message_view() == prefix + std::to_string(next[level]++));
+    order.push_back(entry->get_level());
+  }
+  assert(next[0] == 100 && next[1] == 10 && order.size() == 110);
+  // первая выборка ERROR обошла INFO, затем 3 WARN - всего 4 обхода
+  assert(order[3] == Logger::Level::INFO && order[4] == Logger::Level::WARN);
+  int run = 0;
+  for (auto level : order) {
+    run = level == Logger::Level::INFO ? 0 : run + 1;
+    assert(run <= 4);
+  }
+
+  /* под непрерывной нагрузкой INFO задержка ERROR ограничена */
+  Channel loaded;
+  std::atomic<bool> stop{false};
+  std::thread producer([&] {
+    while (!stop) loaded.send(Chanel_protocol("noise", Logger::Level::INFO, time(nullptr)));
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  assert(loaded.send(Chanel_protocol("urgent", Logger::Level::ERROR, time(nullptr))));
+  int before = 0;
+  for (auto entry = loaded.receive_wait(); entry->get_level() != Logger::Level::ERROR;
+       entry = loaded.receive_wait()) {
+    ++before;
+  }
+  stop = true;
+  producer.join();
+  assert(before <= 1);
+}
+
+void test_parse_writer_options() {
+  char const* valid[] = {"--suppress=30"};
+  auto options = parse_writer_options(1, valid);
+  assert(options && options->suppress_window == 30);
+  assert(parse_writer_options(0, nullptr)->suppress_window == 0);
+  char const* invalid[] = {"--suppress=abc"};
+  assert(!parse_writer_options(1, invalid));
+  char const* policy[] = {"--sample=INFO:10", "--rate=WARN:100:200", "--keep=ERROR"};
+  options = parse_writer_options(3, policy);
+  assert(options && options->rate_policy);
+  assert(options->rate_policy->levels[0].sample == 10);
+  assert(options->rate_policy->levels[1].rate == 100 && options->rate_policy->levels[1].burst == 200);
+  assert(options->rate_policy->levels[2].always_keep);
+  char const* bad_level[] = {"--sample=DEBUG:10"};
+  assert(!parse_writer_options(1, bad_level));
+  char const* unknown[] = {"--unknown=1"};
+  assert(!parse_writer_options(1, unknown));
+
+  assert(parse_writer_options(0, nullptr)->file.durability == Logger::Durability::NONE);
+  char const* sync[] = {"--durability=sync"};
+  assert(parse_writer_options(1, sync)->file.durability == Logger::Durability::SYNC);
+  char const* periodic[] = {"--durability=periodic:250"};
+  options = parse_writer_options(1, periodic);
+  assert(options && options->file.durability == Logger::Durability::PERIODIC);
+  assert(options->file.sync_interval_ms == 250);
+  char const* bad_durability[] = {"--durability=sync:10"};
+  assert(!parse_writer_options(1, bad_durability));
+  char const* bad_interval[] = {"--durability=periodic:0"};
+  assert(!parse_writer_options(1, bad_interval));
+
+  assert(parse_writer_options(0, nullptr)->file.format == Logger::Output_format::TEXT);
+  char const* json[] = {"--format=json"};
+  assert(parse_writer_options(1, json)->file.format == Logger::Output_format::JSON);
+  char const* bad_format[] = {"--format=xml"};
+  assert(!parse_writer_options(1, bad_format));
+  char const* index[] = {"--index=1048576"};
+  assert(parse_writer_options(1, index)->file.index_segment_bytes == 1048576);
+  char const* bad_index[] = {"--index=0"};
+  assert(!parse_writer_options(1, bad_index));
+  assert(parse_writer_options(0, nullptr)->starvation_limit == Channel::default_starvation_limit);
+  char const* starvation[] = {"--starvation=4"};
+  assert(parse_writer_options(1, starvation)->starvation_limit == 4);
+  char const* bad_starvation[] = {"--starvation=0"};
+  assert(!parse_writer_options(1, bad_starvation));
+}
+
+void test_parse_input_config() {
+  std::istringstream config("# вход журнал уровень\n"
+    "/run/a.fifo a.log INFO\n"
+    "\n"
+    "  /var/b.txt a.log ERROR\n");
+  auto inputs = parse_input_config(config);
+  assert(inputs && inputs->size() == 2);
+  assert((*inputs)[1].input == "/var/b.txt" && (*inputs)[1].file == "a.log");
+  assert((*inputs)[1].level == Logger::Level::ERROR);
+  std::istringstream bad_level("/run/a.fifo a.log DEBUG\n");
+  assert(!parse_input_config(bad_level));
+  std::istringstream extra("/run/a.fifo a.log INFO x\n");
+  assert(!parse_input_config(extra));
+  std::istringstream empty("# пусто\n");
+  assert(!parse_input_config(empty));
+  char const* writers[] = {"--writers=3"};
+  assert(parse_writer_options(1, writers)->writers == 3);
+  char const* no_writers[] = {"--writers=0"};
+  assert(!parse_writer_options(1, no_writers));
+}
+
+void test_run_inputs() {
+  const std::string fifo_a{"test_input_a.fifo"}, fifo_b{"test_input_b.fifo"};
+  const std::string text{"test_input_c.txt"}, log_1{"test_inputs_1.log"}, log_2{"test_inputs_2.log"};
+  for (auto& file : {fifo_a, fifo_b, text, log_1, log_2}) std::remove(file.data());
+  assert(!::mkfifo(fifo_a.data(), 0600) && !::mkfifo(fifo_b.data(), 0600));
+  std::ofstream(text) << "c0\nc1\n";
+
+  /* два входа пишут в один журнал, один - в отдельный */
+  std::vector<Input_config> inputs{
+    {fifo_a, log_1, Logger::Level::INFO},
+    {fifo_b, log_2, Logger::Level::WARN},
+    {text, log_1, Logger::Level::ERROR}};
+  Writer_options options;
+  options.writers = 2;
+  std::atomic<bool> stop{false};
+  std::thread reader([&]{ assert(!run_inputs(inputs, options, stop)); });
+
+  constexpr int count = 100;
+  int a = ::open(fifo_a.data(), O_WRONLY), b = ::open(fifo_b.data(), O_WRONLY);
+  assert(a != -1 && b != -1);
+  for (int i = 0; i < count; ++i) {
+    auto line = "a" + std::to_string(i) + "\n";
+    assert(::write(a, line.data(), line.size()) == static_cast<ssize_t>(line.size()));
+    // строка входа b приходит двумя частями
+    line = "b" + std::to_string(i);
+    assert(::write(b, line.data(), 1) == 1);
+    line = line.substr(1) + "\n";
+    assert(::write(b, line.data(), line.size()) == static_cast<ssize_t>(line.size()));
+  }
+  /* писатель FIFO может отключиться, вход продолжает работу */
+  ::close(a);
+  std::ofstream(text, std::ios::app) << "c2\n";
+  assert(::write(b, "tail", 4) == 4);
+  ::close(b);
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while ((read_lines(log_1).size() < count + 3 || read_lines(log_2).size() < count) &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  stop = true;
+  reader.join();
+
+  int next_a = 0, next_c = 0;
+  auto first = read_lines(log_1);
+  assert(first.size() == count + 3);
+  for (const auto& line : first) {
+    if (line[0] == 'a') {
+      assert(line.rfind("a" + std::to_string(next_a++) + " INFO ", 0) == 0);
+    } else {
+      assert(line.rfind("c" + std::to_string(next_c++) + " ERROR ", 0) == 0);
+    }
+  }
+  assert(next_a == count && next_c == 3);
+  /* неполная последняя строка записывается при остановке */
+  auto second = read_lines(log_2);
+  assert(second.size() == count + 1);
+  for (int i = 0; i < count; ++i) {
+    assert(second[i].rfind("b" + std::to_string(i) + " WARN ", 0) == 0);
+  }
+  assert(second.back().rfind("tail WARN ", 0) == 0);
+  for (auto& file : {fifo_a, fifo_b, text, log_1, log_2}) std::remove(file.data());
+}
+
 int main() {
   test_send_receive();
   test_non_blocking_receive();
   test_close_receive();
+  test_receive_wait_for();
+  test_idle_flush();
+  test_priority_lanes();
+  test_parse_writer_options();
+  test_parse_input_config();
+  test_run_inputs();
 }
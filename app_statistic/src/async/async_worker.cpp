@@ -0,0 +1,97 @@
+#include "../statistic_app.hpp"
+#include "async_io.hpp"
+
+namespace {
+  namespace Async = Logger::Async;
+
+  constexpr auto stop_check = std::chrono::milliseconds(100); ///< Период проверки остановки и ретрансляции
+
+  /// Закрывает подключение и при уничтожении кадра вместе с исполнителем
+  struct Socket_guard {
+    int fd;
+    ~Socket_guard() { ::close(fd); }
+  };
+
+  /**
+   * @brief Обработчик подключения: читает кадры, пока клиент не закроет соединение
+   */
+  Async::Task<void> serve(Async::Executor& executor, int fd, bool packet, Statistic_shard& shard,
+      Statistic_context& context) {
+    Socket_guard guard{fd};
+    Connection connection;
+    connection.packet = packet;
+    std::string frame, reply;
+    for (;;) {
+      auto error = co_await Async::read_frame(executor, fd, frame, packet, context.get_max_frame());
+      if (!error) error = handle_frame(connection, frame, shard, context, reply);
+      if (!error && !reply.empty()) error = co_await Async::write_frame(executor, fd, reply, packet);
+      if (error) {
+        context.get_echo().report(error->get_err_message());
+        co_return;
+      }
+    }
+  }
+
+  /// Принимает подключения и запускает обработчик на каждое
+  Async::Task<void> accept_loop(Async::Executor& executor, int listen_fd, bool packet,
+      Statistic_shard& shard, Statistic_context& context, int& result) {
+    for (;;) {
+      auto accepted = co_await Async::accept(executor, listen_fd);
+      if (auto error = std::get_if<Logger::Error>(&accepted)) {
+        context.get_echo().report(error->get_err_message());
+        result = -1;
+        executor.stop();
+        co_return;
+      }
+      executor.spawn(serve(executor, std::get<int>(accepted), packet, shard, context));
+    }
+  }
+
+  /// Останавливает исполнитель вместе с контекстом, отправляет пачки ретрансляции
+  Async::Task<void> watch(Async::Executor& executor, Statistic_shard& shard, Statistic_context& context) {
+    while (!context.is_stopped()) {
+      co_await executor.sleep_for(stop_check);
+      context.relay_tick(shard);
+    }
+    executor.stop();
+  }
+}
+
+/**
+ * @brief Цикл потока-обработчика на сопрограммах.
+ *
+ * @param listen_fd Собственный слушающий сокет обработчика (SO_REUSEPORT)
+ *        или общий сокет UNIX, переводится в неблокирующий режим.
+ * @param shard Шард статистики обработчика.
+ * @param context Общее состояние обработчиков.
+ *
+ * @return Возвращает 0 после остановки контекста или -1 в случае ошибки
+ *
+ * @details
+ * Каждое подключение обслуживает своя сопрограмма на исполнителе epoll
+ * (Logger::Async::Executor) этого потока: ожидание сокета не занимает поток,
+ * тысячи подключений обслуживаются несколькими потоками. Кадры разбираются
+ * так же, как в statistic_worker_run (handle_frame); все сопрограммы
+ * потока пишут в его шард. Незавершённые подключения закрываются при остановке.
+ */
+int statistic_async_run(const int listen_fd, Statistic_shard& shard, Statistic_context& context) {
+  int result = 0;
+  auto created = Async::Executor::create();
+  if (auto error = std::get_if<Logger::Error>(&created)) {
+    context.get_echo().report(error->get_err_message());
+    return -1;
+  }
+  auto executor = std::move(std::get<std::unique_ptr<Async::Executor>>(created));
+  int socket_type = SOCK_STREAM;
+  socklen_t type_size = sizeof(socket_type);
+  ::getsockopt(listen_fd, SOL_SOCKET, SO_TYPE, &socket_type, &type_size);
+  executor->spawn(accept_loop(*executor, listen_fd, socket_type == SOCK_SEQPACKET, shard, context, result));
+  executor->spawn(watch(*executor, shard, context));
+  if (auto error = executor->run()) {
+    context.get_echo().report(error->get_err_message());
+    result = -1;
+  }
+  executor.reset();
+  context.relay_tick(shard, true);
+  return result;
+}
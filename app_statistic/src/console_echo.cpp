@@ -0,0 +1,164 @@
+#include "statistic_app.hpp"
+#include <charconv>
+#include <iostream>
+
+/**
+ * @brief Разбирает режим вывода сообщений на консоль
+ *
+ * @param mode Строка режима:
+ *        - "full" - все сообщения;
+ *        - "level:<LEVEL>" - сообщения с уровнем не ниже LEVEL;
+ *        - "sample:<N>" - каждое N-е сообщение;
+ *        - "none" - только статистика.
+ * @return optional<Echo_config> Конфигурация или пустое значение, если строка некорректна
+ */
+std::optional<Echo_config> parse_echo_config(const std::string& mode) {
+  Echo_config config;
+  if (mode == "full") {
+    config.mode = Echo_mode::FULL;
+  } else if (mode == "none") {
+    config.mode = Echo_mode::NONE;
+  } else if (mode.rfind("level:", 0) == 0) {
+    auto level = Logger::deserialization_level(std::string_view(mode).substr(6));
+    if (!level) return {};
+    config.mode = Echo_mode::LEVEL;
+    config.level = level.value();
+  } else if (mode.rfind("sample:", 0) == 0) {
+    uint64_t sample{};
+    auto end = mode.data() + mode.size();
+    auto result = std::from_chars(mode.data() + 7, end, sample);
+    if (result.ec != std::errc() || result.ptr != end || !sample) return {};
+    config.mode = Echo_mode::SAMPLED;
+    config.sample = sample;
+  } else {
+    return {};
+  }
+  return config;
+}
+
+/**
+ * @brief Создаёт объект вывода и запускает поток вывода
+ * @param os Поток, в который выводятся сообщения
+ * @param config Режим вывода и ёмкость буфера
+ */
+Console_echo::Console_echo(std::ostream& os, const Echo_config& config)
+  : config(config), os(os) {
+  records.reserve(config.capacity);
+  worker = std::thread([this]{ run(); });
+}
+
+/**
+ * @brief Проверяет, должна ли запись выводиться в текущем режиме
+ * @param entry Запись протокола
+ * @return true, если запись выводится
+ */
+bool Console_echo::accept(const Logger::Logger_protocol::Protocol& entry) {
+  switch (config.mode) {
+    case Echo_mode::FULL: return true;
+    case Echo_mode::LEVEL: return entry.get_level() >= config.level;
+    case Echo_mode::SAMPLED:
+      return !(sample_counter.fetch_add(1, std::memory_order_relaxed) % config.sample);
+    case Echo_mode::NONE: return false;
+  }
+  return false;
+}
+
+/**
+ * @brief Передаёт запись в поток вывода без ожидания
+ *
+ * Фильтрация по режиму выполняется до постановки в буфер.
+ * При заполненном буфере запись отбрасывается и учитывается в счётчике
+ *
+ * @param entry Запись протокола, перемещается в буфер
+ * @return true, если запись поставлена в очередь вывода
+ */
+bool Console_echo::echo(Logger::Logger_protocol::Protocol&& entry) {
+  if (!accept(entry)) return false;
+  bool notify{};
+  {
+    std::lock_guard lock(mtx);
+    if (stopped || records.size() >= config.capacity) {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    records.push_back(std::move(entry));
+    notify = waiting;
+  }
+  // будим поток вывода, только если он простаивает
+  if (notify) condvar.notify_one();
+  return true;
+}
+
+/**
+ * @brief Передаёт строку отчёта в поток вывода
+ * @param text Отчёт статистики или сообщение об ошибке
+ */
+void Console_echo::report(std::string&& text) {
+  {
+    std::lock_guard lock(mtx);
+    if (stopped) return;
+    reports.push_back(std::move(text));
+  }
+  condvar.notify_one();
+}
+
+/**
+ * @brief Останавливает поток вывода, дожидаясь вывода накопленных данных
+ */
+void Console_echo::stop() {
+  {
+    std::lock_guard lock(mtx);
+    stopped = true;
+  }
+  condvar.notify_one();
+  if (worker.joinable()) worker.join();
+}
+
+/**
+ * @brief Цикл потока вывода
+ *
+ * Забирает накопленные записи и отчёты целиком, освобождая буфер
+ * для потока приёма, и выводит их без удержания мьютекса.
+ * Записи пачки форматируются в один буфер и выводятся одной записью,
+ * поток сбрасывается один раз на пачку.
+ */
+void Console_echo::run() {
+  std::vector<Logger::Logger_protocol::Protocol> batch;
+  std::vector<std::string> texts;
+  Logger::Logger_protocol::Entry_formatter formatter(config.format);
+  std::string lines; ///< Строки пачки, буфер переиспользуется
+  batch.reserve(config.capacity);
+  uint64_t reported_dropped{};
+  while (true) {
+    {
+      std::unique_lock lock(mtx);
+      waiting = true;
+      condvar.wait(lock, [this]{
+        return !records.empty() || !reports.empty() || stopped;
+      });
+      waiting = false;
+      batch.swap(records);
+      texts.swap(reports);
+      if (stopped && batch.empty() && texts.empty()) break;
+    }
+    lines.clear();
+    for (const auto& entry : batch) {
+      formatter.format(lines, entry);
+      lines.push_back('\n');
+    }
+    os.write(lines.data(), static_cast<std::streamsize>(lines.size()));
+    batch.clear();
+    if (auto count = get_dropped(); count != reported_dropped) {
+      os << "echo dropped: " << count - reported_dropped << '\n';
+      reported_dropped = count;
+    }
+    for (const auto& text : texts) {
+      os << text << '\n';
+    }
+    texts.clear();
+    os.flush();
+  }
+  if (auto count = get_dropped(); count != reported_dropped) {
+    os << "echo dropped: " << count - reported_dropped << std::endl;
+  }
+}
@@ -0,0 +1,289 @@
+#include "statistic_app.hpp"
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace {
+  constexpr std::size_t stamp_size = 19; ///< "YYYY-MM-DD HH:MM:SS"
+  constexpr std::size_t fraction_digits = 9; ///< Наибольшая длина дробной части секунды
+
+  /// Количество дней от 1970-01-01 по григорианскому календарю
+  int64_t days_from_civil(int64_t year, unsigned month, unsigned day) {
+    year -= month <= 2;
+    const int64_t era = (year >= 0 ? year : year - 399) / 400;
+    const unsigned year_of_era = static_cast<unsigned>(year - era * 400);
+    const unsigned day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const unsigned day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + static_cast<int64_t>(day_of_era) - 719468;
+  }
+
+  /// Читает count десятичных цифр
+  bool parse_digits(const char* text, int count, int& value) {
+    value = 0;
+    for (int i = 0; i < count; ++i) {
+      unsigned digit = static_cast<unsigned char>(text[i]) - '0';
+      if (digit > 9) return false;
+      value = value * 10 + static_cast<int>(digit);
+    }
+    return true;
+  }
+
+  /**
+   * @brief Отображённый в память файл, освобождается при разрушении
+   */
+  struct Mapped_file {
+    void* data = MAP_FAILED;
+    std::size_t size{};
+    Mapped_file() = default;
+    Mapped_file(Mapped_file&& other) noexcept : data(other.data), size(other.size) {
+      other.data = MAP_FAILED;
+    }
+    Mapped_file(const Mapped_file&) = delete;
+    ~Mapped_file() {
+      if (data != MAP_FAILED) ::munmap(data, size);
+    }
+  };
+
+  /// Результат потока разбора
+  struct Worker_result {
+    Statistic stats;
+    uint64_t lines{}, skipped{}, filtered{}, blocks{};
+  };
+}
+
+/**
+ * @brief Разбирает строку, записанную File_logging
+ *
+ * @param line Строка без перевода строки
+ * @return optional<Line> Уровень, длина сообщения и время, либо пустое значение
+ */
+std::optional<Log_line_parser::Line> Log_line_parser::parse(std::string_view line) {
+  if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+  auto dot = line.find_last_not_of("0123456789");
+  long nanoseconds = 0;
+  if (dot != std::string_view::npos && line[dot] == '.' && dot + 1 < line.size() &&
+      line.size() - dot - 1 <= fraction_digits) {
+    for (std::size_t i = dot + 1; i < dot + 1 + fraction_digits; ++i) {
+      nanoseconds = nanoseconds * 10 + (i < line.size() ? line[i] - '0' : 0);
+    }
+    line = line.substr(0, dot);
+  }
+  if (line.size() < stamp_size + 2 || line[line.size() - stamp_size - 1] != ' ') return {};
+  const char* stamp = line.data() + line.size() - stamp_size;
+  int year, month, day, hour, minute, second;
+  if (!parse_digits(stamp, 4, year) || stamp[4] != '-' ||
+      !parse_digits(stamp + 5, 2, month) || stamp[7] != '-' ||
+      !parse_digits(stamp + 8, 2, day) || stamp[10] != ' ' ||
+      !parse_digits(stamp + 11, 2, hour) || stamp[13] != ':' ||
+      !parse_digits(stamp + 14, 2, minute) || stamp[16] != ':' ||
+      !parse_digits(stamp + 17, 2, second) ||
+      month < 1 || month > 12 || day < 1 || day > 31) {
+    return {};
+  }
+  auto rest = line.substr(0, line.size() - stamp_size - 1);
+  auto space = rest.rfind(' ');
+  if (space == std::string_view::npos) return {};
+  auto level = Logger::deserialization_level(rest.substr(space + 1));
+  if (!level) return {};
+
+  time_t local = static_cast<time_t>(days_from_civil(year, month, day) * 86400 +
+    hour * 3600 + minute * 60 + second);
+  time_t hour_start = local - (minute * 60 + second);
+  if (hour_start != cached_hour) {
+    // смещение пояса (с учётом летнего времени) постоянно в пределах часа
+    tm fields{};
+    fields.tm_year = year - 1900;
+    fields.tm_mon = month - 1;
+    fields.tm_mday = day;
+    fields.tm_hour = hour;
+    fields.tm_isdst = -1;
+    time_t utc = std::mktime(&fields);
+    cached_hour = hour_start;
+    cached_offset = utc == -1 ? 0 : hour_start - utc;
+  }
+  return Line{level.value(), space, local - cached_offset, nanoseconds};
+}
+
+/**
+ * @brief Считает статистику по файлам журнала и архивам параллельно
+ *
+ * Текстовые файлы отображаются в память и делятся на куски около chunk_bytes
+ * по границам строк. Архивы (Logger::Archive) делятся на блоки: блоки вне
+ * интервала пропускаются по заголовку, из остальных читаются только столбцы
+ * времени, уровня и длины. Потоки забирают куски и блоки по одному
+ * и разбирают их в собственный шард Statistic, шарды объединяются в конце.
+ *
+ * @param files Пути к файлам, записанным File_logging, или к архивам
+ * @param threads Количество потоков разбора
+ * @param chunk_bytes Размер куска
+ * @param range Учитываются только записи с временем в интервале
+ * @return variant<File_analysis, Error> Результат или ошибка открытия файла
+ */
+std::variant<File_analysis, Error>
+analyze_log_files(const std::vector<std::string>& files, std::size_t threads, std::size_t chunk_bytes,
+    const Time_range& range) {
+  std::vector<Mapped_file> mapped;
+  std::vector<std::string_view> chunks;
+  std::vector<std::unique_ptr<Logger::Archive::Reader>> archives;
+  std::vector<std::pair<const Logger::Archive::Reader*, const Logger::Archive::Block_info*>> blocks;
+  File_analysis analysis;
+  // границы интервала в наносекундах для заголовков блоков
+  auto from = range.from == std::numeric_limits<time_t>::min() ? Logger::Timestamp::min() :
+    Logger::Clock::from_seconds(range.from);
+  auto to = range.to == std::numeric_limits<time_t>::max() ? Logger::Timestamp::max() :
+    Logger::Clock::from_seconds(range.to) + std::chrono::seconds(1) - Logger::Timestamp(1);
+  for (const auto& file : files) {
+    int fd = ::open(file.data(), O_RDONLY);
+    if (fd == -1) return Error(Error_code::ERROR, file + ": " + strerror(errno));
+    struct stat info{};
+    if (::fstat(fd, &info)) {
+      Error error(Error_code::ERROR, file + ": " + strerror(errno));
+      ::close(fd);
+      return error;
+    }
+    Mapped_file map;
+    map.size = static_cast<std::size_t>(info.st_size);
+    if (map.size) {
+      map.data = ::mmap(nullptr, map.size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    ::close(fd);
+    if (!map.size) continue;
+    if (map.data == MAP_FAILED) return Error(Error_code::ERROR, file + ": " + strerror(errno));
+    std::string_view content(static_cast<const char*>(map.data), map.size);
+    analysis.bytes += map.size;
+    if (Logger::Archive::Reader::is_archive(content)) {
+      auto opened = Logger::Archive::Reader::open(file);
+      if (auto error = std::get_if<Logger::Error>(&opened)) {
+        return Error(Error_code::ERROR, error->get_err_message());
+      }
+      archives.push_back(std::move(std::get<std::unique_ptr<Logger::Archive::Reader>>(opened)));
+      for (const auto& block : archives.back()->blocks()) {
+        if (block.overlaps(from, to)) {
+          blocks.emplace_back(archives.back().get(), &block);
+        } else {
+          ++analysis.skipped_blocks;
+        }
+      }
+      continue;
+    }
+    ::madvise(map.data, map.size, MADV_SEQUENTIAL);
+    for (std::size_t position = 0; position < content.size();) {
+      auto end = std::min(position + std::max<std::size_t>(chunk_bytes, 1), content.size());
+      if (end < content.size()) {
+        auto newline = content.find('\n', end - 1);
+        end = newline == std::string_view::npos ? content.size() : newline + 1;
+      }
+      chunks.push_back(content.substr(position, end - position));
+      position = end;
+    }
+    mapped.push_back(std::move(map));
+  }
+
+  auto items = chunks.size() + blocks.size();
+  threads = std::max<std::size_t>(1, std::min(threads, items));
+  std::vector<Worker_result> results(threads);
+  std::vector<std::optional<Logger::Error>> errors(threads);
+  std::atomic<std::size_t> next_item{0};
+  auto work = [&](Worker_result& result, std::optional<Logger::Error>& error) {
+    Log_line_parser parser;
+    Logger::Archive::Block block;
+    for (std::size_t index; (index = next_item.fetch_add(1)) < items && !error;) {
+      if (index >= chunks.size()) {
+        auto [reader, info] = blocks[index - chunks.size()];
+        error = reader->read(*info, Logger::Archive::TIME | Logger::Archive::LEVEL |
+          Logger::Archive::LENGTH, block);
+        for (uint32_t i = 0; !error && i < info->count; ++i) {
+          auto time = static_cast<time_t>(
+            std::chrono::floor<std::chrono::seconds>(block.times[i]).count());
+          if (!range.contains(time)) {
+            ++result.filtered;
+            continue;
+          }
+          result.stats.update(block.levels[i], block.lengths[i], time);
+          ++result.lines;
+        }
+        ++result.blocks;
+        continue;
+      }
+      auto chunk = chunks[index];
+      while (!chunk.empty()) {
+        auto newline = chunk.find('\n');
+        auto line = chunk.substr(0, newline);
+        chunk.remove_prefix(newline == std::string_view::npos ? chunk.size() : newline + 1);
+        if (line.empty()) continue;
+        if (auto parsed = parser.parse(line)) {
+          if (!range.contains(parsed->time)) {
+            ++result.filtered;
+            continue;
+          }
+          result.stats.update(parsed->level, parsed->length, parsed->time);
+          ++result.lines;
+        } else {
+          ++result.skipped;
+        }
+      }
+    }
+  };
+  std::vector<std::thread> workers;
+  for (std::size_t i = 1; i < threads; ++i) {
+    workers.emplace_back(work, std::ref(results[i]), std::ref(errors[i]));
+  }
+  work(results[0], errors[0]);
+  for (auto& worker : workers) worker.join();
+  for (auto& error : errors) {
+    if (error) return Error(Error_code::ERROR, error->get_err_message());
+  }
+  for (const auto& result : results) {
+    analysis.stats.merge(result.stats);
+    analysis.lines += result.lines;
+    analysis.skipped += result.skipped;
+    analysis.filtered += result.filtered;
+    analysis.blocks += result.blocks;
+  }
+  return analysis;
+}
+
+/**
+ * @brief Преобразует закрытый журнал File_logging в столбцовый архив
+ *
+ * Строки не в формате print_log_entry пропускаются. Время восстанавливается
+ * с точностью записи (секунды и дробная часть, если она была)
+ * @param log_file Журнал в формате Output_format::TEXT
+ * @param archive_file Путь к архиву, появляется после успешного завершения
+ * @param options Размер блока архива
+ * @return variant<Archive_conversion, Error> Счётчики или ошибка чтения/записи
+ */
+std::variant<Archive_conversion, Error>
+convert_log_file(const std::string& log_file, const std::string& archive_file,
+    const Logger::Archive::Writer_options& options) {
+  std::ifstream input(log_file, std::ios::binary);
+  if (!input.is_open()) return Error(Error_code::ERROR, log_file + ": " + strerror(errno));
+  auto created = Logger::Archive::Writer::create(archive_file, options);
+  if (auto error = std::get_if<Logger::Error>(&created)) {
+    return Error(Error_code::ERROR, error->get_err_message());
+  }
+  auto& writer = std::get<std::unique_ptr<Logger::Archive::Writer>>(created);
+  Archive_conversion conversion;
+  Log_line_parser parser;
+  for (std::string line; std::getline(input, line);) {
+    conversion.bytes += line.size() + 1;
+    if (line.empty()) continue;
+    auto parsed = parser.parse(line);
+    if (!parsed) {
+      ++conversion.skipped;
+      continue;
+    }
+    Logger::Logger_protocol::Protocol entry(std::string_view(line).substr(0, parsed->length),
+      parsed->level, Logger::Clock::from_seconds(parsed->time) + Logger::Timestamp(parsed->nanoseconds));
+    if (auto error = writer->write(entry)) return Error(Error_code::ERROR, error->get_err_message());
+    ++conversion.lines;
+  }
+  if (input.bad()) return Error(Error_code::ERROR, log_file + ": " + strerror(errno));
+  if (auto error = writer->close()) return Error(Error_code::ERROR, error->get_err_message());
+  conversion.archive_bytes = writer->get_bytes();
+  conversion.blocks = writer->get_blocks();
+  return conversion;
+}
@@ -0,0 +1,151 @@
+#include "statistic_app.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+namespace {
+  namespace Token_index = Logger::Token_index;
+
+  constexpr std::size_t read_bytes = 4u << 20; ///< Размер чтения участка журнала
+
+  /**
+   * @brief Токены запроса: строка совпадает, если содержит их все
+   */
+  struct Query {
+    std::vector<std::string> tokens;
+    std::vector<uint64_t> hashes;
+    std::size_t longest{}; ///< Индекс самого длинного токена для предварительной проверки
+    std::vector<char> found; ///< Найденные в текущей строке токены
+
+    /// Сегмент может содержать все токены запроса
+    bool may_match(const Token_index::Bloom_filter& filter) const {
+      return std::all_of(hashes.begin(), hashes.end(),
+        [&filter](uint64_t hash) { return filter.may_contain(hash); });
+    }
+
+    bool matches(std::string_view line) {
+      if (line.find(tokens[longest]) == std::string_view::npos) return false;
+      std::fill(found.begin(), found.end(), 0);
+      std::size_t remaining = tokens.size();
+      Token_index::for_each_token(line, [&](std::string_view token) {
+        for (std::size_t i = 0; i < tokens.size(); ++i) {
+          if (!found[i] && tokens[i] == token) {
+            found[i] = 1;
+            --remaining;
+          }
+        }
+      });
+      return !remaining;
+    }
+  };
+
+  /**
+   * @brief Читает участок журнала [begin, end) и передаёт строки, совпавшие с запросом
+   *
+   * Участок читается pread частями по read_bytes, неполная строка
+   * в конце части переносится в следующую
+   */
+  std::optional<Error> scan_range(int fd, uint64_t begin, uint64_t end, const std::string& file,
+      Query& query, std::string& buffer, Log_search& search, const Search_callback& on_match) {
+    std::size_t carry = 0;
+    while (begin < end) {
+      auto chunk = static_cast<std::size_t>(std::min<uint64_t>(read_bytes, end - begin));
+      buffer.resize(carry + chunk);
+      auto got = ::pread(fd, buffer.data() + carry, chunk, static_cast<off_t>(begin));
+      if (got == -1) {
+        if (errno == EINTR) continue;
+        return Error(Error_code::ERROR, file + ": " + strerror(errno));
+      }
+      if (got == 0) break; // журнал усечён во время поиска
+      begin += static_cast<uint64_t>(got);
+      search.bytes_read += static_cast<uint64_t>(got);
+      std::string_view data(buffer.data(), carry + static_cast<std::size_t>(got));
+      for (auto newline = data.find('\n'); newline != std::string_view::npos; newline = data.find('\n')) {
+        auto line = data.substr(0, newline);
+        if (query.matches(line)) {
+          ++search.matches;
+          on_match(file, line);
+        }
+        data.remove_prefix(newline + 1);
+      }
+      carry = data.size();
+      std::memmove(buffer.data(), data.data(), carry);
+    }
+    if (carry && query.matches(std::string_view(buffer.data(), carry))) {
+      ++search.matches;
+      on_match(file, std::string_view(buffer.data(), carry));
+    }
+    return {};
+  }
+}
+
+/**
+ * @brief Ищет строки журналов, содержащие все токены запроса
+ *
+ * Сегменты индекса "<журнал>.idx", фильтры которых не содержат хотя бы
+ * одного токена, не читаются. Сегменты должны идти подряд по возрастанию
+ * и не выходить за конец журнала, остальные не учитываются; участки
+ * без сегмента (журнал без индекса, хвост после сбоя) читаются целиком.
+ * Токены - как в Token_index::for_each_token, регистр учитывается
+ * @param files Журналы File_logging
+ * @param query Запрос, например "id_1234 ERROR"
+ * @param on_match Получает найденные строки в порядке журнала
+ * @return variant<Log_search, Error> Счётчики или ошибка чтения либо пустой запрос
+ */
+std::variant<Log_search, Error>
+search_log_files(const std::vector<std::string>& files, std::string_view query_text,
+    const Search_callback& on_match) {
+  Query query;
+  Token_index::for_each_token(query_text, [&query](std::string_view token) {
+    if (std::find(query.tokens.begin(), query.tokens.end(), token) != query.tokens.end()) return;
+    query.tokens.emplace_back(token);
+    query.hashes.push_back(Token_index::hash_token(token));
+    if (token.size() > query.tokens[query.longest].size()) query.longest = query.tokens.size() - 1;
+  });
+  if (query.tokens.empty()) return Error(Error_code::ERROR, "search query has no tokens");
+  query.found.resize(query.tokens.size());
+
+  Log_search search;
+  std::string buffer;
+  for (const auto& file : files) {
+    int fd = ::open(file.data(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) return Error(Error_code::ERROR, file + ": " + strerror(errno));
+    struct stat status{};
+    if (::fstat(fd, &status)) {
+      ::close(fd);
+      return Error(Error_code::ERROR, file + ": " + strerror(errno));
+    }
+    auto size = static_cast<uint64_t>(status.st_size);
+    search.bytes += size;
+    std::vector<Token_index::Segment> segments;
+    if (auto index = Token_index::read_index(Token_index::index_path(file));
+        auto list = std::get_if<std::vector<Token_index::Segment>>(&index)) {
+      segments = std::move(*list);
+    }
+    uint64_t position = 0;
+    std::optional<Error> error;
+    for (const auto& segment : segments) {
+      auto end = segment.offset + segment.length;
+      if (segment.offset < position || end > size || end < segment.offset) continue;
+      ++search.segments;
+      if (position < segment.offset) {
+        error = scan_range(fd, position, segment.offset, file, query, buffer, search, on_match);
+        if (error) break;
+      }
+      if (query.may_match(segment.filter)) {
+        error = scan_range(fd, segment.offset, end, file, query, buffer, search, on_match);
+        if (error) break;
+      } else {
+        ++search.skipped_segments;
+      }
+      position = end;
+    }
+    if (!error && position < size) {
+      error = scan_range(fd, position, size, file, query, buffer, search, on_match);
+    }
+    ::close(fd);
+    if (error) return *error;
+  }
+  return search;
+}
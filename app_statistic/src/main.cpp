@@ -1,10 +1,154 @@
 #include "statistic_app.hpp"
+#include <charconv>
+#include <cstring>
 #include <chrono>
 #include <iostream>
+#include <fcntl.h>
 
-int main(const int argc, char const *argv[]) {
+/// Разбирает целое число значения параметра "--<имя>=<число>"
+template<typename T>
+static bool parse_option_number(const std::string& option, std::size_t prefix, T& value) {
+  auto end = option.data() + option.size();
+  auto result = std::from_chars(option.data() + prefix, end, value);
+  return result.ec == std::errc() && result.ptr == end;
+}
+
+/**
+ * @brief Режим разбора файлов:
+ *        statistic_app --analyze [--threads=<N>] [--from=<сек>] [--to=<сек>] <файл или архив>...
+ */
+static int analyze_main(const int argc, char const *argv[]) {
+  std::size_t threads = std::max(1u, std::thread::hardware_concurrency());
+  Time_range range;
+  std::vector<std::string> files;
+  for (int i = 2; i < argc; ++i) {
+    std::string option(argv[i]);
+    if (option.rfind("--threads=", 0) == 0) {
+      if (!parse_option_number(option, 10, threads) || !threads) {
+        std::cerr << "invalid threads: " << option << std::endl;
+        return EXIT_FAILURE;
+      }
+    } else if (option.rfind("--from=", 0) == 0) {
+      if (!parse_option_number(option, 7, range.from)) {
+        std::cerr << "invalid from: " << option << std::endl;
+        return EXIT_FAILURE;
+      }
+    } else if (option.rfind("--to=", 0) == 0) {
+      if (!parse_option_number(option, 5, range.to)) {
+        std::cerr << "invalid to: " << option << std::endl;
+        return EXIT_FAILURE;
+      }
+    } else {
+      files.push_back(std::move(option));
+    }
+  }
+  if (files.empty()) {
+    std::cerr << "using --analyze [--threads=<N>] [--from=<sec>] [--to=<sec>] <log file or archive>..."
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+  auto start = std::chrono::steady_clock::now();
+  auto result = analyze_log_files(files, threads, 8u << 20, range);
+  if (auto error = std::get_if<Error>(&result)) {
+    std::cerr << error->get_err_message() << std::endl;
+    return EXIT_FAILURE;
+  }
+  auto& analysis = std::get<File_analysis>(result);
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  analysis.stats.statistic_display(std::cout) << '\n';
+  std::cout << "lines: " << analysis.lines << " skipped: " << analysis.skipped <<
+    " filtered: " << analysis.filtered << " blocks: " << analysis.blocks <<
+    " skipped blocks: " << analysis.skipped_blocks <<
+    " bytes: " << analysis.bytes << " seconds: " << elapsed.count() << std::endl;
+  return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Режим архивации: statistic_app --archive [--block=<записей>] <журнал> <архив>
+ */
+static int archive_main(const int argc, char const *argv[]) {
+  Logger::Archive::Writer_options options;
+  std::vector<std::string> paths;
+  for (int i = 2; i < argc; ++i) {
+    std::string option(argv[i]);
+    if (option.rfind("--block=", 0) == 0) {
+      if (!parse_option_number(option, 8, options.block_records) || !options.block_records) {
+        std::cerr << "invalid block: " << option << std::endl;
+        return EXIT_FAILURE;
+      }
+    } else {
+      paths.push_back(std::move(option));
+    }
+  }
+  if (paths.size() != 2) {
+    std::cerr << "using --archive [--block=<records>] <log file> <archive>" << std::endl;
+    return EXIT_FAILURE;
+  }
+  auto result = convert_log_file(paths[0], paths[1], options);
+  if (auto error = std::get_if<Error>(&result)) {
+    std::cerr << error->get_err_message() << std::endl;
+    return EXIT_FAILURE;
+  }
+  auto& conversion = std::get<Archive_conversion>(result);
+  std::cout << "lines: " << conversion.lines << " skipped: " << conversion.skipped <<
+    " bytes: " << conversion.bytes << " archive bytes: " << conversion.archive_bytes <<
+    " blocks: " << conversion.blocks << std::endl;
+  return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Режим поиска: statistic_app --search "<токены>" <журнал>...
+ *
+ * Найденные строки выводятся в stdout (с путём журнала, если журналов
+ * несколько), счётчики сегментов и прочитанных байт - в stderr
+ */
+static int search_main(const int argc, char const *argv[]) {
   if (argc < 4) {
-    std::cerr << "using <host> <port> <interval count message> <interval time sec>" << std::endl;
+    std::cerr << "using --search \"<tokens>\" <log file>..." << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::vector<std::string> files(argv + 3, argv + argc);
+  bool prefix = files.size() > 1;
+  auto start = std::chrono::steady_clock::now();
+  auto result = search_log_files(files, argv[2], [prefix](const std::string& file, std::string_view line) {
+    if (prefix) std::cout << file << ':';
+    std::cout << line << '\n';
+  });
+  if (auto error = std::get_if<Error>(&result)) {
+    std::cerr << error->get_err_message() << std::endl;
+    return EXIT_FAILURE;
+  }
+  auto& search = std::get<Log_search>(result);
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  std::cout.flush();
+  std::cerr << "matches: " << search.matches << " segments: " << search.segments <<
+    " skipped segments: " << search.skipped_segments << " bytes: " << search.bytes <<
+    " bytes read: " << search.bytes_read << " seconds: " << elapsed.count() << std::endl;
+  return EXIT_SUCCESS;
+}
+
+int main(const int argc, char const *argv[]) {
+  if (argc > 1 && std::string_view(argv[1]) == "--analyze") {
+    return analyze_main(argc, argv);
+  }
+  if (argc > 1 && std::string_view(argv[1]) == "--archive") {
+    return archive_main(argc, argv);
+  }
+  if (argc > 1 && std::string_view(argv[1]) == "--search") {
+    return search_main(argc, argv);
+  }
+  if (argc < 5) {
+    std::cerr << "using --analyze [--threads=<N>] [--from=<sec>] [--to=<sec>] <log file or archive>...\n"
+      "using --archive [--block=<records>] <log file> <archive>\n"
+      "using --search \"<tokens>\" <log file>...\n"
+      "using <host> <port> (or <socket path> -) <interval count message> <interval time sec>"
+      " [--echo=full|none|level:<LEVEL>|sample:<N>] [--format=text|json|logfmt]"
+      " [--stats=<host>:<port>|<socket path>]"
+      " [--workers=<N>] [--seqpacket] [--ring=<name>] [--max-frame=<bytes>]"
+#ifdef STATISTIC_ASYNC
+      " [--async]"
+#endif
+      " [--upstream=<host>:<port>|<socket path> [--relay=records|partials[:<ms>]]]" << std::endl;
     return EXIT_FAILURE;
   }
   std::string host(argv[1]);
@@ -14,14 +158,158 @@ int main(const int argc, char const *argv[]) {
   if (interval_count_message < 1 || interval_time < 1) {
     return EXIT_FAILURE;
   }
-  auto server = init_listen_server(host, port);
-  if (auto error = std::get_if<Error>(&server)) {
-    std::cerr << error->get_err_message() << std::endl;
-    return EXIT_FAILURE;
+  Echo_config echo_config;
+  std::optional<Logger::Output_format> format_option;
+  std::string stats_address;
+  std::size_t workers = 1;
+  int unix_type = SOCK_STREAM;
+  std::string ring_name;
+  std::string upstream, relay_mode;
+  std::size_t max_frame = Logger::Transport::max_frame_size;
+#ifdef STATISTIC_ASYNC
+  bool async = false;
+#endif
+  for (int i = 5; i < argc; ++i) {
+    std::string option(argv[i]);
+    if (option.rfind("--echo=", 0) == 0) {
+      auto config = parse_echo_config(option.substr(7));
+      if (!config) {
+        std::cerr << "invalid echo mode: " << option << std::endl;
+        return EXIT_FAILURE;
+      }
+      echo_config = config.value();
+    } else if (option.rfind("--format=", 0) == 0) {
+      auto format = Logger::parse_output_format(std::string_view(option).substr(9));
+      if (!format) {
+        std::cerr << "invalid format: " << option << std::endl;
+        return EXIT_FAILURE;
+      }
+      format_option = format.value();
+    } else if (option.rfind("--stats=", 0) == 0) {
+      stats_address = option.substr(8);
+    } else if (option.rfind("--workers=", 0) == 0) {
+      auto end = option.data() + option.size();
+      auto result = std::from_chars(option.data() + 10, end, workers);
+      if (result.ec != std::errc() || result.ptr != end || !workers) {
+        std::cerr << "invalid workers: " << option << std::endl;
+        return EXIT_FAILURE;
+      }
+    } else if (option.rfind("--max-frame=", 0) == 0) {
+      if (!parse_option_number(option, 12, max_frame) || !max_frame) {
+        std::cerr << "invalid max frame: " << option << std::endl;
+        return EXIT_FAILURE;
+      }
+    } else if (option.rfind("--ring=", 0) == 0) {
+      ring_name = option.substr(7);
+    } else if (option.rfind("--upstream=", 0) == 0) {
+      upstream = option.substr(11);
+    } else if (option.rfind("--relay=", 0) == 0) {
+      relay_mode = option.substr(8);
+    } else if (option == "--seqpacket") {
+      unix_type = SOCK_SEQPACKET;
+#ifdef STATISTIC_ASYNC
+    } else if (option == "--async") {
+      async = true;
+#endif
+    } else {
+      std::cerr << "unknown option: " << option << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  std::optional<Relay_config> relay;
+  if (!upstream.empty() || !relay_mode.empty()) {
+    relay = parse_relay_config(upstream, relay_mode);
+    if (!relay) {
+      std::cerr << "invalid relay: --upstream=" << upstream << " --relay=" << relay_mode << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  /* у каждого обработчика свой слушающий сокет,
+     при нескольких обработчиках ядро распределяет подключения (SO_REUSEPORT) */
+  std::vector<int> listen_fds;
+  auto close_all = [&listen_fds]{
+    for (int fd : listen_fds) close(fd);
+  };
+  if (host.find('/') != std::string::npos) {
+    /* сокет домена UNIX: SO_REUSEPORT не поддерживается, обработчики делят
+       один неблокирующий слушающий сокет (копии дескриптора) */
+    auto server = init_listen_unix(host, unix_type);
+    if (auto error = std::get_if<Error>(&server)) {
+      std::cerr << error->get_err_message() << std::endl;
+      return EXIT_FAILURE;
+    }
+    int fd = std::get<int>(server);
+    if (workers > 1) ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+    listen_fds.push_back(fd);
+    for (std::size_t i = 1; i < workers; ++i) {
+      int copy = ::dup(fd);
+      if (copy == -1) {
+        std::cerr << "dup: " << strerror(errno) << std::endl;
+        close_all();
+        return EXIT_FAILURE;
+      }
+      listen_fds.push_back(copy);
+    }
+  }
+  for (std::size_t i = listen_fds.size(); i < workers; ++i) {
+    auto server = init_listen_server(host, port, workers > 1);
+    if (auto error = std::get_if<Error>(&server)) {
+      std::cerr << error->get_err_message() << std::endl;
+      close_all();
+      return EXIT_FAILURE;
+    }
+    listen_fds.push_back(std::get<int>(server));
   }
-  int fd = std::get<int>(server);
 
-  statistic_app_run(fd, std::chrono::seconds(interval_time), interval_count_message);
-  close(fd);
+  std::vector<Statistic_input> inputs;
+  std::vector<int> poll_fds = listen_fds;
+#ifdef STATISTIC_ASYNC
+  if (async) {
+    /* обработчики на сопрограммах: подключения потока обслуживает исполнитель epoll */
+    poll_fds.clear();
+    for (int fd : listen_fds) {
+      inputs.push_back([fd](Statistic_shard& shard, Statistic_context& context) {
+        return statistic_async_run(fd, shard, context);
+      });
+    }
+  }
+#endif
+
+  /* кольцо в разделяемой памяти читается отдельным потоком со своим шардом */
+  std::unique_ptr<Logger::Shared_ring> ring;
+  if (!ring_name.empty()) {
+    Logger::Ring_options ring_options;
+    ring_options.name = ring_name;
+    auto opened = Logger::Shared_ring::open(ring_options, true);
+    if (auto error = std::get_if<Logger::Error>(&opened)) {
+      std::cerr << error->get_err_message() << std::endl;
+      close_all();
+      return EXIT_FAILURE;
+    }
+    ring = std::move(std::get<std::unique_ptr<Logger::Shared_ring>>(opened));
+    inputs.push_back([&ring](Statistic_shard& shard, Statistic_context& context) {
+      return statistic_ring_run(*ring, shard, context);
+    });
+  }
+
+  // --echo заменяет настройки целиком, формат применяется после разбора всех параметров
+  if (format_option) echo_config.format = *format_option;
+  Console_echo echo(std::cout, echo_config);
+  Statistic_context context(poll_fds.size() + inputs.size(), echo, interval_count_message);
+  if (relay) context.set_relay(relay.value());
+  context.set_max_frame(max_frame);
+  std::unique_ptr<Stats_endpoint> endpoint;
+  if (!stats_address.empty()) {
+    auto stats_server = init_listen_address(stats_address);
+    if (auto error = std::get_if<Error>(&stats_server)) {
+      std::cerr << error->get_err_message() << std::endl;
+      close_all();
+      return EXIT_FAILURE;
+    }
+    endpoint = std::make_unique<Stats_endpoint>(std::get<int>(stats_server),
+      [&context]{ return context.snapshot_data(); });
+  }
+  statistic_app_run(poll_fds, std::chrono::seconds(interval_time), context, inputs);
+  close_all();
   return EXIT_SUCCESS;
 }
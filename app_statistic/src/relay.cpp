@@ -0,0 +1,217 @@
+#include "statistic_app.hpp"
+#include <charconv>
+#include <poll.h>
+
+namespace {
+  constexpr int handshake_timeout_ms = 1000;
+  constexpr int connect_timeout_ms = 1000;
+  constexpr int send_timeout_ms = 1000;
+  constexpr std::size_t relay_batch_bytes = 64 * 1024;
+  constexpr std::size_t relay_chunk_bytes = 64 * 1024;
+
+  /// Разделяет адрес "<ip>:<port>" или путь к сокету UNIX на хост и порт
+  bool split_address(const std::string& address, std::string& host, std::string& port) {
+    if (address.find('/') != std::string::npos) {
+      host = address;
+      port.clear();
+      return true;
+    }
+    auto position = address.rfind(':');
+    if (position == std::string::npos || !position || position + 1 == address.size()) return false;
+    host = address.substr(0, position);
+    port = address.substr(position + 1);
+    return true;
+  }
+}
+
+/**
+ * @brief Разбирает настройки ретрансляции
+ * @param upstream Адрес вышестоящего statistic_app: "<ip>:<port>" или путь к сокету UNIX
+ * @param mode "records" или "partials", необязательно ":<интервал мс>"
+ * @return optional<Relay_config> Настройки или пустое значение при ошибке
+ */
+std::optional<Relay_config> parse_relay_config(const std::string& upstream, const std::string& mode) {
+  Relay_config config;
+  std::string host, port;
+  if (!split_address(upstream, host, port)) return {};
+  config.upstream = upstream;
+  std::string_view name = mode, interval;
+  if (auto position = name.find(':'); position != std::string_view::npos) {
+    interval = name.substr(position + 1);
+    name = name.substr(0, position);
+  }
+  if (name.empty() || name == "records") {
+    config.mode = Relay_mode::RECORDS;
+  } else if (name == "partials") {
+    config.mode = Relay_mode::PARTIALS;
+  } else {
+    return {};
+  }
+  if (!interval.empty()) {
+    long milliseconds{};
+    auto end = interval.data() + interval.size();
+    auto result = std::from_chars(interval.data(), end, milliseconds);
+    if (result.ec != std::errc() || result.ptr != end || milliseconds <= 0) return {};
+    config.interval = std::chrono::milliseconds(milliseconds);
+  }
+  return config;
+}
+
+/**
+ * @brief Создаёт соединение без подключения
+ * @param upstream Адрес в формате parse_relay_config
+ */
+Relay_link::Relay_link(const std::string& upstream) {
+  split_address(upstream, host, port);
+}
+
+/**
+ * @brief Подключается и согласует кадры с типом
+ *
+ * Подключение, согласование и отправка ограничены по времени: недоступный
+ * или переставший читать вышестоящий сервер не останавливает поток отчётов
+ * @return optional<Error> Ошибка подключения, либо вышестоящий сервер не поддерживает согласование
+ */
+std::optional<Error> Relay_link::connect() {
+  auto connected = Logger::Socket::socket_connect(host, port, false, connect_timeout_ms);
+  if (auto error = std::get_if<Logger::Error>(&connected)) {
+    return Error(Error_code::ERROR, error->get_err_message());
+  }
+  fd = std::get<int>(connected);
+  if (auto error = Logger::Socket::set_send_timeout(fd, send_timeout_ms)) {
+    disconnect();
+    return Error(Error_code::ERROR, error->get_err_message());
+  }
+  auto sent = Logger::Socket::socket_write(fd, Logger::Transport::make_handshake("hello", {}));
+  pollfd pfd{fd, POLLIN, 0};
+  if (std::holds_alternative<Logger::Error>(sent) ||
+      ::poll(&pfd, 1, handshake_timeout_ms) <= 0 ||
+      Logger::Socket::socket_read(fd, frame) ||
+      !Logger::Transport::parse_handshake(frame, "welcome")) {
+    disconnect();
+    return Error(Error_code::ERROR, "upstream handshake failed");
+  }
+  return {};
+}
+
+void Relay_link::disconnect() {
+  if (fd == -1) return;
+  ::close(fd);
+  fd = -1;
+}
+
+/**
+ * @brief Отправляет частичную статистику
+ *
+ * Кадр, не отправленный за send_timeout_ms, - ошибка
+ * @param partial Статистика за интервал
+ * @return optional<Error> Пустое значение при успехе, иначе соединение закрывается
+ */
+std::optional<Error> Relay_link::send(const Statistic& partial) {
+  if (fd == -1) {
+    if (auto error = connect()) return error;
+  }
+  frame.assign(1, partial_frame);
+  partial.serialize(frame);
+  auto sent = Logger::Socket::socket_write(fd, frame);
+  if (auto error = std::get_if<Logger::Error>(&sent)) {
+    disconnect();
+    return Error(Error_code::ERROR, error->get_err_message());
+  }
+  return {};
+}
+
+/**
+ * @brief Включает ретрансляцию вышестоящему statistic_app
+ *
+ * Вызывается до запуска обработчиков
+ * @param config Настройки ретрансляции
+ */
+void Statistic_context::set_relay(const Relay_config& config) {
+  relay = config;
+  relay_link = std::make_unique<Relay_link>(config.upstream);
+  relay_sent = std::chrono::steady_clock::now();
+}
+
+/**
+ * @brief Пересылает запись вверх (режим записей)
+ *
+ * Вызывается только потоком шарда. Соединение открывается при первой записи
+ * и после ошибки не чаще одного раза за интервал ретрансляции. Записи длиннее
+ * relay_chunk_bytes отправляются частями, кадры вышестоящему ограничены
+ * независимо от длины записи
+ * @param shard Шард текущего обработчика
+ * @param entry_log Запись протокола
+ */
+void Statistic_context::relay_record(Statistic_shard& shard,
+    const Logger::Logger_protocol::Protocol& entry_log) {
+  if (!shard.upstream) {
+    auto now = std::chrono::steady_clock::now();
+    if (now - shard.upstream_flush < relay->interval) return;
+    shard.upstream_flush = now;
+    std::string host, port;
+    split_address(relay->upstream, host, port);
+    Logger::Socket_options options;
+    options.batch_bytes = relay_batch_bytes;
+    options.handshake_timeout_ms = handshake_timeout_ms;
+    options.connect_timeout_ms = connect_timeout_ms;
+    options.send_timeout_ms = send_timeout_ms;
+    options.nanoseconds = true;
+    options.chunk_bytes = relay_chunk_bytes;
+    auto upstream = std::make_unique<Logger::Logging>(host, port, Logger::Level::INFO, options);
+    if (auto error = upstream->open_session()) {
+      echo.report("relay: " + error->get_err_message());
+      return;
+    }
+    shard.upstream = std::move(upstream);
+  }
+  if (auto error = shard.upstream->log_write(entry_log)) {
+    echo.report("relay: " + error->get_err_message());
+    shard.upstream.reset();
+  }
+}
+
+/**
+ * @brief Отправляет накопленную пачку записей шарда, если прошёл интервал
+ *
+ * Вызывается только потоком шарда
+ * @param shard Шард текущего обработчика
+ * @param force Отправить независимо от интервала (завершение)
+ */
+void Statistic_context::relay_tick(Statistic_shard& shard, bool force) {
+  if (!shard.upstream) return;
+  auto now = std::chrono::steady_clock::now();
+  if (!force && now - shard.upstream_flush < relay->interval) return;
+  shard.upstream_flush = now;
+  if (auto error = shard.upstream->flush()) {
+    echo.report("relay: " + error->get_err_message());
+    shard.upstream.reset();
+  }
+}
+
+/**
+ * @brief Отправляет частичную статистику всех шардов, если прошёл интервал
+ *
+ * Вызывается потоком отчётов. При ошибке отправки статистика возвращается
+ * в первый шард и будет отправлена со следующей
+ * @param force Отправить независимо от интервала (завершение)
+ */
+void Statistic_context::relay_partials(bool force) {
+  if (!relay) return;
+  auto now = std::chrono::steady_clock::now();
+  if (!force && now - relay_sent < relay->interval) return;
+  relay_sent = now;
+  Statistic partial;
+  for (auto& item : shards) {
+    std::lock_guard lock(item->mtx);
+    if (!item->pending.get_count_message()) continue;
+    partial.merge(item->pending);
+    item->pending = Statistic{};
+  }
+  if (!partial.get_count_message()) return;
+  if (auto error = relay_link->send(partial)) {
+    echo.report("relay: " + error->get_err_message());
+    std::lock_guard lock(shards.front()->mtx);
+    shards.front()->pending.merge(partial);
+  }
+}
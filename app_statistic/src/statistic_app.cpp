@@ -1,9 +1,174 @@
 #include "statistic_app.hpp"
 #include <sys/poll.h>
+#include <algorithm>
 #include <optional>
 #include <iostream>
 #include <arpa/inet.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sstream>
 #include <variant>
+#include <endian.h>
+#include <cmath>
+#include <iomanip>
+
+namespace {
+  /// Дописывает uint64_t в порядке big-endian
+  void put_u64(std::string& out, uint64_t value) {
+    value = ::htobe64(value);
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+
+  /// Читает uint64_t в порядке big-endian, сдвигая представление
+  bool get_u64(std::string_view& in, uint64_t& value) {
+    if (in.size() < sizeof(value)) return false;
+    std::memcpy(&value, in.data(), sizeof(value));
+    value = ::be64toh(value);
+    in.remove_prefix(sizeof(value));
+    return true;
+  }
+
+  /// Задержка в наносекундах с подходящей единицей измерения
+  std::string format_latency(uint64_t nanoseconds) {
+    static constexpr const char* units[] = {"ns", "us", "ms", "s"};
+    std::size_t unit = 0;
+    double value = static_cast<double>(nanoseconds);
+    while (value >= 1000 && unit + 1 < std::size(units)) {
+      value /= 1000;
+      ++unit;
+    }
+    std::ostringstream os;
+    os << std::fixed << std::setprecision(!unit ? 0 : value < 10 ? 2 : value < 100 ? 1 : 0) <<
+    value << units[unit];
+    return os.str();
+  }
+
+  /// Количество источников в отчёте
+  constexpr std::size_t display_sources = 10;
+
+  /// Хеш идентификатора источника (FNV-1a), 0 зарезервирован за свободной ячейкой
+  uint64_t source_hash(std::string_view source) {
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char symbol : source) hash = (hash ^ symbol) * 1099511628211ull;
+    return hash ? hash : 1;
+  }
+}
+
+/**
+ * @brief Возвращает корзину для секунды
+ * @param time Метка времени в секундах
+ */
+Time_window::Slot& Time_window::slot(time_t time) {
+  auto size = static_cast<time_t>(slots.size());
+  return slots[((time % size) + size) % size];
+}
+
+/**
+ * @brief Сдвигает окно к новой самой поздней метке
+ *
+ * Секунды, вышедшие из окна, вычитаются из общего счётчика.
+ * Перебирается не больше размера окна корзин.
+ * @param time Новая самая поздняя метка, time > newest
+ */
+void Time_window::advance(time_t time) {
+  auto size = static_cast<time_t>(slots.size());
+  if (time - newest >= size) {
+    for (auto& item : slots) item = Slot{};
+    total = 0;
+  } else {
+    for (time_t second = newest - size + 1; second <= time - size; ++second) {
+      auto& item = slot(second);
+      if (item.time == second) {
+        total -= item.count;
+        item.count = 0;
+      }
+    }
+  }
+  newest = time;
+}
+
+/**
+ * @brief Добавляет сообщения с меткой времени в окно
+ *
+ * Метки старше окна относительно самой поздней метки не учитываются
+ * @param time Метка времени в секундах
+ * @param count Количество сообщений с этой меткой
+ */
+void Time_window::add(time_t time, uint64_t count) {
+  if (empty) {
+    newest = time;
+    empty = false;
+  } else if (time > newest) {
+    advance(time);
+  }
+  if (time <= newest - static_cast<time_t>(slots.size())) return;
+  auto& item = slot(time);
+  if (item.time != time) item = Slot{time, 0};
+  item.count += count;
+  total += count;
+}
+
+/**
+ * @brief Добавляет в окно сообщения другого окна того же размера
+ * @param other Окно другого шарда
+ */
+void Time_window::merge(const Time_window& other) {
+  if (other.empty) return;
+  if (empty || other.newest > newest) add(other.newest, 0);
+  for (const auto& item : other.slots) {
+    if (item.count) add(item.time, item.count);
+  }
+}
+
+/**
+ * @brief Учитывает задержку доставки записи
+ * @param delay Время приёма минус метка записи
+ */
+void Latency_histogram::add(Logger::Timestamp delay) {
+  if (delay.count() < 0) {
+    ++negative;
+    return;
+  }
+  auto value = static_cast<uint64_t>(delay.count());
+  auto index = value ? 64 - __builtin_clzll(value) : 0;
+  ++buckets[std::min<std::size_t>(index, bucket_count - 1)];
+  ++total;
+  max_latency = std::max(max_latency, value);
+}
+
+/**
+ * @brief Добавляет задержки другой гистограммы
+ * @param other Гистограмма другого шарда
+ */
+void Latency_histogram::merge(const Latency_histogram& other) {
+  for (std::size_t i = 0; i < bucket_count; ++i) buckets[i] += other.buckets[i];
+  total += other.total;
+  negative += other.negative;
+  max_latency = std::max(max_latency, other.max_latency);
+}
+
+/**
+ * @brief Оценивает процентиль задержки
+ *
+ * Возвращается верхняя граница корзины, в которую попал процентиль
+ * (погрешность - не больше чем вдвое), но не больше наибольшей задержки
+ * @param fraction Доля в [0, 1], например 0.99
+ * @return uint64_t Задержка в наносекундах, 0 при пустой гистограмме
+ */
+uint64_t Latency_histogram::percentile(double fraction) const {
+  if (!total) return 0;
+  auto rank = static_cast<uint64_t>(std::ceil(std::clamp(fraction, 0.0, 1.0) * total));
+  rank = std::max<uint64_t>(rank, 1);
+  uint64_t seen = 0;
+  for (std::size_t i = 0; i < bucket_count; ++i) {
+    seen += buckets[i];
+    if (seen >= rank) {
+      uint64_t upper = i ? (uint64_t{1} << i) - 1 : 0;
+      return std::min(upper, max_latency);
+    }
+  }
+  return max_latency;
+}
 
 /**
  * @brief Выводит статистику сообщений в поток.
@@ -15,30 +180,54 @@ Statistic::statistic_display(std::ostream& os) const {
   os << "Message statistic:" << '\n' <<
   "count: " << get_count_message() << '\n' <<
   "level " << Logger::serialization_level(Logger::Level::INFO).value() << ":" <<
-  level_map.at(Logger::Level::INFO) << '\n' <<
+  total.level_counts[static_cast<int>(Logger::Level::INFO)] << '\n' <<
   "level " << Logger::serialization_level(Logger::Level::WARN).value() << ":" <<
-  level_map.at(Logger::Level::WARN) << '\n' <<
+  total.level_counts[static_cast<int>(Logger::Level::WARN)] << '\n' <<
   "level " << Logger::serialization_level(Logger::Level::ERROR).value() << ":" <<
-  level_map.at(Logger::Level::ERROR) << '\n' <<
-  "last hour: " << times.size() << '\n' <<
-  "max length: " << max_length << '\n' <<
-  "min length: " << min_length << '\n' <<
-  "averege length: " << averege_length;
+  total.level_counts[static_cast<int>(Logger::Level::ERROR)] << '\n' <<
+  "last hour: " << times.count() << '\n' <<
+  "max length: " << total.max_length << '\n' <<
+  "min length: " << total.min_length << '\n' <<
+  "averege length: " << average_length();
+  if (latency.count()) {
+    os << '\n' << "latency p50: " << format_latency(latency.percentile(0.5)) <<
+    " p90: " << format_latency(latency.percentile(0.9)) <<
+    " p99: " << format_latency(latency.percentile(0.99)) <<
+    " max: " << format_latency(latency.get_max());
+  }
+  if (latency.get_negative()) {
+    os << '\n' << "latency clock skew: " << latency.get_negative();
+  }
+  // источники выводятся, если есть хотя бы один именованный
+  auto top = sources.top(display_sources);
+  if (sources.size() > 1 || sources.get_other().count() ||
+      (!top.empty() && !top.front()->get_name().empty())) {
+    os << '\n' << "sources: " << sources.size();
+    for (const auto* entry : top) {
+      const auto& counts = entry->stats.level_counts;
+      os << '\n' << "source " << (entry->get_name().empty() ? "-" : entry->get_name()) << ": " <<
+      entry->stats.count() << " (" << counts[0] << "/" << counts[1] << "/" << counts[2] << ")";
+    }
+    if (sources.get_other().count() || sources.get_evicted()) {
+      os << '\n' << "source other: " << sources.get_other().count() <<
+      " evicted: " << sources.get_evicted();
+    }
+  }
   return os;
 }
 
 Statistics_data
 Statistic::get_statistics_data() const {
   Statistics_data data;
-  data.Level_INFO_count = level_map.at(Logger::Level::INFO);
-  data.Level_WARN_count = level_map.at(Logger::Level::WARN);
-  data.Level_ERROR_count = level_map.at(Logger::Level::ERROR);
+  data.Level_INFO_count = total.level_counts[static_cast<int>(Logger::Level::INFO)];
+  data.Level_WARN_count = total.level_counts[static_cast<int>(Logger::Level::WARN)];
+  data.Level_ERROR_count = total.level_counts[static_cast<int>(Logger::Level::ERROR)];
   data.all_count = get_count_message();
-  data.count_last_interval_time = times.size();
-  data.averege_length = averege_length;
-  data.max_length = max_length;
-  data.min_length = min_length;
-  data.sum_length = sum_length;
+  data.count_last_interval_time = times.count();
+  data.averege_length = average_length();
+  data.max_length = total.max_length;
+  data.min_length = total.min_length;
+  data.sum_length = total.sum_length;
   return data;
 }
 
@@ -49,168 +238,982 @@ Statistic::get_statistics_data() const {
  * обновляет статистику длины сообщений и временные метки.
  *
  * @param entry_log Объект Protocol с информацией о лог-сообщении.
+ * @param source Идентификатор источника, пустой - без идентификатора.
  */
-void Statistic::update(const Logger::Logger_protocol::Protocol& entry_log) {
-  ++level_map[entry_log.get_level()];
-  update_length_message(entry_log.get_message()->size());
-  add_time(entry_log.get_time());
+void Statistic::update(const Logger::Logger_protocol::Protocol& entry_log, std::string_view source) {
+  update(entry_log.get_level(), entry_log.get_message_view().size(), entry_log.get_time(), source);
 }
 
 /**
- * @brief Возвращает общее количество обработанных сообщений.
- * Суммирует количество сообщений по всем уровням логирования.
- * @return uint64_t Общее количество сообщений.
+ * @brief Обновляет статистику по полям сообщения без записи протокола.
+ *
+ * @param level Уровень сообщения.
+ * @param length Длина сообщения.
+ * @param time Метка времени.
+ * @param source Идентификатор источника, пустой - без идентификатора.
  */
-uint64_t Statistic::get_count_message() const {
-  return (
-    level_map.at(Logger::Level::INFO) +
-    level_map.at(Logger::Level::WARN) +
-    level_map.at(Logger::Level::ERROR));
+void Statistic::update(Logger::Level level, uint64_t length, time_t time, std::string_view source) {
+  if (static_cast<std::size_t>(level) >= Stat_block::level_count) return;
+  total.update(level, length);
+  sources.find(source, time).update(level, length);
+  times.add(time);
 }
 
 /**
- * @brief Добавляет отметку времени в статистику и удаляет устаревшие записи.
+ * @brief Учитывает задержку доставки записи.
  *
- * @param time Временная метка (в формате time_t), которая добавляется в очередь.
- * @note По протоколу логирования время приходит в секундах
- *       class Statistic хранит interval равным 3600 секунд = 1 час
- * @details
- * Функция помещает новое значение времени в очередь.
- * Затем проверяет разницу между последним и первым элементом очереди.
- * Если эта разница больше или равна заданному интервалу времени, то
- * удаляет устаревшие временные метки из начала очереди до тех пор,
- * пока интервал между крайними элементами не станет меньше заданного значения.
+ * @param delay Время приёма минус метка записи.
  */
-void Statistic::add_time(time_t time) {
-  times.push(time);
-  while(times.back() - times.front() >= interval_time) {
-    times.pop();
-  }
+void Statistic::add_latency(Logger::Timestamp delay) {
+  latency.add(delay);
+}
+
+/**
+ * @brief Объединяет статистику другого шарда с текущей.
+ *
+ * Складывает счётчики уровней и суммы длин, объединяет минимум и максимум,
+ * блоки источников, окна времени и гистограммы задержки.
+ *
+ * @param other Статистика другого шарда.
+ */
+void Statistic::merge(const Statistic& other) {
+  total.merge(other.total);
+  sources.merge(other.sources);
+  times.merge(other.times);
+  latency.merge(other.latency);
 }
 
 /**
- * @brief Обновляет статистику по длинам сообщений.
+ * @brief Дописывает непустые секундные корзины окна
  *
- * Пересчитывает сумму, максимальную, минимальную и среднюю длины сообщений.
- * Средняя длина пересчитывается на основе текущего количества сообщений.
+ * Формат: количество корзин, затем пары (секунда, количество), uint64_t big-endian
+ * @param[out] out Буфер
+ */
+void Time_window::serialize(std::string& out) const {
+  uint64_t used = std::count_if(slots.begin(), slots.end(),
+    [](const Slot& item) { return item.count != 0; });
+  put_u64(out, used);
+  for (const auto& item : slots) {
+    if (!item.count) continue;
+    put_u64(out, static_cast<uint64_t>(item.time));
+    put_u64(out, item.count);
+  }
+}
+
+/**
+ * @brief Добавляет в окно корзины в формате serialize
+ * @param in Представление, сдвигается за прочитанные данные
+ * @return false при неверном формате
+ */
+bool Time_window::deserialize(std::string_view& in) {
+  uint64_t used;
+  if (!get_u64(in, used) || used > slots.size()) return false;
+  for (uint64_t i = 0; i < used; ++i) {
+    uint64_t time, count;
+    if (!get_u64(in, time) || !get_u64(in, count)) return false;
+    add(static_cast<time_t>(time), count);
+  }
+  return true;
+}
+
+/**
+ * @brief Дописывает непустые корзины гистограммы
  *
- * @param uint64_t length Длина нового сообщения.
+ * Формат: отрицательные задержки, наибольшая задержка, количество корзин,
+ * затем пары (номер корзины, количество), uint64_t big-endian
+ * @param[out] out Буфер
+ */
+void Latency_histogram::serialize(std::string& out) const {
+  put_u64(out, negative);
+  put_u64(out, max_latency);
+  put_u64(out, static_cast<uint64_t>(std::count_if(std::begin(buckets), std::end(buckets),
+    [](uint64_t count) { return count != 0; })));
+  for (std::size_t i = 0; i < bucket_count; ++i) {
+    if (!buckets[i]) continue;
+    put_u64(out, i);
+    put_u64(out, buckets[i]);
+  }
+}
+
+/**
+ * @brief Добавляет в гистограмму корзины в формате serialize
+ * @param in Представление, сдвигается за прочитанные данные
+ * @return false при неверном формате
  */
-void Statistic::update_length_message(uint64_t length) {
+bool Latency_histogram::deserialize(std::string_view& in) {
+  uint64_t skew, max, used;
+  if (!get_u64(in, skew) || !get_u64(in, max) || !get_u64(in, used) || used > bucket_count) {
+    return false;
+  }
+  negative += skew;
+  max_latency = std::max(max_latency, max);
+  for (uint64_t i = 0; i < used; ++i) {
+    uint64_t index, count;
+    if (!get_u64(in, index) || !get_u64(in, count) || index >= bucket_count) return false;
+    buckets[index] += count;
+    total += count;
+  }
+  return true;
+}
+
+/**
+ * @brief Учитывает сообщение
+ * @param level Уровень сообщения
+ * @param length Длина сообщения
+ */
+void Stat_block::update(Logger::Level level, uint64_t length) {
+  auto index = static_cast<std::size_t>(level);
+  if (index >= level_count) return;
+  ++level_counts[index];
   sum_length += length;
   max_length = std::max(max_length, length);
   min_length = std::min(min_length, length);
-  int count = !get_count_message() ? 1 : get_count_message();
-  averege_length = sum_length / count;
 }
 
 /**
- * @brief Запускает статистическое приложение,
- *        принимающее данные по сокету и обрабатывающее их
- *        с периодическим выводом статистики.
+ * @brief Добавляет счётчики другого блока
+ * @param other Блок другого шарда или источника
+ */
+void Stat_block::merge(const Stat_block& other) {
+  for (std::size_t level = 0; level < level_count; ++level) {
+    level_counts[level] += other.level_counts[level];
+  }
+  sum_length += other.sum_length;
+  max_length = std::max(max_length, other.max_length);
+  min_length = std::min(min_length, other.min_length);
+}
+
+uint64_t Stat_block::count() const {
+  uint64_t result = 0;
+  for (auto value : level_counts) result += value;
+  return result;
+}
+
+/**
+ * @brief Дописывает блок: счётчики уровней, сумма, максимум и минимум длин
+ * @param[out] out Буфер
+ */
+void Stat_block::serialize(std::string& out) const {
+  for (auto count : level_counts) put_u64(out, count);
+  put_u64(out, sum_length);
+  put_u64(out, max_length);
+  put_u64(out, min_length);
+}
+
+/**
+ * @brief Читает блок в формате serialize
+ * @param in Представление, сдвигается за прочитанные данные
+ * @return false при неверном формате
+ */
+bool Stat_block::deserialize(std::string_view& in) {
+  for (auto& count : level_counts) {
+    if (!get_u64(in, count)) return false;
+  }
+  return get_u64(in, sum_length) && get_u64(in, max_length) && get_u64(in, min_length);
+}
+
+/**
+ * @brief Создаёт пустую таблицу
+ * @param max_sources Наибольшее количество источников в таблице
+ * @param idle_seconds Через сколько секунд без записей источник может быть вытеснен
+ */
+Source_table::Source_table(std::size_t max_sources, time_t idle_seconds)
+  : max_sources(std::max<std::size_t>(max_sources, 1)), idle_seconds(idle_seconds) {}
+
+/**
+ * @brief Возвращает блок источника, добавляя источник при отсутствии
  *
- * @param listen_fd Дескриптор слушающего сокета для принятия новых подключений.
- * @param interval_time Интервал времени (секунды) между отображением статистики.
+ * Если таблица заполнена и вытеснить некого, возвращается блок "other".
+ * После неудачной попытки вытеснения следующая выполняется не раньше,
+ * чем самый давний источник может стать простаивающим, поэтому поток
+ * записей от не поместившихся источников не обходит таблицу на каждой записи.
+ * @param source Идентификатор источника
+ * @param time Метка записи в секундах
+ * @return Stat_block& Блок для обновления
+ */
+Stat_block& Source_table::find(std::string_view source, time_t time) {
+  if (source.size() > Logger::Transport::max_source_length) return other;
+  if (slots.empty()) {
+    std::size_t capacity = 8;
+    while (capacity * 3 < max_sources * 4) capacity *= 2;
+    slots.resize(capacity);
+  }
+  newest = std::max(newest, time);
+  auto hash = source_hash(source);
+  auto mask = slots.size() - 1;
+  auto index = hash & mask;
+  for (; slots[index].hash; index = (index + 1) & mask) {
+    auto& entry = slots[index];
+    if (entry.hash == hash && entry.get_name() == source) {
+      entry.last_seen = std::max(entry.last_seen, time);
+      return entry.stats;
+    }
+  }
+  if (used >= max_sources) {
+    if (newest < evict_after || !evict_idle()) return other;
+    // обратный сдвиг мог занять найденную свободную ячейку
+    for (index = hash & mask; slots[index].hash; index = (index + 1) & mask) {}
+  }
+  auto& entry = slots[index];
+  entry = Entry{};
+  entry.hash = hash;
+  entry.last_seen = time;
+  entry.name_size = static_cast<uint8_t>(source.size());
+  std::memcpy(entry.name, source.data(), source.size());
+  ++used;
+  return entry.stats;
+}
+
+/**
+ * @brief Вытесняет в "other" источник с самой давней записью, если он простаивает
+ * @return true если ячейка освободилась
+ */
+bool Source_table::evict_idle() {
+  std::size_t oldest = slots.size();
+  for (std::size_t i = 0; i < slots.size(); ++i) {
+    if (slots[i].hash && (oldest == slots.size() || slots[i].last_seen < slots[oldest].last_seen)) {
+      oldest = i;
+    }
+  }
+  if (oldest == slots.size()) return false;
+  if (newest - slots[oldest].last_seen < idle_seconds) {
+    evict_after = slots[oldest].last_seen + idle_seconds;
+    return false;
+  }
+  other.merge(slots[oldest].stats);
+  erase(oldest);
+  ++evicted;
+  return true;
+}
+
+/**
+ * @brief Удаляет ячейку обратным сдвигом следующих за ней в цепочке пробирования
+ * @param index Занятая ячейка
+ */
+void Source_table::erase(std::size_t index) {
+  auto mask = slots.size() - 1;
+  auto hole = index;
+  for (auto next = (hole + 1) & mask; slots[next].hash; next = (next + 1) & mask) {
+    auto home = slots[next].hash & mask;
+    // ячейку можно сдвинуть, если дыра лежит между её домашней позицией и ею
+    if (((next - home) & mask) >= ((next - hole) & mask)) {
+      slots[hole] = slots[next];
+      hole = next;
+    }
+  }
+  slots[hole] = Entry{};
+  --used;
+}
+
+/**
+ * @brief Добавляет источники другой таблицы
+ * @param other_table Таблица другого шарда или ретранслятора
+ */
+void Source_table::merge(const Source_table& other_table) {
+  for (const auto& entry : other_table.slots) {
+    if (entry.hash) find(entry.get_name(), entry.last_seen).merge(entry.stats);
+  }
+  other.merge(other_table.other);
+  evicted += other_table.evicted;
+}
+
+/**
+ * @brief Объединяет блоки всех источников и "other"
+ * @return Stat_block Общие счётчики
+ */
+Stat_block Source_table::total() const {
+  Stat_block result = other;
+  for (const auto& entry : slots) {
+    if (entry.hash) result.merge(entry.stats);
+  }
+  return result;
+}
+
+/**
+ * @brief Возвращает источники с наибольшим количеством сообщений
+ * @param count Сколько источников вернуть
+ * @return vector<const Entry*> Источники по убыванию количества
+ */
+std::vector<const Source_table::Entry*> Source_table::top(std::size_t count) const {
+  std::vector<const Entry*> result;
+  for (const auto& entry : slots) {
+    if (entry.hash) result.push_back(&entry);
+  }
+  count = std::min(count, result.size());
+  std::partial_sort(result.begin(), result.begin() + count, result.end(),
+    [](const Entry* first, const Entry* second) {
+      if (first->stats.count() != second->stats.count()) {
+        return first->stats.count() > second->stats.count();
+      }
+      return first->get_name() < second->get_name();
+    });
+  result.resize(count);
+  return result;
+}
+
+/**
+ * @brief Дописывает источники
+ *
+ * Формат: количество источников, затем для каждого длина имени, имя,
+ * метка последней записи и блок; затем блок "other" и количество вытесненных
+ * @param[out] out Буфер
+ */
+void Source_table::serialize(std::string& out) const {
+  put_u64(out, used);
+  for (const auto& entry : slots) {
+    if (!entry.hash) continue;
+    put_u64(out, entry.name_size);
+    out.append(entry.name, entry.name_size);
+    put_u64(out, static_cast<uint64_t>(entry.last_seen));
+    entry.stats.serialize(out);
+  }
+  other.serialize(out);
+  put_u64(out, evicted);
+}
+
+/**
+ * @brief Добавляет источники в формате serialize
+ * @param in Представление, сдвигается за прочитанные данные
+ * @return false при неверном формате
+ */
+bool Source_table::deserialize(std::string_view& in) {
+  uint64_t count;
+  if (!get_u64(in, count)) return false;
+  for (uint64_t i = 0; i < count; ++i) {
+    uint64_t size, last_seen;
+    if (!get_u64(in, size) || size > Logger::Transport::max_source_length || in.size() < size) {
+      return false;
+    }
+    auto name = in.substr(0, size);
+    in.remove_prefix(size);
+    Stat_block block;
+    if (!get_u64(in, last_seen) || !block.deserialize(in)) return false;
+    find(name, static_cast<time_t>(last_seen)).merge(block);
+  }
+  Stat_block rest;
+  uint64_t rest_evicted;
+  if (!rest.deserialize(in) || !get_u64(in, rest_evicted)) return false;
+  other.merge(rest);
+  evicted += rest_evicted;
+  return true;
+}
+
+/**
+ * @brief Сериализует статистику для передачи вышестоящему statistic_app
+ *
+ * Формат: счётчики уровней, сумма, максимум и минимум длин, окно времени,
+ * гистограмма задержки, затем источники
+ * @param[out] out Буфер, данные дописываются в конец
+ */
+void Statistic::serialize(std::string& out) const {
+  total.serialize(out);
+  times.serialize(out);
+  latency.serialize(out);
+  sources.serialize(out);
+}
+
+/**
+ * @brief Разбирает статистику в формате serialize
+ *
+ * Гистограмма задержки и источники необязательны: их нет у ретрансляторов
+ * прежних версий, тогда все сообщения относятся к источнику без идентификатора
+ * @param in Сериализованная статистика
+ * @return optional<Statistic> Статистика или пустое значение при неверном формате
+ */
+std::optional<Statistic> Statistic::deserialize(std::string_view in) {
+  Statistic result;
+  if (!result.total.deserialize(in) || !result.times.deserialize(in) ||
+      (!in.empty() && !result.latency.deserialize(in))) {
+    return {};
+  }
+  if (in.empty()) {
+    if (result.total.count()) result.sources.find({}, 0).merge(result.total);
+  } else if (!result.sources.deserialize(in) || !in.empty()) {
+    return {};
+  }
+  return result;
+}
+
+/**
+ * @brief Возвращает общее количество обработанных сообщений.
+ * Суммирует количество сообщений по всем уровням логирования.
+ * @return uint64_t Общее количество сообщений.
+ */
+uint64_t Statistic::get_count_message() const {
+  return total.count();
+}
+
+/// Средняя длина сообщения, 0 без сообщений
+uint64_t Statistic::average_length() const {
+  auto count = get_count_message();
+  return count ? total.sum_length / count : 0;
+}
+
+/**
+ * @brief Объединяет два снимка статистики.
+ *
+ * Окна времени снимков складываются приближённо: каждый шард считает
+ * своё окно от своей самой поздней метки.
+ *
+ * @param first Снимок первого шарда.
+ * @param second Снимок второго шарда.
+ * @return Statistics_data Объединённый снимок.
+ */
+Statistics_data
+merge_statistics_data(const Statistics_data& first, const Statistics_data& second) {
+  if (!first.all_count) return second;
+  if (!second.all_count) return first;
+  Statistics_data data;
+  data.Level_INFO_count = first.Level_INFO_count + second.Level_INFO_count;
+  data.Level_WARN_count = first.Level_WARN_count + second.Level_WARN_count;
+  data.Level_ERROR_count = first.Level_ERROR_count + second.Level_ERROR_count;
+  data.all_count = first.all_count + second.all_count;
+  data.count_last_interval_time = first.count_last_interval_time + second.count_last_interval_time;
+  data.sum_length = first.sum_length + second.sum_length;
+  data.max_length = std::max(first.max_length, second.max_length);
+  data.min_length = std::min(first.min_length, second.min_length);
+  data.averege_length = data.sum_length / data.all_count;
+  return data;
+}
+
+/**
+ * @brief Создаёт контекст с заданным количеством шардов.
+ * @param shard_count Количество шардов (потоков-обработчиков).
+ * @param echo Вывод сообщений и статистики на консоль.
  * @param interval_count_message Интервал сообщений (количество) между выводами статистики.
+ */
+Statistic_context::Statistic_context(std::size_t shard_count, Console_echo& echo,
+    uint64_t interval_count_message)
+  : echo(echo), interval_count_message(interval_count_message) {
+  for (std::size_t i = 0; i < shard_count; ++i) {
+    shards.push_back(std::make_unique<Statistic_shard>());
+  }
+}
+
+/**
+ * @brief Учитывает запись в шарде обработчика и передаёт её на вывод.
  *
- * @return Возвращает 0 при успешном завершении или -1 в случае ошибки
+ * Публикует снимок шарда для сокета запросов и, если достигнут
+ * интервал сообщений по всем шардам, выводит объединённую статистику.
  *
- * @details
- * Функция для принятия подключений и чтении сообщений из сокета.
- * Использует системный вызов poll с таймаутом interval_time.
- * При получении сообщений десериализует лог-записи и выводит их.
- * Периодически, после каждых interval_count_message сообщений, выводит статистику.
+ * @param shard Шард текущего обработчика.
+ * @param entry_log Запись протокола.
+ * @param received Время приёма записи, если её метка в наносекундах,
+ *        иначе нулевое (задержка не учитывается).
+ * @param source Идентификатор источника из согласования подключения.
+ * @param length Длина сообщения, если в записи только его начало
+ *        (запись, принятая частями), иначе - длина сообщения записи.
+ * @param whole Запись целиком для ретрансляции, если в entry_log только её начало.
+ */
+void Statistic_context::process(Statistic_shard& shard, Logger::Logger_protocol::Protocol&& entry_log,
+    Logger::Timestamp received, std::string_view source, std::optional<uint64_t> length,
+    const Logger::Logger_protocol::Protocol* whole) {
+  {
+    std::lock_guard lock(shard.mtx);
+    auto message_length = length.value_or(entry_log.get_message_view().size());
+    shard.stats.update(entry_log.get_level(), message_length, entry_log.get_time(), source);
+    auto partial = relay && relay->mode == Relay_mode::PARTIALS;
+    if (partial) shard.pending.update(entry_log.get_level(), message_length, entry_log.get_time(), source);
+    if (received.count()) {
+      auto delay = received - entry_log.get_timestamp();
+      shard.stats.add_latency(delay);
+      if (partial) shard.pending.add_latency(delay);
+    }
+    shard.snapshot.publish(shard.stats.get_statistics_data());
+  }
+  if (relays_records()) relay_record(shard, whole ? *whole : entry_log);
+  echo.echo(std::move(entry_log));
+  auto count = count_message.fetch_add(1, std::memory_order_relaxed) + 1;
+  if (!(count % interval_count_message)) {
+    report(false);
+  }
+}
+
+/**
+ * @brief Учитывает частичную статистику нижестоящего ретранслятора.
  *
- * Таймаут в poll задаёт максимальное время ожидания новых данных,
- * если он истекает то статистика выводится на экран,
- * при условии что она изменилась с последнего вывода
+ * При включённой ретрансляции частичная статистика пересылается дальше.
  *
- * Aлгоритм отображения статистики:
- * - запоминаем количество сообщений при последнем выводе статистики.
- * - после истечения таймаута сравниваем текущее количество сообщений
- *   с количесвтом последнего отображения, если они не равны данные статистики обновились
+ * @param shard Шард текущего обработчика.
+ * @param partial Частичная статистика.
  */
-int statistic_app_run(
-  const int listen_fd,
-  std::chrono::seconds interval_time,
-  const int interval_count_message
-) {
-  //конвертируем в млс для poll
-  int timeout = std::chrono::duration_cast<std::chrono::milliseconds>(interval_time).count();
-  Statistic stats;
-  const int tracket_length = 1;
-  pollfd tracket_set_fd[tracket_length];
-  auto& tracket_fd = tracket_set_fd[0];
-  int previous_count_message{}; // для отслеживания изменений в статистике
-  while (true) {
-    int new_connect_fd = ::accept(listen_fd,nullptr,nullptr);
-    if (new_connect_fd == -1) {
-      if (errno == EINTR) continue;
-      std::cerr << strerror(errno) << std::endl;
-      return -1;
+void Statistic_context::process_partial(Statistic_shard& shard, const Statistic& partial) {
+  {
+    std::lock_guard lock(shard.mtx);
+    shard.stats.merge(partial);
+    shard.snapshot.publish(shard.stats.get_statistics_data());
+    if (relay) shard.pending.merge(partial);
+  }
+  auto added = partial.get_count_message();
+  auto count = count_message.fetch_add(added, std::memory_order_relaxed) + added;
+  if (count / interval_count_message != (count - added) / interval_count_message) {
+    report(false);
+  }
+}
+
+/**
+ * @brief Объединяет все шарды в одну статистику.
+ * @return Statistic Объединённая статистика.
+ */
+Statistic Statistic_context::merge() {
+  Statistic result;
+  for (auto& item : shards) {
+    std::lock_guard lock(item->mtx);
+    result.merge(item->stats);
+  }
+  return result;
+}
+
+/**
+ * @brief Собирает снимок статистики из снимков шардов без блокировок.
+ * @return Statistics_data Объединённый снимок.
+ */
+Statistics_data Statistic_context::snapshot_data() const {
+  Statistics_data data;
+  for (const auto& item : shards) {
+    data = merge_statistics_data(data, item->snapshot.read());
+  }
+  return data;
+}
+
+/**
+ * @brief Выводит объединённую статистику шардов.
+ *
+ * @param only_changed Выводить, только если с последнего отчёта
+ *        количество сообщений изменилось.
+ */
+void Statistic_context::report(bool only_changed) {
+  std::lock_guard lock(report_mtx);
+  auto count = count_message.load(std::memory_order_relaxed);
+  if (only_changed && count <= previous_count_message) return;
+  previous_count_message = count;
+  std::ostringstream os;
+  merge().statistic_display(os);
+  echo.report(os.str());
+}
+
+void Input_buffer::reserve(std::size_t size) {
+  if (size <= capacity) return;
+  std::unique_ptr<char[]> grown(new char[size]);
+  if (used) std::memcpy(grown.get(), data.get(), used);
+  data = std::move(grown);
+  capacity = size;
+}
+
+void Chunked_record::append(std::string_view data) {
+  if (assemble) whole.append(data);
+  if (head.size() < preview_bytes) head.append(data.substr(0, preview_bytes - head.size()));
+  bytes += data.size();
+  if (data.size() >= tail_bytes) {
+    tail.assign(data.substr(data.size() - tail_bytes));
+  } else {
+    tail.append(data);
+    if (tail.size() > tail_bytes) tail.erase(0, tail.size() - tail_bytes);
+  }
+}
+
+namespace {
+  /**
+   * @brief Учитывает часть записи; после последней части учитывает запись
+   *
+   * Уровень и время разбираются из конца записи, длина сообщения - принятые
+   * байты без них. В вывод попадает начало сообщения (Chunked_record::preview_bytes),
+   * в статистику - полная длина. При ретрансляции записей запись собирается
+   * и передаётся дальше целиком
+   * @return optional<Error> Ошибка формата кадра или запись длиннее допустимой
+   */
+  std::optional<Logger::Error> handle_chunk(Connection& connection, std::string_view frame,
+      Statistic_shard& shard, Statistic_context& context) {
+    auto chunk = Logger::Transport::parse_chunk(frame);
+    if (!chunk) return Logger::Error(Logger::Error_code::ERROR, "invalid chunk frame");
+    auto& record = connection.chunked;
+    if (!record.active) {
+      record.active = true;
+      record.assemble = context.relays_records();
+      record.bytes = 0;
+      record.head.clear();
+      record.tail.clear();
+      record.whole.clear();
+    }
+    record.append(chunk->data);
+    if (record.assemble &&
+        record.bytes > Logger::Logger_protocol::Protocol::max_length + Chunked_record::tail_bytes) {
+      return Logger::Error(Logger::Error_code::ERROR, "chunked record too large to relay");
+    }
+    if (chunk->more) return {};
+    record.active = false;
+    ++connection.received;
+    auto received = connection.nanoseconds ? Logger::Clock::now() : Logger::Timestamp{};
+    auto log_entry = Logger::Logger_protocol::deserialization_log(record.tail);
+    if (!log_entry) return {};
+    auto fields = record.tail.size() - log_entry->get_message_view().size();
+    auto length = record.bytes - fields;
+    auto preview = std::string_view(record.head).substr(0, static_cast<std::size_t>(
+      std::min<uint64_t>(record.head.size(), length)));
+    std::optional<Logger::Logger_protocol::Protocol> whole;
+    if (record.assemble) {
+      whole = Logger::Logger_protocol::deserialization_log(record.whole);
+      record.whole = std::string(); // память под большую запись освобождается
     }
-    tracket_fd.fd = new_connect_fd;
-    tracket_fd.events = POLLIN | POLLRDHUP;
-    while (true) {
-      int result_tracket = poll(tracket_set_fd, tracket_length, timeout);
-      if (result_tracket == -1) {
+    context.process(shard, Logger::Logger_protocol::Protocol(preview, log_entry->get_level(),
+      log_entry->get_timestamp()), received, connection.source, length, whole ? &*whole : nullptr);
+    return {};
+  }
+
+  constexpr std::size_t read_size = 64 * 1024; ///< Начальная ёмкость буфера приёма подключения
+  constexpr int reads_per_event = 16; ///< Ограничение чтений подключения за событие poll
+
+  /**
+   * @brief Читает доступные данные неблокирующего подключения и передаёт полные кадры
+   *
+   * SOCK_STREAM: байты накапливаются в Connection::input, неполный кадр ждёт
+   * следующей готовности сокета, длина кадра проверяется по префиксу до приёма данных;
+   * буфер не заполняется перед recv и растёт только под объявленный кадр.
+   * SOCK_SEQPACKET: каждый пакет - кадр. Чтений за вызов не больше reads_per_event,
+   * чтобы одно подключение не задерживало остальные подключения обработчика
+   * @param on_frame Получает кадр, возвращает optional<Error>
+   * @return optional<Error> Ошибка чтения или кадра, закрытие соединения
+   */
+  template<typename Callback>
+  std::optional<Logger::Error> receive_frames(const int fd, Connection& connection,
+      std::size_t max_frame, Callback&& on_frame) {
+    if (connection.packet) {
+      for (int count = 0; count < reads_per_event; ++count) {
+        auto size = ::recv(fd, nullptr, 0, MSG_PEEK | MSG_TRUNC | MSG_DONTWAIT);
+        if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return {};
+        if (auto error = Logger::Socket::packet_read(fd, connection.packet_frame, max_frame)) return error;
+        if (auto error = on_frame(std::string_view(connection.packet_frame))) return error;
+      }
+      return {};
+    }
+    auto& input = connection.input;
+    input.reserve(read_size);
+    for (int count = 0; count < reads_per_event; ++count) {
+      auto space = input.capacity - input.used;
+      auto size = ::recv(fd, input.data.get() + input.used, space, MSG_DONTWAIT);
+      if (size < 0) {
         if (errno == EINTR) continue;
-        std::cerr << strerror(errno) << std::endl;
-        close(tracket_fd.fd);
-        break;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return {};
+        return Logger::Error(Logger::Error_code::ERROR, strerror(errno));
       }
-      // пришли новые данные из сокета
-      if (result_tracket == 1 && tracket_fd.revents | POLLIN) {
-        auto data_socket = Logger::Socket::socket_read(tracket_fd.fd);
-        if (auto message =
-            std::get_if<std::shared_ptr<std::string>>(&data_socket)) {
-          if (auto log_entry = Logger::Logger_protocol::deserialization_log(*message)) {
-            Logger::Logger_protocol::print_log_entry(std::cout, log_entry.value()) << std::endl;
-
-            // обновляем статистику
-            stats.update(log_entry.value());
-            /*
-              если достиг интервал сообщений то выводим статистику
-              и обновляем количество сообщений при последнем выводе
-              текущим количеством сообщений
-            */
-            if (!(stats.get_count_message() % interval_count_message)) {
-              previous_count_message = stats.get_count_message();
-              stats.statistic_display(std::cout) << std::endl;
-            }
-          }
-        } else {
-          auto error = std::get<Logger::Error>(data_socket);
-          std::cout << error.get_err_message() << std::endl;
-          close(tracket_fd.fd);
+      if (!size) return Logger::Error(Logger::Error_code::ERROR, "closed the connection");
+      input.used += static_cast<std::size_t>(size);
+      std::string_view data(input.data.get(), input.used);
+      std::size_t offset = 0;
+      while (data.size() - offset >= sizeof(uint32_t)) {
+        uint32_t length{};
+        std::memcpy(&length, data.data() + offset, sizeof(length));
+        length = ::ntohl(length);
+        if (length > max_frame) return Logger::Transport::frame_too_large(length, max_frame);
+        if (data.size() - offset - sizeof(length) < length) {
+          // неполный кадр: буфер растёт, только если кадр в него не поместится
+          input.reserve(sizeof(length) + length);
           break;
         }
+        if (auto error = on_frame(data.substr(offset + sizeof(length), length))) return error;
+        offset += sizeof(length) + length;
+      }
+      if (offset) {
+        input.used -= offset;
+        std::memmove(input.data.get(), input.data.get() + offset, input.used);
+      }
+      if (static_cast<std::size_t>(size) < space) return {};
+    }
+    return {};
+  }
+
+  /// Добавляет кадр ответа в очередь отправки подключения
+  void queue_reply(Connection& connection, std::string_view reply) {
+    uint32_t length = ::htonl(static_cast<uint32_t>(reply.size()));
+    connection.output.append(reinterpret_cast<const char*>(&length), sizeof(length));
+    connection.output.append(reply);
+  }
+
+  /**
+   * @brief Отправляет очередь ответов подключения без блокировки
+   *
+   * SOCK_STREAM: очередь отправляется как есть, префикс длины - часть кадра.
+   * SOCK_SEQPACKET: каждый кадр без префикса - отдельный пакет.
+   * Неотправленное остаётся в очереди до готовности сокета к записи
+   * @return optional<Error> Ошибка отправки
+   */
+  std::optional<Logger::Error> send_replies(const int fd, Connection& connection) {
+    auto& output = connection.output;
+    std::size_t offset = 0;
+    while (offset < output.size()) {
+      std::size_t prefix = 0, size = output.size() - offset;
+      if (connection.packet) {
+        uint32_t length{};
+        std::memcpy(&length, output.data() + offset, sizeof(length));
+        prefix = sizeof(length);
+        size = ::ntohl(length);
+      }
+      auto sent = ::send(fd, output.data() + offset + prefix, size, MSG_NOSIGNAL | MSG_DONTWAIT);
+      if (sent < 0) {
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+        return Logger::Error(Logger::Error_code::WRITE, strerror(errno));
+      }
+      offset += connection.packet ? prefix + size : static_cast<std::size_t>(sent);
+    }
+    output.erase(0, offset);
+    return {};
+  }
+}
+
+/**
+ * @brief Обрабатывает принятый кадр подключения
+ *
+ * Первый кадр может быть запросом согласования: на него готовится ответ,
+ * и дальнейшие кадры разбираются как пачки или части записи. Иначе кадр - одна запись.
+ * Для записей с метками в наносекундах учитывается задержка: время приёма
+ * берётся один раз на кадр. Если согласованы подтверждения, после обработки
+ * кадра готовится накопительное количество принятых записей.
+ * Ответ отправляет вызывающий: синхронно или из сопрограммы.
+ * @param[out] reply Кадр ответа клиенту, пустой - ответа нет
+ * @return optional<Error> Ошибка формата кадра
+ */
+std::optional<Logger::Error> handle_frame(Connection& connection, std::string_view frame,
+    Statistic_shard& shard, Statistic_context& context, std::string& reply) {
+  namespace Transport = Logger::Transport;
+  reply.clear();
+  if (connection.framed) {
+    auto chunk = !frame.empty() && frame[0] == static_cast<char>(Transport::Frame_type::CHUNK);
+    if (chunk || connection.chunked.active) {
+      if (!chunk) return Logger::Error(Logger::Error_code::ERROR, "chunked record interrupted");
+      auto error = handle_chunk(connection, frame, shard, context);
+      if (!error && connection.acknowledge && !connection.chunked.active) {
+        reply = Transport::make_ack(connection.received);
+      }
+      return error;
+    }
+    if (!frame.empty() && frame[0] == partial_frame) {
+      auto partial = Statistic::deserialize(frame.substr(1));
+      if (!partial) return Logger::Error(Logger::Error_code::ERROR, "invalid partial statistic");
+      context.process_partial(shard, partial.value());
+      return {};
+    }
+    auto received = connection.nanoseconds ? Logger::Clock::now() : Logger::Timestamp{};
+    auto error = Transport::decode_frame(frame, connection.scratch, [&](std::string_view record) {
+      ++connection.received;
+      if (auto log_entry = Logger::Logger_protocol::deserialization_log(record)) {
+        context.process(shard, std::move(log_entry.value()), received, connection.source);
+      }
+    });
+    if (!error && connection.acknowledge) reply = Transport::make_ack(connection.received);
+    return error;
+  }
+  if (auto hello = Transport::parse_handshake(frame, "hello")) {
+    connection.source = std::move(hello->source);
+    reply = Transport::make_handshake("welcome", *hello);
+    connection.framed = true;
+    connection.nanoseconds = hello->nanoseconds;
+    connection.acknowledge = hello->acknowledge;
+    return {};
+  }
+  if (auto log_entry = Logger::Logger_protocol::deserialization_log(frame)) {
+    context.process(shard, std::move(log_entry.value()));
+  }
+  return {};
+}
+
+/**
+ * @brief Цикл потока-обработчика: приём подключений и чтение сообщений.
+ *
+ * @param listen_fd Собственный слушающий сокет обработчика (SO_REUSEPORT).
+ * @param shard Шард статистики обработчика.
+ * @param context Общее состояние обработчиков.
+ *
+ * @return Возвращает 0 после остановки контекста или -1 в случае ошибки
+ *
+ * @details
+ * Использует poll по слушающему сокету и всем подключениям обработчика.
+ * Подключения неблокирующие: неполный кадр накапливается в буфере подключения,
+ * ответы, не принятые сокетом, ждут готовности к записи - медленный клиент
+ * не задерживает остальные подключения. Сообщения десериализуются и учитываются в шарде. Для слушающего сокета
+ * SOCK_SEQPACKET каждый пакет - один кадр без префикса длины. Клиент может согласовать
+ * отправку пачек, сжатие и подтверждения первым кадром (Logger::Transport). Таймаут poll
+ * ограничивает время реакции на остановку контекста.
+ */
+int statistic_worker_run(const int listen_fd, Statistic_shard& shard, Statistic_context& context) {
+  constexpr int stop_check_ms = 200;
+  std::vector<pollfd> tracket_fds{{listen_fd, POLLIN, 0}};
+  std::vector<Connection> connections{1}; // параллельно tracket_fds, [0] не используется
+  std::string reply; // ответ клиенту: согласование или подтверждение
+  int socket_type = SOCK_STREAM;
+  socklen_t type_size = sizeof(socket_type);
+  ::getsockopt(listen_fd, SOL_SOCKET, SO_TYPE, &socket_type, &type_size);
+  const bool packet = socket_type == SOCK_SEQPACKET;
+  int result = 0;
+  while (!context.is_stopped()) {
+    int result_tracket = ::poll(tracket_fds.data(), tracket_fds.size(), stop_check_ms);
+    if (result_tracket == -1) {
+      if (errno == EINTR) continue;
+      context.get_echo().report(strerror(errno));
+      result = -1;
+      break;
+    }
+    context.relay_tick(shard);
+    if (!result_tracket) continue;
+    for (std::size_t i = 1; i < tracket_fds.size(); ++i) {
+      auto& tracket_fd = tracket_fds[i];
+      if (!tracket_fd.revents) continue;
+      auto& connection = connections[i];
+      std::optional<Logger::Error> error;
+      // пришли новые данные из сокета или соединение закрыто
+      if (tracket_fd.revents & ~POLLOUT) {
+        error = receive_frames(tracket_fd.fd, connection, context.get_max_frame(),
+          [&](std::string_view frame) {
+            auto frame_error = handle_frame(connection, frame, shard, context, reply);
+            if (!frame_error && !reply.empty()) queue_reply(connection, reply);
+            return frame_error;
+          });
       }
-      /* если истек таймаут,
-         то проверяем количество сообщений при последнем отображении,
-         если оно изменилось то выводим статистику и обновляем количество
-         сообщений при последнем выводе текущим количеством сообщений
-      */
-      if (!result_tracket && stats.get_count_message() > previous_count_message) {
-        previous_count_message = stats.get_count_message();
-        stats.statistic_display(std::cout) << std::endl;
+      if (!error && !connection.output.empty()) error = send_replies(tracket_fd.fd, connection);
+      if (error) {
+        context.get_echo().report(error.value().get_err_message());
+        close(tracket_fd.fd);
+        tracket_fd.fd = -1;
+        continue;
+      }
+      tracket_fd.events = POLLIN | POLLRDHUP | (connection.output.empty() ? 0 : POLLOUT);
+    }
+    std::size_t alive = 1;
+    for (std::size_t i = 1; i < tracket_fds.size(); ++i) {
+      if (tracket_fds[i].fd == -1) continue;
+      if (alive != i) {
+        tracket_fds[alive] = tracket_fds[i];
+        connections[alive] = std::move(connections[i]);
+      }
+      ++alive;
+    }
+    tracket_fds.resize(alive);
+    connections.resize(alive);
+    if (tracket_fds[0].revents & POLLIN) {
+      int new_connect_fd = ::accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+      if (new_connect_fd == -1) {
+        if (errno == EINTR || errno == EAGAIN || errno == ECONNABORTED) continue;
+        context.get_echo().report(strerror(errno));
+        result = -1;
+        break;
       }
+      tracket_fds.push_back({new_connect_fd, POLLIN | POLLRDHUP, 0});
+      connections.emplace_back().packet = packet;
+    }
+  }
+  for (std::size_t i = 1; i < tracket_fds.size(); ++i) close(tracket_fds[i].fd);
+  context.relay_tick(shard, true);
+  return result;
+}
+
+/**
+ * @brief Цикл потока чтения кольца в разделяемой памяти.
+ *
+ * @param ring Кольцо, открытое как потребитель.
+ * @param shard Шард статистики потока.
+ * @param context Общее состояние обработчиков.
+ *
+ * @return Возвращает 0 после остановки контекста
+ *
+ * @details
+ * Записи копируются из слотов пачками; пока кольцо пусто, поток спит
+ * на futex. Метки в кольце всегда в наносекундах, задержка учитывается
+ * для каждой записи. Изменения счётчиков отброшенных и пропущенных записей
+ * выводятся на консоль.
+ */
+int statistic_ring_run(Logger::Shared_ring& ring, Statistic_shard& shard, Statistic_context& context) {
+  constexpr int stop_check_ms = 200;
+  constexpr std::size_t batch = 256;
+  uint64_t dropped = ring.get_dropped(), abandoned = ring.get_abandoned();
+  auto on_entry = [&](Logger::Logger_protocol::Protocol&& entry) {
+    context.process(shard, std::move(entry), Logger::Clock::now());
+  };
+  while (!context.is_stopped()) {
+    context.relay_tick(shard);
+    if (ring.consume(on_entry, batch)) continue;
+    if (ring.get_dropped() != dropped || ring.get_abandoned() != abandoned) {
+      dropped = ring.get_dropped();
+      abandoned = ring.get_abandoned();
+      context.get_echo().report("ring dropped: " + std::to_string(dropped) +
+        " abandoned: " + std::to_string(abandoned));
     }
+    ring.wait(stop_check_ms);
   }
+  context.relay_tick(shard, true);
   return 0;
 }
 
+/**
+ * @brief Запускает статистическое приложение,
+ *        принимающее данные по сокетам и обрабатывающее их
+ *        с периодическим выводом статистики.
+ *
+ * @param listen_fds Слушающие сокеты, по одному на поток-обработчик.
+ * @param interval_time Интервал времени (секунды) между отображением статистики.
+ * @param inputs Дополнительные источники записей, шарды после шардов обработчиков.
+ * @param context Общее состояние, количество шардов равно количеству сокетов.
+ *
+ * @return Возвращает 0 при успешном завершении или -1 в случае ошибки
+ *
+ * @details
+ * Для каждого слушающего сокета запускается поток-обработчик
+ * со своим шардом статистики (statistic_worker_run).
+ * Статистика выводится после каждых interval_count_message сообщений
+ * по всем шардам, а также каждые interval_time секунд,
+ * если она изменилась с последнего вывода.
+ * Функция завершается, когда контекст остановлен или
+ * все обработчики завершились с ошибкой.
+ */
+int statistic_app_run(
+  const std::vector<int>& listen_fds,
+  std::chrono::seconds interval_time,
+  Statistic_context& context,
+  const std::vector<Statistic_input>& inputs
+) {
+  std::vector<std::thread> workers;
+  std::atomic<std::size_t> running{listen_fds.size() + inputs.size()};
+  std::atomic<int> result{0};
+  for (std::size_t i = 0; i < listen_fds.size(); ++i) {
+    workers.emplace_back([&, i]{
+      if (statistic_worker_run(listen_fds[i], context.shard(i), context)) result = -1;
+      --running;
+    });
+  }
+  for (std::size_t i = 0; i < inputs.size(); ++i) {
+    workers.emplace_back([&, i]{
+      if (inputs[i](context.shard(listen_fds.size() + i), context)) result = -1;
+      --running;
+    });
+  }
+  constexpr auto tick = std::chrono::milliseconds(100);
+  auto next_report = std::chrono::steady_clock::now() + interval_time;
+  while (!context.is_stopped() && running) {
+    std::this_thread::sleep_for(tick);
+    context.relay_partials();
+    if (std::chrono::steady_clock::now() >= next_report) {
+      context.report(true);
+      next_report += interval_time;
+    }
+  }
+  context.stop();
+  for (auto& worker : workers) worker.join();
+  context.relay_partials(true);
+  return result;
+}
+
 /**
  * @brief Инициализирует TCP-сокет и переводит его в режим прослушивания.
  * @param host IPv4-адрес в строковом виде.
  * @param port Порт в строковом виде.
+ * @param reuse_port Разрешить нескольким сокетам слушать один порт (SO_REUSEPORT),
+ *        ядро распределяет подключения между ними.
  *
  * @return variant<int, Error>
  *         - int  — файловый дескриптор слушающего сокета.
  *         - Error — ошибка с кодом и сообщением.
  */
 std::variant<int, Error>
-init_listen_server(const std::string& host, const std::string& port) {
+init_listen_server(const std::string& host, const std::string& port, bool reuse_port) {
   sockaddr_in listen_address{};
   int fd{};
   if (auto error = convert_string_to_host(host,port,listen_address)) {
@@ -223,6 +1226,9 @@ init_listen_server(const std::string& host, const std::string& port) {
   if (::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
     return Error(Error_code::ERROR, strerror(errno));
   }
+  if (reuse_port && ::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
+    return Error(Error_code::ERROR, strerror(errno));
+  }
   if (::bind(fd, reinterpret_cast<sockaddr*>(&listen_address), sizeof(listen_address)) < 0) {
     return Error(Error_code::ERROR, strerror(errno));
   }
@@ -232,6 +1238,76 @@ init_listen_server(const std::string& host, const std::string& port) {
   return fd;
 }
 
+/**
+ * @brief Инициализирует сокет домена UNIX и переводит его в режим прослушивания.
+ * @param path Путь к файлу сокета. Существующий сокет заменяется, только если
+ *        он не принимает подключений (остался от завершившегося процесса);
+ *        сокет работающего сервера и файл другого типа - ошибка.
+ * @param type Тип сокета (SOCK_STREAM или SOCK_SEQPACKET).
+ *
+ * @return variant<int, Error>
+ *         - int  — файловый дескриптор слушающего сокета.
+ *         - Error — ошибка с кодом и сообщением.
+ */
+std::variant<int, Error>
+init_listen_unix(const std::string& path, int type) {
+  sockaddr_un listen_address{};
+  if (path.empty() || path.size() >= sizeof(listen_address.sun_path)) {
+    return Error(Error_code::ERROR, "Invalid socket path");
+  }
+  listen_address.sun_family = AF_UNIX;
+  std::memcpy(listen_address.sun_path, path.data(), path.size());
+  int fd = ::socket(AF_UNIX, type, 0);
+  if (fd < 0) {
+    return Error(Error_code::ERROR, strerror(errno));
+  }
+  struct stat info{};
+  if (!::lstat(path.data(), &info)) {
+    if (!S_ISSOCK(info.st_mode)) {
+      close(fd);
+      return Error(Error_code::ERROR, path + ": exists and is not a socket");
+    }
+    int probe = ::socket(AF_UNIX, type, 0);
+    bool stale = probe >= 0 &&
+      ::connect(probe, reinterpret_cast<sockaddr*>(&listen_address), sizeof(listen_address)) < 0 &&
+      errno == ECONNREFUSED;
+    if (probe >= 0) close(probe);
+    if (!stale) {
+      close(fd);
+      return Error(Error_code::ERROR, path + ": socket is in use");
+    }
+    ::unlink(path.data());
+  }
+  if (::bind(fd, reinterpret_cast<sockaddr*>(&listen_address), sizeof(listen_address)) < 0 ||
+      ::listen(fd, LISTEN_QUEUE) < 0) {
+    Error error(Error_code::ERROR, strerror(errno));
+    close(fd);
+    return error;
+  }
+  return fd;
+}
+
+/**
+ * @brief Инициализирует слушающий сокет по строке адреса.
+ * @param address "<ip>:<port>" для TCP, либо путь (содержит '/') для сокета UNIX.
+ * @param type Тип сокета UNIX (SOCK_STREAM или SOCK_SEQPACKET).
+ *
+ * @return variant<int, Error>
+ *         - int  — файловый дескриптор слушающего сокета.
+ *         - Error — ошибка с кодом и сообщением.
+ */
+std::variant<int, Error>
+init_listen_address(const std::string& address, int type) {
+  if (address.find('/') != std::string::npos) {
+    return init_listen_unix(address, type);
+  }
+  auto position = address.rfind(':');
+  if (position == std::string::npos) {
+    return Error(Error_code::ERROR, "Invalid address");
+  }
+  return init_listen_server(address.substr(0, position), address.substr(position + 1));
+}
+
 /**
  * @brief Конвертирует строковые представления IP-адреса и порта в структуру sockaddr_in.
  *
@@ -1,9 +1,17 @@
 #include "logger.hpp"
+#include "archive.hpp"
+#include "shared_ring.hpp"
+#include "token_index.hpp"
 #include <chrono>
+#include <condition_variable>
+#include <functional>
 #include <limits>
+#include <mutex>
 #include <queue>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 #define LISTEN_QUEUE 512
 
 enum class Error_code {
@@ -25,37 +33,542 @@ struct Statistics_data {
   uint64_t sum_length{}, averege_length{};
   uint64_t max_length{}, min_length{};
   int Level_INFO_count{}, Level_WARN_count{},Level_ERROR_count{};
-  int count_last_interval_time{}, all_count;
+  int count_last_interval_time{}, all_count{};
 };
 
 /**
- * @class Statistic
- * @brief Класс для сбора и отображения статистики лог-сообщений за заданный интервал времени.
+ * @class Time_window
+ * @brief Счётчик сообщений за скользящее окно в секундах
+ *
+ * Кольцо секундных корзин: добавление и сдвиг окна - амортизированно O(1),
+ * объединение двух окон - O(размер окна), без хранения каждой метки времени.
+ * Окно - (newest - seconds, newest], где newest - самая поздняя метка
  */
-class Statistic {
-  std::unordered_map<Logger::Level,int> level_map{
-    {Logger::Level::INFO, 0},
-    {Logger::Level::WARN, 0},
-    {Logger::Level::ERROR, 0}
+class Time_window {
+  struct Slot {
+    time_t time{}; ///< Секунда, которой принадлежит корзина
+    uint64_t count{}; ///< Сообщений за эту секунду
   };
-  uint64_t sum_length{}, averege_length{};
+  std::vector<Slot> slots;
+  time_t newest{}; ///< Самая поздняя метка времени
+  uint64_t total{}; ///< Сообщений в окне
+  bool empty{true};
+  public:
+  explicit Time_window(int seconds) : slots(seconds) {}
+  void add(time_t, uint64_t = 1);
+  void merge(const Time_window&);
+  uint64_t count() const { return total; }
+  void serialize(std::string&) const;
+  bool deserialize(std::string_view&);
+  private:
+  Slot& slot(time_t);
+  void advance(time_t);
+};
+
+/**
+ * @class Latency_histogram
+ * @brief Гистограмма задержки доставки записей от производителя до statistic_app
+ *
+ * Корзины - степени двойки наносекунд: корзина i (i > 0) считает задержки
+ * в [2^(i-1), 2^i), корзина 0 - нулевые. Добавление - O(1), объединение -
+ * сумма корзин, поэтому шарды и частичная статистика ретрансляторов
+ * объединяются без потерь. Отрицательные задержки (часы хостов расходятся)
+ * считаются отдельно и в корзины не попадают.
+ */
+class Latency_histogram {
+  public:
+  static constexpr std::size_t bucket_count = 64;
+  private:
+  uint64_t buckets[bucket_count]{};
+  uint64_t total{}; ///< Задержек в корзинах
+  uint64_t negative{}; ///< Отрицательных задержек
+  uint64_t max_latency{}; ///< Наибольшая задержка, нс
+  public:
+  void add(Logger::Timestamp);
+  void merge(const Latency_histogram&);
+  uint64_t count() const { return total; }
+  uint64_t get_negative() const { return negative; }
+  uint64_t get_max() const { return max_latency; }
+  uint64_t percentile(double) const;
+  void serialize(std::string&) const;
+  bool deserialize(std::string_view&);
+};
+
+/**
+ * @brief Счётчики сообщений фиксированного размера: общие и одного источника
+ */
+struct Stat_block {
+  static constexpr std::size_t level_count = 3;
+  uint64_t level_counts[level_count]{}; ///< Количество сообщений по уровням
+  uint64_t sum_length{};
   uint64_t max_length{};
   uint64_t min_length = std::numeric_limits<uint64_t>::max();
-  std::queue<time_t> times{};
+
+  void update(Logger::Level, uint64_t length);
+  void merge(const Stat_block&);
+  uint64_t count() const;
+  void serialize(std::string&) const;
+  bool deserialize(std::string_view&);
+};
+
+/**
+ * @class Source_table
+ * @brief Статистика по источникам записей (идентификатор при согласовании)
+ *
+ * Таблица с открытой адресацией (линейное пробирование) из блоков
+ * фиксированного размера: имя хранится в блоке, поиск не выделяет память.
+ * Количество источников ограничено max_sources: при заполнении источник,
+ * не присылавший записей дольше idle_seconds (по меткам записей),
+ * вытесняется - его счётчики переносятся в блок "other"; если простаивающих
+ * нет, записи нового источника учитываются в "other". Удаление - обратным
+ * сдвигом, без надгробий. Память выделяется при первой записи.
+ */
+class Source_table {
+  public:
+  static constexpr std::size_t default_max_sources = 256;
+  static constexpr time_t default_idle_seconds = 300;
+
+  /// Блок источника
+  struct Entry {
+    uint64_t hash{}; ///< 0 - свободная ячейка
+    time_t last_seen{}; ///< Метка последней записи
+    uint8_t name_size{};
+    char name[Logger::Transport::max_source_length];
+    Stat_block stats;
+    std::string_view get_name() const { return {name, name_size}; }
+  };
+
+  explicit Source_table(std::size_t max_sources = default_max_sources,
+    time_t idle_seconds = default_idle_seconds);
+
+  Stat_block& find(std::string_view source, time_t);
+  void merge(const Source_table&);
+  std::size_t size() const { return used; }
+  const Stat_block& get_other() const { return other; }
+  uint64_t get_evicted() const { return evicted; }
+  Stat_block total() const;
+  std::vector<const Entry*> top(std::size_t) const;
+  void serialize(std::string&) const;
+  bool deserialize(std::string_view&);
+
+  private:
+  std::vector<Entry> slots; ///< Степень двойки, заполнение не больше 3/4
+  std::size_t max_sources;
+  time_t idle_seconds;
+  std::size_t used{};
+  time_t newest{}; ///< Самая поздняя метка записи
+  Stat_block other; ///< Вытесненные и не поместившиеся источники
+  uint64_t evicted{}; ///< Вытеснено источников
+  time_t evict_after{}; ///< До этой метки простаивающих источников нет
+  bool evict_idle();
+  void erase(std::size_t);
+};
+
+/**
+ * @class Statistic
+ * @brief Класс для сбора и отображения статистики лог-сообщений за заданный интервал времени.
+ *
+ * Несколько экземпляров (шардов) объединяются методом merge().
+ * Счётчики ведутся по источникам (Source_table); общие счётчики равны
+ * объединению блоков источников и обновляются вместе с ними, чтобы снимок,
+ * публикуемый на каждую запись, не обходил таблицу.
+ */
+class Statistic {
+  Stat_block total; ///< Объединение блоков источников
+  Source_table sources; ///< Счётчики по источникам
   public:
   static constexpr int interval_time = 3600; // 1 час
+  private:
+  Time_window times{interval_time};
+  Latency_histogram latency; ///< Задержка доставки записей с метками в наносекундах
+  public:
   std::ostream& statistic_display(std::ostream& os) const;
   Statistics_data get_statistics_data() const;
-  void update(const Logger::Logger_protocol::Protocol&);
+  void update(const Logger::Logger_protocol::Protocol&, std::string_view source = {});
+  void update(Logger::Level, uint64_t length, time_t, std::string_view source = {});
+  void add_latency(Logger::Timestamp);
+  const Latency_histogram& get_latency() const { return latency; }
+  const Source_table& get_sources() const { return sources; }
+  void merge(const Statistic&);
   uint64_t get_count_message() const;
+  void serialize(std::string&) const;
+  static std::optional<Statistic> deserialize(std::string_view);
+  private:
+  uint64_t average_length() const;
+};
+
+Statistics_data merge_statistics_data(const Statistics_data&, const Statistics_data&);
+
+/**
+ * @enum Echo_mode
+ * @brief Режимы вывода принятых сообщений на консоль
+ */
+enum class Echo_mode {
+  FULL,    ///< Все сообщения
+  LEVEL,   ///< Сообщения с уровнем не ниже заданного
+  SAMPLED, ///< Каждое N-е сообщение
+  NONE     ///< Только статистика
+};
+
+struct Echo_config {
+  Echo_mode mode = Echo_mode::FULL;
+  Logger::Level level = Logger::Level::INFO; ///< Порог для Echo_mode::LEVEL
+  uint64_t sample = 1; ///< N для Echo_mode::SAMPLED
+  std::size_t capacity = 4096; ///< Ёмкость буфера записей
+  Logger::Output_format format = Logger::Output_format::TEXT; ///< Формат строк записей
+};
+
+std::optional<Echo_config> parse_echo_config(const std::string&);
+
+/**
+ * @class Console_echo
+ * @brief Неблокирующий вывод сообщений и статистики на консоль
+ *
+ * Записи передаются в отдельный поток вывода через ограниченный буфер.
+ * Если консоль не успевает, записи отбрасываются, а количество
+ * отброшенных выводится отдельной строкой - приём данных не тормозится.
+ * Отчёты статистики не отбрасываются и не фильтруются режимом.
+ * Записи выводятся в Echo_config::format, отчёты - текстом как есть.
+ */
+class Console_echo {
+  Echo_config config;
+  std::ostream& os; ///< Поток вывода, используется только потоком вывода
+  std::mutex mtx; ///< Защищает records, reports, waiting, stopped
+  std::condition_variable condvar;
+  std::vector<Logger::Logger_protocol::Protocol> records; ///< Записи для вывода
+  std::vector<std::string> reports; ///< Отчёты статистики и ошибки
+  bool waiting{false}; ///< Поток вывода ожидает данных
+  bool stopped{false};
+  std::atomic<uint64_t> sample_counter{}; ///< Счётчик для выборки 1 из N
+  std::atomic<uint64_t> dropped{}; ///< Отброшено записей
+  std::thread worker; ///< Поток вывода
+  public:
+  Console_echo(std::ostream&, const Echo_config& = {});
+  Console_echo(const Console_echo&) = delete;
+  Console_echo& operator=(const Console_echo&) = delete;
+  ~Console_echo() { stop(); }
+
+  bool echo(Logger::Logger_protocol::Protocol&&);
+  void report(std::string&&);
+  void stop();
+  uint64_t get_dropped() const { return dropped.load(std::memory_order_relaxed); }
   private:
-  void add_time(time_t);
-  void update_length_message(uint64_t);
+  bool accept(const Logger::Logger_protocol::Protocol&);
+  void run();
+};
+
+/**
+ * @class Statistic_snapshot
+ * @brief Последний опубликованный снимок Statistics_data (seqlock)
+ *
+ * Писатель (поток приёма) публикует снимок без блокировок и ожидания,
+ * читатели повторяют чтение, если попали на запись. Любое количество
+ * читателей не влияет на писателя.
+ * @note Данные хранятся словами std::atomic, чтобы чтение во время
+ *       записи не было гонкой данных
+ */
+class Statistic_snapshot {
+  static constexpr std::size_t words = (sizeof(Statistics_data) + 7) / 8;
+  std::atomic<uint64_t> sequence{}; ///< Нечётное значение - идёт запись
+  std::atomic<uint64_t> data[words]{};
+  public:
+  void publish(const Statistics_data&);
+  Statistics_data read() const;
+  uint64_t version() const { return sequence.load(std::memory_order_acquire) / 2; }
+};
+
+std::string statistics_to_json(const Statistics_data&);
+std::string statistics_to_binary(const Statistics_data&);
+std::optional<Statistics_data> statistics_from_binary(std::string_view);
+
+/**
+ * @class Stats_endpoint
+ * @brief Локальный сокет запросов статистики
+ *
+ * Отдельный поток принимает подключения мониторинга и на каждый запрос
+ * отвечает кадром протокола lib_logger (длина + данные):
+ * - байт 'j' - снимок в JSON;
+ * - байт 'b' - снимок в двоичном виде (9 чисел uint64_t, big-endian).
+ * Снимок собирается функцией source из Statistic_snapshot шардов,
+ * поток приёма не блокируется.
+ */
+class Stats_endpoint {
+  int listen_fd{-1};
+  std::function<Statistics_data()> source; ///< Источник снимка статистики
+  std::atomic<bool> stopped{false};
+  std::thread worker;
+  public:
+  Stats_endpoint(int, std::function<Statistics_data()>);
+  Stats_endpoint(const Stats_endpoint&) = delete;
+  Stats_endpoint& operator=(const Stats_endpoint&) = delete;
+  ~Stats_endpoint() { stop(); }
+  void stop();
+  private:
+  void run();
+  bool answer(int);
+};
+
+/**
+ * @brief Шард статистики одного потока-обработчика
+ *
+ * Обновляется только своим обработчиком; мьютекс не конкурентен
+ * и захватывается другим потоком лишь при объединении шардов для отчёта
+ */
+struct Statistic_shard {
+  std::mutex mtx; ///< Защищает stats и pending
+  Statistic stats;
+  Statistic_snapshot snapshot; ///< Снимок шарда для сокета запросов
+  Statistic pending; ///< Частичная статистика для отправки вверх (ретрансляция)
+  std::unique_ptr<Logger::Logging> upstream; ///< Пересылка записей, только поток шарда
+  std::chrono::steady_clock::time_point upstream_flush; ///< Последняя отправка пачки
 };
 
-int statistic_app_run(const int, const std::chrono::seconds, const int);
+/**
+ * @enum Relay_mode
+ * @brief Что ретранслятор отправляет вышестоящему statistic_app
+ */
+enum class Relay_mode {
+  RECORDS,  ///< Записи пачками (Logger::Socket_options)
+  PARTIALS  ///< Частичную статистику за интервал
+};
+
+/**
+ * @brief Настройки ретрансляции
+ *
+ * Частичная статистика, полученная от нижестоящих ретрансляторов,
+ * пересылается как частичная в обоих режимах.
+ */
+struct Relay_config {
+  std::string upstream; ///< "<ip>:<port>" или путь к сокету UNIX
+  Relay_mode mode = Relay_mode::RECORDS;
+  std::chrono::milliseconds interval{500}; ///< Период отправки пачек и частичной статистики
+};
+
+std::optional<Relay_config> parse_relay_config(const std::string& upstream, const std::string& mode);
+
+/// Первый байт кадра частичной статистики после согласования
+constexpr char partial_frame = 'S';
+
+/**
+ * @class Relay_link
+ * @brief Соединение с вышестоящим statistic_app для частичной статистики
+ *
+ * Подключается и согласует кадры с типом при первой отправке,
+ * после ошибки переподключается при следующей.
+ */
+class Relay_link {
+  std::string host, port;
+  int fd{-1};
+  std::string frame; ///< Переиспользуемый буфер кадра
+  public:
+  explicit Relay_link(const std::string& upstream);
+  Relay_link(const Relay_link&) = delete;
+  Relay_link& operator=(const Relay_link&) = delete;
+  ~Relay_link() { disconnect(); }
+  std::optional<Error> send(const Statistic&);
+  private:
+  std::optional<Error> connect();
+  void disconnect();
+};
+
+/**
+ * @class Statistic_context
+ * @brief Общее состояние обработчиков statistic_app
+ *
+ * Хранит шарды статистики, счётчик сообщений для отчётов по количеству
+ * и вывод на консоль. Отчёты строятся объединением шардов.
+ */
+class Statistic_context {
+  std::vector<std::unique_ptr<Statistic_shard>> shards;
+  Console_echo& echo;
+  const uint64_t interval_count_message;
+  std::atomic<uint64_t> count_message{}; ///< Сообщений во всех шардах
+  std::mutex report_mtx; ///< Упорядочивает отчёты
+  uint64_t previous_count_message{}; ///< Количество при последнем отчёте
+  std::atomic<bool> stopped{false};
+  std::optional<Relay_config> relay; ///< Настройки ретрансляции
+  std::unique_ptr<Relay_link> relay_link; ///< Отправка частичной статистики
+  std::chrono::steady_clock::time_point relay_sent; ///< Последняя отправка частичной
+  std::size_t max_frame = Logger::Transport::max_frame_size; ///< Наибольший принимаемый кадр
+  public:
+  Statistic_context(std::size_t, Console_echo&, uint64_t);
+  Statistic_context(const Statistic_context&) = delete;
+  Statistic_context& operator=(const Statistic_context&) = delete;
+
+  std::size_t shard_count() const { return shards.size(); }
+  Statistic_shard& shard(std::size_t index) { return *shards[index]; }
+  Console_echo& get_echo() { return echo; }
+
+  void set_relay(const Relay_config&);
+  void set_max_frame(std::size_t size) { max_frame = size; }
+  std::size_t get_max_frame() const { return max_frame; }
+  bool relays_records() const { return relay && relay->mode == Relay_mode::RECORDS; }
+  void process(Statistic_shard&, Logger::Logger_protocol::Protocol&&, Logger::Timestamp received = {},
+    std::string_view source = {}, std::optional<uint64_t> length = {},
+    const Logger::Logger_protocol::Protocol* whole = nullptr);
+  void process_partial(Statistic_shard&, const Statistic&);
+  void relay_tick(Statistic_shard&, bool force = false);
+  void relay_partials(bool force = false);
+  Statistic merge();
+  Statistics_data snapshot_data() const;
+  void report(bool only_changed);
+  void stop() { stopped = true; }
+  bool is_stopped() const { return stopped; }
+  private:
+  void relay_record(Statistic_shard&, const Logger::Logger_protocol::Protocol&);
+};
+
+/**
+ * @brief Запись, принимаемая частями (Logger::Transport::Frame_type::CHUNK)
+ *
+ * Для статистики запись целиком не хранится: длина считается по мере приёма,
+ * сохраняются начало сообщения для вывода и конец записи с уровнем и временем.
+ * При ретрансляции записей (Relay_mode::RECORDS) запись собирается целиком,
+ * но не длиннее сообщения наибольшей длины (Protocol::max_length)
+ */
+struct Chunked_record {
+  static constexpr std::size_t preview_bytes = 256; ///< Начало записи для вывода
+  static constexpr std::size_t tail_bytes = 64; ///< Конец записи: " <уровень> <время>" с запасом
+  bool active{false}; ///< Приняты части без последней
+  bool assemble{false}; ///< Собирать запись целиком для ретрансляции
+  uint64_t bytes{}; ///< Принято байт записи
+  std::string head; ///< Первые preview_bytes байт записи
+  std::string tail; ///< Последние tail_bytes байт записи
+  std::string whole; ///< Запись целиком, если assemble
+
+  /// Добавляет часть к записи
+  void append(std::string_view data);
+};
+
+/**
+ * @brief Буфер приёма кадров SOCK_STREAM
+ *
+ * Память выделяется без заполнения нулями и переиспользуется: буфер растёт,
+ * только когда префикс длины объявляет кадр больше ёмкости
+ */
+struct Input_buffer {
+  std::unique_ptr<char[]> data;
+  std::size_t capacity{}; ///< Выделено байт
+  std::size_t used{}; ///< Принято байт, начиная с data[0]
+
+  /// Увеличивает ёмкость до size, сохраняя принятые байты
+  void reserve(std::size_t size);
+};
+
+/**
+ * @brief Состояние подключения обработчика
+ */
+struct Connection {
+  bool packet{false}; ///< Сокет SOCK_SEQPACKET: кадр - один пакет
+  bool framed{false}; ///< Согласованы кадры с типом (Logger::Transport)
+  bool nanoseconds{false}; ///< Согласовано время записей в наносекундах
+  bool acknowledge{false}; ///< Согласованы подтверждения записей
+  std::string source; ///< Идентификатор источника из согласования
+  uint64_t received{}; ///< Записей принято соединением
+  std::string scratch; ///< Буфер распаковки сжатых пачек
+  Chunked_record chunked; ///< Запись, принимаемая частями
+  Input_buffer input; ///< Принятые байты неполного кадра с префиксом длины (SOCK_STREAM)
+  std::string packet_frame; ///< Буфер пакета (SOCK_SEQPACKET)
+  std::string output; ///< Неотправленные ответы: кадры с префиксом длины
+};
+
+std::optional<Logger::Error> handle_frame(Connection&, std::string_view frame, Statistic_shard&,
+  Statistic_context&, std::string& reply);
+
+/**
+ * @brief Результат разбора файлов журнала
+ */
+struct File_analysis {
+  Statistic stats; ///< Объединённая статистика
+  uint64_t lines{}; ///< Учтено строк и записей архивов
+  uint64_t skipped{}; ///< Строк не в формате print_log_entry
+  uint64_t filtered{}; ///< Строк и записей вне интервала времени
+  uint64_t bytes{}; ///< Размер файлов
+  uint64_t blocks{}; ///< Прочитано блоков архивов
+  uint64_t skipped_blocks{}; ///< Блоков архивов вне интервала, не прочитанных
+};
+
+/**
+ * @brief Интервал времени разбора, секунды от начала эпохи Unix, границы включаются
+ */
+struct Time_range {
+  time_t from = std::numeric_limits<time_t>::min();
+  time_t to = std::numeric_limits<time_t>::max();
+  bool contains(time_t time) const { return time >= from && time <= to; }
+};
+
+/**
+ * @class Log_line_parser
+ * @brief Разбор строки формата Logger_protocol::print_log_entry
+ *
+ * "<сообщение> <УРОВЕНЬ> YYYY-MM-DD HH:MM:SS[.<дробная часть>]", время локальное.
+ * Смещение местного времени кэшируется по часу, mktime вызывается
+ * один раз на каждый новый час.
+ */
+class Log_line_parser {
+  time_t cached_hour = -1; ///< Местное время начала кэшированного часа без учёта пояса
+  time_t cached_offset{}; ///< Разница с UTC для этого часа
+  public:
+  struct Line {
+    Logger::Level level;
+    std::size_t length; ///< Длина сообщения, оно - начало строки
+    time_t time;
+    long nanoseconds; ///< Дробная часть секунды
+  };
+  std::optional<Line> parse(std::string_view);
+};
+
+std::variant<File_analysis, Error>
+analyze_log_files(const std::vector<std::string>&, std::size_t threads,
+  std::size_t chunk_bytes = 8u << 20, const Time_range& = {});
+
+/**
+ * @brief Результат преобразования журнала в архив
+ */
+struct Archive_conversion {
+  uint64_t lines{}; ///< Записано записей
+  uint64_t skipped{}; ///< Строк не в формате print_log_entry
+  uint64_t bytes{}; ///< Размер журнала
+  uint64_t archive_bytes{}; ///< Размер архива
+  uint64_t blocks{}; ///< Блоков архива
+};
+
+std::variant<Archive_conversion, Error>
+convert_log_file(const std::string& log_file, const std::string& archive_file,
+  const Logger::Archive::Writer_options& = {});
+
+/**
+ * @brief Результат поиска токенов в журналах
+ */
+struct Log_search {
+  uint64_t matches{}; ///< Найдено строк
+  uint64_t segments{}; ///< Сегментов индекса, соответствующих журналам
+  uint64_t skipped_segments{}; ///< Сегментов, исключённых фильтрами, не прочитанных
+  uint64_t bytes{}; ///< Размер журналов
+  uint64_t bytes_read{}; ///< Прочитано байт журналов
+};
+
+/// Получает найденную строку (без перевода строки) и путь к её журналу
+using Search_callback = std::function<void(const std::string& file, std::string_view line)>;
+
+std::variant<Log_search, Error>
+search_log_files(const std::vector<std::string>&, std::string_view query, const Search_callback&);
+
+/// Дополнительный источник записей: выполняется в своём потоке со своим шардом
+using Statistic_input = std::function<int(Statistic_shard&, Statistic_context&)>;
+
+int statistic_worker_run(const int, Statistic_shard&, Statistic_context&);
+int statistic_ring_run(Logger::Shared_ring&, Statistic_shard&, Statistic_context&);
+/// Обработчик на сопрограммах, собирается с -DSTATISTIC_ASYNC=ON (src/async)
+int statistic_async_run(const int, Statistic_shard&, Statistic_context&);
+int statistic_app_run(const std::vector<int>&, const std::chrono::seconds, Statistic_context&,
+  const std::vector<Statistic_input>& = {});
+std::variant<int, Error>
+init_listen_server(const std::string&, const std::string&, bool = false);
+std::variant<int, Error>
+init_listen_unix(const std::string&, int = SOCK_STREAM);
 std::variant<int, Error>
-init_listen_server(const std::string&, const std::string&);
+init_listen_address(const std::string&, int = SOCK_STREAM);
 
 std::optional<Error>
 convert_string_to_host(const std::string&, const std::string&, sockaddr_in&);
@@ -0,0 +1,191 @@
+#include "statistic_app.hpp"
+#include <endian.h>
+#include <sys/poll.h>
+#include <algorithm>
+#include <cerrno>
+#include <sstream>
+
+/**
+ * @brief Публикует новый снимок статистики
+ *
+ * Последовательность нечётна на время записи, читатели,
+ * увидевшие нечётное или изменившееся значение, повторяют чтение.
+ * @param value Новый снимок
+ * @note Предполагается один писатель
+ */
+void Statistic_snapshot::publish(const Statistics_data& value) {
+  uint64_t buffer[words]{};
+  std::memcpy(buffer, &value, sizeof(value));
+  auto start = sequence.load(std::memory_order_relaxed);
+  sequence.store(start + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  for (std::size_t i = 0; i < words; ++i) {
+    data[i].store(buffer[i], std::memory_order_relaxed);
+  }
+  sequence.store(start + 2, std::memory_order_release);
+}
+
+/**
+ * @brief Читает согласованный снимок статистики
+ * @return Statistics_data Последний полностью опубликованный снимок
+ */
+Statistics_data Statistic_snapshot::read() const {
+  uint64_t buffer[words];
+  uint64_t before{}, after{};
+  do {
+    before = sequence.load(std::memory_order_acquire);
+    for (std::size_t i = 0; i < words; ++i) {
+      buffer[i] = data[i].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    after = sequence.load(std::memory_order_relaxed);
+  } while ((before & 1) || before != after);
+  Statistics_data value;
+  std::memcpy(&value, buffer, sizeof(value));
+  return value;
+}
+
+/**
+ * @brief Формирует JSON-представление статистики
+ * @param data Снимок статистики
+ * @return string Объект JSON в одну строку
+ */
+std::string statistics_to_json(const Statistics_data& data) {
+  std::ostringstream os;
+  os << "{\"count\":" << data.all_count <<
+  ",\"info\":" << data.Level_INFO_count <<
+  ",\"warn\":" << data.Level_WARN_count <<
+  ",\"error\":" << data.Level_ERROR_count <<
+  ",\"last_hour\":" << data.count_last_interval_time <<
+  ",\"sum_length\":" << data.sum_length <<
+  ",\"averege_length\":" << data.averege_length <<
+  ",\"max_length\":" << data.max_length <<
+  ",\"min_length\":" << data.min_length << '}';
+  return os.str();
+}
+
+/**
+ * @brief Формирует двоичное представление статистики
+ *
+ * Порядок полей: count, info, warn, error, last_hour,
+ * sum_length, averege_length, max_length, min_length;
+ * каждое поле - uint64_t в сетевом порядке байт
+ *
+ * @param data Снимок статистики
+ * @return string 72 байта
+ */
+std::string statistics_to_binary(const Statistics_data& data) {
+  const uint64_t fields[] = {
+    static_cast<uint64_t>(data.all_count),
+    static_cast<uint64_t>(data.Level_INFO_count),
+    static_cast<uint64_t>(data.Level_WARN_count),
+    static_cast<uint64_t>(data.Level_ERROR_count),
+    static_cast<uint64_t>(data.count_last_interval_time),
+    data.sum_length, data.averege_length, data.max_length, data.min_length
+  };
+  std::string out(sizeof(fields), '\0');
+  for (std::size_t i = 0; i < std::size(fields); ++i) {
+    uint64_t value = ::htobe64(fields[i]);
+    std::memcpy(out.data() + i * sizeof(value), &value, sizeof(value));
+  }
+  return out;
+}
+
+/**
+ * @brief Разбирает двоичное представление статистики
+ * @param binary 72 байта в формате statistics_to_binary
+ * @return optional<Statistics_data> Снимок или пустое значение при неверной длине
+ */
+std::optional<Statistics_data> statistics_from_binary(std::string_view binary) {
+  uint64_t fields[9];
+  if (binary.size() != sizeof(fields)) return {};
+  for (std::size_t i = 0; i < std::size(fields); ++i) {
+    uint64_t value;
+    std::memcpy(&value, binary.data() + i * sizeof(value), sizeof(value));
+    fields[i] = ::be64toh(value);
+  }
+  Statistics_data data;
+  data.all_count = static_cast<int>(fields[0]);
+  data.Level_INFO_count = static_cast<int>(fields[1]);
+  data.Level_WARN_count = static_cast<int>(fields[2]);
+  data.Level_ERROR_count = static_cast<int>(fields[3]);
+  data.count_last_interval_time = static_cast<int>(fields[4]);
+  data.sum_length = fields[5];
+  data.averege_length = fields[6];
+  data.max_length = fields[7];
+  data.min_length = fields[8];
+  return data;
+}
+
+/**
+ * @brief Запускает поток обслуживания запросов статистики
+ * @param fd Слушающий сокет, переходит во владение объекта
+ * @param source Источник снимка, вызывается на каждый запрос
+ */
+Stats_endpoint::Stats_endpoint(int fd, std::function<Statistics_data()> source)
+  : listen_fd(fd), source(std::move(source)) {
+  worker = std::thread([this]{ run(); });
+}
+
+/**
+ * @brief Останавливает поток и закрывает слушающий сокет
+ */
+void Stats_endpoint::stop() {
+  stopped = true;
+  if (worker.joinable()) worker.join();
+  if (listen_fd != -1) {
+    close(listen_fd);
+    listen_fd = -1;
+  }
+}
+
+/**
+ * @brief Отвечает на запросы одного клиента
+ * @param fd Сокет клиента с данными для чтения
+ * @return false, если клиент отключился или прислал неизвестный запрос
+ */
+bool Stats_endpoint::answer(int fd) {
+  char request[64];
+  auto received = ::recv(fd, request, sizeof(request), 0);
+  if (received <= 0) return false;
+  for (ssize_t i = 0; i < received; ++i) {
+    std::string response;
+    switch (request[i]) {
+      case 'j': response = statistics_to_json(source()); break;
+      case 'b': response = statistics_to_binary(source()); break;
+      case '\n': case '\r': continue;
+      default: return false;
+    }
+    if (std::holds_alternative<Logger::Error>(Logger::Socket::socket_write(fd, response))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Цикл обслуживания: poll по слушающему сокету и клиентам
+ *
+ * Таймаут poll ограничивает время реакции на stop()
+ */
+void Stats_endpoint::run() {
+  constexpr int stop_check_ms = 100;
+  std::vector<pollfd> fds{{listen_fd, POLLIN, 0}};
+  while (!stopped) {
+    int ready = ::poll(fds.data(), fds.size(), stop_check_ms);
+    if (ready <= 0) continue;
+    for (std::size_t i = 1; i < fds.size(); ++i) {
+      if (fds[i].revents && !answer(fds[i].fd)) {
+        close(fds[i].fd);
+        fds[i].fd = -1;
+      }
+    }
+    fds.erase(std::remove_if(fds.begin() + 1, fds.end(),
+      [](const pollfd& item) { return item.fd == -1; }), fds.end());
+    if (fds[0].revents & POLLIN) {
+      int client = ::accept(listen_fd, nullptr, nullptr);
+      if (client != -1) fds.push_back({client, POLLIN, 0});
+    }
+  }
+  for (std::size_t i = 1; i < fds.size(); ++i) close(fds[i].fd);
+}
@@ -1,6 +1,11 @@
 #include "../src/statistic_app.hpp"
 #include <algorithm>
 #include <cassert>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <thread>
+#include <sys/un.h>
 
 void test_valid_ip_port() {
   sockaddr_in addr{};
@@ -29,6 +34,56 @@ void test_invalid_port_too_large() {
     assert(err->get_err_message() == "Invalid port");
 }
 
+void test_listen_unix() {
+  const std::string path = "/tmp/test_statistic_listen.sock";
+  ::unlink(path.data());
+
+  /* файл другого типа не удаляется */
+  std::ofstream(path) << "data";
+  assert(std::holds_alternative<Error>(init_listen_unix(path, SOCK_STREAM)));
+  assert(std::ifstream(path).is_open());
+  ::unlink(path.data());
+
+  /* сокет работающего сервера не заменяется */
+  auto live = init_listen_unix(path, SOCK_SEQPACKET);
+  assert(std::holds_alternative<int>(live));
+  assert(std::holds_alternative<Error>(init_listen_unix(path, SOCK_SEQPACKET)));
+  assert(std::holds_alternative<Error>(init_listen_unix(path, SOCK_STREAM)));
+
+  /* пакет нулевой длины - не закрытие соединения */
+  std::ostringstream out;
+  Echo_config quiet;
+  quiet.mode = Echo_mode::NONE;
+  Console_echo echo(out, quiet);
+  Statistic_context context(1, echo, 1000);
+  std::thread worker([&]{
+    statistic_worker_run(std::get<int>(live), context.shard(0), context);
+  });
+  int client = ::socket(AF_UNIX, SOCK_SEQPACKET, 0);
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  std::memcpy(address.sun_path, path.data(), path.size());
+  assert(!::connect(client, reinterpret_cast<sockaddr*>(&address), sizeof(address)));
+  assert(!::send(client, "", 0, MSG_NOSIGNAL));
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  std::string record = "after empty 0 " + std::to_string(std::time(nullptr));
+  assert(::send(client, record.data(), record.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(record.size()));
+  for (int i = 0; i < 100 && context.snapshot_data().all_count != 1; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  assert(context.snapshot_data().all_count == 1);
+  ::close(client);
+  context.stop();
+  worker.join();
+
+  /* сокет завершившегося сервера заменяется */
+  close(std::get<int>(live));
+  auto replaced = init_listen_unix(path, SOCK_SEQPACKET);
+  assert(std::holds_alternative<int>(replaced));
+  close(std::get<int>(replaced));
+  ::unlink(path.data());
+}
+
 void statistic_test() {
   Statistic stats;
 
@@ -92,11 +147,825 @@ void statistic_test() {
   assert(data.averege_length == sum_len / 3);
 }
 
+void test_statistic_merge() {
+  /* статистика двух шардов после объединения совпадает с общей */
+  Statistic all, first, second;
+  time_t now = std::time(nullptr);
+  const char* messages[] = {"a", "bbbb", "cc", "dddddddd", "eee"};
+  for (int i = 0; i < 5; ++i) {
+    auto level = static_cast<Logger::Level>(i % 3);
+    Logger::Logger_protocol::Protocol entry(messages[i], level, now + i * 1000);
+    all.update(entry);
+    (i % 2 ? first : second).update(entry);
+  }
+  first.merge(second);
+  auto merged = first.get_statistics_data();
+  auto expected = all.get_statistics_data();
+  assert(merged.all_count == expected.all_count);
+  assert(merged.Level_INFO_count == expected.Level_INFO_count);
+  assert(merged.Level_WARN_count == expected.Level_WARN_count);
+  assert(merged.Level_ERROR_count == expected.Level_ERROR_count);
+  assert(merged.sum_length == expected.sum_length);
+  assert(merged.averege_length == expected.averege_length);
+  assert(merged.max_length == expected.max_length);
+  assert(merged.min_length == expected.min_length);
+  /* окно: метки now+1000 .. now+4000, первая выпадает из часа */
+  assert(expected.count_last_interval_time == 4);
+  assert(merged.count_last_interval_time == expected.count_last_interval_time);
+
+  /* объединение снимков */
+  auto data = merge_statistics_data(Statistics_data{}, expected);
+  assert(data.all_count == expected.all_count && data.min_length == expected.min_length);
+  data = merge_statistics_data(expected, expected);
+  assert(data.all_count == 2 * expected.all_count);
+  assert(data.averege_length == expected.sum_length / expected.all_count);
+}
+
+void test_parse_echo_config() {
+  assert(parse_echo_config("full")->mode == Echo_mode::FULL);
+  assert(parse_echo_config("none")->mode == Echo_mode::NONE);
+  auto level = parse_echo_config("level:WARN");
+  assert(level && level->mode == Echo_mode::LEVEL && level->level == Logger::Level::WARN);
+  auto sample = parse_echo_config("sample:100");
+  assert(sample && sample->mode == Echo_mode::SAMPLED && sample->sample == 100);
+  assert(!parse_echo_config("sample:0"));
+  assert(!parse_echo_config("level:DEBUG"));
+  assert(!parse_echo_config("loud"));
+}
+
+/* буфер потока, блокирующий вывод до разрешения - имитирует медленную консоль */
+class Blocking_buf : public std::stringbuf {
+  std::mutex mtx;
+  std::condition_variable condvar;
+  bool blocked{false}, released{false};
+  protected:
+  std::streamsize xsputn(const char* s, std::streamsize n) override {
+    std::unique_lock lock(mtx);
+    blocked = true;
+    condvar.notify_all();
+    condvar.wait(lock, [this]{ return released; });
+    return std::stringbuf::xsputn(s, n);
+  }
+  public:
+  void wait_blocked() {
+    std::unique_lock lock(mtx);
+    condvar.wait(lock, [this]{ return blocked; });
+  }
+  void release() {
+    std::lock_guard lock(mtx);
+    released = true;
+    condvar.notify_all();
+  }
+};
+
+void test_console_echo_drops() {
+  Blocking_buf buf;
+  std::ostream os(&buf);
+  Echo_config config;
+  config.capacity = 4;
+  Console_echo echo(os, config);
+
+  /* поток вывода забирает первую запись и блокируется на консоли */
+  assert(echo.echo(Logger::Logger_protocol::Protocol("first", Logger::Level::INFO, 0)));
+  buf.wait_blocked();
+  /* буфер вмещает 4 записи, остальные отбрасываются без ожидания */
+  for (int i = 0; i < 6; ++i) {
+    echo.echo(Logger::Logger_protocol::Protocol("next", Logger::Level::INFO, 0));
+  }
+  assert(echo.get_dropped() == 2);
+  echo.report("report");
+  buf.release();
+  echo.stop();
+
+  auto out = buf.str();
+  assert(out.find("first") != std::string::npos);
+  assert(out.find("echo dropped: 2") != std::string::npos);
+  assert(out.find("report") != std::string::npos);
+}
+
+void test_console_echo_modes() {
+  std::ostringstream os;
+  Echo_config config;
+  config.mode = Echo_mode::LEVEL;
+  config.level = Logger::Level::WARN;
+  {
+    Console_echo echo(os, config);
+    assert(!echo.echo(Logger::Logger_protocol::Protocol("info", Logger::Level::INFO, 0)));
+    assert(echo.echo(Logger::Logger_protocol::Protocol("error", Logger::Level::ERROR, 0)));
+  }
+  assert(os.str().find("info") == std::string::npos);
+  assert(os.str().find("error") != std::string::npos);
+
+  config.mode = Echo_mode::SAMPLED;
+  config.sample = 3;
+  Console_echo sampled(os, config);
+  int accepted = 0;
+  for (int i = 0; i < 9; ++i) {
+    accepted += sampled.echo(Logger::Logger_protocol::Protocol("s", Logger::Level::INFO, 0));
+  }
+  assert(accepted == 3);
+
+  /* записи в JSON lines, отчёты - текстом */
+  std::ostringstream json_os;
+  Echo_config json_config;
+  json_config.format = Logger::Output_format::JSON;
+  {
+    Console_echo echo(json_os, json_config);
+    assert(echo.echo(Logger::Logger_protocol::Protocol("path \"C:\\tmp\"", Logger::Level::WARN, 0)));
+  }
+  assert(json_os.str() ==
+    "{\"time\":\"1970-01-01T00:00:00.000000000Z\",\"level\":\"WARN\",\"msg\":\"path \\\"C:\\\\tmp\\\"\"}\n");
+}
+
+void test_statistic_snapshot() {
+  Statistic_snapshot snapshot;
+  std::atomic<bool> done{false};
+  /* читатель всегда видит согласованный снимок: все поля из одной публикации */
+  std::thread reader([&]{
+    while (!done) {
+      auto data = snapshot.read();
+      assert(data.sum_length == static_cast<uint64_t>(data.all_count) * 2);
+      assert(data.max_length == static_cast<uint64_t>(data.all_count));
+    }
+  });
+  Statistics_data data;
+  for (int i = 1; i <= 100000; ++i) {
+    data.all_count = i;
+    data.sum_length = static_cast<uint64_t>(i) * 2;
+    data.max_length = i;
+    snapshot.publish(data);
+  }
+  done = true;
+  reader.join();
+  assert(snapshot.read().all_count == 100000);
+  assert(snapshot.version() == 100000);
+}
+
+void test_stats_endpoint() {
+  const std::string path = "/tmp/test_statistic_endpoint.sock";
+  auto server = init_listen_address(path);
+  assert(std::holds_alternative<int>(server));
+  Statistic_snapshot snapshot;
+  Statistics_data data;
+  data.all_count = 3;
+  data.Level_ERROR_count = 3;
+  data.min_length = 5;
+  snapshot.publish(data);
+  Stats_endpoint endpoint(std::get<int>(server), [&snapshot]{ return snapshot.read(); });
+
+  int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  std::memcpy(address.sun_path, path.data(), path.size());
+  assert(!::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)));
+
+  assert(::send(fd, "jb", 2, 0) == 2);
+  std::string response;
+  assert(!Logger::Socket::socket_read(fd, response));
+  assert(response.find("\"count\":3") != std::string::npos);
+  assert(response.find("\"min_length\":5") != std::string::npos);
+  assert(!Logger::Socket::socket_read(fd, response));
+  auto binary = statistics_from_binary(response);
+  assert(binary && binary->all_count == 3 && binary->Level_ERROR_count == 3);
+  close(fd);
+  endpoint.stop();
+  ::unlink(path.data());
+}
+
+void test_statistic_partial_serialize() {
+  Statistic stats;
+  time_t now = std::time(nullptr);
+  stats.update(Logger::Logger_protocol::Protocol("abc", Logger::Level::INFO, now));
+  stats.update(Logger::Logger_protocol::Protocol("abcdefgh", Logger::Level::ERROR, now - 10));
+  std::string binary;
+  stats.serialize(binary);
+  auto restored = Statistic::deserialize(binary);
+  assert(restored);
+  auto data = restored->get_statistics_data();
+  auto expected = stats.get_statistics_data();
+  assert(data.all_count == 2 && data.Level_ERROR_count == 1);
+  assert(data.min_length == 3 && data.max_length == 8 && data.sum_length == 11);
+  assert(data.averege_length == expected.averege_length);
+  assert(data.count_last_interval_time == 2);
+  assert(!Statistic::deserialize(binary.substr(0, binary.size() - 1)));
+  assert(!Statistic::deserialize(binary + "x"));
+}
+
+void test_latency_histogram() {
+  using std::chrono::microseconds;
+  using std::chrono::milliseconds;
+  Latency_histogram histogram;
+  for (int i = 0; i < 90; ++i) histogram.add(microseconds(100));
+  for (int i = 0; i < 10; ++i) histogram.add(milliseconds(50));
+  histogram.add(Logger::Timestamp(-5));
+  assert(histogram.count() == 100 && histogram.get_negative() == 1);
+  assert(histogram.get_max() == 50000000);
+  /* процентиль - верхняя граница корзины степени двойки */
+  auto p50 = histogram.percentile(0.5);
+  assert(p50 >= 100000 && p50 < 200000);
+  auto p99 = histogram.percentile(0.99);
+  assert(p99 == 50000000);
+  assert(Latency_histogram{}.percentile(0.5) == 0);
+
+  /* задержка учитывается для записей с временем приёма и переживает сериализацию */
+  Statistic stats;
+  auto sent = Logger::Clock::now();
+  Logger::Logger_protocol::Protocol entry("abc", Logger::Level::INFO, sent);
+  stats.update(entry);
+  stats.add_latency(sent + milliseconds(3) - entry.get_timestamp());
+  std::string binary;
+  stats.serialize(binary);
+  auto restored = Statistic::deserialize(binary);
+  assert(restored && restored->get_latency().count() == 1);
+  assert(restored->get_latency().get_max() == 3000000);
+  std::ostringstream os;
+  restored->statistic_display(os);
+  assert(os.str().find("latency p50: 3.00ms") != std::string::npos);
+
+  /* частичная статистика без гистограммы и источников (прежний ретранслятор) */
+  Statistic old_stats;
+  old_stats.update(entry);
+  binary.clear();
+  old_stats.serialize(binary);
+  std::string sources;
+  old_stats.get_sources().serialize(sources);
+  binary.resize(binary.size() - sources.size() - 3 * sizeof(uint64_t));
+  restored = Statistic::deserialize(binary);
+  assert(restored && restored->get_count_message() == 1 && !restored->get_latency().count());
+  assert(restored->get_sources().size() == 1 && restored->get_sources().total().count() == 1);
+}
+
+void test_parse_relay_config() {
+  auto config = parse_relay_config("127.0.0.1:5000", "");
+  assert(config && config->mode == Relay_mode::RECORDS);
+  config = parse_relay_config("/tmp/up.sock", "partials:250");
+  assert(config && config->mode == Relay_mode::PARTIALS);
+  assert(config->interval == std::chrono::milliseconds(250));
+  assert(!parse_relay_config("", "records"));
+  assert(!parse_relay_config("127.0.0.1", "records"));
+  assert(!parse_relay_config("127.0.0.1:5000", "all"));
+  assert(!parse_relay_config("127.0.0.1:5000", "partials:0"));
+}
+
+void test_relay_tree() {
+  /* вышестоящий statistic_app и два ретранслятора в разных режимах */
+  const std::string path = "/tmp/test_statistic_upstream.sock";
+  auto server = init_listen_address(path);
+  assert(std::holds_alternative<int>(server));
+  std::ostringstream upstream_out, relay_out;
+  Echo_config quiet;
+  quiet.mode = Echo_mode::NONE;
+  Console_echo upstream_echo(upstream_out, quiet), relay_echo(relay_out, quiet);
+  Statistic_context upstream(1, upstream_echo, 1000);
+  std::thread upstream_worker([&]{
+    statistic_worker_run(std::get<int>(server), upstream.shard(0), upstream);
+  });
+
+  time_t now = std::time(nullptr);
+  for (auto mode : {"records", "partials"}) {
+    Statistic_context relay(1, relay_echo, 1000);
+    relay.set_relay(parse_relay_config(path, std::string(mode) + ":1").value());
+    for (int i = 0; i < 10; ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+      relay.process(relay.shard(0), Logger::Logger_protocol::Protocol(
+        "relayed", static_cast<Logger::Level>(i % 3), now));
+    }
+    relay.relay_tick(relay.shard(0), true);
+    relay.relay_partials(true);
+    assert(relay.merge().get_count_message() == 10);
+  }
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (upstream.snapshot_data().all_count < 20 && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  auto data = upstream.snapshot_data();
+  assert(data.all_count == 20);
+  assert(data.Level_INFO_count == 8 && data.Level_ERROR_count == 6);
+  assert(data.count_last_interval_time == 20);
+  /* записи, пересланные с метками в наносекундах, дают задержку */
+  assert(upstream.merge().get_latency().count() == 10);
+  upstream.stop();
+  upstream_worker.join();
+  close(std::get<int>(server));
+  ::unlink(path.data());
+}
+
+void test_relay_unresponsive() {
+  /* вышестоящий сервер не принимает подключений: очередь listen заполнена */
+  int listen_fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = ::htonl(INADDR_LOOPBACK);
+  assert(!::bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)));
+  assert(!::listen(listen_fd, 0));
+  socklen_t size = sizeof(address);
+  assert(!::getsockname(listen_fd, reinterpret_cast<sockaddr*>(&address), &size));
+  std::vector<int> fillers;
+  for (int i = 0; i < 4; ++i) {
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    fillers.push_back(fd);
+  }
+
+  std::ostringstream out;
+  Echo_config quiet;
+  quiet.mode = Echo_mode::NONE;
+  Console_echo echo(out, quiet);
+  Statistic_context relay(1, echo, 1000);
+  auto upstream = "127.0.0.1:" + std::to_string(::ntohs(address.sin_port));
+  relay.set_relay(parse_relay_config(upstream, "partials").value());
+  relay.process(relay.shard(0), Logger::Logger_protocol::Protocol("pending", Logger::Level::INFO,
+    std::time(nullptr)));
+  /* отправка ограничена по времени, статистика остаётся для следующей попытки */
+  auto start = std::chrono::steady_clock::now();
+  relay.relay_partials(true);
+  assert(std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+  assert(relay.shard(0).pending.get_count_message() == 1);
+  for (int fd : fillers) ::close(fd);
+  ::close(listen_fd);
+}
+
+void test_source_table() {
+  /* заполненная таблица: новый источник - в "other", пока никто не простаивает */
+  Source_table table(4, 10);
+  for (const char* name : {"a", "b", "c", "d"}) table.find(name, 100).update(Logger::Level::INFO, 1);
+  table.find("e", 105).update(Logger::Level::WARN, 1);
+  assert(table.size() == 4 && table.get_other().count() == 1 && !table.get_evicted());
+  table.find("a", 115).update(Logger::Level::INFO, 1);
+  /* b, c, d простаивают 15 секунд: один вытесняется, "e" получает ячейку */
+  table.find("e", 115).update(Logger::Level::ERROR, 1);
+  assert(table.size() == 4 && table.get_evicted() == 1 && table.get_other().count() == 2);
+  assert(table.total().count() == 7);
+  auto top = table.top(2);
+  assert(top.size() == 2 && top[0]->get_name() == "a" && top[0]->stats.count() == 2);
+  assert(&table.find(std::string(Logger::Transport::max_source_length + 1, 'x'), 115) ==
+         &table.get_other());
+
+  /* сравнение с моделью: вытесняется источник с самой давней записью */
+  constexpr std::size_t capacity = 48;
+  Source_table lru(capacity, 0);
+  std::map<std::string, std::pair<uint64_t, time_t>> model; // имя -> (количество, последняя запись)
+  uint64_t model_other = 0, seed = 12345;
+  for (time_t t = 1; t <= 5000; ++t) {
+    seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+    auto name = "src" + std::to_string((seed >> 33) % 200);
+    lru.find(name, t).update(Logger::Level::INFO, 1);
+    if (!model.count(name) && model.size() == capacity) {
+      auto oldest = std::min_element(model.begin(), model.end(), [](auto& first, auto& second) {
+        return first.second.second < second.second.second;
+      });
+      model_other += oldest->second.first;
+      model.erase(oldest);
+    }
+    auto& item = model[name];
+    ++item.first;
+    item.second = t;
+  }
+  assert(lru.size() == model.size() && lru.get_other().count() == model_other);
+  for (const auto* entry : lru.top(capacity)) {
+    auto found = model.find(std::string(entry->get_name()));
+    assert(found != model.end() && found->second.first == entry->stats.count());
+    assert(found->second.second == entry->last_seen);
+  }
+  assert(lru.total().count() == 5000);
+
+  /* источники переживают сериализацию и объединение шардов */
+  Statistic first, second;
+  time_t now = std::time(nullptr);
+  first.update(Logger::Level::INFO, 3, now, "web");
+  first.update(Logger::Level::WARN, 5, now, "db");
+  second.update(Logger::Level::WARN, 4, now, "web");
+  second.update(Logger::Level::ERROR, 2, now);
+  std::string binary;
+  second.serialize(binary);
+  auto restored = Statistic::deserialize(binary);
+  assert(restored && restored->get_sources().size() == 2);
+  first.merge(restored.value());
+  assert(first.get_sources().size() == 3);
+  auto total = first.get_sources().total();
+  assert(total.count() == first.get_count_message() && total.sum_length == 14);
+  std::ostringstream os;
+  first.statistic_display(os);
+  assert(os.str().find("sources: 3") != std::string::npos);
+  assert(os.str().find("source web: 2 (1/1/0)") != std::string::npos);
+  assert(os.str().find("source -: 1 (0/0/1)") != std::string::npos);
+
+  /* без идентификаторов источников вывод прежний */
+  Statistic plain;
+  plain.update(Logger::Level::INFO, 3, now);
+  os.str("");
+  plain.statistic_display(os);
+  assert(os.str().find("source") == std::string::npos);
+}
+
+void test_reliable_delivery() {
+  const std::string path = "/tmp/test_statistic_reliable.sock";
+  auto server = init_listen_address(path);
+  assert(std::holds_alternative<int>(server));
+  std::ostringstream out;
+  Echo_config quiet;
+  quiet.mode = Echo_mode::NONE;
+  Console_echo echo(out, quiet);
+  Statistic_context context(1, echo, 1000);
+  std::thread worker([&]{
+    statistic_worker_run(std::get<int>(server), context.shard(0), context);
+  });
+
+  Logger::Socket_options options;
+  options.reliable = true;
+  options.batch_bytes = 256;
+  options.window_records = 16; // окно меньше числа записей: отправка ждёт подтверждений
+  options.source = "reliable-client";
+  Logger::Logging log(path, "", Logger::Level::INFO, options);
+  assert(!log.open_session());
+  for (int i = 0; i < 200; ++i) {
+    assert(!log.log_write(std::string("reliable record"), std::time(nullptr)));
+  }
+  assert(!log.close_session());
+  /* close_session ждёт подтверждений: все записи уже учтены */
+  assert(context.snapshot_data().all_count == 200);
+  assert(log.get_statistics().unacknowledged == 0);
+  /* источник объявлен при согласовании */
+  auto sources = context.merge().get_sources().top(1);
+  assert(sources.size() == 1 && sources[0]->get_name() == "reliable-client");
+  assert(sources[0]->stats.count() == 200);
+  context.stop();
+  worker.join();
+  close(std::get<int>(server));
+  ::unlink(path.data());
+}
+
+void test_slow_client() {
+  const std::string path = "/tmp/test_statistic_slow.sock";
+  auto server = init_listen_address(path);
+  assert(std::holds_alternative<int>(server));
+  std::ostringstream out;
+  Echo_config quiet;
+  quiet.mode = Echo_mode::NONE;
+  Console_echo echo(out, quiet);
+  Statistic_context context(1, echo, 1000);
+  std::thread worker([&]{
+    statistic_worker_run(std::get<int>(server), context.shard(0), context);
+  });
+
+  /* клиент отправил часть префикса длины и половину кадра и замолчал */
+  auto slow = Logger::Socket::socket_connect(path, "");
+  assert(std::holds_alternative<int>(slow));
+  std::string record = "slow record 0 " + std::to_string(std::time(nullptr));
+  uint32_t length = htonl(static_cast<uint32_t>(record.size()));
+  assert(::send(std::get<int>(slow), &length, 2, MSG_NOSIGNAL) == 2);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  assert(::send(std::get<int>(slow), reinterpret_cast<char*>(&length) + 2, 2, MSG_NOSIGNAL) == 2);
+  assert(::send(std::get<int>(slow), record.data(), 5, MSG_NOSIGNAL) == 5);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  /* остальные подключения обработчика не ждут его */
+  Logger::Socket_options options;
+  options.reliable = true;
+  Logger::Logging log(path, "", Logger::Level::INFO, options);
+  assert(!log.open_session());
+  for (int i = 0; i < 100; ++i) {
+    assert(!log.log_write(std::string("fast record"), std::time(nullptr)));
+  }
+  assert(!log.close_session());
+  assert(context.snapshot_data().all_count == 100);
+
+  /* остаток кадра дописан - запись учтена */
+  assert(::send(std::get<int>(slow), record.data() + 5, record.size() - 5, MSG_NOSIGNAL) ==
+    static_cast<ssize_t>(record.size() - 5));
+  for (int i = 0; i < 100 && context.snapshot_data().all_count != 101; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  assert(context.snapshot_data().all_count == 101);
+
+  /* уровень вне INFO..ERROR: запись отбрасывается, в счётчики не попадает */
+  for (const char* level : {"3", "4", "-1", "2"}) {
+    std::string frame = std::string("level ") + level + " " + std::to_string(std::time(nullptr));
+    uint32_t size = htonl(static_cast<uint32_t>(frame.size()));
+    frame.insert(0, reinterpret_cast<const char*>(&size), sizeof(size));
+    assert(::send(std::get<int>(slow), frame.data(), frame.size(), MSG_NOSIGNAL) ==
+      static_cast<ssize_t>(frame.size()));
+  }
+  for (int i = 0; i < 100 && context.snapshot_data().all_count != 102; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  auto data = context.snapshot_data();
+  assert(data.all_count == 102 && data.Level_ERROR_count == 1);
+  assert(context.merge().get_count_message() == 102);
+  close(std::get<int>(slow));
+  context.stop();
+  worker.join();
+  close(std::get<int>(server));
+  ::unlink(path.data());
+}
+
+void test_chunked_records() {
+  const std::string path = "/tmp/test_statistic_chunks.sock";
+  auto server = init_listen_address(path);
+  assert(std::holds_alternative<int>(server));
+  std::ostringstream out;
+  Echo_config quiet;
+  quiet.mode = Echo_mode::NONE;
+  Console_echo echo(out, quiet);
+  Statistic_context context(1, echo, 1000);
+  context.set_max_frame(4096);
+  std::thread worker([&]{
+    statistic_worker_run(std::get<int>(server), context.shard(0), context);
+  });
+
+  /* запись в 1 МБ частями по 1 КБ при кадрах не больше 4 КБ */
+  const std::size_t large = 1u << 20;
+  Logger::Socket_options options;
+  options.reliable = true;
+  options.batch_bytes = 256;
+  options.chunk_bytes = 1024;
+  Logger::Logging log(path, "", Logger::Level::INFO, options);
+  assert(!log.open_session());
+  assert(!log.log_write(std::string("short"), std::time(nullptr)));
+  assert(!log.log_write(std::string(large, 'x') + " ERROR", std::time(nullptr)));
+  assert(!log.log_write(std::string("tail"), std::time(nullptr)));
+  assert(!log.close_session());
+  auto data = context.snapshot_data();
+  assert(data.all_count == 3 && data.Level_ERROR_count == 1);
+  assert(data.max_length == large && data.sum_length == large + 5 + 4);
+
+  /* кадр больше ограничения: соединение закрывается, записи не учитываются */
+  Logger::Logging whole(path, "", Logger::Level::INFO);
+  assert(!whole.open_session());
+  whole.log_write(std::string(8192, 'y'), std::time(nullptr));
+  whole.close_session();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  assert(context.snapshot_data().all_count == 3);
+  context.stop();
+  worker.join();
+  close(std::get<int>(server));
+  ::unlink(path.data());
+
+  /* ретрансляция записей: запись, принятая частями, передаётся вверх целиком */
+  const std::string upstream_path = "/tmp/test_statistic_chunks_upstream.sock";
+  auto upstream_server = init_listen_address(upstream_path);
+  auto relay_server = init_listen_address(path);
+  assert(std::holds_alternative<int>(upstream_server) && std::holds_alternative<int>(relay_server));
+  std::ostringstream relay_out;
+  Console_echo upstream_echo(out, quiet), relay_echo(relay_out, quiet);
+  Statistic_context upstream(1, upstream_echo, 1000), relay(1, relay_echo, 1000);
+  upstream.set_max_frame(256 * 1024);
+  relay.set_max_frame(4096);
+  relay.set_relay(parse_relay_config(upstream_path, "records:1").value());
+  std::thread upstream_worker([&]{
+    statistic_worker_run(std::get<int>(upstream_server), upstream.shard(0), upstream);
+  });
+  std::thread relay_worker([&]{
+    statistic_worker_run(std::get<int>(relay_server), relay.shard(0), relay);
+  });
+  Logger::Logging relayed(path, "", Logger::Level::INFO, options);
+  assert(!relayed.open_session());
+  assert(!relayed.log_write(std::string(large, 'z') + " WARN", std::time(nullptr)));
+  assert(!relayed.close_session());
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (upstream.snapshot_data().all_count < 1 && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  data = upstream.snapshot_data();
+  assert(data.all_count == 1 && data.Level_WARN_count == 1 && data.max_length == large);
+  relay.stop();
+  relay_worker.join();
+  upstream.stop();
+  upstream_worker.join();
+  close(std::get<int>(relay_server));
+  close(std::get<int>(upstream_server));
+  ::unlink(path.data());
+  ::unlink(upstream_path.data());
+}
+
+#ifdef STATISTIC_ASYNC
+void test_async_worker() {
+  const std::string path = "/tmp/test_statistic_async.sock";
+  auto server = init_listen_address(path);
+  assert(std::holds_alternative<int>(server));
+  int listen_fd = std::get<int>(server);
+  std::ostringstream out;
+  Echo_config quiet;
+  quiet.mode = Echo_mode::NONE;
+  Console_echo echo(out, quiet);
+  Statistic_context context(2, echo, 100000);
+  /* два потока-обработчика делят слушающий сокет UNIX, как --workers */
+  int shared_fd = ::dup(listen_fd);
+  std::vector<std::thread> workers;
+  for (int fd : {listen_fd, shared_fd}) {
+    workers.emplace_back([&context, fd, index = workers.size()]{
+      assert(!statistic_async_run(fd, context.shard(index), context));
+    });
+  }
+
+  /* все подключения открыты одновременно: обработчики - сопрограммы */
+  constexpr int clients = 300, per_client = 10;
+  std::vector<std::unique_ptr<Logger::Logging>> logs;
+  for (int i = 0; i < clients; ++i) {
+    Logger::Socket_options options;
+    options.batch_bytes = 128;
+    options.reliable = i % 2; // подтверждения отправляются из сопрограммы
+    options.source = "async-" + std::to_string(i % 4);
+    logs.push_back(std::make_unique<Logger::Logging>(path, "", Logger::Level::INFO, options));
+    assert(!logs.back()->open_session());
+  }
+  for (int record = 0; record < per_client; ++record) {
+    for (auto& log : logs) assert(!log->log_write(std::string("async record"), std::time(nullptr)));
+  }
+  for (auto& log : logs) assert(!log->close_session());
+  for (int i = 0; i < 200 && context.snapshot_data().all_count < clients * per_client; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  assert(context.snapshot_data().all_count == clients * per_client);
+  assert(context.merge().get_sources().size() == 4);
+  context.stop();
+  for (auto& worker : workers) worker.join();
+  ::close(listen_fd);
+  ::close(shared_fd);
+  ::unlink(path.data());
+}
+#endif
+
+void test_analyze_log_files() {
+  const std::string first = "/tmp/test_statistic_analyze_1.log";
+  const std::string second = "/tmp/test_statistic_analyze_2.log";
+  std::remove(first.data());
+  std::remove(second.data());
+  Statistic expected;
+  time_t now = std::time(nullptr);
+  for (const auto& file : {first, second}) {
+    Logger::Logging log(file, Logger::Level::INFO);
+    assert(!log.open_session());
+    for (int i = 0; i < 300; ++i) {
+      Logger::Logger_protocol::Protocol entry(std::string(1 + i % 40, 'm'),
+        static_cast<Logger::Level>(i % 3), now - i * 30);
+      assert(!log.log_write(entry));
+      expected.update(entry);
+    }
+    assert(!log.close_session());
+  }
+  {
+    std::ofstream garbage(second, std::ios::app);
+    garbage << "not a log line\n\n";
+  }
+
+  Log_line_parser parser;
+  auto line = parser.parse("hello world WARN 2024-03-01 12:30:45");
+  assert(line && line->level == Logger::Level::WARN && line->length == 11);
+  auto precise = parser.parse("hello world WARN 2024-03-01 12:30:45.123456789");
+  assert(precise && precise->length == 11 && precise->time == line->time);
+  assert(!parser.parse("hello WARN 2024-03-01 12:30"));
+  assert(!parser.parse("hello DEBUG 2024-03-01 12:30:45"));
+
+  auto result = analyze_log_files({first, second}, 3, 512);
+  assert(std::holds_alternative<File_analysis>(result));
+  auto& analysis = std::get<File_analysis>(result);
+  assert(analysis.lines == 600 && analysis.skipped == 1);
+  auto data = analysis.stats.get_statistics_data();
+  auto wanted = expected.get_statistics_data();
+  assert(data.all_count == wanted.all_count);
+  assert(data.Level_WARN_count == wanted.Level_WARN_count);
+  assert(data.sum_length == wanted.sum_length);
+  assert(data.min_length == wanted.min_length && data.max_length == wanted.max_length);
+  assert(data.count_last_interval_time == wanted.count_last_interval_time);
+
+  assert(std::holds_alternative<Error>(analyze_log_files({"/tmp/test_statistic_missing.log"}, 2)));
+  std::remove(first.data());
+  std::remove(second.data());
+}
+
+void test_log_archive() {
+  const std::string log = "/tmp/test_statistic_archive.log";
+  const std::string archive = "/tmp/test_statistic_archive.lga";
+  std::remove(log.data());
+  std::remove(archive.data());
+  /* записи за 10 часов, по одной в 36 секунд; часть - с наносекундами */
+  time_t start = 1754839845;
+  {
+    Logger::Logging file(log, Logger::Level::INFO);
+    assert(!file.open_session());
+    for (int i = 0; i < 1000; ++i) {
+      auto time = Logger::Clock::from_seconds(start + i * 36) + Logger::Timestamp(i % 2 ? 123456789 : 0);
+      Logger::Logger_protocol::Protocol entry("record " + std::to_string(i),
+        static_cast<Logger::Level>(i % 3), time);
+      assert(!file.log_write(entry));
+    }
+    assert(!file.close_session());
+    std::ofstream garbage(log, std::ios::app);
+    garbage << "not a log line\n";
+  }
+  Logger::Archive::Writer_options options;
+  options.block_records = 100;
+  auto converted = convert_log_file(log, archive, options);
+  assert(std::holds_alternative<Archive_conversion>(converted));
+  auto& conversion = std::get<Archive_conversion>(converted);
+  assert(conversion.lines == 1000 && conversion.skipped == 1 && conversion.blocks == 10);
+  assert(conversion.archive_bytes < conversion.bytes);
+
+  /* время восстановлено с наносекундами */
+  auto opened = Logger::Archive::Reader::open(archive);
+  auto& reader = std::get<std::unique_ptr<Logger::Archive::Reader>>(opened);
+  Logger::Archive::Block block;
+  assert(!reader->read(reader->blocks()[0], Logger::Archive::ALL, block));
+  assert(block.times[1] == Logger::Clock::from_seconds(start + 36) + Logger::Timestamp(123456789));
+  assert(block.messages.rfind("record 0record 1", 0) == 0);
+
+  /* статистика по архиву совпадает со статистикой по журналу */
+  auto text = std::get<File_analysis>(analyze_log_files({log}, 2));
+  auto columnar = std::get<File_analysis>(analyze_log_files({archive}, 2));
+  auto text_data = text.stats.get_statistics_data(), archive_data = columnar.stats.get_statistics_data();
+  assert(columnar.lines == 1000 && columnar.blocks == 10 && !columnar.skipped_blocks);
+  assert(archive_data.all_count == text_data.all_count && archive_data.sum_length == text_data.sum_length);
+  assert(archive_data.Level_ERROR_count == text_data.Level_ERROR_count);
+
+  /* интервал: блоки вне него не читаются, в пограничных записи отбираются */
+  Time_range range{start + 250 * 36, start + 449 * 36};
+  auto ranged = std::get<File_analysis>(analyze_log_files({archive}, 2, 8u << 20, range));
+  assert(ranged.lines == 200 && ranged.blocks == 3 && ranged.skipped_blocks == 7);
+  assert(ranged.filtered == 100);
+  auto ranged_text = std::get<File_analysis>(analyze_log_files({log}, 2, 8u << 20, range));
+  assert(ranged_text.lines == 200 && ranged_text.filtered == 800);
+  assert(ranged.stats.get_statistics_data().sum_length ==
+         ranged_text.stats.get_statistics_data().sum_length);
+  std::remove(log.data());
+  std::remove(archive.data());
+}
+
+void test_search_log_files() {
+  const std::string log = "/tmp/test_statistic_search.log";
+  const auto index = Logger::Token_index::index_path(log);
+  std::remove(log.data());
+  std::remove(index.data());
+  /* 20000 записей с индексом по сегментам 32 КБ, затем хвост без индекса */
+  Logger::File_options options;
+  options.index_segment_bytes = 32768;
+  {
+    Logger::Logging file(log, Logger::Level::INFO, options);
+    assert(!file.open_session());
+    for (int i = 0; i < 20000; ++i) {
+      assert(!file.log_write("request id_" + std::to_string(i) + " user u" + std::to_string(i % 7) +
+        (i == 12345 ? " failed ERROR" : " served INFO"), 1754839845 + i));
+    }
+    assert(!file.close_session());
+    Logger::Logging tail(log, Logger::Level::INFO);
+    assert(!tail.open_session());
+    assert(!tail.log_write("request id_12345 retried WARN", 1754859845));
+    assert(!tail.close_session());
+  }
+  std::vector<std::string> found;
+  auto collect = [&found](const std::string&, std::string_view line) { found.emplace_back(line); };
+  auto result = search_log_files({log}, "id_12345", collect);
+  auto& search = std::get<Log_search>(result);
+  assert(search.matches == 2 && found.size() == 2);
+  assert(found[0].rfind("request id_12345 user u4 failed ERROR", 0) == 0);
+  assert(found[1].rfind("request id_12345 retried WARN", 0) == 0);
+  assert(search.segments > 20 && search.skipped_segments + 2 >= search.segments);
+  assert(search.bytes_read < search.bytes / 10);
+
+  /* все токены запроса; токен - целое слово */
+  found.clear();
+  search = std::get<Log_search>(search_log_files({log}, "id_12345 ERROR", collect));
+  assert(search.matches == 1 && found.size() == 1);
+  search = std::get<Log_search>(search_log_files({log}, "id_1234", collect));
+  assert(search.matches == 1);
+  assert(std::holds_alternative<Error>(search_log_files({log}, " -- ", collect)));
+
+  /* без индекса журнал читается целиком, результат тот же */
+  std::remove(index.data());
+  found.clear();
+  search = std::get<Log_search>(search_log_files({log}, "id_12345", collect));
+  assert(search.matches == 2 && !search.segments && search.bytes_read == search.bytes);
+  std::remove(log.data());
+}
+
 int main() {
   test_valid_ip_port();
   test_invalid_ip();
   test_invalid_port_zero();
   test_invalid_port_too_large();
+  test_listen_unix();
   statistic_test();
+  test_statistic_merge();
+  test_parse_echo_config();
+  test_console_echo_drops();
+  test_console_echo_modes();
+  test_statistic_snapshot();
+  test_stats_endpoint();
+  test_statistic_partial_serialize();
+  test_latency_histogram();
+  test_parse_relay_config();
+  test_relay_tree();
+  test_relay_unresponsive();
+  test_source_table();
+  test_reliable_delivery();
+  test_slow_client();
+  test_chunked_records();
+  test_analyze_log_files();
+  test_log_archive();
+  test_search_log_files();
+#ifdef STATISTIC_ASYNC
+  test_async_worker();
+#endif
   return 0;
 }
@@ -0,0 +1,348 @@
+#include "include/archive.hpp"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+namespace Logger::Archive {
+  namespace {
+    constexpr std::size_t header_size = 56; ///< Размер заголовка блока в файле
+    constexpr uint32_t flag_compressed = 1; ///< Текст блока сжат
+    constexpr std::size_t max_block_messages = 64u << 20; ///< Текст блока, после которого блок закрывается
+
+    void put32(std::string& out, uint32_t value) {
+      value = ::htonl(value);
+      out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void put64(std::string& out, int64_t value) {
+      auto raw = ::htobe64(static_cast<uint64_t>(value));
+      out.append(reinterpret_cast<const char*>(&raw), sizeof(raw));
+    }
+
+    uint32_t get32(const char* data) {
+      uint32_t value;
+      std::memcpy(&value, data, sizeof(value));
+      return ::ntohl(value);
+    }
+
+    int64_t get64(const char* data) {
+      uint64_t value;
+      std::memcpy(&value, data, sizeof(value));
+      return static_cast<int64_t>(::be64toh(value));
+    }
+
+    void put_varint(std::string& out, uint64_t value) {
+      while (value >= 0x80) {
+        out.push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+      }
+      out.push_back(static_cast<char>(value));
+    }
+
+    /// Читает LEB128, false - число не помещается в данные
+    bool get_varint(std::string_view& data, uint64_t& value) {
+      value = 0;
+      for (unsigned shift = 0; shift < 64 && !data.empty(); shift += 7) {
+        auto byte = static_cast<unsigned char>(data.front());
+        data.remove_prefix(1);
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+      }
+      return false;
+    }
+
+    uint64_t zigzag(int64_t value) {
+      return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    }
+
+    int64_t unzigzag(uint64_t value) {
+      return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    std::optional<Error> write_all(int fd, std::string_view data) {
+      while (!data.empty()) {
+        auto written = ::write(fd, data.data(), data.size());
+        if (written == -1) {
+          if (errno == EINTR) continue;
+          return Error(Error_code::WRITE, std::string("archive: ") + ::strerror(errno));
+        }
+        data.remove_prefix(static_cast<std::size_t>(written));
+      }
+      return {};
+    }
+
+    /// Читает ровно size байт с offset, false - ошибка или конец файла
+    bool read_all(int fd, char* data, std::size_t size, uint64_t offset) {
+      while (size) {
+        auto result = ::pread(fd, data, size, static_cast<off_t>(offset));
+        if (result == -1 && errno == EINTR) continue;
+        if (result <= 0) return false;
+        data += result;
+        size -= static_cast<std::size_t>(result);
+        offset += static_cast<uint64_t>(result);
+      }
+      return true;
+    }
+
+    Error corrupt(const char* what) {
+      return Error(Error_code::ERROR, std::string("corrupt archive block: ") + what);
+    }
+  }
+
+  /*** Archive writer ***/
+
+  /**
+   * @brief Создаёт временный файл архива и записывает сигнатуру
+   * @param path Путь к архиву
+   * @param options Размер блока
+   * @return variant<unique_ptr<Writer>, Error> Писатель или ошибка создания файла
+   */
+  std::variant<std::unique_ptr<Writer>, Error>
+  Writer::create(const std::string& path, const Writer_options& options) {
+    if (!options.block_records) return Error(Error_code::OPEN_SESSION, "archive block is empty");
+    auto temporary = path + ".tmp";
+    int fd = ::open(temporary.data(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1) return Error(Error_code::OPEN_SESSION, temporary + ": " + ::strerror(errno));
+    std::unique_ptr<Writer> writer(new Writer(fd, path, options));
+    if (auto error = write_all(fd, std::string_view(magic, sizeof(magic)))) return *error;
+    writer->bytes = sizeof(magic);
+    return writer;
+  }
+
+  /// Удаляет временный файл архива, если close() не вызывался или не удался
+  Writer::~Writer() {
+    if (fd == -1) return;
+    ::close(fd);
+    ::unlink((path + ".tmp").data());
+  }
+
+  /**
+   * @brief Добавляет запись в столбцы текущего блока
+   * @param entry Запись протокола
+   * @return optional<Error> Ошибка записи заполненного блока
+   */
+  std::optional<Error> Writer::write(const Logger_protocol::Protocol& entry) {
+    if (fd == -1) return Error(Error_code::WRITE, "archive is closed");
+    auto message = entry.get_message_view();
+    times.push_back(entry.get_timestamp().count());
+    levels.push_back(static_cast<uint8_t>(entry.get_level()));
+    lengths.push_back(static_cast<uint32_t>(message.size()));
+    messages.append(message);
+    ++records;
+    if (times.size() >= options.block_records || messages.size() >= max_block_messages) {
+      return write_block();
+    }
+    return {};
+  }
+
+  /**
+   * @brief Кодирует столбцы накопленных записей и дописывает блок в файл
+   *
+   * Время - разности с предыдущей меткой (первая - с наименьшей),
+   * записи могут идти не по порядку времени
+   */
+  std::optional<Error> Writer::write_block() {
+    if (times.empty()) return {};
+    auto [min, max] = std::minmax_element(times.begin(), times.end());
+    uint32_t level_counts[3]{};
+    std::string columns[column_count];
+    int64_t previous = *min;
+    for (auto time : times) {
+      put_varint(columns[0], zigzag(time - previous));
+      previous = time;
+    }
+    columns[1].assign((levels.size() + 3) / 4, '\0');
+    for (std::size_t i = 0; i < levels.size(); ++i) {
+      ++level_counts[levels[i] % 3];
+      columns[1][i / 4] = static_cast<char>(columns[1][i / 4] | (levels[i] & 3) << (i % 4 * 2));
+    }
+    for (auto length : lengths) put_varint(columns[2], length);
+    compressed.clear();
+    Compression::compress(messages, compressed);
+    bool compress = compressed.size() < messages.size();
+    columns[3] = compress ? compressed : messages;
+
+    block.clear();
+    put32(block, static_cast<uint32_t>(times.size()));
+    put64(block, *min);
+    put64(block, *max);
+    for (auto count : level_counts) put32(block, count);
+    for (const auto& column : columns) put32(block, static_cast<uint32_t>(column.size()));
+    put32(block, static_cast<uint32_t>(messages.size()));
+    put32(block, compress ? flag_compressed : 0);
+    for (const auto& column : columns) block.append(column);
+    if (auto error = write_all(fd, block)) return error;
+    bytes += block.size();
+    ++blocks;
+    times.clear();
+    levels.clear();
+    lengths.clear();
+    messages.clear();
+    return {};
+  }
+
+  /**
+   * @brief Записывает последний блок, сохраняет архив на диске и переименовывает его
+   * @return optional<Error> Ошибка записи, fdatasync или rename
+   */
+  std::optional<Error> Writer::close() {
+    if (fd == -1) return {};
+    if (auto error = write_block()) return error;
+    if (::fdatasync(fd)) return Error(Error_code::CLOSE_SESSION, std::string("archive: ") + ::strerror(errno));
+    auto temporary = path + ".tmp";
+    if (::rename(temporary.data(), path.data())) {
+      return Error(Error_code::CLOSE_SESSION, path + ": " + ::strerror(errno));
+    }
+    ::close(fd);
+    fd = -1;
+    return {};
+  }
+
+  /*** Archive reader ***/
+
+  bool Reader::is_archive(std::string_view prefix) {
+    return prefix.size() >= sizeof(magic) && !std::memcmp(prefix.data(), magic, sizeof(magic));
+  }
+
+  /**
+   * @brief Открывает архив и читает заголовки всех блоков
+   *
+   * Столбцы не читаются: после заголовка читатель переходит к следующему
+   * блоку по размерам столбцов. Количество записей и размер текста
+   * сверяются с размерами столбцов, чтобы повреждённый заголовок
+   * не приводил к огромному выделению памяти в read()
+   * @param path Путь к архиву
+   * @return variant<unique_ptr<Reader>, Error> Читатель или ошибка формата
+   */
+  std::variant<std::unique_ptr<Reader>, Error> Reader::open(const std::string& path) {
+    int fd = ::open(path.data(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) return Error(Error_code::OPEN_SESSION, path + ": " + ::strerror(errno));
+    std::unique_ptr<Reader> reader(new Reader(fd));
+    struct stat info{};
+    if (::fstat(fd, &info)) return Error(Error_code::OPEN_SESSION, path + ": " + ::strerror(errno));
+    auto size = static_cast<uint64_t>(info.st_size);
+    char header[header_size];
+    if (!read_all(fd, header, sizeof(magic), 0) || !is_archive({header, sizeof(magic)})) {
+      return Error(Error_code::OPEN_SESSION, path + ": not a log archive");
+    }
+    for (uint64_t offset = sizeof(magic); offset < size;) {
+      if (!read_all(fd, header, header_size, offset)) {
+        return Error(Error_code::OPEN_SESSION, path + ": truncated block header");
+      }
+      Block_info block;
+      const char* field = header;
+      block.count = get32(field);
+      block.min_time = Timestamp(get64(field + 4));
+      block.max_time = Timestamp(get64(field + 12));
+      field += 20;
+      for (auto& count : block.levels) {
+        count = get32(field);
+        field += 4;
+      }
+      uint64_t columns = 0;
+      for (auto& column : block.sizes) {
+        column = get32(field);
+        columns += column;
+        field += 4;
+      }
+      block.message_bytes = get32(field);
+      block.compressed = get32(field + 4) & flag_compressed;
+      block.offset = offset + header_size;
+      if (block.offset + columns > size) {
+        return Error(Error_code::OPEN_SESSION, path + ": truncated block");
+      }
+      // разность времени занимает не меньше байта, уровень - 2 бита,
+      // сообщение - не больше max_length: read() резервирует память по count
+      if (block.count > block.sizes[0] || block.sizes[1] != (uint64_t{block.count} + 3) / 4 ||
+          block.message_bytes > uint64_t{block.count} * Logger_protocol::Protocol::max_length) {
+        return Error(Error_code::OPEN_SESSION, path + ": corrupt block header");
+      }
+      reader->index.push_back(block);
+      offset = block.offset + columns;
+    }
+    return reader;
+  }
+
+  /**
+   * @brief Читает и декодирует выбранные столбцы блока
+   *
+   * Читается одним pread непрерывный участок от первого до последнего
+   * выбранного столбца; текст при выборе только TIME/LEVEL/LENGTH не читается
+   * @param info Заголовок блока из blocks()
+   * @param columns Маска Column
+   * @param[out] block Столбцы, не выбранные - пустые
+   * @return optional<Error> Ошибка чтения или повреждённый блок
+   */
+  std::optional<Error> Reader::read(const Block_info& info, unsigned columns, Block& block) const {
+    block.times.clear();
+    block.levels.clear();
+    block.lengths.clear();
+    block.messages.clear();
+    std::size_t first = column_count, last = 0;
+    for (std::size_t i = 0; i < column_count; ++i) {
+      if (columns & (1u << i)) {
+        first = std::min(first, i);
+        last = i;
+      }
+    }
+    if (first == column_count) return {};
+    uint64_t start = info.offset, length = 0;
+    for (std::size_t i = 0; i < first; ++i) start += info.sizes[i];
+    for (std::size_t i = first; i <= last; ++i) length += info.sizes[i];
+    block.data.resize(length);
+    if (!read_all(fd, block.data.data(), block.data.size(), start)) {
+      return Error(Error_code::ERROR, "archive read: truncated block");
+    }
+    std::string_view data[column_count];
+    for (std::size_t i = first, position = 0; i <= last; position += info.sizes[i], ++i) {
+      data[i] = std::string_view(block.data).substr(position, info.sizes[i]);
+    }
+
+    if (columns & TIME) {
+      block.times.reserve(info.count);
+      auto column = data[0];
+      int64_t time = info.min_time.count();
+      for (uint32_t i = 0; i < info.count; ++i) {
+        uint64_t delta;
+        if (!get_varint(column, delta)) return corrupt("time column");
+        time += unzigzag(delta);
+        block.times.emplace_back(time);
+      }
+    }
+    if (columns & LEVEL) {
+      if (data[1].size() != (info.count + 3) / 4) return corrupt("level column");
+      block.levels.reserve(info.count);
+      for (uint32_t i = 0; i < info.count; ++i) {
+        unsigned level = static_cast<unsigned char>(data[1][i / 4]) >> (i % 4 * 2) & 3u;
+        if (level > static_cast<unsigned>(Level::ERROR)) return corrupt("level column");
+        block.levels.push_back(static_cast<Level>(level));
+      }
+    }
+    if (columns & LENGTH) {
+      block.lengths.reserve(info.count);
+      auto column = data[2];
+      uint64_t total = 0;
+      for (uint32_t i = 0; i < info.count; ++i) {
+        uint64_t length;
+        if (!get_varint(column, length) || length > Logger_protocol::Protocol::max_length) {
+          return corrupt("length column");
+        }
+        total += length;
+        block.lengths.push_back(static_cast<uint32_t>(length));
+      }
+      if (total != info.message_bytes) return corrupt("length column");
+    }
+    if (columns & MESSAGE) {
+      if (info.compressed) {
+        if (auto error = Compression::decompress(data[3], info.message_bytes, block.messages)) {
+          return error;
+        }
+      } else {
+        block.messages.assign(data[3]);
+      }
+      if (block.messages.size() != info.message_bytes) return corrupt("message column");
+    }
+    return {};
+  }
+}
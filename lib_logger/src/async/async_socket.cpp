@@ -0,0 +1,346 @@
+#include "async_io.hpp"
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
+namespace Logger::Async {
+  namespace {
+    constexpr auto connect_retry = std::chrono::milliseconds(1);
+
+    /**
+     * @brief Подключает неблокирующий сокет, ожидая завершения connect
+     *
+     * Для сокета UNIX EAGAIN означает заполненную очередь слушающего
+     * сокета - подключение повторяется, а не ожидается
+     */
+    Task<std::optional<Error>> connect_socket(Executor& executor, int fd, const sockaddr* address,
+        socklen_t size) {
+      while (::connect(fd, address, size)) {
+        if (errno == EAGAIN) {
+          co_await executor.sleep_for(connect_retry);
+          continue;
+        }
+        if (errno != EINPROGRESS && errno != EINTR) co_return Error(Error_code::OPEN_SESSION, ::strerror(errno));
+        co_await executor.writable(fd);
+        break;
+      }
+      int error = 0;
+      socklen_t error_size = sizeof(error);
+      if (::getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &error_size)) error = errno;
+      if (error) co_return Error(Error_code::OPEN_SESSION, ::strerror(error));
+      co_return std::nullopt;
+    }
+
+    /// Читает ровно size байт
+    Task<std::optional<Error>> receive_exact(Executor& executor, int fd, char* data, std::size_t size) {
+      while (size) {
+        auto received = ::recv(fd, data, size, 0);
+        if (received > 0) {
+          data += received;
+          size -= static_cast<std::size_t>(received);
+        } else if (!received) {
+          co_return Error(Error_code::ERROR, "closed the connection");
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+          co_await executor.readable(fd);
+        } else if (errno != EINTR) {
+          co_return Error(Error_code::ERROR, ::strerror(errno));
+        }
+      }
+      co_return std::nullopt;
+    }
+  }
+
+  /**
+   * @brief Подключается, не блокируя поток
+   *
+   * Адрес разбирается как у Socket::socket_connect: путь - сокет UNIX,
+   * иначе числовой IPv4-адрес и порт (без обращения к DNS)
+   * @return variant<int, Error> Неблокирующий дескриптор или ошибка
+   */
+  Task<std::variant<int, Error>>
+  connect(Executor& executor, std::string host, std::string port, bool seqpacket) {
+    if (host.find('/') != std::string::npos) {
+      sockaddr_un address{};
+      if (host.size() >= sizeof(address.sun_path)) {
+        co_return Error(Error_code::OPEN_SESSION, "socket path too long");
+      }
+      address.sun_family = AF_UNIX;
+      std::memcpy(address.sun_path, host.data(), host.size());
+      int fd = ::socket(AF_UNIX, (seqpacket ? SOCK_SEQPACKET : SOCK_STREAM) | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+      if (fd == -1) co_return Error(Error_code::OPEN_SESSION, ::strerror(errno));
+      auto error = co_await connect_socket(executor, fd, reinterpret_cast<sockaddr*>(&address),
+        sizeof(address));
+      if (error) {
+        ::close(fd);
+        co_return *error;
+      }
+      co_return fd;
+    }
+    addrinfo hints{};
+    addrinfo* result;
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_NUMERICSERV | AI_NUMERICHOST;
+    if (int code = ::getaddrinfo(host.data(), port.data(), &hints, &result)) {
+      co_return Error(Error_code::OPEN_SESSION, ::gai_strerror(code));
+    }
+    std::optional<Error> error = Error(Error_code::OPEN_SESSION, "no address");
+    int fd = -1;
+    for (auto rp = result; rp; rp = rp->ai_next) {
+      fd = ::socket(rp->ai_family, rp->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, rp->ai_protocol);
+      if (fd == -1) {
+        error = Error(Error_code::OPEN_SESSION, ::strerror(errno));
+        continue;
+      }
+      error = co_await connect_socket(executor, fd, rp->ai_addr, rp->ai_addrlen);
+      if (!error) break;
+      ::close(fd);
+      fd = -1;
+    }
+    ::freeaddrinfo(result);
+    if (error) co_return *error;
+    co_return fd;
+  }
+
+  /**
+   * @brief Принимает подключение, ожидая его без блокировки потока
+   * @param listen_fd Слушающий сокет, может быть общим для нескольких исполнителей
+   * @return variant<int, Error> Неблокирующий дескриптор подключения или ошибка
+   */
+  Task<std::variant<int, Error>> accept(Executor& executor, int listen_fd) {
+    int flags = ::fcntl(listen_fd, F_GETFL);
+    if (flags != -1 && !(flags & O_NONBLOCK)) ::fcntl(listen_fd, F_SETFL, flags | O_NONBLOCK);
+    for (;;) {
+      int fd = ::accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+      if (fd != -1) co_return fd;
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        co_await executor.readable(listen_fd);
+      } else if (errno != EINTR && errno != ECONNABORTED) {
+        co_return Error(Error_code::ERROR, ::strerror(errno));
+      }
+    }
+  }
+
+  /**
+   * @brief Пишет кадр: префикс длины и тело одним вызовом sendmsg, либо пакет
+   *
+   * Пока буфер отправки сокета заполнен, сопрограмма ждёт готовности на запись
+   * @param data Тело кадра, должно жить до завершения
+   * @return optional<Error> Пустой optional при успехе, или объект ошибки
+   */
+  Task<std::optional<Error>>
+  write_frame(Executor& executor, int fd, std::string_view data, bool packet) {
+    uint32_t length = ::htonl(static_cast<uint32_t>(data.size()));
+    iovec parts[2] = {
+      {&length, sizeof(length)},
+      {const_cast<char*>(data.data()), data.size()}
+    };
+    iovec* part = packet ? parts + 1 : parts;
+    std::size_t count = packet ? 1 : 2;
+    msghdr message{};
+    while (count) {
+      message.msg_iov = part;
+      message.msg_iovlen = count;
+      auto sent = ::sendmsg(fd, &message, MSG_NOSIGNAL);
+      if (sent < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+          co_await executor.writable(fd);
+          continue;
+        }
+        if (errno == EINTR) continue;
+        co_return Error(Error_code::WRITE, ::strerror(errno));
+      }
+      if (packet) break; // пакет отправляется целиком
+      // частичная отправка потока: пропускаем отправленные части
+      auto left = static_cast<std::size_t>(sent);
+      while (count && left >= part->iov_len) {
+        left -= part->iov_len;
+        ++part;
+        --count;
+      }
+      if (count) {
+        part->iov_base = static_cast<char*>(part->iov_base) + left;
+        part->iov_len -= left;
+      }
+    }
+    co_return std::nullopt;
+  }
+
+  /**
+   * @brief Читает кадр: префикс длины и тело, либо пакет целиком
+   *
+   * Кадр длиннее max_size не читается (пакет отбрасывается), возвращается ошибка.
+   * Пакет нулевой длины - пустой кадр, закрытие соединения - Socket::peer_closed
+   * @param[out] frame Буфер кадра, память переиспользуется между вызовами
+   * @param max_size Наибольший размер кадра
+   * @return optional<Error> Пустой optional при успехе, или объект ошибки
+   */
+  Task<std::optional<Error>>
+  read_frame(Executor& executor, int fd, std::string& frame, bool packet, std::size_t max_size) {
+    if (packet) {
+      for (;;) {
+        auto size = ::recv(fd, nullptr, 0, MSG_PEEK | MSG_TRUNC);
+        if (!size) {
+          if (Socket::peer_closed(fd)) co_return Error(Error_code::ERROR, "closed the connection");
+          ::recv(fd, nullptr, 0, 0); // пустой пакет
+          frame.clear();
+          co_return std::nullopt;
+        }
+        if (size > 0 && static_cast<std::size_t>(size) > max_size) {
+          char skipped;
+          ::recv(fd, &skipped, sizeof(skipped), 0);
+          co_return Transport::frame_too_large(static_cast<std::size_t>(size), max_size);
+        }
+        if (size > 0) {
+          try {
+            frame.resize(static_cast<std::size_t>(size));
+          }
+          catch (const std::bad_alloc& ex) {
+            co_return Error(Error_code::ERROR, ex.what());
+          }
+          if (::recv(fd, frame.data(), frame.size(), 0) != size) {
+            co_return Error(Error_code::ERROR, "not all data received");
+          }
+          co_return std::nullopt;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+          co_await executor.readable(fd);
+        } else if (errno != EINTR) {
+          co_return Error(Error_code::ERROR, ::strerror(errno));
+        }
+      }
+    }
+    uint32_t length;
+    if (auto error = co_await receive_exact(executor, fd, reinterpret_cast<char*>(&length),
+        sizeof(length))) {
+      co_return error;
+    }
+    length = ::ntohl(length);
+    if (length > max_size) co_return Transport::frame_too_large(length, max_size);
+    // может не выделить память
+    try {
+      frame.resize(length);
+    }
+    catch (const std::bad_alloc& ex) {
+      co_return Error(Error_code::ERROR, ex.what());
+    }
+    co_return co_await receive_exact(executor, fd, frame.data(), frame.size());
+  }
+
+  Socket_sender::~Socket_sender() {
+    if (fd != -1) ::close(fd);
+  }
+
+  /**
+   * @brief Подключается и при необходимости согласует кадры с типом
+   * @return optional<Error> Пустой optional при успехе или откате к прежнему
+   *         формату, объект Error при ошибке подключения
+   */
+  Task<std::optional<Error>> Socket_sender::open() {
+    if (options.reliable) {
+      co_return Error(Error_code::OPEN_SESSION, "reliable mode is not supported by async sender");
+    }
+    if (!options.source.empty() && !Transport::valid_source(options.source)) {
+      co_return Error(Error_code::OPEN_SESSION, "invalid source id");
+    }
+    auto connected = co_await Async::connect(executor, host, port, options.seqpacket);
+    if (auto error = std::get_if<Error>(&connected)) co_return *error;
+    fd = std::get<int>(connected);
+    packet = options.seqpacket && host.find('/') != std::string::npos;
+    if (!options.batch_bytes && !options.compress && !options.nanoseconds && options.source.empty()) {
+      co_return std::nullopt;
+    }
+    auto error = co_await negotiate();
+    if (error) {
+      ::close(fd);
+      fd = -1;
+    }
+    co_return error;
+  }
+
+  /**
+   * @brief Согласует кадры как Socket_logging::negotiate
+   *
+   * Сервер прежней версии не отвечает за handshake_timeout_ms -
+   * сессия остаётся в прежнем формате
+   */
+  Task<std::optional<Error>> Socket_sender::negotiate() {
+    framed = compress = nanoseconds = false;
+    frame = Transport::make_handshake("hello",
+      Transport::Handshake{options.compress, options.nanoseconds, false, options.source});
+    if (auto error = co_await write_frame(executor, fd, frame, packet)) {
+      co_return Error(Error_code::OPEN_SESSION, error->get_err_message());
+    }
+    if (!co_await executor.readable(fd, std::chrono::milliseconds(options.handshake_timeout_ms))) {
+      co_return std::nullopt;
+    }
+    if (auto error = co_await read_frame(executor, fd, buffer, packet)) {
+      co_return Error(Error_code::OPEN_SESSION, error->get_err_message());
+    }
+    if (auto reply = Transport::parse_handshake(buffer, "welcome")) {
+      framed = true;
+      compress = options.compress && reply->compress;
+      nanoseconds = options.nanoseconds && reply->nanoseconds;
+    }
+    co_return std::nullopt;
+  }
+
+  /**
+   * @brief Отправляет запись: после согласования - в пачку, иначе отдельным кадром
+   *
+   * Запись сериализуется до первого ожидания, ссылка на неё дальше не используется
+   * @return optional<Error> Пустой optional при успехе, или объект Error при ошибке записи
+   */
+  Task<std::optional<Error>> Socket_sender::write(const Logger_protocol::Protocol& entry) {
+    if (fd == -1) co_return Error(Error_code::WRITE, "session is not open");
+    buffer.clear();
+    Logger_protocol::serialization_log(entry, buffer, nanoseconds);
+    if (framed) {
+      Transport::append_record(batch, buffer);
+      if (batch.size() < options.batch_bytes) co_return std::nullopt;
+      co_return co_await flush();
+    }
+    bytes_raw += buffer.size();
+    bytes_sent += buffer.size();
+    co_return co_await write_frame(executor, fd, buffer, packet);
+  }
+
+  /**
+   * @brief Отправляет накопленную пачку, сжимая её как Socket_logging::send_batch
+   * @return optional<Error> Пустой optional при успехе, или объект Error при ошибке записи
+   */
+  Task<std::optional<Error>> Socket_sender::flush() {
+    if (fd == -1 || !framed || batch.empty()) co_return std::nullopt;
+    frame.clear();
+    if (compress && batch.size() >= options.compress_threshold) {
+      frame.push_back(static_cast<char>(Transport::Frame_type::COMPRESSED));
+      uint32_t raw_size = ::htonl(static_cast<uint32_t>(batch.size()));
+      frame.append(reinterpret_cast<const char*>(&raw_size), sizeof(raw_size));
+      Compression::compress(batch, frame);
+      if (frame.size() >= batch.size() + 1) frame.clear();
+    }
+    if (frame.empty()) {
+      frame.push_back(static_cast<char>(Transport::Frame_type::BATCH));
+      frame.append(batch);
+    }
+    bytes_raw += batch.size();
+    bytes_sent += frame.size();
+    batch.clear();
+    co_return co_await write_frame(executor, fd, frame, packet);
+  }
+
+  /**
+   * @brief Отправляет остаток пачки и закрывает соединение
+   * @return optional<Error> Ошибка отправки остатка
+   */
+  Task<std::optional<Error>> Socket_sender::close() {
+    if (fd == -1) co_return std::nullopt;
+    auto error = co_await flush();
+    ::shutdown(fd, SHUT_RDWR);
+    ::close(fd);
+    fd = -1;
+    framed = compress = nanoseconds = packet = false;
+    co_return error;
+  }
+}
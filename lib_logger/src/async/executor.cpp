@@ -0,0 +1,203 @@
+#include "async_io.hpp"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+namespace Logger::Async {
+  namespace Detail {
+    /**
+     * @brief Корневая сопрограмма spawn: владеет задачей, кадр удаляет себя сам
+     *
+     * Регистрируется в исполнителе при создании и снимается с учёта
+     * при разрушении кадра - по завершении или вместе с исполнителем
+     */
+    struct Root {
+      struct promise_type {
+        Executor& executor;
+        promise_type(Executor& executor, Task<void>&) : executor(executor) {}
+        ~promise_type() {
+          executor.roots.erase(std::coroutine_handle<promise_type>::from_promise(*this).address());
+        }
+        Root get_return_object() {
+          auto handle = std::coroutine_handle<promise_type>::from_promise(*this);
+          executor.roots.insert(handle.address());
+          executor.ready.push_back(handle);
+          return {};
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+      };
+    };
+
+    Root run_root(Executor&, Task<void> task) {
+      co_await task;
+    }
+  }
+
+  namespace {
+    constexpr int max_events = 64; ///< Событий за один epoll_wait
+  }
+
+  /**
+   * @brief Создаёт исполнитель
+   * @return variant<unique_ptr<Executor>, Error> Исполнитель или ошибка epoll/eventfd
+   */
+  std::variant<std::unique_ptr<Executor>, Error> Executor::create() {
+    int epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd == -1) {
+      return Error(Error_code::OPEN_SESSION, std::string("epoll: ") + ::strerror(errno));
+    }
+    int wake_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.ptr = nullptr;
+    if (wake_fd == -1 || ::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &event)) {
+      Error error(Error_code::OPEN_SESSION, std::string("eventfd: ") + ::strerror(errno));
+      if (wake_fd != -1) ::close(wake_fd);
+      ::close(epoll_fd);
+      return error;
+    }
+    return std::unique_ptr<Executor>(new Executor(epoll_fd, wake_fd));
+  }
+
+  /**
+   * @brief Уничтожает незавершённые сопрограммы и закрывает epoll
+   *
+   * Кадры разрушаются в приостановленном состоянии, локальные объекты
+   * (и закрывающие дескрипторы в деструкторах) освобождаются
+   */
+  Executor::~Executor() {
+    auto frames = std::move(roots);
+    roots.clear();
+    for (auto frame : frames) std::coroutine_handle<>::from_address(frame).destroy();
+    timers.clear();
+    ready.clear();
+    ::close(wake_fd);
+    ::close(epoll_fd);
+  }
+
+  /**
+   * @brief Запускает сопрограмму независимо от вызывающей
+   *
+   * Сопрограмма начнёт выполняться в run()
+   * @param task Задача, исполнитель становится её владельцем
+   */
+  void Executor::spawn(Task<void>&& task) {
+    Detail::run_root(*this, std::move(task));
+  }
+
+  /**
+   * @brief Выполняет сопрограммы в вызывающем потоке
+   *
+   * Возвращается после stop() или когда все сопрограммы spawn завершились
+   * @return optional<Error> Ошибка epoll_wait
+   */
+  std::optional<Error> Executor::run() {
+    epoll_event events[max_events];
+    while (!stopped.load(std::memory_order_relaxed)) {
+      while (!ready.empty()) {
+        auto handle = ready.front();
+        ready.pop_front();
+        handle.resume();
+      }
+      fire_timers();
+      if (roots.empty() || stopped.load(std::memory_order_relaxed)) break;
+      int count = ::epoll_wait(epoll_fd, events, max_events, ready.empty() ? next_timeout() : 0);
+      if (count == -1) {
+        if (errno == EINTR) continue;
+        return Error(Error_code::ERROR, std::string("epoll: ") + ::strerror(errno));
+      }
+      for (int i = 0; i < count; ++i) {
+        auto wait = static_cast<Wait*>(events[i].data.ptr);
+        if (!wait) {
+          uint64_t value;
+          [[maybe_unused]] auto size = ::read(wake_fd, &value, sizeof(value));
+          continue;
+        }
+        wait->ready = true;
+        ready.push_back(wait->handle);
+      }
+    }
+    return {};
+  }
+
+  /**
+   * @brief Останавливает run(), можно вызывать из любого потока
+   */
+  void Executor::stop() {
+    stopped.store(true, std::memory_order_relaxed);
+    uint64_t value = 1;
+    [[maybe_unused]] auto size = ::write(wake_fd, &value, sizeof(value));
+  }
+
+  /**
+   * @brief Переносит ожидания с истёкшим сроком в очередь готовых
+   *
+   * Дескриптор ожидания удаляется из epoll: пустая маска не подходит - EPOLLHUP
+   * и EPOLLERR сообщаются всегда, и событие со ссылкой на уничтоженное ожидание
+   * возобновило бы сопрограмму повторно. Следующее ожидание добавляет дескриптор заново
+   */
+  void Executor::fire_timers() {
+    auto now = Clock::now();
+    while (!timers.empty() && timers.begin()->first <= now) {
+      auto wait = timers.begin()->second;
+      timers.erase(timers.begin());
+      wait->timer_set = false;
+      if (wait->fd != -1) ::epoll_ctl(epoll_fd, EPOLL_CTL_DEL, wait->fd, nullptr);
+      ready.push_back(wait->handle);
+    }
+  }
+
+  /// Таймаут epoll_wait до ближайшего срока, -1 - сроков нет
+  int Executor::next_timeout() const {
+    if (timers.empty()) return -1;
+    auto left = std::chrono::ceil<std::chrono::milliseconds>(timers.begin()->first - Clock::now());
+    return static_cast<int>(std::max<std::chrono::milliseconds::rep>(left.count(), 0));
+  }
+
+  Executor::Wait Executor::readable(int fd, std::optional<std::chrono::milliseconds> timeout) {
+    return Wait(*this, fd, EPOLLIN | EPOLLRDHUP,
+      timeout ? std::optional(Clock::now() + *timeout) : std::nullopt);
+  }
+
+  Executor::Wait Executor::writable(int fd, std::optional<std::chrono::milliseconds> timeout) {
+    return Wait(*this, fd, EPOLLOUT,
+      timeout ? std::optional(Clock::now() + *timeout) : std::nullopt);
+  }
+
+  Executor::Wait Executor::sleep_for(std::chrono::milliseconds duration) {
+    return Wait(*this, -1, 0, Clock::now() + duration);
+  }
+
+  /**
+   * @brief Регистрирует ожидание дескриптора (EPOLLONESHOT) и срока
+   * @return false - не удалось зарегистрировать, сопрограмма продолжается сразу
+   */
+  bool Executor::Wait::await_suspend(std::coroutine_handle<> awaiting) {
+    handle = awaiting;
+    if (fd != -1) {
+      epoll_event event{};
+      event.events = events | EPOLLONESHOT;
+      event.data.ptr = this;
+      if (::epoll_ctl(executor.epoll_fd, EPOLL_CTL_MOD, fd, &event) &&
+          (errno != ENOENT || ::epoll_ctl(executor.epoll_fd, EPOLL_CTL_ADD, fd, &event))) {
+        return false;
+      }
+    }
+    if (deadline) {
+      timer = executor.timers.emplace(*deadline, this);
+      timer_set = true;
+    }
+    return true;
+  }
+
+  /// Снимает несработавший срок; true - дескриптор готов
+  bool Executor::Wait::await_resume() noexcept {
+    if (timer_set) {
+      executor.timers.erase(timer);
+      timer_set = false;
+    }
+    return ready;
+  }
+}
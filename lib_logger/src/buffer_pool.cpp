@@ -0,0 +1,111 @@
+#include "include/buffer_pool.hpp"
+#include <new>
+
+namespace Logger::Memory {
+  namespace {
+    /**
+     * @brief Кэш свободных блоков потока
+     *
+     * Доступен только своему потоку, поэтому не требует синхронизации.
+     * При завершении потока блоки возвращаются в общие списки пула
+     */
+    struct Thread_cache {
+      Buffer_pool::Node* head[Buffer_pool::class_count]{};
+      ~Thread_cache() {
+        for (std::size_t index = 0; index < Buffer_pool::class_count; ++index) {
+          if (auto first = head[index]) {
+            auto last = first;
+            while (last->next) last = last->next;
+            Buffer_pool::instance().give_back(index, first, last);
+          }
+        }
+      }
+    };
+    thread_local Thread_cache cache;
+  }
+
+  /**
+   * @brief Возвращает единственный экземпляр пула
+   * @note Пул намеренно не разрушается, чтобы записи, освобождаемые
+   *       при завершении программы, могли вернуть свои буферы
+   */
+  Buffer_pool& Buffer_pool::instance() {
+    static Buffer_pool* pool = new Buffer_pool;
+    return *pool;
+  }
+
+  /**
+   * @brief Определяет класс размера для запроса
+   * @param size Запрошенный размер в байтах
+   * @return Индекс класса, либо class_count если запрос больше max_block
+   */
+  std::size_t Buffer_pool::size_class(std::size_t size) {
+    if (size > max_block) return class_count;
+    std::size_t index = 0;
+    for (std::size_t block = min_block; block < size; block <<= 1) ++index;
+    return index;
+  }
+
+  /**
+   * @brief Выделяет буфер не меньше запрошенного размера
+   *
+   * Сначала используется кэш потока, затем список возврата класса,
+   * и только если оба пусты - системный аллокатор
+   *
+   * @param size Размер в байтах
+   * @return void* Указатель на буфер, выровненный по alignment
+   */
+  void* Buffer_pool::allocate(std::size_t size) {
+    auto index = size_class(size);
+    if (index == class_count) {
+      return ::operator new(size, std::align_val_t(alignment));
+    }
+    auto& head = cache.head[index];
+    if (!head) {
+      // забираем весь список возврата за одну операцию
+      head = returned[index].exchange(nullptr, std::memory_order_acquire);
+    }
+    if (head) {
+      auto block = head;
+      head = block->next;
+      return block;
+    }
+    system_count.fetch_add(1, std::memory_order_relaxed);
+    return ::operator new(min_block << index, std::align_val_t(alignment));
+  }
+
+  /**
+   * @brief Возвращает буфер в пул
+   *
+   * Может вызываться из любого потока, не блокируется
+   *
+   * @param ptr Указатель, полученный от allocate
+   * @param size Размер, переданный в allocate
+   */
+  void Buffer_pool::deallocate(void* ptr, std::size_t size) noexcept {
+    if (!ptr) return;
+    auto index = size_class(size);
+    if (index == class_count) {
+      ::operator delete(ptr, std::align_val_t(alignment));
+      return;
+    }
+    auto block = static_cast<Node*>(ptr);
+    give_back(index, block, block);
+  }
+
+  /**
+   * @brief Вставляет цепочку блоков в начало списка возврата
+   *
+   * @param index Класс размера
+   * @param first Первый блок цепочки
+   * @param last Последний блок цепочки
+   */
+  void Buffer_pool::give_back(std::size_t index, Node* first, Node* last) noexcept {
+    auto& list = returned[index];
+    auto expected = list.load(std::memory_order_relaxed);
+    do {
+      last->next = expected;
+    } while (!list.compare_exchange_weak(expected, first,
+        std::memory_order_release, std::memory_order_relaxed));
+  }
+}
@@ -0,0 +1,120 @@
+#include "include/logger.hpp"
+#include <functional>
+
+namespace Logger {
+  /*** Duplicate suppression ***/
+
+  /**
+   * @brief Создаёт фильтр повторов
+   *
+   * @param window Длительность окна подавления в секундах
+   * @param slots_per_level Размер таблицы отпечатков одного уровня,
+   *        округляется вверх до степени двойки
+   */
+  Duplicate_filter::Duplicate_filter(time_t window, std::size_t slots_per_level)
+    : window(window) {
+    std::size_t size = 1;
+    while (size < slots_per_level) size <<= 1;
+    mask = size - 1;
+    slots.resize(size * level_count);
+  }
+
+  /**
+   * @brief Проверяет запись на повтор
+   *
+   * Запись с тем же уровнем и текстом, что и первая запись открытого окна,
+   * подсчитывается и не записывается. Запись, вытесняющая другое сообщение
+   * из ячейки таблицы, закрывает его окно
+   *
+   * @param entry Запись протокола
+   * @return true, если запись нужно записать; false, если это подавленный повтор
+   */
+  bool Duplicate_filter::accept(const Logger_protocol::Protocol& entry) {
+    auto time = entry.get_time();
+    auto message = entry.get_message_view();
+    auto hash = std::hash<std::string_view>{}(message);
+    std::lock_guard lock(mtx);
+    if (time > last_sweep) {
+      // окна закрываются не чаще раза в секунду меток времени
+      close_expired(time);
+      last_sweep = time;
+    }
+    auto level = static_cast<std::size_t>(entry.get_level()) % level_count;
+    auto& slot = slots[level * (mask + 1) + (hash & mask)];
+    if (slot.used && slot.hash == hash &&
+        slot.entry.get_message_view() == message &&
+        time - slot.window_start < window) {
+      ++slot.repeats;
+      slot.last_time = std::max(slot.last_time, time);
+      return false;
+    }
+    if (slot.used) close(slot);
+    slot.hash = hash;
+    slot.window_start = time;
+    slot.last_time = time;
+    slot.repeats = 0;
+    slot.used = true;
+    slot.entry = entry.clone();
+    return true;
+  }
+
+  /**
+   * @brief Закрывает все открытые окна
+   * @note Вызывается перед закрытием сессии, чтобы не потерять счётчики
+   */
+  void Duplicate_filter::flush() {
+    std::lock_guard lock(mtx);
+    for (auto& slot : slots) {
+      if (slot.used) close(slot);
+    }
+  }
+
+  /**
+   * @brief Закрывает окна, истёкшие к моменту времени, без новой записи
+   *
+   * Серия повторов, после которой записей нет, получает запись о повторах
+   * при первом вызове после истечения окна, а не со следующей записью
+   * @param now Текущее время в секундах (например, std::time(nullptr))
+   */
+  void Duplicate_filter::sweep(time_t now) {
+    std::lock_guard lock(mtx);
+    close_expired(now);
+  }
+
+  /**
+   * @brief Забирает накопленные записи о повторах
+   * @return vector<Protocol> Записи в порядке закрытия окон
+   */
+  std::vector<Logger_protocol::Protocol> Duplicate_filter::take_summaries() {
+    std::vector<Logger_protocol::Protocol> result;
+    std::lock_guard lock(mtx);
+    result.swap(summaries);
+    return result;
+  }
+
+  /**
+   * @brief Закрывает окно ячейки, формируя запись о повторах, если они были
+   * @param slot Ячейка таблицы отпечатков
+   */
+  void Duplicate_filter::close(Slot& slot) {
+    if (slot.repeats) {
+      std::string message(slot.entry.get_message_view());
+      message.append(" (repeated ").append(std::to_string(slot.repeats)).append(" times)");
+      summaries.emplace_back(message, slot.entry.get_level(), slot.last_time);
+    }
+    slot.used = false;
+    slot.entry = Logger_protocol::Protocol();
+  }
+
+  /**
+   * @brief Закрывает окна, истёкшие к метке времени, мьютекс захвачен вызывающим
+   * @param time Текущая метка времени
+   */
+  void Duplicate_filter::close_expired(time_t time) {
+    for (auto& slot : slots) {
+      if (slot.used && time - slot.window_start >= window) close(slot);
+    }
+  }
+
+  /*** Duplicate suppression ***/
+}
@@ -1,19 +1,31 @@
-#include "include/logger.hpp"
+#include "include/token_index.hpp"
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <utility>
 
 namespace Logger {
   /*** Implementation write file***/
 
+  File_logging::File_logging(const std::string& file_name, const File_options& options)
+    : file_name(file_name), options(options), formatter(options.format) {}
+
   /**
    * @brief Открывает сессию записи в файл
    *
    * Открывает файл для дозаписи (append mode)
    * Если файл не может быть открыт, возвращает Error с кодом OPEN_SESSION
    * Если файл не сущетсвует - создается новый
+   * При Durability::PERIODIC и SYNC открывается дескриптор для fdatasync,
+   * при PERIODIC запускается поток фиксации
+   * При File_options::index_segment_bytes открывается индекс токенов,
+   * первый сегмент начинается с текущего конца файла
    * @return optional<Error> Пустое значение в случае успеха,
    *         либо объект Error с описанием ошибки
    */
   std::optional<Error>
   File_logging::open_session() {
+    std::lock_guard lock(mtx);
     if (!log_file.is_open()) {
       log_file.open(file_name, std::ios::app);
     }
@@ -22,13 +34,36 @@ namespace Logger {
       log_file.flush();
       return Error(Error_code::OPEN_SESSION,::strerror(errno));
     }
+    if (options.index_segment_bytes && !index) {
+      struct stat status{};
+      if (::stat(file_name.data(), &status)) return Error(Error_code::OPEN_SESSION, ::strerror(errno));
+      auto builder = Token_index::Builder::open(file_name, static_cast<uint64_t>(status.st_size),
+        options.index_segment_bytes);
+      if (auto error = std::get_if<Error>(&builder)) return *error;
+      index = std::move(std::get<std::unique_ptr<Token_index::Builder>>(builder));
+      index_error.reset();
+    }
+    if (options.durability != Durability::NONE && sync_fd == -1) {
+      sync_fd = ::open(file_name.data(), O_WRONLY | O_APPEND | O_CLOEXEC);
+      if (sync_fd == -1) {
+        return Error(Error_code::OPEN_SESSION, std::string("fdatasync descriptor: ") + ::strerror(errno));
+      }
+      appended = durable = 0;
+      sync_error.reset();
+    }
+    if (options.durability == Durability::PERIODIC && !syncer.joinable()) {
+      stopping = false;
+      syncer = std::thread(&File_logging::run_syncer, this);
+    }
     return {};
   }
 
   /**
    * @brief Закрывает сессию записи в файл
    *
-   * Закрывает файловый поток
+   * Останавливает поток фиксации, сохраняет на диск оставшиеся записи
+   * (кроме Durability::NONE), записывает последний сегмент индекса токенов
+   * и закрывает файловый поток
    * В случае ошибки при закрытии возвращает Error с кодом WRITE
    *
    * @return optional<Error> Пустое значение при успешном закрытии,
@@ -36,19 +71,41 @@ namespace Logger {
    */
   std::optional<Error>
   File_logging::close_session()  {
+    {
+      std::lock_guard lock(mtx);
+      stopping = true;
+    }
+    synced.notify_all();
+    if (syncer.joinable()) syncer.join();
+
+    std::unique_lock lock(mtx);
+    std::optional<Error> error;
+    if (sync_fd != -1) {
+      error = commit(lock, appended);
+      ::close(sync_fd);
+      sync_fd = -1;
+    }
+    if (index) {
+      if (auto index_failure = index->finish(); index_failure && !index_error) index_error = index_failure;
+      index.reset();
+    }
+    if (!error) error = std::exchange(index_error, std::nullopt);
     log_file.close();
     if (log_file.fail()) {
       return Error(Error_code::WRITE,::strerror(errno));
     }
-    return {};
+    return error;
   }
 
   /**
    * @brief Записывает протокол лога записи в файл
    *
-   * Вызывает функцию вывода лог-записи в поток, добавляет перевод строки
+   * Форматирует запись в File_options::format, добавляет перевод строки
    * Проверяет состояние потока после записи. В случае ошибки записи
    * очищает состояние потока и возвращает Error с кодом WRITE
+   * При Durability::SYNC возвращается после fdatasync, сохранившего запись
+   * Строка учитывается в индексе токенов; ошибка индекса не мешает записи
+   * в журнал - индекс отключается до конца сессии, ошибку вернёт close_session
    *
    * @param entry Объект Protocol, содержащий лог для записи
    * @return optional<Error> Пустое значение в случае успеха,
@@ -56,13 +113,92 @@ namespace Logger {
    */
   std::optional<Error>
   File_logging::write(const Logger_protocol::Protocol& entry)  {
-    print_log_entry(log_file,entry) << std::endl;
+    std::unique_lock lock(mtx);
+    if (sync_error) return sync_error;
+    line.clear();
+    formatter.format(line, entry);
+    line.push_back('\n');
+    log_file.write(line.data(), static_cast<std::streamsize>(line.size()));
+    // в режиме SYNC поток сбрасывается один раз на группу перед fdatasync
+    if (options.durability != Durability::SYNC) log_file.flush();
     if (log_file.fail()) {
       log_file.clear();
       log_file.flush();
       return Error(Error_code::WRITE,::strerror(errno));
     }
-    return {};
+    if (index) {
+      if (auto error = index->add(line)) {
+        index_error = std::move(error);
+        index.reset();
+      }
+    }
+    auto position = ++appended;
+    if (options.durability != Durability::SYNC) return {};
+    return commit(lock, position);
+  }
+
+  /**
+   * @brief Ждёт сохранения на диске записей до position включительно
+   *
+   * Если fdatasync никто не выполняет, вызывающий поток становится ведущим:
+   * сбрасывает поток файла и выполняет fdatasync без блокировки за все
+   * дописанные записи. Записи, дописанные во время fdatasync, войдут
+   * в следующую группу.
+   * @param lock Захваченная блокировка mtx
+   * @param position Номер записи
+   * @return optional<Error> Ошибка сброса потока или fdatasync
+   */
+  std::optional<Error>
+  File_logging::commit(std::unique_lock<std::mutex>& lock, uint64_t position) {
+    while (durable < position && !sync_error) {
+      if (syncing) {
+        synced.wait(lock);
+        continue;
+      }
+      syncing = true;
+      auto target = appended;
+      log_file.flush();
+      int result = -1, code = EIO;
+      if (!log_file.fail()) {
+        lock.unlock();
+        result = ::fdatasync(sync_fd);
+        code = errno;
+        lock.lock();
+        syncs.fetch_add(1, std::memory_order_relaxed);
+      } else {
+        log_file.clear();
+      }
+      syncing = false;
+      if (result) {
+        sync_error = Error(Error_code::WRITE, std::string("fdatasync: ") + ::strerror(code));
+      } else {
+        durable = target;
+      }
+      synced.notify_all();
+    }
+    if (durable >= position) return {};
+    return sync_error;
+  }
+
+  /**
+   * @brief Поток периодической фиксации (Durability::PERIODIC)
+   *
+   * Раз в sync_interval_ms выполняет fdatasync, если появились новые записи.
+   * Ошибка возвращается следующим вызовом write
+   */
+  void File_logging::run_syncer() {
+    std::unique_lock lock(mtx);
+    auto interval = std::chrono::milliseconds(std::max(options.sync_interval_ms, 1));
+    while (!stopping && !sync_error) {
+      synced.wait_for(lock, interval, [this] { return stopping; });
+      commit(lock, appended);
+    }
+  }
+
+  File_logging::~File_logging() { close_session(); }
+
+  void File_logging::add_statistics(Logging_statistics& statistics) const {
+    statistics.syncs = syncs.load(std::memory_order_relaxed);
   }
 
   /*** Implementation write file***/
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "logger.hpp"
+
+/**
+ * @file archive.hpp
+ * @brief Столбцовый архив закрытых журналов
+ *
+ * Записи хранятся блоками, в блоке - отдельными столбцами: время
+ * (разности соседних меток), уровни (по 2 бита), длины сообщений
+ * и текст сообщений подряд (сжатый LZ4, если так короче). Заголовок блока
+ * содержит количество записей, наименьшее и наибольшее время и счётчики
+ * по уровням, поэтому блоки вне интервала времени пропускаются без чтения,
+ * а из остальных читаются только нужные столбцы.
+ *
+ * Формат файла: "LOGARCH1", затем блоки; числа заголовка блока - в сетевом
+ * порядке байт, разности времени и длины - LEB128 (разности - zigzag).
+ */
+
+namespace Logger::Archive {
+  constexpr char magic[8] = {'L', 'O', 'G', 'A', 'R', 'C', 'H', '1'};
+
+  /// Столбцы блока, выбираемые при чтении (битовая маска)
+  enum Column : unsigned {
+    TIME = 1,    ///< Метки времени
+    LEVEL = 2,   ///< Уровни
+    LENGTH = 4,  ///< Длины сообщений
+    MESSAGE = 8, ///< Текст сообщений
+    ALL = TIME | LEVEL | LENGTH | MESSAGE
+  };
+
+  /// Количество столбцов в блоке
+  constexpr std::size_t column_count = 4;
+
+  /**
+   * @brief Заголовок блока: метаданные и размеры столбцов
+   */
+  struct Block_info {
+    uint64_t offset{}; ///< Смещение первого столбца в файле
+    uint32_t count{}; ///< Записей в блоке
+    Timestamp min_time{}, max_time{};
+    uint32_t levels[3]{}; ///< Записей по уровням
+    uint32_t sizes[column_count]{}; ///< Размеры столбцов в файле
+    uint32_t message_bytes{}; ///< Размер текста до сжатия
+    bool compressed{false}; ///< Текст сжат LZ4
+
+    /// Блок пересекается с интервалом [from, to]
+    bool overlaps(Timestamp from, Timestamp to) const { return max_time >= from && min_time <= to; }
+  };
+
+  /**
+   * @brief Прочитанные столбцы блока; не выбранные при чтении столбцы пусты
+   */
+  struct Block {
+    std::vector<Timestamp> times;
+    std::vector<Level> levels;
+    std::vector<uint32_t> lengths;
+    std::string messages; ///< Тексты подряд, границы - по lengths
+    std::string data; ///< Прочитанные байты столбцов, переиспользуется
+  };
+
+  struct Writer_options {
+    uint32_t block_records = 16384; ///< Записей в блоке
+  };
+
+  /**
+   * @class Writer
+   * @brief Пишет архив: записи накапливаются по столбцам и сбрасываются блоками
+   *
+   * Архив пишется во временный файл "<путь>.tmp" и переименовывается
+   * после fdatasync в close() - читатель не увидит недописанный архив.
+   * Без close() временный файл удаляется.
+   */
+  class Writer {
+    int fd;
+    std::string path;
+    Writer_options options;
+    std::vector<int64_t> times;
+    std::vector<uint8_t> levels;
+    std::vector<uint32_t> lengths;
+    std::string messages;
+    std::string block; ///< Буфер блока для записи в файл
+    std::string compressed; ///< Буфер сжатого текста
+    uint64_t blocks{}, records{}, bytes{};
+
+    Writer(int fd, const std::string& path, const Writer_options& options)
+      : fd(fd), path(path), options(options) {}
+    std::optional<Error> write_block();
+
+    public:
+    static std::variant<std::unique_ptr<Writer>, Error>
+    create(const std::string& path, const Writer_options& = {});
+    Writer(const Writer&) = delete;
+    Writer& operator=(const Writer&) = delete;
+    ~Writer();
+
+    std::optional<Error> write(const Logger_protocol::Protocol&);
+    std::optional<Error> close();
+    uint64_t get_blocks() const { return blocks; }
+    uint64_t get_records() const { return records; }
+    /// Размер архива
+    uint64_t get_bytes() const { return bytes; }
+  };
+
+  /**
+   * @class Reader
+   * @brief Читает архив: заголовки блоков при открытии, столбцы - по запросу
+   *
+   * read() использует pread и не меняет состояние читателя, поэтому
+   * блоки одного архива можно читать из нескольких потоков
+   * (у каждого потока свой Block).
+   */
+  class Reader {
+    int fd;
+    std::vector<Block_info> index;
+
+    Reader(int fd) : fd(fd) {}
+
+    public:
+    static std::variant<std::unique_ptr<Reader>, Error> open(const std::string& path);
+    /// Начинается ли содержимое файла с сигнатуры архива
+    static bool is_archive(std::string_view prefix);
+    Reader(const Reader&) = delete;
+    Reader& operator=(const Reader&) = delete;
+    ~Reader() { ::close(fd); }
+
+    const std::vector<Block_info>& blocks() const { return index; }
+    std::optional<Error> read(const Block_info&, unsigned columns, Block&) const;
+  };
+}
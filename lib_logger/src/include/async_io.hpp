@@ -0,0 +1,230 @@
+#pragma once
+
+#include "logger.hpp"
+#include <coroutine>
+#include <exception>
+#include <map>
+#include <unordered_set>
+#include <utility>
+
+/**
+ * @file async_io.hpp
+ * @brief Асинхронный ввод-вывод на сопрограммах C++20 (цель logger_async)
+ *
+ * Исполнитель (Executor) - цикл epoll одного потока: сопрограмма, ожидающая
+ * сокет или таймер, приостанавливается, и поток обслуживает остальные.
+ * Несколько потоков - несколько исполнителей, у каждого свои подключения,
+ * как у обработчиков statistic_app. Сборка с -DLOGGER_ASYNC=ON, требуется C++20;
+ * остальная библиотека остаётся на C++17.
+ */
+
+namespace Logger::Async {
+  class Executor;
+
+  namespace Detail {
+    struct Root;
+
+    /// Общая часть обещания Task: продолжение после завершения
+    struct Promise_base {
+      std::coroutine_handle<> continuation = std::noop_coroutine();
+
+      struct Final_awaiter {
+        bool await_ready() noexcept { return false; }
+        template<typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+          return handle.promise().continuation;
+        }
+        void await_resume() noexcept {}
+      };
+
+      std::suspend_always initial_suspend() noexcept { return {}; }
+      Final_awaiter final_suspend() noexcept { return {}; }
+      void unhandled_exception() noexcept { std::terminate(); }
+    };
+
+    template<typename T>
+    struct Promise : Promise_base {
+      std::optional<T> result;
+      template<typename U>
+      void return_value(U&& value) { result.emplace(std::forward<U>(value)); }
+      T take() { return std::move(*result); }
+    };
+
+    template<>
+    struct Promise<void> : Promise_base {
+      void return_void() noexcept {}
+      void take() noexcept {}
+    };
+  }
+
+  /**
+   * @class Task
+   * @brief Ленивая сопрограмма с результатом T
+   *
+   * Начинает выполнение при co_await и по завершении передаёт управление
+   * ожидающей сопрограмме (симметричная передача, стек не растёт).
+   * Владеет кадром сопрограммы. Исключения не поддерживаются (std::terminate).
+   * Аргументы-ссылки должны жить до завершения: Task ожидают сразу.
+   */
+  template<typename T>
+  class Task {
+    public:
+    struct promise_type : Detail::Promise<T> {
+      Task get_return_object() {
+        return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+      }
+    };
+    using handle_type = std::coroutine_handle<promise_type>;
+
+    Task(Task&& other) noexcept : handle(std::exchange(other.handle, {})) {}
+    Task& operator=(Task&& other) noexcept {
+      if (this != &other) {
+        if (handle) handle.destroy();
+        handle = std::exchange(other.handle, {});
+      }
+      return *this;
+    }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task() {
+      if (handle) handle.destroy();
+    }
+
+    bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+      handle.promise().continuation = awaiting;
+      return handle;
+    }
+    T await_resume() { return handle.promise().take(); }
+
+    private:
+    handle_type handle;
+    explicit Task(handle_type handle) : handle(handle) {}
+  };
+
+  /**
+   * @class Executor
+   * @brief Однопоточный исполнитель сопрограмм на epoll
+   *
+   * Ожидание дескриптора регистрируется в epoll однократно (EPOLLONESHOT):
+   * у дескриптора одновременно один ожидающий. Сроки ожидания хранятся
+   * в упорядоченной таблице, ближайший задаёт таймаут epoll_wait.
+   * Методы, кроме stop(), вызываются потоком исполнителя (или до run()).
+   * Незавершённые сопрограммы уничтожаются вместе с исполнителем.
+   */
+  class Executor {
+    public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Ожидание готовности дескриптора, истечения срока или обоих
+     *
+     * co_await возвращает true, если дескриптор готов, и false,
+     * если истёк срок или дескриптор не удалось зарегистрировать в epoll
+     */
+    class Wait {
+      friend class Executor;
+      Executor& executor;
+      int fd; ///< -1 - только срок
+      uint32_t events;
+      std::optional<Clock::time_point> deadline;
+      std::multimap<Clock::time_point, Wait*>::iterator timer;
+      bool timer_set{false};
+      bool ready{false};
+      std::coroutine_handle<> handle;
+      public:
+      Wait(Executor& executor, int fd, uint32_t events, std::optional<Clock::time_point> deadline)
+        : executor(executor), fd(fd), events(events), deadline(deadline) {}
+      Wait(const Wait&) = delete;
+      Wait& operator=(const Wait&) = delete;
+      bool await_ready() const noexcept { return false; }
+      bool await_suspend(std::coroutine_handle<>);
+      bool await_resume() noexcept;
+    };
+
+    static std::variant<std::unique_ptr<Executor>, Error> create();
+    Executor(const Executor&) = delete;
+    Executor& operator=(const Executor&) = delete;
+    ~Executor();
+
+    void spawn(Task<void>&&);
+    std::optional<Error> run();
+    void stop();
+
+    Wait readable(int fd, std::optional<std::chrono::milliseconds> timeout = {});
+    Wait writable(int fd, std::optional<std::chrono::milliseconds> timeout = {});
+    Wait sleep_for(std::chrono::milliseconds);
+    /// Количество выполняющихся сопрограмм spawn
+    std::size_t task_count() const { return roots.size(); }
+
+    private:
+    int epoll_fd;
+    int wake_fd; ///< eventfd: пробуждение из stop()
+    std::atomic<bool> stopped{false};
+    std::deque<std::coroutine_handle<>> ready; ///< Готовые к возобновлению
+    std::multimap<Clock::time_point, Wait*> timers;
+    std::unordered_set<void*> roots; ///< Кадры сопрограмм spawn
+
+    Executor(int epoll_fd, int wake_fd) : epoll_fd(epoll_fd), wake_fd(wake_fd) {}
+    void fire_timers();
+    int next_timeout() const;
+    friend struct Detail::Root;
+  };
+
+  /*
+   * Операции сокета. Дескрипторы неблокирующие; кадры - как у Logger::Socket:
+   * uint32_t длина в сетевом порядке и тело, для SOCK_SEQPACKET - пакет.
+   */
+
+  /// Подключается по TCP/IPv4, либо к сокету UNIX, если хост - путь
+  Task<std::variant<int, Error>>
+  connect(Executor&, std::string host, std::string port, bool seqpacket = false);
+  /// Принимает подключение, слушающий сокет переводится в неблокирующий режим
+  Task<std::variant<int, Error>> accept(Executor&, int listen_fd);
+  /// Пишет кадр; данные должны жить до завершения
+  Task<std::optional<Error>> write_frame(Executor&, int fd, std::string_view, bool packet = false);
+  /// Читает кадр в переиспользуемый буфер, кадр длиннее max_size - ошибка
+  Task<std::optional<Error>> read_frame(Executor&, int fd, std::string&, bool packet = false,
+    std::size_t max_size = Transport::max_frame_size);
+
+  /**
+   * @class Socket_sender
+   * @brief Асинхронная отправка записей в сокет - путь Socket_logging для сопрограмм
+   *
+   * Подключение, согласование (пачки, сжатие, время в наносекундах, источник)
+   * и формат кадров - как у Socket_logging; ожидание сокета приостанавливает
+   * сопрограмму, а не поток. Надёжный режим (Socket_options::reliable)
+   * не поддерживается. Методы вызываются последовательно одной сопрограммой.
+   */
+  class Socket_sender {
+    Executor& executor;
+    std::string host, port;
+    Socket_options options;
+    int fd{-1};
+    bool framed{false}; ///< Сервер согласовал кадры с типом
+    bool compress{false}; ///< Сервер согласовал сжатие
+    bool nanoseconds{false}; ///< Сервер согласовал время в наносекундах
+    bool packet{false}; ///< Кадры - пакеты SOCK_SEQPACKET
+    std::string buffer; ///< Буфер сериализации
+    std::string batch; ///< Тело текущей пачки
+    std::string frame; ///< Буфер кадра для отправки
+    uint64_t bytes_raw{}, bytes_sent{};
+    public:
+    Socket_sender(Executor& executor, const std::string& host, const std::string& port,
+      const Socket_options& options = {})
+      : executor(executor), host(host), port(port), options(options) {}
+    Socket_sender(const Socket_sender&) = delete;
+    Socket_sender& operator=(const Socket_sender&) = delete;
+    ~Socket_sender();
+
+    Task<std::optional<Error>> open();
+    Task<std::optional<Error>> write(const Logger_protocol::Protocol&);
+    Task<std::optional<Error>> flush();
+    Task<std::optional<Error>> close();
+    bool is_open() const { return fd != -1; }
+    uint64_t get_bytes_raw() const { return bytes_raw; }
+    uint64_t get_bytes_sent() const { return bytes_sent; }
+    private:
+    Task<std::optional<Error>> negotiate();
+  };
+}
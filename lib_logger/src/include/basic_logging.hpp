@@ -0,0 +1,221 @@
+#pragma once
+
+#include "logger.hpp"
+#include <cerrno>
+#include <fcntl.h>
+#include <tuple>
+#include <utility>
+
+/**
+ * @file basic_logging.hpp
+ * @brief Логгер со статически заданными приёмником и форматом
+ *
+ * Basic_logging<Sink, Format> вызывает приёмник и формат напрямую, без
+ * виртуальных методов Session: вся цепочка log_write видна компилятору
+ * и встраивается. Logging остаётся фасадом со стиранием типа, выбор
+ * сессии во время выполнения, фильтры повторов и скорости - только у него.
+ *
+ * Приёмник (Sink) - класс с методами open(), close(), flush()
+ * и write(std::string_view), возвращающими std::optional<Error>.
+ * Формат (Format) - класс с методом format(std::string&, const Protocol&),
+ * дописывающим строку записи без перевода строки.
+ */
+
+namespace Logger {
+
+  /**
+   * @class Structured_format
+   * @brief Формат Entry_formatter для Basic_logging
+   *
+   * Text_format совпадает с выводом File_logging (тот же Entry_formatter),
+   * Json_format и Logfmt_format - JSON lines и logfmt. Объект не потокобезопасен,
+   * Basic_logging вызывает его под блокировкой.
+   */
+  template<Output_format Output>
+  class Structured_format {
+    Logger_protocol::Entry_formatter formatter{Output};
+
+    public:
+    void format(std::string& out, const Logger_protocol::Protocol& entry) {
+      formatter.format(out, entry);
+    }
+  };
+  using Text_format = Structured_format<Output_format::TEXT>;
+  using Json_format = Structured_format<Output_format::JSON>;
+  using Logfmt_format = Structured_format<Output_format::LOGFMT>;
+
+  /**
+   * @class File_sink
+   * @brief Приёмник - файл, одна запись ::write на строку (как File_logging с Durability::NONE)
+   */
+  class File_sink {
+    std::string file_name;
+    int fd{-1};
+
+    public:
+    explicit File_sink(std::string file_name) : file_name(std::move(file_name)) {}
+    File_sink(File_sink&& other) noexcept
+      : file_name(std::move(other.file_name)), fd(std::exchange(other.fd, -1)) {}
+    File_sink& operator=(File_sink&&) = delete;
+    File_sink(const File_sink&) = delete;
+    File_sink& operator=(const File_sink&) = delete;
+    ~File_sink() { close(); }
+
+    /// Открывает файл для дозаписи, отсутствующий файл создаётся
+    std::optional<Error> open() {
+      if (fd != -1) return {};
+      fd = ::open(file_name.data(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0666);
+      if (fd == -1) return Error(Error_code::OPEN_SESSION, file_name + ": " + ::strerror(errno));
+      return {};
+    }
+
+    std::optional<Error> close() {
+      if (fd != -1 && ::close(std::exchange(fd, -1))) {
+        return Error(Error_code::CLOSE_SESSION, file_name + ": " + ::strerror(errno));
+      }
+      return {};
+    }
+
+    std::optional<Error> flush() { return {}; }
+
+    std::optional<Error> write(std::string_view line) {
+      if (fd == -1) return Error(Error_code::WRITE, "session is not open");
+      while (!line.empty()) {
+        auto written = ::write(fd, line.data(), line.size());
+        if (written == -1) {
+          if (errno == EINTR) continue;
+          return Error(Error_code::WRITE, ::strerror(errno));
+        }
+        line.remove_prefix(static_cast<std::size_t>(written));
+      }
+      return {};
+    }
+  };
+
+  /**
+   * @class Null_sink
+   * @brief Приёмник без вывода, считает байты - для замеров и отключённого вывода
+   */
+  class Null_sink {
+    uint64_t bytes{};
+
+    public:
+    std::optional<Error> open() { return {}; }
+    std::optional<Error> close() { return {}; }
+    std::optional<Error> flush() { return {}; }
+    std::optional<Error> write(std::string_view line) {
+      bytes += line.size();
+      return {};
+    }
+    uint64_t get_bytes() const { return bytes; }
+  };
+
+  /**
+   * @class Tee_sink
+   * @brief Несколько приёмников, запись передаётся каждому по порядку
+   *
+   * Ошибка одного приёмника не останавливает остальные, возвращается первая
+   */
+  template<typename... Sinks>
+  class Tee_sink {
+    std::tuple<Sinks...> sinks;
+
+    template<typename Operation>
+    std::optional<Error> each(Operation operation) {
+      std::optional<Error> first;
+      std::apply([&](auto&... sink) {
+        ((void)[&] {
+          auto error = operation(sink);
+          if (error && !first) first = std::move(error);
+        }(), ...);
+      }, sinks);
+      return first;
+    }
+
+    public:
+    explicit Tee_sink(Sinks&&... sinks) : sinks(std::move(sinks)...) {}
+
+    std::optional<Error> open() { return each([](auto& sink) { return sink.open(); }); }
+    std::optional<Error> close() { return each([](auto& sink) { return sink.close(); }); }
+    std::optional<Error> flush() { return each([](auto& sink) { return sink.flush(); }); }
+    std::optional<Error> write(std::string_view line) {
+      return each([line](auto& sink) { return sink.write(line); });
+    }
+    template<std::size_t Index>
+    auto& get() { return std::get<Index>(sinks); }
+  };
+
+  /**
+   * @class Basic_logging
+   * @brief Логгер с приёмником Sink и форматом Format, известными при компиляции
+   *
+   * Интерфейс повторяет Logging: open_session/close_session/flush/log_write,
+   * минимальный уровень и счётчики written. Запись форматируется
+   * в переиспользуемый буфер и передаётся приёмнику под одной блокировкой,
+   * поэтому строки разных потоков не перемешиваются.
+   */
+  template<typename Sink, typename Format = Text_format>
+  class Basic_logging {
+    Sink sink;
+    Format format;
+    std::string line; ///< Переиспользуемый буфер строки
+    std::mutex mtx; ///< Защищает формат, буфер и приёмник
+    std::atomic<Level> level; ///< Минимальный уровень логирования
+    std::atomic<uint64_t> written[3]{}; ///< Передано приёмнику по уровням
+
+    public:
+    Basic_logging(Sink sink, Level level, Format format = {})
+      : sink(std::move(sink)), format(std::move(format)), level(level) {}
+    Basic_logging(const Basic_logging&) = delete;
+    Basic_logging& operator=(const Basic_logging&) = delete;
+
+    std::optional<Error> open_session() {
+      std::lock_guard lock(mtx);
+      return sink.open();
+    }
+    std::optional<Error> close_session() {
+      std::lock_guard lock(mtx);
+      return sink.close();
+    }
+    std::optional<Error> flush() {
+      std::lock_guard lock(mtx);
+      return sink.flush();
+    }
+
+    /// Уровень берётся из последнего слова сообщения, как в Logging
+    std::optional<Error> log_write(std::string&& message, Timestamp time) {
+      if (auto entry = Logger_protocol::Protocol::create_log_entry(std::move(message), level, time)) {
+        return log_write(*entry);
+      }
+      return {};
+    }
+    std::optional<Error> log_write(std::string&& message, time_t time) {
+      return log_write(std::move(message), Clock::from_seconds(time));
+    }
+
+    /// Записывает запись, если её уровень >= минимальному уровню логирования
+    std::optional<Error> log_write(const Logger_protocol::Protocol& entry) {
+      if (entry.get_level() < level.load(std::memory_order_relaxed)) return {};
+      auto index = static_cast<std::size_t>(entry.get_level()) % std::size(written);
+      written[index].fetch_add(1, std::memory_order_relaxed);
+      std::lock_guard lock(mtx);
+      line.clear();
+      format.format(line, entry);
+      line.push_back('\n');
+      return sink.write(line);
+    }
+
+    void set_level(const Level lvl) { level = lvl; }
+
+    Logging_statistics get_statistics() const {
+      Logging_statistics statistics;
+      for (std::size_t i = 0; i < std::size(written); ++i) {
+        statistics.written[i] = written[i].load(std::memory_order_relaxed);
+      }
+      return statistics;
+    }
+
+    /// Приёмник; вызывается, когда запись не выполняется
+    Sink& get_sink() { return sink; }
+  };
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+
+/**
+ * @file buffer_pool.hpp
+ * @brief Пул буферов сообщений
+ *
+ * Буферы фиксированных классов размера переиспользуются между потоками:
+ * поток-писатель возвращает буфер в общий список без блокировок,
+ * поток-производитель забирает список целиком и выделяет из него повторно.
+ * В установившемся режиме обмен сообщениями не обращается к malloc/free
+ */
+
+namespace Logger::Memory {
+
+  /**
+   * @class Buffer_pool
+   * @brief Пул буферов с классами размера 64 байта .. 64 КБ
+   *
+   * Освобождение - lock-free вставка в список возврата класса размера.
+   * Выделение - из кэша текущего потока, пустой кэш забирает
+   * весь список возврата одной операцией exchange (без проблемы ABA).
+   * Запросы больше максимального класса обслуживаются системным аллокатором.
+   * Память пула не возвращается системе.
+   */
+  class Buffer_pool {
+    public:
+    static constexpr std::size_t min_block = 64; ///< Размер наименьшего класса
+    static constexpr std::size_t class_count = 11; ///< 64 << 0 .. 64 << 10
+    static constexpr std::size_t max_block = min_block << (class_count - 1);
+    static constexpr std::size_t alignment = 64; ///< Выравнивание блоков
+
+    struct Node { Node* next; }; ///< Свободный блок
+
+    static Buffer_pool& instance();
+
+    void* allocate(std::size_t size);
+    void deallocate(void* ptr, std::size_t size) noexcept;
+
+    /// Количество блоков, полученных от системного аллокатора
+    uint64_t system_allocations() const {
+      return system_count.load(std::memory_order_relaxed);
+    }
+    /// Индекс класса размера, либо class_count для больших запросов
+    static std::size_t size_class(std::size_t size);
+
+    /// Возвращает цепочку блоков класса в общий список
+    void give_back(std::size_t index, Node* first, Node* last) noexcept;
+
+    private:
+    Buffer_pool() = default;
+    Buffer_pool(const Buffer_pool&) = delete;
+    Buffer_pool& operator=(const Buffer_pool&) = delete;
+
+    std::atomic<Node*> returned[class_count]{}; ///< Списки возврата по классам
+    std::atomic<uint64_t> system_count{}; ///< Счётчик системных выделений
+  };
+
+  /**
+   * @brief STL-аллокатор поверх Buffer_pool
+   * @tparam T Тип элементов контейнера
+   */
+  template<typename T>
+  struct Pool_allocator {
+    static_assert(alignof(T) <= Buffer_pool::alignment, "alignment too large for pool");
+    using value_type = T;
+
+    Pool_allocator() noexcept = default;
+    template<typename U>
+    Pool_allocator(const Pool_allocator<U>&) noexcept {}
+
+    T* allocate(std::size_t n) {
+      return static_cast<T*>(Buffer_pool::instance().allocate(n * sizeof(T)));
+    }
+    void deallocate(T* ptr, std::size_t n) noexcept {
+      Buffer_pool::instance().deallocate(ptr, n * sizeof(T));
+    }
+
+    template<typename U>
+    bool operator==(const Pool_allocator<U>&) const noexcept { return true; }
+    template<typename U>
+    bool operator!=(const Pool_allocator<U>&) const noexcept { return false; }
+  };
+
+  /// Строка, память которой выделяется из пула
+  using Pool_string = std::basic_string<char, std::char_traits<char>, Pool_allocator<char>>;
+
+  /// Очередь на основе deque, блоки которой выделяются из пула
+  template<typename T>
+  using Pool_deque = std::deque<T, Pool_allocator<T>>;
+}
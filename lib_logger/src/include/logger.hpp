@@ -1,17 +1,28 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <cstring>
+#include <deque>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <fstream>
+#include <functional>
+#include <thread>
 
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <netdb.h>
 #include <unistd.h>
 #include <variant>
+#include <vector>
+
+#include "buffer_pool.hpp"
 
 /**
  * @file logger.hpp
@@ -44,45 +55,142 @@ namespace Logger {
      WRITE          ///< Ошибка при записи сообщения
    };
 
+  /**
+   * @enum Output_format
+   * @brief Формат строки записи в файле и на консоли
+   */
+   enum class Output_format {
+     TEXT,  ///< "<сообщение> <УРОВЕНЬ> <дата время>[.<наносекунды>]" (print_log_entry)
+     JSON,  ///< JSON lines: {"time":"<RFC 3339 UTC>","level":"<УРОВЕНЬ>","msg":"<сообщение>"}
+     LOGFMT ///< time=<RFC 3339 UTC> level=<УРОВЕНЬ> msg=<сообщение, в кавычках при необходимости>
+   };
+
+  /// Метка времени записи: наносекунды от начала эпохи Unix
+  using Timestamp = std::chrono::nanoseconds;
+
+  /**
+   * @brief Часы для меток времени записей
+   *
+   * clock_gettime в Linux выполняется в vDSO без перехода в ядро.
+   * Грубые часы ещё дешевле (без чтения счётчика тактов),
+   * но шаг их - тик планировщика, обычно 1-4 мс
+   */
+  namespace Clock {
+    Timestamp now();
+    Timestamp coarse_now();
+    /// Метка времени из секунд
+    constexpr Timestamp from_seconds(time_t seconds) { return std::chrono::seconds(seconds); }
+  }
+
   namespace Logger_protocol {
     /**
      * @class Protocol
-     * @brief Класс для хранения и формирования записи лога
+     * @brief Компактная запись лога
      *
-     * Содержит сообщение, уровень логирования и время секундах
+     * Запись занимает одну кэш-линию (64 байта): время в наносекундах,
+     * длина и уровень упакованы в одно 32-битное поле, короткие сообщения хранятся
+     * внутри объекта, длинные - в буфере из Memory::Buffer_pool
+     * с единоличным владением.
+     * Объект только перемещаемый, копия создаётся явно через clone()
      */
-    class Protocol {
-      std::shared_ptr<std::string> message; ///< Сообщение
-      Level level{}; ///< Уровень
-      time_t time{}; ///< Время секунды
+    class alignas(64) Protocol {
+      public:
+      /// Максимальная длина сообщения, хранимого внутри записи
+      static constexpr std::size_t inline_capacity = 52;
+
+      private:
+      static constexpr uint32_t length_bits = 30; ///< Биты под длину в length
+
+      public:
+      /// Максимальная длина сообщения, более длинное обрезается
+      static constexpr std::size_t max_length = (1u << length_bits) - 1;
+
+      private:
+      int64_t stamp{}; ///< Время в наносекундах от начала эпохи Unix
+      uint32_t length{}; ///< Длина сообщения (младшие 30 бит) и уровень (старшие 2 бита)
+      char storage[inline_capacity]{}; ///< Сообщение, либо указатель на буфер
+
       public:
       /**
        * @brief Конструктор протокола лога.
        *
-       * @param msg Указатель на строку с сообщением.
+       * @param msg Текст сообщения, копируется в запись.
        * @param lvl Уровень логирования (enum Level).
        * @param t Unix Метка времени в секундах.
        */
-      Protocol(
-        const std::shared_ptr<std::string>& msg,
-        const Level lvl,
-        time_t t
-      ) : message(msg), level(lvl), time(t) {}
+      Protocol(std::string_view msg, const Level lvl, time_t t)
+        : Protocol(msg, lvl, Clock::from_seconds(t)) {}
+      Protocol(std::string_view msg, const Level lvl, Timestamp t);
+      /// Совместимость со старым API: сообщение копируется из shared_ptr
+      Protocol(const std::shared_ptr<std::string>& msg, const Level lvl, time_t t)
+        : Protocol(std::string_view(*msg), lvl, t) {}
       Protocol() = default;
-      std::optional<Protocol>
+      Protocol(Protocol&&) noexcept;
+      Protocol& operator=(Protocol&&) noexcept;
+      Protocol(const Protocol&) = delete;
+      Protocol& operator=(const Protocol&) = delete;
+      ~Protocol() { release(); }
+
+      Protocol clone() const;
+
+      static std::optional<Protocol>
       create_log_entry(std::string&&, const Level, time_t);
-      Level get_level() const { return level; }
-      time_t get_time() const { return time; }
+      static std::optional<Protocol>
+      create_log_entry(std::string&&, const Level, Timestamp);
+      Level get_level() const { return static_cast<Level>(length >> length_bits); }
+      /// Время в секундах (с округлением вниз)
+      time_t get_time() const {
+        return static_cast<time_t>(std::chrono::floor<std::chrono::seconds>(get_timestamp()).count());
+      }
+      Timestamp get_timestamp() const { return Timestamp(stamp); }
+      /// Сообщение без копирования, действительно пока жива запись
+      std::string_view get_message_view() const { return {data(), size()}; }
+      /// Совместимость со старым API: возвращает копию сообщения
       std::shared_ptr<std::string>
-      get_message() const { return message; }
+      get_message() const { return std::make_shared<std::string>(get_message_view()); }
+
+      private:
+      std::size_t size() const { return length & max_length; }
+      bool is_external() const { return size() > inline_capacity; }
+      const char* data() const;
+      void release();
     };
+    static_assert(sizeof(Protocol) == 64, "Protocol must fit one cache line");
 
     template<typename T>
     std::optional<T> extract_last_number(std::string&);
+    template<typename T>
+    std::optional<T> extract_last_number(std::string_view&);
 
+    void serialization_log(const Protocol&, std::string&, bool nanoseconds = false);
+    std::optional<Protocol> deserialization_log(std::string_view);
+    /// Совместимость со старым API
     std::shared_ptr<std::string> serialization_log(const Protocol&);
+    /// Совместимость со старым API
     std::optional<Protocol> deserialization_log(std::shared_ptr<std::string>);
     std::ostream& print_log_entry(std::ostream& os, const Protocol&);
+
+    /**
+     * @class Entry_formatter
+     * @brief Форматирует записи в Output_format, дописывая в буфер вызывающего
+     *
+     * Дата форматируется один раз в секунду и берётся из кэша для соседних
+     * записей. Поиск символов, требующих экранирования (кавычка, обратная
+     * косая черта, управляющие символы), на x86-64 выполняется SSE2 по 16 байт,
+     * сообщение без таких символов копируется одним append. Байты UTF-8
+     * копируются как есть. Объект не потокобезопасен.
+     */
+    class Entry_formatter {
+      Output_format output;
+      long cached_second; ///< Секунда, для которой отформатирована дата
+      char date[40]{};
+      std::size_t date_length{};
+      public:
+      explicit Entry_formatter(Output_format output = Output_format::TEXT);
+      Output_format get_format() const { return output; }
+      /// Дописывает строку записи без перевода строки
+      void format(std::string& out, const Protocol&);
+    };
   }
 
   struct Error {
@@ -96,6 +204,23 @@ namespace Logger {
     std::string get_err_message() const { return error_message; }
   };
 
+  /**
+   * @brief Счётчики записанных и отброшенных записей по уровням
+   */
+  struct Logging_statistics {
+    uint64_t written[3]{}; ///< Передано в сессию
+    uint64_t sampled[3]{}; ///< Отброшено выборкой 1 из N
+    uint64_t rate_limited[3]{}; ///< Отброшено ограничением скорости
+    uint64_t suppressed[3]{}; ///< Подавлено повторов
+    uint64_t bytes_raw{}; ///< Байт записей до сжатия (транспорт сокета)
+    uint64_t bytes_sent{}; ///< Байт отправлено в сокет
+    uint64_t unacknowledged{}; ///< Записей ждут подтверждения (надёжный режим)
+    uint64_t retransmitted{}; ///< Записей отправлено из окна после переподключения
+    uint64_t syncs{}; ///< Вызовов fdatasync (запись в файл)
+    uint64_t dumps{}; ///< Выгрузок бортового самописца
+    uint64_t overwritten{}; ///< Записей самописца вытеснено новыми без выгрузки
+  };
+
   /**
    * @class Session
    * @brief Абстрактный интерфейс сессии логирования
@@ -113,9 +238,184 @@ namespace Logger {
     /// Записывает сообщение
     virtual std::optional<Error>
     write(const Logger_protocol::Protocol&) = 0;
+    /// Отправляет накопленные записи
+    virtual std::optional<Error> flush() { return {}; }
+    /// Дополняет счётчики данными транспорта
+    virtual void add_statistics(Logging_statistics&) const {}
     virtual ~Session() = default;
   };
 
+  /**
+   * @class Duplicate_filter
+   * @brief Подавление повторяющихся сообщений
+   *
+   * Для каждого уровня хранится небольшая таблица отпечатков (хеш сообщения)
+   * недавних сообщений. Первое сообщение окна записывается, повторы
+   * внутри окна только подсчитываются. Когда окно закрывается, формируется
+   * одна запись "<сообщение> (repeated N times)".
+   * Окно отсчитывается по меткам времени записей; окна, истёкшие по часам,
+   * закрываются sweep() (Logging::flush), даже если записей больше нет.
+   * Потокобезопасен: таблица защищена мьютексом, log_write может
+   * вызываться из нескольких потоков
+   */
+  class Duplicate_filter {
+    struct Slot {
+      std::size_t hash{}; ///< Отпечаток сообщения
+      time_t window_start{}; ///< Начало окна
+      time_t last_time{}; ///< Метка последнего повтора
+      uint64_t repeats{}; ///< Подавлено повторов
+      bool used{false};
+      Logger_protocol::Protocol entry; ///< Первая запись окна
+    };
+    static constexpr std::size_t level_count = 3;
+    time_t window; ///< Длительность окна в секундах
+    std::size_t mask; ///< Размер таблицы уровня - 1
+    std::mutex mtx; ///< Защищает slots, last_sweep и summaries
+    std::vector<Slot> slots; ///< Таблицы всех уровней подряд
+    time_t last_sweep{}; ///< Метка последней проверки закрытия окон
+    std::vector<Logger_protocol::Protocol> summaries; ///< Закрытые окна с повторами
+
+    public:
+    Duplicate_filter(time_t window, std::size_t slots_per_level);
+    bool accept(const Logger_protocol::Protocol&);
+    void sweep(time_t);
+    void flush();
+    /// Забирает записи о повторах закрытых окон, вызывающий выводит их
+    std::vector<Logger_protocol::Protocol> take_summaries();
+
+    private:
+    void close(Slot&);
+    void close_expired(time_t);
+  };
+
+  /**
+   * @brief Политика отбора записей одного уровня
+   */
+  struct Level_policy {
+    uint32_t sample = 1; ///< Оставлять 1 запись из sample (1 - все)
+    double rate = 0; ///< Записей в секунду (token bucket), 0 - без ограничения
+    double burst = 0; ///< Ёмкость корзины токенов, не меньше 1
+    bool always_keep = false; ///< Не применять выборку и ограничение (например, для ERROR)
+  };
+
+  /**
+   * @brief Политики отбора по уровням, индекс - значение Level
+   */
+  struct Rate_policy {
+    Level_policy levels[3];
+  };
+
+  /**
+   * @brief Настройки транспорта сокета
+   *
+   * При batch_bytes > 0 или compress при подключении отправляется
+   * запрос согласования; если сервер не ответил за handshake_timeout_ms,
+   * используется прежний формат - одна запись на кадр.
+   */
+  struct Socket_options {
+    std::size_t batch_bytes = 0; ///< Размер пачки записей, 0 - без пачек
+    /// Пачка, начатая раньше, отправляется при следующей записи, 0 - только по batch_bytes;
+    /// без новых записей пачку отправляет flush()
+    int batch_delay_ms = 200;
+    bool compress = false; ///< Сжимать пачки (LZ)
+    std::size_t compress_threshold = 256; ///< Пачки меньше не сжимаются
+    int handshake_timeout_ms = 1000; ///< Ожидание ответа на согласование
+    int connect_timeout_ms = 0; ///< Ожидание подключения, 0 - без ограничения
+    int send_timeout_ms = 0; ///< Ожидание отправки кадра (SO_SNDTIMEO), 0 - без ограничения
+    bool seqpacket = false; ///< Сокет UNIX типа SOCK_SEQPACKET: кадр - один пакет
+    bool nanoseconds = false; ///< Передавать время в наносекундах (согласуется с сервером)
+    bool reliable = false; ///< Подтверждения сервера и повторная отправка после переподключения
+    std::size_t window_records = 4096; ///< Наибольшее число неподтверждённых записей
+    int ack_timeout_ms = 5000; ///< Ожидание подтверждения при заполненном окне и закрытии
+    /// Идентификатор источника для статистики сервера по источникам
+    /// (Transport::valid_source), пустой - не передаётся
+    std::string source;
+    /// Записи длиннее отправляются частями такого размера (Transport::Frame_type::CHUNK,
+    /// согласуется с сервером), 0 - целиком одним кадром
+    std::size_t chunk_bytes = 0;
+  };
+
+  /**
+   * @enum Durability
+   * @brief Гарантия сохранности записей в файле при сбое системы
+   */
+  enum class Durability {
+    NONE,     ///< Записи остаются в кэше страниц ОС
+    PERIODIC, ///< fdatasync фоновым потоком раз в sync_interval_ms
+    SYNC      ///< log_write возвращается после сохранения записи на диск
+  };
+
+  /**
+   * @brief Настройки записи в файл
+   */
+  struct File_options {
+    Durability durability = Durability::NONE;
+    int sync_interval_ms = 1000; ///< Период fdatasync для Durability::PERIODIC
+    Output_format format = Output_format::TEXT; ///< Формат строк файла
+    /// Размер сегмента индекса токенов "<файл>.idx" (token_index.hpp), 0 - без индекса
+    std::size_t index_segment_bytes = 0;
+  };
+
+  /**
+   * @brief Настройки кольца в разделяемой памяти (Shared_ring)
+   *
+   * Размеры применяются только при создании кольца, существующее
+   * кольцо открывается с собственными размерами.
+   */
+  struct Ring_options {
+    std::string name; ///< Имя объекта shm_open
+    uint32_t slot_count = 4096; ///< Количество слотов, степень двойки
+    uint32_t slot_size = 256; ///< Размер слота вместе с заголовком
+    int abandon_timeout_ms = 1000; ///< Через сколько пропускать незафиксированный слот
+  };
+
+  /**
+   * @brief Настройки бортового самописца (Recorder_logging)
+   */
+  struct Recorder_options {
+    std::size_t capacity = 4u << 20; ///< Размер кольца записей, байт
+    std::string dump_file; ///< Файл выгрузки, записи дописываются в формате File_logging
+    std::optional<Level> trigger = Level::ERROR; ///< Выгрузка при записи не ниже уровня
+    int dump_signal = 0; ///< Сигнал выгрузки (например SIGUSR1), 0 - без сигнала
+  };
+
+  class Shared_ring;
+  namespace Token_index { class Builder; }
+
+  /**
+   * @class Rate_filter
+   * @brief Выборка и ограничение скорости записей по уровням
+   *
+   * Политика заменяется атомарно во время работы: читатель загружает
+   * shared_ptr на неизменяемую политику (std::atomic_load), заменённая
+   * политика освобождается, когда её перестают использовать.
+   * Потокобезопасен: счётчики выборки атомарные, корзина токенов уровня
+   * изменяется под собственной спин-блокировкой.
+   */
+  class Rate_filter {
+    public:
+    enum class Result { KEEP, SAMPLED, RATE_LIMITED };
+
+    Rate_filter() = default;
+    Rate_filter(const Rate_filter&) = delete;
+    Rate_filter& operator=(const Rate_filter&) = delete;
+
+    void set_policy(const Rate_policy&);
+    Result check(Level);
+
+    private:
+    struct Bucket {
+      std::atomic_flag locked = ATOMIC_FLAG_INIT; ///< Спин-блокировка полей корзины
+      double tokens{};
+      std::chrono::steady_clock::time_point last{};
+      bool started{false};
+    };
+    std::shared_ptr<const Rate_policy> policy; ///< Текущая политика, только std::atomic_load/store
+    std::atomic<bool> enabled{false}; ///< Политика установлена: без неё check не загружает policy
+    std::atomic<uint64_t> counters[3]{}; ///< Счётчики выборки
+    Bucket buckets[3]; ///< Корзины токенов
+  };
+
   /**
    * @class Logging
    * @brief Основной интерфейс логгера, позволяющий записывать сообщения
@@ -127,39 +427,95 @@ namespace Logger {
   class Logging {
     std::unique_ptr<Session> session; ///< Объект сессии (файл или сокет)
     std::atomic<Level> level; ///< Минимальный уровень логирования
-    Logger_protocol::Protocol protocol; ///< Протокол формирования лог-записей
+    std::unique_ptr<Duplicate_filter> duplicates; ///< Подавление повторов (не обязательно)
+    Rate_filter rates; ///< Выборка и ограничение скорости
+    std::atomic<uint64_t> written[3]{}; ///< Передано в сессию по уровням
+    std::atomic<uint64_t> sampled[3]{}; ///< Отброшено выборкой по уровням
+    std::atomic<uint64_t> rate_limited[3]{}; ///< Отброшено ограничением скорости по уровням
+    std::atomic<uint64_t> suppressed[3]{}; ///< Подавлено повторов по уровням
 
     public:
     /// Конструктор для записи в сокет
-    Logging(const std::string& host,const std::string& port,Level level);
+    Logging(const std::string& host,const std::string& port,Level level,
+      const Socket_options& options = {});
     /// Конструктор для записи в файл
-    Logging(const std::string& file_name, Level level);
+    Logging(const std::string& file_name, Level level, const File_options& options = {});
+    /// Конструктор для записи в кольцо в разделяемой памяти
+    Logging(const Ring_options& options, Level level);
+    /// Конструктор бортового самописца
+    Logging(const Recorder_options& options, Level level);
 
     Logging() = delete;
     Logging(const Logging&) = delete;
     Logging& operator=(const Logging&) = delete;
+    ~Logging();
 
     std::optional<Error> open_session();
     std::optional<Error> close_session();
+    std::optional<Error> flush();
 
+    std::optional<Error>
+    log_write(std::string&&, time_t);
+    std::optional<Error>
+    log_write(std::string&&, Timestamp);
+    std::optional<Error>
+    log_write(const Logger_protocol::Protocol&);
+    /// Совместимость со старым API
     std::optional<Error>
     log_write(std::shared_ptr<std::string>, time_t);
 
     void set_level(const Level);
+    void set_suppression(time_t window, std::size_t slots_per_level = 64);
+    void set_rate_policy(const Rate_policy&);
+    Logging_statistics get_statistics() const;
+
+    private:
+    std::optional<Error> write_summaries();
   };
 
   /**
    * @class Socket_logging
    * @brief Реализация сессии логирования через сокет
-   * @brief Использует протокол IPv4 и TCP
+   * @brief Использует протокол IPv4 и TCP, либо сокет домена UNIX,
+   *        если адрес хоста - путь (содержит '/')
+   *
+   * После согласования записи отправляются пачками (Transport::Frame_type::BATCH),
+   * пачки не меньше compress_threshold сжимаются (Transport::Frame_type::COMPRESSED).
+   * Запись длиннее chunk_bytes отправляется после текущей пачки кадрами
+   * Transport::Frame_type::CHUNK, каждый не больше chunk_bytes + 2 байт, -
+   * размер кадра ограничен независимо от длины записи.
+   *
+   * Надёжный режим (Socket_options::reliable): отправленные записи хранятся
+   * в окне до накопительного подтверждения сервера (Transport::Frame_type::ACK).
+   * Отправка не ждёт подтверждений, пока окно не заполнено. После ошибки
+   * сокета или истечения ack_timeout_ms сессия переподключается и отправляет
+   * окно повторно - доставка "не менее одного раза".
    */
   class Socket_logging final : public Session {
     friend class Logging;
-    int fd{};
+    int fd{-1};
     std::string host, port;
+    Socket_options options;
+    std::string buffer; ///< Переиспользуемый буфер сериализации
+    std::string batch; ///< Тело текущей пачки
+    std::chrono::steady_clock::time_point batch_started; ///< Первая запись текущей пачки
+    std::string frame; ///< Буфер кадра для отправки
+    bool framed{false}; ///< Сервер согласовал кадры с типом
+    bool compress{false}; ///< Сервер согласовал сжатие
+    bool nanoseconds{false}; ///< Сервер согласовал время в наносекундах
+    bool acknowledged{false}; ///< Сервер согласовал подтверждения
+    bool chunked{false}; ///< Сервер согласовал передачу записей частями
+    bool packet{false}; ///< Кадры - пакеты SOCK_SEQPACKET без префикса длины
+    std::atomic<uint64_t> bytes_raw{}, bytes_sent{};
+    std::deque<std::string> window; ///< Отправленные и неподтверждённые записи
+    uint64_t window_base{}; ///< Номер первой записи окна
+    uint64_t connection_base{}; ///< Номер первой записи текущего соединения
+    std::string acks; ///< Принятые байты кадров подтверждения
+    std::atomic<uint64_t> unacknowledged{}, retransmitted{};
 
-    Socket_logging(const std::string& host, const std::string& port)
-      : host(host), port(port)
+    Socket_logging(const std::string& host, const std::string& port,
+      const Socket_options& options = {})
+      : host(host), port(port), options(options)
     {}
     public:
     Socket_logging(const Socket_logging&) = delete;
@@ -169,37 +525,223 @@ namespace Logger {
     std::optional<Error> open_session() override;
     std::optional<Error> close_session() override;
     std::optional<Error> write(const Logger_protocol::Protocol&) override;
+    std::optional<Error> flush() override;
+    void add_statistics(Logging_statistics&) const override;
+    std::optional<Error> negotiate();
+    std::optional<Error> send_batch();
+    std::optional<Error> send_chunks(std::string_view record);
+    std::optional<Error> reconnect();
+    std::optional<Error> receive_acks(int timeout_ms);
+    std::optional<Error> wait_acknowledged(std::size_t pending);
+    void acknowledge(uint64_t count);
+    void disconnect();
+    std::variant<int, Error> send_frame(std::string_view);
+    std::optional<Error> receive_frame(std::string&);
+  };
+
+  /**
+   * @class Ring_logging
+   * @brief Реализация сессии логирования в кольцо в разделяемой памяти
+   *
+   * Запись не выполняет системных вызовов; при заполненном кольце
+   * запись отбрасывается с ошибкой, а счётчик кольца dropped увеличивается.
+   */
+  class Ring_logging final : public Session {
+    friend class Logging;
+    Ring_options options;
+    std::unique_ptr<Shared_ring> ring;
+
+    Ring_logging(const Ring_options& options);
+    public:
+    Ring_logging(const Ring_logging&) = delete;
+    Ring_logging& operator=(const Ring_logging&) = delete;
+    ~Ring_logging() override;
+    private:
+    std::optional<Error> open_session() override;
+    std::optional<Error> close_session() override;
+    std::optional<Error> write(const Logger_protocol::Protocol&) override;
   };
 
   /**
    * @class File_logging
    * @brief Реализация сессии логирования в файл.
+   *
+   * Запись потокобезопасна. В режиме Durability::SYNC используется
+   * групповая фиксация: поток, заставший диск свободным, выполняет
+   * fdatasync за все дописанные к этому моменту записи, остальные
+   * ждут его и освобождаются, как только их запись сохранена.
+   * После ошибки fdatasync сессия больше не подтверждает записи.
    */
   class File_logging final: public Session {
     friend class Logging;
     std::ofstream log_file;
     std::string file_name;
+    File_options options;
+    Logger_protocol::Entry_formatter formatter; ///< Формат options.format
+    std::string line; ///< Переиспользуемый буфер строки
+    int sync_fd{-1}; ///< Дескриптор того же файла для fdatasync
+    std::mutex mtx; ///< Защищает поток файла и состояние фиксации
+    std::condition_variable synced; ///< Завершён fdatasync или остановка
+    uint64_t appended{}; ///< Номер последней дописанной записи
+    uint64_t durable{}; ///< Номер последней сохранённой на диске записи
+    bool syncing{false}; ///< fdatasync выполняется без блокировки
+    bool stopping{false}; ///< Остановка потока периодической фиксации
+    std::optional<Error> sync_error; ///< Ошибка fdatasync
+    std::thread syncer; ///< Поток периодической фиксации
+    std::atomic<uint64_t> syncs{}; ///< Вызовов fdatasync
+    std::unique_ptr<Token_index::Builder> index; ///< Индекс токенов по сегментам
+    std::optional<Error> index_error; ///< Ошибка индекса, возвращается close_session
 
-    File_logging(const std::string& file_name) : file_name(file_name) {}
+    File_logging(const std::string& file_name, const File_options& options);
     File_logging(const File_logging&) = delete;
     File_logging& operator=(const File_logging&) = delete;
 
     public:
-    ~File_logging() override { close_session(); }
+    ~File_logging() override;
 
     private:
     std::optional<Error> open_session() override;
     std::optional<Error> close_session() override;
     std::optional<Error> write(const Logger_protocol::Protocol&) override;
+    void add_statistics(Logging_statistics&) const override;
+
+    std::optional<Error> commit(std::unique_lock<std::mutex>&, uint64_t position);
+    void run_syncer();
   };
 
-  std::optional<Level> deserialization_level(const std::string&);
+  /**
+   * @class Recorder_logging
+   * @brief Бортовой самописец: последние записи в кольце в памяти
+   *
+   * Кольцо выделяется и заполняется при открытии сессии. Запись копирует
+   * заголовок (длина, уровень, время в наносекундах) и текст в кольцо,
+   * вытесняя самые старые записи, - без системных вызовов.
+   * Записи выгружаются в dump_file по flush(), по сигналу dump_signal
+   * и при записи уровня не ниже trigger; выгрузку выполняет отдельный поток
+   * (кроме flush), выгруженные записи из кольца удаляются.
+   * При закрытии сессии невыгруженные записи отбрасываются.
+   */
+  class Recorder_logging final : public Session {
+    friend class Logging;
+    Recorder_options options;
+    std::unique_ptr<char[]> ring; ///< Кольцо записей
+    uint64_t head{}; ///< Позиция самой старой записи (растёт монотонно)
+    uint64_t tail{}; ///< Позиция следующей записи
+    std::mutex mtx; ///< Защищает кольцо и запрос выгрузки
+    std::condition_variable wake; ///< Запрос выгрузки или остановка
+    bool dump_requested{false};
+    bool stopping{false};
+    std::mutex dump_mtx; ///< Упорядочивает выгрузки
+    std::optional<Error> dump_error; ///< Ошибка выгрузки потоком, под mtx
+    std::thread dumper; ///< Поток выгрузки по уровню и сигналу
+    std::atomic<uint64_t> dumps{};
+    std::atomic<uint64_t> overwritten{};
+
+    Recorder_logging(const Recorder_options& options) : options(options) {}
+    public:
+    Recorder_logging(const Recorder_logging&) = delete;
+    Recorder_logging& operator=(const Recorder_logging&) = delete;
+    ~Recorder_logging() override { close_session(); }
+    private:
+    std::optional<Error> open_session() override;
+    std::optional<Error> close_session() override;
+    std::optional<Error> write(const Logger_protocol::Protocol&) override;
+    std::optional<Error> flush() override;
+    void add_statistics(Logging_statistics&) const override;
+
+    std::optional<Error> dump();
+    void run_dumper(uint64_t seen);
+    void drop_oldest();
+  };
+
+  std::optional<Level> deserialization_level(std::string_view);
   std::optional<std::string>serialization_level(const Level);
+  std::optional<Output_format> parse_output_format(std::string_view);
+
+  namespace Compression {
+    /// Сжимает данные в блок формата LZ4, дописывая в out
+    void compress(std::string_view, std::string& out);
+    /// Распаковывает блок, размер исходных данных известен заранее
+    std::optional<Error> decompress(std::string_view, std::size_t, std::string& out);
+  }
+
+  namespace Transport {
+    /// Первый байт кадра согласования, не встречается в начале записи
+    constexpr char control_marker = '\x01';
+    /// Наибольший размер распакованной пачки
+    constexpr std::size_t max_batch_size = 64u << 20;
+    /// Наибольший размер принимаемого кадра по умолчанию (Socket::socket_read)
+    constexpr std::size_t max_frame_size = 64u << 20;
+
+    /**
+     * @enum Frame_type
+     * @brief Тип кадра после согласования, первый байт кадра
+     */
+    enum class Frame_type : char {
+      RECORD = 'R',     ///< Одна запись
+      BATCH = 'B',      ///< Пачка: записи с префиксом длины uint32_t
+      COMPRESSED = 'Z', ///< Сжатая пачка: uint32_t размер пачки + блок LZ
+      ACK = 'A',        ///< Подтверждение сервера: uint64_t записей, принятых соединением
+      CHUNK = 'C'       ///< Часть большой записи: флаг продолжения (1 - будут ещё части) + данные
+    };
+
+    /**
+     * @brief Параметры согласования соединения
+     */
+    struct Handshake {
+      bool compress{false}; ///< Сжатие пачек
+      bool nanoseconds{false}; ///< Время записей в наносекундах ("<секунды>.<9 цифр>")
+      bool acknowledge{false}; ///< Накопительные подтверждения записей
+      std::string source; ///< Идентификатор источника записей, пустой - не задан
+      bool chunks{false}; ///< Длинные записи передаются частями (Frame_type::CHUNK)
+    };
+
+    /**
+     * @brief Часть записи из кадра Frame_type::CHUNK
+     */
+    struct Chunk {
+      bool more{false}; ///< За частью следуют другие части той же записи
+      std::string_view data; ///< Байты сериализованной записи
+    };
+
+    /// Наибольшая длина идентификатора источника
+    constexpr std::size_t max_source_length = 47;
+    bool valid_source(std::string_view);
+
+    std::string make_handshake(std::string_view, const Handshake&);
+    std::optional<Handshake> parse_handshake(std::string_view, std::string_view);
+    void append_record(std::string& batch, std::string_view record);
+    std::string make_ack(uint64_t);
+    std::optional<uint64_t> parse_ack(std::string_view);
+    Error frame_too_large(std::size_t size, std::size_t max_size);
+    void append_chunk(std::string& frame, std::string_view data, bool more);
+    std::optional<Chunk> parse_chunk(std::string_view);
+    std::optional<Error> decode_frame(std::string_view, std::string& scratch,
+      const std::function<void(std::string_view)>&);
+  }
 
   namespace Socket {
-    /// читает сокет
-    std::variant<std::shared_ptr<std::string>, Error> socket_read(const int);
+    /// подключается по TCP/IPv4, либо к сокету UNIX, если хост - путь
+    std::variant<int, Error> socket_connect(const std::string&, const std::string&, bool = false,
+      int timeout_ms = 0);
+    /// ограничивает ожидание отправки в сокет (SO_SNDTIMEO), 0 - без ограничения
+    std::optional<Error> set_send_timeout(const int, int timeout_ms);
+    /// читает сокет в переиспользуемый буфер, кадр длиннее max_size - ошибка
+    std::optional<Error> socket_read(const int, std::string&, std::size_t max_size = Transport::max_frame_size);
+    /// читает сокет в буфер из пула
+    std::optional<Error> socket_read(const int, Memory::Pool_string&,
+      std::size_t max_size = Transport::max_frame_size);
     /// пишет в сокет
+    std::variant<int, Error> socket_write(const int, std::string_view);
+    /// читает сокет (совместимость со старым API)
+    std::variant<std::shared_ptr<std::string>, Error> socket_read(const int);
+    /// пишет в сокет (совместимость со старым API)
     std::variant<int, Error> socket_write(const int,std::shared_ptr<std::string>);
+    /// читает пакет SOCK_SEQPACKET в переиспользуемый буфер
+    std::optional<Error> packet_read(const int, std::string&, std::size_t max_size = Transport::max_frame_size);
+    /// пишет пакет SOCK_SEQPACKET
+    std::variant<int, Error> packet_write(const int, std::string_view);
+    /// собеседник закрыл соединение: recv вернул 0 не из-за пакета нулевой длины
+    bool peer_closed(const int);
   }
 }
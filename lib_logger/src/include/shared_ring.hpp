@@ -0,0 +1,101 @@
+#pragma once
+
+#include "logger.hpp"
+
+/**
+ * @file shared_ring.hpp
+ * @brief Кольцо записей в разделяемой памяти
+ *
+ * Производители (Ring_logging) из разных процессов записывают записи в слоты
+ * кольца без системного вызова на запись, потребитель (statistic_app) копирует
+ * запись из слота в Protocol и проверяет контрольную сумму копии. Потребитель
+ * засыпает на futex только когда кольцо пусто.
+ */
+
+namespace Logger {
+
+  /**
+   * @class Shared_ring
+   * @brief Ограниченная очередь фиксированных слотов в памяти shm_open
+   *
+   * Слот несёт номер последовательности (схема Вьюкова): производитель
+   * резервирует позицию CAS-ом head, записывает запись и фиксирует слот
+   * CAS-ом номера; потребитель освобождает слот для следующего круга.
+   *
+   * Устойчивость:
+   * - потребитель единственный (flock), позиция чтения хранится в кольце,
+   *   перезапущенный потребитель продолжает с неё (запись, обработка которой
+   *   прервалась, будет прочитана повторно);
+   * - слот, зарезервированный и не зафиксированный дольше abandon_timeout_ms
+   *   (производитель завершился аварийно), пропускается потребителем;
+   *   опоздавший производитель не сможет его зафиксировать;
+   * - каждая запись проверяется контрольной суммой, повреждённые пропускаются.
+   */
+  class Shared_ring {
+    public:
+    static constexpr uint64_t magic_value = 0x4c4f4752494e4732; ///< "LOGRING2"
+
+    /// Заголовок кольца в разделяемой памяти
+    struct Header {
+      std::atomic<uint64_t> magic; ///< Записывается последним при создании
+      uint32_t slot_count;
+      uint32_t slot_size;
+      int32_t abandon_timeout_ms;
+      alignas(64) std::atomic<uint64_t> head; ///< Следующая позиция производителей
+      alignas(64) std::atomic<uint64_t> tail; ///< Следующая позиция потребителя
+      std::atomic<uint32_t> signal; ///< Слово futex пробуждения потребителя
+      std::atomic<uint32_t> consumer_waiting; ///< Потребитель спит на signal
+      std::atomic<uint64_t> dropped; ///< Записи, не поместившиеся в кольцо
+      std::atomic<uint64_t> abandoned; ///< Пропущенные слоты
+    };
+
+    /// Заголовок слота, за ним - текст сообщения
+    struct Slot {
+      std::atomic<uint64_t> sequence; ///< pos - свободен, pos + 1 - зафиксирован
+      uint32_t checksum;
+      uint32_t length;
+      int64_t time; ///< Наносекунды от начала эпохи Unix
+      uint32_t level;
+    };
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared atomics must be lock-free");
+    static_assert(std::atomic<uint32_t>::is_always_lock_free, "shared atomics must be lock-free");
+
+    static std::variant<std::unique_ptr<Shared_ring>, Error>
+    open(const Ring_options&, bool consumer = false);
+    static void remove(const std::string& name);
+
+    ~Shared_ring();
+    Shared_ring(const Shared_ring&) = delete;
+    Shared_ring& operator=(const Shared_ring&) = delete;
+
+    std::optional<Error> push(const Logger_protocol::Protocol&);
+    std::size_t consume(const std::function<void(Logger_protocol::Protocol&&)>&,
+      std::size_t max_count = SIZE_MAX);
+    void wait(int timeout_ms);
+
+    /// Наибольшая длина сообщения в слоте
+    std::size_t max_message() const { return header->slot_size - sizeof(Slot); }
+    uint64_t get_dropped() const { return header->dropped.load(std::memory_order_relaxed); }
+    uint64_t get_abandoned() const { return header->abandoned.load(std::memory_order_relaxed); }
+
+    private:
+    Shared_ring(int fd, void* memory, std::size_t size)
+      : fd(fd), memory(memory), size(size), header(static_cast<Header*>(memory))
+    {}
+
+    Slot& slot(uint64_t position) {
+      auto base = static_cast<char*>(memory) + sizeof(Header);
+      return *reinterpret_cast<Slot*>(
+        base + (position & (header->slot_count - 1)) * header->slot_size);
+    }
+    bool skip_abandoned(uint64_t position);
+
+    int fd;
+    void* memory;
+    std::size_t size;
+    Header* header;
+    uint64_t stuck_position{UINT64_MAX}; ///< Позиция незафиксированного слота
+    std::chrono::steady_clock::time_point stuck_since; ///< С какого момента ждём
+  };
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "logger.hpp"
+
+/**
+ * @file token_index.hpp
+ * @brief Индекс токенов журнала: фильтры Блума по сегментам файла
+ *
+ * File_logging с File_options::index_segment_bytes делит файл на сегменты
+ * (участки из целых строк) и для каждого дописывает в "<журнал>.idx" фильтр
+ * Блума по токенам строк. Поиск проверяет фильтры и читает только сегменты,
+ * которые могут содержать все токены запроса; участки файла без фильтра
+ * (хвост после сбоя, строки до включения индекса) читаются всегда.
+ *
+ * Токен - наибольшая последовательность латинских букв, цифр, '_'
+ * и байтов UTF-8 (>= 0x80); регистр учитывается.
+ * Формат файла: "LOGBLOOM", затем сегменты; числа - в сетевом порядке байт.
+ */
+
+namespace Logger::Token_index {
+  constexpr char magic[8] = {'L', 'O', 'G', 'B', 'L', 'O', 'O', 'M'};
+
+  /// Символ входит в токен
+  inline bool is_token_char(unsigned char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+      c == '_' || c >= 0x80;
+  }
+
+  /// Вызывает on_token для каждого токена текста по порядку
+  template<typename Callback>
+  void for_each_token(std::string_view text, Callback&& on_token) {
+    std::size_t position = 0;
+    while (position < text.size()) {
+      while (position < text.size() && !is_token_char(static_cast<unsigned char>(text[position]))) {
+        ++position;
+      }
+      auto start = position;
+      while (position < text.size() && is_token_char(static_cast<unsigned char>(text[position]))) {
+        ++position;
+      }
+      if (position > start) on_token(text.substr(start, position - start));
+    }
+  }
+
+  uint64_t hash_token(std::string_view);
+
+  /**
+   * @class Bloom_filter
+   * @brief Фильтр Блума по хешам токенов
+   *
+   * Размер выбирается по количеству различных токенов сегмента:
+   * bits_per_token бит на токен и hash_count проверяемых бит
+   * (около 1% ложных срабатываний при 10 битах и 7 хешах)
+   */
+  class Bloom_filter {
+    std::vector<uint64_t> words;
+    uint32_t hash_count{};
+    public:
+    static constexpr uint32_t bits_per_token = 10;
+    static constexpr uint32_t default_hashes = 7;
+
+    /// Строит фильтр; хеши сортируются и повторы удаляются
+    static Bloom_filter build(std::vector<uint64_t>& hashes);
+    bool may_contain(uint64_t hash) const;
+    std::size_t bit_count() const { return words.size() * 64; }
+    void serialize(std::string&) const;
+    /// Разбирает фильтр в начале data и удаляет его из data
+    static std::optional<Bloom_filter> deserialize(std::string_view& data);
+  };
+
+  /**
+   * @brief Сегмент журнала: участок [offset, offset + length) и его фильтр
+   */
+  struct Segment {
+    uint64_t offset{};
+    uint64_t length{};
+    Bloom_filter filter;
+  };
+
+  /// Путь к индексу журнала
+  inline std::string index_path(const std::string& log_file) { return log_file + ".idx"; }
+
+  /**
+   * @brief Читает сегменты индекса
+   *
+   * Недописанный последний сегмент (сбой во время записи) отбрасывается
+   * @return variant<vector<Segment>, Error> Сегменты по порядку записи или ошибка формата
+   */
+  std::variant<std::vector<Segment>, Error> read_index(const std::string& path);
+
+  /**
+   * @class Builder
+   * @brief Накопление токенов текущего сегмента и запись фильтров в индекс
+   *
+   * Используется File_logging под его блокировкой: add() после каждой
+   * строки, сегмент закрывается, когда в нём не меньше segment_bytes байт
+   */
+  class Builder {
+    int fd;
+    std::size_t segment_bytes;
+    uint64_t offset; ///< Начало текущего сегмента в журнале
+    uint64_t length{}; ///< Байт строк текущего сегмента
+    std::vector<uint64_t> hashes; ///< Хеши токенов текущего сегмента
+    std::string buffer; ///< Буфер записи сегмента
+    uint64_t segments{}; ///< Записано сегментов
+
+    Builder(int fd, std::size_t segment_bytes, uint64_t offset)
+      : fd(fd), segment_bytes(segment_bytes), offset(offset) {}
+
+    public:
+    static std::variant<std::unique_ptr<Builder>, Error>
+    open(const std::string& log_file, uint64_t log_size, std::size_t segment_bytes);
+    Builder(const Builder&) = delete;
+    Builder& operator=(const Builder&) = delete;
+    ~Builder() { ::close(fd); }
+
+    /// Учитывает строку журнала, line - вместе с переводом строки
+    std::optional<Error> add(std::string_view line);
+    /// Записывает незакрытый сегмент
+    std::optional<Error> finish();
+    uint64_t get_segments() const { return segments; }
+  };
+}
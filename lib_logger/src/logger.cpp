@@ -2,28 +2,57 @@
 #include <algorithm>
 #include <cctype>
 #include <charconv>
-#include <unordered_map>
 #include <iomanip>
+#include <time.h>
 
 namespace Logger {
 
 /*** Interface Logger ***/
   /**
     * @brief Конструктор для логирования в сокет
-    * @param host  Адрес хоста (IP)
-    * @param port  Порт для подключения
+    * @param host  Адрес хоста (IP), либо путь к сокету домена UNIX
+    * @param port  Порт для подключения (для сокета UNIX не используется)
     * @param level Минимальный уровень логирования (сообщения ниже будут отфильтрованы)
+    * @param options Настройки транспорта: пачки, сжатие, тип сокета UNIX
   */
-  Logging::Logging(const std::string& host,const std::string& port, Logger::Level level)
-    : session(new Socket_logging(host, port)), level(level) {}
+  Logging::Logging(const std::string& host,const std::string& port, Logger::Level level,
+    const Socket_options& options)
+    : session(new Socket_logging(host, port, options)), level(level) {}
 
   /**
    * @brief Конструктор для логирования в файл
    * @param file_name Путь к файлу, в который будут записываться логи
    * @param level Минимальный уровень логирования (сообщения ниже будут отфильтрованы)
+   * @param options Гарантия сохранности записей (Durability)
   */
-  Logging::Logging(const std::string& file_name, Logger::Level level)
-    : session(new File_logging(file_name)), level(level) {}
+  Logging::Logging(const std::string& file_name, Logger::Level level, const File_options& options)
+    : session(new File_logging(file_name, options)), level(level) {}
+
+  /**
+   * @brief Конструктор для логирования в кольцо в разделяемой памяти
+   * @param options Имя и размеры кольца (Shared_ring)
+   * @param level Минимальный уровень логирования (сообщения ниже будут отфильтрованы)
+  */
+  Logging::Logging(const Ring_options& options, Logger::Level level)
+    : session(new Ring_logging(options)), level(level) {}
+
+  /**
+   * @brief Конструктор бортового самописца
+   * @param options Размер кольца, файл и условия выгрузки (Recorder_logging)
+   * @param level Минимальный уровень логирования (сообщения ниже будут отфильтрованы)
+  */
+  Logging::Logging(const Recorder_options& options, Logger::Level level)
+    : session(new Recorder_logging(options)), level(level) {}
+
+  /**
+   * @brief Записывает счётчики открытых окон подавления повторов
+   */
+  Logging::~Logging() {
+    if (duplicates) {
+      duplicates->flush();
+      write_summaries();
+    }
+  }
 
   /**
    * @brief Открывает сессию логирования
@@ -37,24 +66,137 @@ namespace Logger {
    * @return std::nullopt в случае успеха или объект Error при ошибке
    */
   std::optional<Error> Logging::close_session() {
+    if (duplicates) {
+      // закрываем окна подавления, чтобы записать счётчики повторов
+      duplicates->flush();
+      if (auto error = write_summaries()) return error;
+    }
     return session->close_session();
   }
+  /**
+   * @brief Отправляет накопленные сессией записи
+   *
+   * При подавлении повторов сначала закрываются окна, истёкшие по часам,
+   * и записываются их счётчики повторов: периодический flush() выводит итог
+   * серии повторов, даже если после неё записей нет
+   * @return std::nullopt в случае успеха или объект Error при ошибке
+   */
+  std::optional<Error> Logging::flush() {
+    if (duplicates) {
+      duplicates->sweep(std::time(nullptr));
+      if (auto error = write_summaries()) return error;
+    }
+    return session->flush();
+  }
   /**
    * @brief Записывает сообщение в лог, если его уровень >= минимальному уровню логирования
    *
-   * @param message Указатель на строку с текстом сообщения
+   * @param message Строка с текстом сообщения, используется как рабочий буфер
    * @param time Метка времени (в формате time_t)
    * @return std::nullopt в случае успеха или объект Error при ошибке
    */
   std::optional<Error>
-  Logging::log_write(std::shared_ptr<std::string> message, time_t time) {
-    if (auto entry_log = protocol.create_log_entry(std::move(*message), level, time)) {
-      if (entry_log.value().get_level() >= level) {
-        return session->write(entry_log.value());
+  Logging::log_write(std::string&& message, time_t time) {
+    return log_write(std::move(message), Clock::from_seconds(time));
+  }
+
+  /**
+   * @brief Записывает сообщение с меткой времени в наносекундах
+   *
+   * @param message Строка с текстом сообщения, используется как рабочий буфер
+   * @param time Метка времени (например, Clock::now())
+   * @return std::nullopt в случае успеха или объект Error при ошибке
+   */
+  std::optional<Error>
+  Logging::log_write(std::string&& message, Timestamp time) {
+    if (auto entry_log = Logger_protocol::Protocol::create_log_entry(std::move(message), level, time)) {
+      return log_write(entry_log.value());
+    }
+    return {};
+  }
+
+  /**
+   * @brief Записывает готовую запись в лог, если её уровень >= минимальному уровню логирования
+   *
+   * @param entry_log Запись протокола
+   * @return std::nullopt в случае успеха или объект Error при ошибке
+   */
+  std::optional<Error>
+  Logging::log_write(const Logger_protocol::Protocol& entry_log) {
+    if (entry_log.get_level() < level) return {};
+    auto index = static_cast<std::size_t>(entry_log.get_level()) % std::size(written);
+    // отбор выполняется до форматирования записи
+    switch (rates.check(entry_log.get_level())) {
+      case Rate_filter::Result::KEEP: break;
+      case Rate_filter::Result::SAMPLED:
+        sampled[index].fetch_add(1, std::memory_order_relaxed);
+        return {};
+      case Rate_filter::Result::RATE_LIMITED:
+        rate_limited[index].fetch_add(1, std::memory_order_relaxed);
+        return {};
+    }
+    if (duplicates) {
+      bool accepted = duplicates->accept(entry_log);
+      // записи о повторах закрытых окон старше текущей записи
+      if (auto error = write_summaries()) return error;
+      if (!accepted) {
+        suppressed[index].fetch_add(1, std::memory_order_relaxed);
+        return {};
       }
     }
+    written[index].fetch_add(1, std::memory_order_relaxed);
+    return session->write(entry_log);
+  }
+
+  /**
+   * @brief Устанавливает политики выборки и ограничения скорости по уровням
+   *
+   * Может вызываться во время записи из другого потока: политика
+   * заменяется атомарно
+   * @param policy Политики уровней
+   */
+  void Logging::set_rate_policy(const Rate_policy& policy) {
+    rates.set_policy(policy);
+  }
+
+  /**
+   * @brief Возвращает счётчики записанных и отброшенных записей
+   * @return Logging_statistics Счётчики по уровням
+   */
+  Logging_statistics Logging::get_statistics() const {
+    Logging_statistics statistics;
+    for (std::size_t i = 0; i < std::size(written); ++i) {
+      statistics.written[i] = written[i].load(std::memory_order_relaxed);
+      statistics.sampled[i] = sampled[i].load(std::memory_order_relaxed);
+      statistics.rate_limited[i] = rate_limited[i].load(std::memory_order_relaxed);
+      statistics.suppressed[i] = suppressed[i].load(std::memory_order_relaxed);
+    }
+    session->add_statistics(statistics);
+    return statistics;
+  }
+
+  /**
+   * @brief Записывает накопленные записи о подавленных повторах
+   * @return std::nullopt в случае успеха или объект Error при ошибке
+   */
+  std::optional<Error> Logging::write_summaries() {
+    for (const auto& summary : duplicates->take_summaries()) {
+      if (auto error = session->write(summary)) return error;
+    }
     return {};
   }
+
+  /**
+   * @brief Записывает сообщение в лог (совместимость со старым API)
+   *
+   * @param message Указатель на строку с текстом сообщения, строка перемещается
+   * @param time Метка времени (в формате time_t)
+   * @return std::nullopt в случае успеха или объект Error при ошибке
+   */
+  std::optional<Error>
+  Logging::log_write(std::shared_ptr<std::string> message, time_t time) {
+    return log_write(std::move(*message), time);
+  }
   /**
    * @brief Устанавливает минимальный уровень логирования
    * Сообщения с уровнем ниже установленного будут игнорироваться
@@ -62,18 +204,135 @@ namespace Logger {
    */
    void Logging::set_level(const Level lvl) { level = lvl; }
 
+  /**
+   * @brief Включает подавление повторяющихся сообщений
+   *
+   * Повторы сообщения с тем же уровнем в течение окна не записываются,
+   * по закрытии окна записывается одна запись "(repeated N times)".
+   * Стоимость - один хеш сообщения на запись
+   *
+   * @param window Длительность окна в секундах, 0 - отключить подавление
+   * @param slots_per_level Размер таблицы отпечатков одного уровня
+   * @note Открытые окна при отключении отбрасываются
+   */
+  void Logging::set_suppression(time_t window, std::size_t slots_per_level) {
+    if (window <= 0) {
+      duplicates.reset();
+      return;
+    }
+    duplicates = std::make_unique<Duplicate_filter>(window, slots_per_level);
+  }
+
 /*** Interface Logger ***/
 
 /*** ---------------------------------- ***/
 
+/*** clock ***/
+
+/**
+ * @brief Читает часы реального времени
+ * @return Timestamp Время с разрешением часов (обычно наносекунды)
+ */
+Timestamp Clock::now() {
+  timespec time{};
+  ::clock_gettime(CLOCK_REALTIME, &time);
+  return std::chrono::seconds(time.tv_sec) + std::chrono::nanoseconds(time.tv_nsec);
+}
+
+/**
+ * @brief Читает грубые часы реального времени
+ * @return Timestamp Время с точностью до тика планировщика
+ */
+Timestamp Clock::coarse_now() {
+  timespec time{};
+  ::clock_gettime(CLOCK_REALTIME_COARSE, &time);
+  return std::chrono::seconds(time.tv_sec) + std::chrono::nanoseconds(time.tv_nsec);
+}
+
+/*** clock ***/
+
 /*** logger protocol ***/
 
+/**
+ * @brief Создаёт запись с копией сообщения
+ *
+ * Сообщение длиной не более inline_capacity хранится внутри записи,
+ * более длинное - в буфере из пула Memory::Buffer_pool
+ *
+ * @param msg Текст сообщения, длиннее max_length обрезается
+ * @param lvl Уровень логирования
+ * @param t Метка времени в наносекундах от начала эпохи Unix
+ */
+Logger_protocol::Protocol::Protocol(std::string_view msg, const Level lvl, Timestamp t)
+  : stamp(static_cast<int64_t>(t.count())),
+    length(static_cast<uint32_t>(std::min(msg.size(), max_length)) |
+      (static_cast<uint32_t>(lvl) << length_bits)) {
+  if (is_external()) {
+    auto buf = static_cast<char*>(Memory::Buffer_pool::instance().allocate(size()));
+    std::memcpy(buf, msg.data(), size());
+    std::memcpy(storage, &buf, sizeof(buf));
+  } else {
+    std::memcpy(storage, msg.data(), size());
+  }
+}
+
+/**
+ * @brief Перемещает запись, внешний буфер передаётся без копирования
+ */
+Logger_protocol::Protocol::Protocol(Protocol&& other) noexcept
+  : stamp(other.stamp), length(other.length) {
+  std::memcpy(storage, other.storage, sizeof(storage));
+  other.length = 0;
+}
+
+Logger_protocol::Protocol&
+Logger_protocol::Protocol::operator=(Protocol&& other) noexcept {
+  if (this != &other) {
+    release();
+    stamp = other.stamp;
+    length = other.length;
+    std::memcpy(storage, other.storage, sizeof(storage));
+    other.length = 0;
+  }
+  return *this;
+}
+
+/**
+ * @brief Создаёт независимую копию записи
+ * @return Protocol Копия с собственным буфером сообщения
+ */
+Logger_protocol::Protocol
+Logger_protocol::Protocol::clone() const {
+  return Protocol(get_message_view(), get_level(), get_timestamp());
+}
+
+/**
+ * @brief Возвращает указатель на текст сообщения
+ */
+const char* Logger_protocol::Protocol::data() const {
+  if (!is_external()) return storage;
+  const char* buf;
+  std::memcpy(&buf, storage, sizeof(buf));
+  return buf;
+}
+
+/**
+ * @brief Возвращает внешний буфер сообщения в пул
+ */
+void Logger_protocol::Protocol::release() {
+  if (is_external()) {
+    Memory::Buffer_pool::instance().deallocate(const_cast<char*>(data()), size());
+  }
+  length = 0;
+}
+
 /**
  * @brief Извлекает последнее число из строки и удаляет его
  * @brief разделяет последнее число и строку по пробелу
  *
  * @tparam T Тип числа для извлечения (int, long, double)
- * @param entry Строка, из которой извлекается число. После вызова число будет удалено из строки
+ * @param entry Представление строки, из которого извлекается число.
+ *              После вызова число будет отрезано от представления
  * @return optional<T> Извлечённое число, либо пустое значение, если число не найдено
  *
  * Алгоритм:
@@ -85,94 +344,226 @@ namespace Logger {
  */
 template<typename T>
 std::optional<T>
-Logger_protocol::extract_last_number(std::string& entry) {
+Logger_protocol::extract_last_number(std::string_view& entry) {
+  while (entry.size() && std::isspace(static_cast<unsigned char>(entry.back()))) {
+    entry.remove_suffix(1);
+  }
   if (!entry.size()) return {};
-  while (std::isspace(entry.back())) entry.pop_back();
   T value{};
   auto position = entry.rfind(' '); // разделяем строку по пробелу
-  if (position == std::string::npos) return {};
+  if (position == std::string_view::npos) return {};
   // извлекаем число
-  std::string_view string_value(entry.data() + position + 1);
-  auto cast_data = std::from_chars(string_value.data(), string_value.data() + string_value.size(), value);
+  auto cast_data = std::from_chars(entry.data() + position + 1, entry.data() + entry.size(), value);
   if (cast_data.ec != std::errc()) return {};
-  // вырезаем из строки найденную позцию
-  entry.erase(position);
+  // отрезаем найденную позицию
+  entry = entry.substr(0, position);
   return value;
 }
 
+/**
+ * @brief Извлекает последнее число из строки и удаляет его
+ *
+ * @tparam T Тип числа для извлечения (int, long, double)
+ * @param entry Строка, из которой извлекается число. После вызова число будет удалено из строки
+ * @return optional<T> Извлечённое число, либо пустое значение, если число не найдено
+ */
+template<typename T>
+std::optional<T>
+Logger_protocol::extract_last_number(std::string& entry) {
+  if (!entry.size()) return {};
+  std::string_view view(entry);
+  auto value = extract_last_number<T>(view);
+  entry.resize(view.size());
+  return value;
+}
+
+template std::optional<int> Logger_protocol::extract_last_number<int>(std::string&);
+template std::optional<long> Logger_protocol::extract_last_number<long>(std::string&);
+template std::optional<int> Logger_protocol::extract_last_number<int>(std::string_view&);
+template std::optional<long> Logger_protocol::extract_last_number<long>(std::string_view&);
+
+namespace {
+  constexpr long nanoseconds_per_second = 1000000000;
+  constexpr int fraction_digits = 9;
+
+  /// Делит метку на секунды и наносекунды в [0, 1e9)
+  std::pair<long, long> split_timestamp(Timestamp time) {
+    auto seconds = std::chrono::floor<std::chrono::seconds>(time);
+    return {static_cast<long>(seconds.count()), static_cast<long>((time - seconds).count())};
+  }
+
+  /// Дописывает дробную часть секунды: '.' и ровно 9 цифр
+  void append_fraction(std::string& out, long nanoseconds) {
+    char digits[fraction_digits];
+    for (int i = fraction_digits - 1; i >= 0; --i, nanoseconds /= 10) {
+      digits[i] = static_cast<char>('0' + nanoseconds % 10);
+    }
+    out.push_back('.');
+    out.append(digits, fraction_digits);
+  }
+
+  /**
+   * @brief Извлекает последнее поле "<секунды>[.<дробная часть>]" и удаляет его
+   *
+   * Дробная часть - от 1 до 9 цифр, прибавляется к секундам;
+   * отсутствует у записей прежней версии
+   */
+  std::optional<Timestamp> extract_last_timestamp(std::string_view& entry) {
+    while (entry.size() && std::isspace(static_cast<unsigned char>(entry.back()))) {
+      entry.remove_suffix(1);
+    }
+    auto position = entry.rfind(' ');
+    if (position == std::string_view::npos) return {};
+    auto field = entry.substr(position + 1);
+    long nanoseconds = 0;
+    if (auto dot = field.find('.'); dot != std::string_view::npos) {
+      auto fraction = field.substr(dot + 1);
+      if (fraction.empty() || fraction.size() > fraction_digits) return {};
+      for (std::size_t i = 0; i < fraction_digits; ++i) {
+        if (i >= fraction.size()) {
+          nanoseconds *= 10;
+          continue;
+        }
+        unsigned digit = static_cast<unsigned char>(fraction[i]) - '0';
+        if (digit > 9) return {};
+        nanoseconds = nanoseconds * 10 + digit;
+      }
+      field = field.substr(0, dot);
+    }
+    long seconds{};
+    auto end = field.data() + field.size();
+    auto result = std::from_chars(field.data(), end, seconds);
+    if (result.ec != std::errc() || result.ptr != end) return {};
+    entry = entry.substr(0, position);
+    return Clock::from_seconds(seconds) + Timestamp(nanoseconds);
+  }
+}
+
 /**
  * @brief Сериализует запись протокола в строку разделяя пробелами
  *
  * @param entry Объект Protocol, содержащий сообщение, уровень и время.
+ * @param[out] out Буфер, в конец которого дописывается строка формата
+ *                 "<сообщение> <уровень> <время>".
+ * @param nanoseconds Время в формате "<секунды>.<9 цифр>". Получатель прежней
+ *                    версии такую запись не разберёт, поэтому формат согласуется
+ *                    (Transport::Handshake), по умолчанию - только секунды
+ */
+void
+Logger_protocol::serialization_log(const Protocol& entry, std::string& out, bool nanoseconds) {
+  char number[24];
+  out.append(entry.get_message_view());
+  out.push_back(' ');
+  auto result = std::to_chars(number, number + sizeof(number), static_cast<int>(entry.get_level()));
+  out.append(number, result.ptr);
+  out.push_back(' ');
+  auto [seconds, fraction] = split_timestamp(entry.get_timestamp());
+  result = std::to_chars(number, number + sizeof(number), seconds);
+  out.append(number, result.ptr);
+  if (nanoseconds) append_fraction(out, fraction);
+}
+
+/**
+ * @brief Сериализует запись протокола в строку (совместимость со старым API)
+ *
+ * @param entry Объект Protocol, содержащий сообщение, уровень и время.
  * @return shared_ptr<string> Готовая строка формата "<сообщение> <уровень> <время>".
  */
 std::shared_ptr<std::string>
 Logger_protocol::serialization_log(const Protocol& entry) {
-  std::ostringstream os;
-  os << *entry.get_message() << " " <<
-  static_cast<int>(entry.get_level()) << " " <<
-  entry.get_time();
-  return std::make_shared<std::string>(std::move(os.str()));
+  auto out = std::make_shared<std::string>();
+  serialization_log(entry, *out);
+  return out;
 }
 
 /**
  * @brief Десериализует строку в объект Protocol
  *
- * @param entry shared_ptr<string> указатель на строку формата "<сообщение> <уровень> <время>"
+ * @param entry Строка формата "<сообщение> <уровень> <время>"
  * @return optional<Protocol> Объект протокола или пустое значение в случае ошибки
  *
  * Алгоритм:
- * - Извлекается время (long)
- * - Извлекается уровень (int)
+ * - Извлекается время: секунды и необязательная дробная часть через '.'
+ * - Извлекается уровень (int), допустимы только значения Level
  * - Остаток строки используется как сообщение
  */
 std::optional<Logger_protocol::Protocol>
-Logger_protocol::deserialization_log(std::shared_ptr<std::string> entry) {
-  auto time = extract_last_number<long>(*entry);
+Logger_protocol::deserialization_log(std::string_view entry) {
+  auto time = extract_last_timestamp(entry);
   if (!time) return {};
-  auto level = extract_last_number<int>(*entry);
-  if (!level) return {};
+  auto level = extract_last_number<int>(entry);
+  // уровень хранится в 2 битах Protocol: значение вне INFO..ERROR - ошибка формата
+  if (!level || *level < static_cast<int>(Level::INFO) || *level > static_cast<int>(Level::ERROR)) {
+    return {};
+  }
   return Protocol(
     entry,
     static_cast<Level>(level.value()),
-    static_cast<time_t>(time.value())
+    time.value()
   );
 }
 
+/**
+ * @brief Десериализует строку в объект Protocol (совместимость со старым API)
+ *
+ * @param entry shared_ptr<string> указатель на строку формата "<сообщение> <уровень> <время>"
+ * @return optional<Protocol> Объект протокола или пустое значение в случае ошибки
+ */
+std::optional<Logger_protocol::Protocol>
+Logger_protocol::deserialization_log(std::shared_ptr<std::string> entry) {
+  return deserialization_log(std::string_view(*entry));
+}
+
 /**
  * @brief Создаёт объект протокола из строки
  *
- * @param data Строка, содержащая сообщение и, возможно, уровень
+ * @param data Строка, содержащая сообщение и, возможно, уровень.
+ *             Используется как рабочий буфер: пробелы сжимаются на месте
  * @param default_level Уровень по умолчанию, если в строке нет уровня
- * @param time Временная метка записи
+ * @param time Временная метка записи в секундах
  * @return optional<Protocol> Готовый объект или пустое значение, если строка пустая
- *
- * @note Из строки извлекаются только не пробельные символы
  */
 std::optional<Logger_protocol::Protocol>
 Logger_protocol::Protocol::create_log_entry(std::string&& data, const Level default_level, time_t time) {
-  std::istringstream is(std::move(data));
-  std::string word;
-  auto message = std::make_shared<std::string>();
-  while (is >> word) {
-    message->append(word);
-    message->push_back(' ');
+  return create_log_entry(std::move(data), default_level, Clock::from_seconds(time));
+}
+
+/**
+ * @brief Создаёт объект протокола из строки
+ *
+ * @param data Строка, содержащая сообщение и, возможно, уровень.
+ *             Используется как рабочий буфер: пробелы сжимаются на месте
+ * @param default_level Уровень по умолчанию, если в строке нет уровня
+ * @param time Временная метка записи в наносекундах
+ * @return optional<Protocol> Готовый объект или пустое значение, если строка пустая
+ *
+ * @note Слова сообщения разделяются одним пробелом,
+ *       пробельные символы по краям отбрасываются
+ */
+std::optional<Logger_protocol::Protocol>
+Logger_protocol::Protocol::create_log_entry(std::string&& data, const Level default_level, Timestamp time) {
+  auto is_space = [](const char ch) {
+    return std::isspace(static_cast<unsigned char>(ch));
+  };
+  std::size_t size = 0; // длина сжатого сообщения
+  std::size_t last_word = 0; // начало последнего слова
+  for (std::size_t i = 0; i < data.size();) {
+    while (i < data.size() && is_space(data[i])) ++i;
+    if (i == data.size()) break;
+    if (size) data[size++] = ' ';
+    last_word = size;
+    while (i < data.size() && !is_space(data[i])) data[size++] = data[i++];
   }
   // пустая строка
-  if (!word.size()) {
+  if (!size) {
     return {};
   }
-  message->pop_back();
-  if (auto level = deserialization_level(word)) {
+  std::string_view message(data.data(), size);
+  if (auto level = deserialization_level(message.substr(last_word))) {
     // в строке находится уровень сообщения
-    message->erase(
-      std::find_if(message->rbegin() + word.size(), message->rend(),
-        [](const char ch) {
-          return !std::isspace(ch);
-        }).base(),
-      message->end());
+    message = message.substr(0, last_word ? last_word - 1 : 0);
     // пустая строка
-    if (!message->size()) {
+    if (!message.size()) {
       return {};
     }
     return Protocol(message, level.value(), time);
@@ -187,15 +578,23 @@ Logger_protocol::Protocol::create_log_entry(std::string&& data, const Level defa
  * @param log_entry Объект Protocol
  * @return std::ostream& Ссылка на поток
  *
- * Формат: "<сообщение> <уровень> <YYYY-MM-DD HH:MM:SS>"
+ * Формат: "<сообщение> <уровень> <YYYY-MM-DD HH:MM:SS>[.<9 цифр>]".
+ * Дробная часть секунды пишется, только если она ненулевая: записи
+ * с метками в секундах выглядят как в прежней версии
  */
 std::ostream&
 Logger_protocol::print_log_entry(std::ostream& os, const Protocol& log_entry) {
-  time_t time = log_entry.get_time();
+  auto [seconds, fraction] = split_timestamp(log_entry.get_timestamp());
+  time_t time = seconds;
   tm tm = *std::localtime(&time);
-  os << *log_entry.get_message() << " " <<
+  os << log_entry.get_message_view() << " " <<
   serialization_level(log_entry.get_level()).value() << " " <<
   std::put_time(&tm, "%F %T");
+  if (fraction) {
+    std::string digits;
+    append_fraction(digits, fraction);
+    os << digits;
+  }
   return os;
 }
 
@@ -207,15 +606,10 @@ Logger_protocol::print_log_entry(std::ostream& os, const Protocol& log_entry) {
  * @param level Строка ("INFO", "WARN", "ERROR")
  * @return std::optional<Level> Уровень или пустое значение, если строка некорректна
  */
-std::optional<Level> deserialization_level(const std::string& level) {
-  static const std::unordered_map<std::string, Level> mmap{
-    {"INFO", Level::INFO},
-    {"WARN", Level::WARN},
-    {"ERROR", Level::ERROR}
-  };
-  if (auto it = mmap.find(level); it != mmap.end()) {
-    return it->second;
-  }
+std::optional<Level> deserialization_level(std::string_view level) {
+  if (level == "INFO") return Level::INFO;
+  if (level == "WARN") return Level::WARN;
+  if (level == "ERROR") return Level::ERROR;
   return {};
 }
 
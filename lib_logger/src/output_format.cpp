@@ -0,0 +1,171 @@
+#include "include/logger.hpp"
+#include <climits>
+#include <ctime>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace Logger {
+  /*** Output formats ***/
+
+  namespace {
+    constexpr std::string_view level_names[] = {"INFO", "WARN", "ERROR"};
+    constexpr int fraction_digits = 9;
+
+    /// Символ экранируется в строке JSON и в значении logfmt в кавычках
+    bool needs_escape(unsigned char c) {
+      return c < 0x20 || c == '"' || c == '\\';
+    }
+
+    /// Значение logfmt с таким символом берётся в кавычки
+    bool needs_quotes(unsigned char c) {
+      return needs_escape(c) || c == ' ' || c == '=';
+    }
+
+    /**
+     * @brief Ищет первый символ, требующий экранирования (Quotes - или кавычек logfmt)
+     *
+     * На x86-64 блоки по 16 байт проверяются SSE2: сравнения с искомыми
+     * символами объединяются в маску, позиция - младший установленный бит
+     * @return Позиция символа или text.size(), если его нет
+     */
+    template<bool Quotes>
+    std::size_t find_special(std::string_view text, std::size_t position) {
+#if defined(__SSE2__)
+      const __m128i quote = _mm_set1_epi8('"'), backslash = _mm_set1_epi8('\\'),
+        control = _mm_set1_epi8(0x1F), space = _mm_set1_epi8(' '), equals = _mm_set1_epi8('=');
+      for (; position + 16 <= text.size(); position += 16) {
+        auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + position));
+        auto special = _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash));
+        // c <= 0x1F без знака: min(c, 0x1F) == c
+        special = _mm_or_si128(special, _mm_cmpeq_epi8(_mm_min_epu8(chunk, control), chunk));
+        if constexpr (Quotes) {
+          special = _mm_or_si128(special,
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, equals)));
+        }
+        if (int mask = _mm_movemask_epi8(special)) return position + __builtin_ctz(mask);
+      }
+#endif
+      for (; position < text.size(); ++position) {
+        auto c = static_cast<unsigned char>(text[position]);
+        if (Quotes ? needs_quotes(c) : needs_escape(c)) return position;
+      }
+      return text.size();
+    }
+
+    /// Дописывает текст с экранированием JSON (без кавычек вокруг)
+    void append_escaped(std::string& out, std::string_view text) {
+      static constexpr char hex[] = "0123456789abcdef";
+      std::size_t start = 0;
+      for (auto position = find_special<false>(text, 0); position < text.size();
+           position = find_special<false>(text, start)) {
+        out.append(text.data() + start, position - start);
+        auto c = static_cast<unsigned char>(text[position]);
+        switch (c) {
+          case '"': out.append("\\\""); break;
+          case '\\': out.append("\\\\"); break;
+          case '\n': out.append("\\n"); break;
+          case '\r': out.append("\\r"); break;
+          case '\t': out.append("\\t"); break;
+          default: {
+            const char escape[] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 15]};
+            out.append(escape, sizeof(escape));
+          }
+        }
+        start = position + 1;
+      }
+      out.append(text.data() + start, text.size() - start);
+    }
+
+    void append_fraction(std::string& out, long nanoseconds) {
+      char digits[fraction_digits];
+      for (int i = fraction_digits - 1; i >= 0; --i, nanoseconds /= 10) {
+        digits[i] = static_cast<char>('0' + nanoseconds % 10);
+      }
+      out.push_back('.');
+      out.append(digits, fraction_digits);
+    }
+  }
+
+  /**
+   * @brief Разбирает название формата вывода
+   * @param name "text", "json" или "logfmt"
+   * @return optional<Output_format> Формат или пустое значение, если название неизвестно
+   */
+  std::optional<Output_format> parse_output_format(std::string_view name) {
+    if (name == "text") return Output_format::TEXT;
+    if (name == "json") return Output_format::JSON;
+    if (name == "logfmt") return Output_format::LOGFMT;
+    return {};
+  }
+
+  Logger_protocol::Entry_formatter::Entry_formatter(Output_format output)
+    : output(output), cached_second(LONG_MIN) {}
+
+  /**
+   * @brief Дописывает строку записи в формате output
+   *
+   * TEXT совпадает с print_log_entry (местное время, дробная часть
+   * только при ненулевых наносекундах). JSON и logfmt пишут время
+   * в UTC по RFC 3339 с наносекундами - его разбирают сборщики логов
+   * @param[out] out Буфер, в конец которого дописывается строка
+   * @param entry Запись протокола
+   */
+  void Logger_protocol::Entry_formatter::format(std::string& out, const Protocol& entry) {
+    auto time = entry.get_timestamp();
+    auto seconds = std::chrono::floor<std::chrono::seconds>(time);
+    long fraction = static_cast<long>((time - seconds).count());
+    if (seconds.count() != cached_second) {
+      cached_second = static_cast<long>(seconds.count());
+      time_t moment = cached_second;
+      tm tm{};
+      if (output == Output_format::TEXT) {
+        ::localtime_r(&moment, &tm);
+        date_length = std::strftime(date, sizeof(date), "%F %T", &tm);
+      } else {
+        ::gmtime_r(&moment, &tm);
+        date_length = std::strftime(date, sizeof(date), "%FT%T", &tm);
+      }
+    }
+    auto message = entry.get_message_view();
+    auto level = level_names[static_cast<std::size_t>(entry.get_level()) % std::size(level_names)];
+    out.reserve(out.size() + message.size() + 80);
+    switch (output) {
+      case Output_format::TEXT:
+        out.append(message);
+        out.push_back(' ');
+        out.append(level);
+        out.push_back(' ');
+        out.append(date, date_length);
+        if (fraction) append_fraction(out, fraction);
+        break;
+      case Output_format::JSON:
+        out.append("{\"time\":\"");
+        out.append(date, date_length);
+        append_fraction(out, fraction);
+        out.append("Z\",\"level\":\"");
+        out.append(level);
+        out.append("\",\"msg\":\"");
+        append_escaped(out, message);
+        out.append("\"}");
+        break;
+      case Output_format::LOGFMT:
+        out.append("time=");
+        out.append(date, date_length);
+        append_fraction(out, fraction);
+        out.append("Z level=");
+        out.append(level);
+        out.append(" msg=");
+        if (!message.empty() && find_special<true>(message, 0) == message.size()) {
+          out.append(message);
+        } else {
+          out.push_back('"');
+          append_escaped(out, message);
+          out.push_back('"');
+        }
+        break;
+    }
+  }
+
+  /*** Output formats ***/
+}
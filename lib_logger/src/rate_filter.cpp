@@ -0,0 +1,67 @@
+#include "include/logger.hpp"
+#include <algorithm>
+
+namespace Logger {
+  /*** Sampling and rate limiting ***/
+
+  /**
+   * @brief Атомарно заменяет политику отбора
+   *
+   * Политика копируется и публикуется атомарной записью shared_ptr;
+   * log_write, выполняющийся одновременно, видит старую или новую политику целиком.
+   * Заменённая политика освобождается последним использующим её вызовом check
+   *
+   * @param value Новая политика
+   */
+  void Rate_filter::set_policy(const Rate_policy& value) {
+    auto next = std::make_shared<Rate_policy>(value);
+    for (auto& level : next->levels) {
+      if (!level.sample) level.sample = 1;
+      if (level.rate > 0) level.burst = std::max(level.burst, 1.0);
+    }
+    std::atomic_store(&policy, std::shared_ptr<const Rate_policy>(std::move(next)));
+    enabled.store(true, std::memory_order_release);
+  }
+
+  /**
+   * @brief Решает, оставить ли запись уровня
+   *
+   * Сначала выборка 1 из N, затем корзина токенов: токены пополняются
+   * со скоростью rate до ёмкости burst, запись расходует один токен.
+   * Может вызываться из нескольких потоков
+   *
+   * @param level Уровень записи
+   * @return Result KEEP, либо причина отбрасывания
+   */
+  Rate_filter::Result Rate_filter::check(Level level) {
+    if (!enabled.load(std::memory_order_acquire)) return Result::KEEP;
+    auto current = std::atomic_load(&policy);
+    auto index = static_cast<std::size_t>(level) % std::size(current->levels);
+    const auto& rule = current->levels[index];
+    if (rule.always_keep) return Result::KEEP;
+    if (rule.sample > 1 && counters[index].fetch_add(1, std::memory_order_relaxed) % rule.sample) {
+      return Result::SAMPLED;
+    }
+    if (rule.rate > 0) {
+      auto now = std::chrono::steady_clock::now();
+      auto& bucket = buckets[index];
+      while (bucket.locked.test_and_set(std::memory_order_acquire)) {}
+      if (!bucket.started) {
+        bucket.tokens = rule.burst;
+        bucket.started = true;
+      } else {
+        // другой поток мог обновить корзину более поздним временем
+        std::chrono::duration<double> elapsed = now - bucket.last;
+        bucket.tokens = std::min(rule.burst, bucket.tokens + std::max(elapsed.count(), 0.0) * rule.rate);
+      }
+      bucket.last = std::max(bucket.last, now);
+      bool limited = bucket.tokens < 1;
+      if (!limited) bucket.tokens -= 1;
+      bucket.locked.clear(std::memory_order_release);
+      if (limited) return Result::RATE_LIMITED;
+    }
+    return Result::KEEP;
+  }
+
+  /*** Sampling and rate limiting ***/
+}
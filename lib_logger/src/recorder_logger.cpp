@@ -0,0 +1,237 @@
+#include "include/logger.hpp"
+#include <algorithm>
+#include <csignal>
+
+namespace Logger {
+  namespace {
+    /// Заголовок записи в кольце самописца, за ним - текст; запись выровнена на 8 байт
+    struct Record_header {
+      uint32_t length; ///< Длина текста, wrap_marker - продолжение с начала кольца
+      uint32_t level;
+      int64_t time; ///< Наносекунды от начала эпохи Unix
+    };
+    constexpr uint32_t wrap_marker = UINT32_MAX;
+    constexpr std::size_t min_capacity = 64;
+    constexpr int signal_check_ms = 100; ///< Период проверки сигнала выгрузки
+
+    std::size_t record_size(std::size_t length) {
+      return (sizeof(Record_header) + length + 7) & ~std::size_t{7};
+    }
+
+    std::atomic<uint64_t> dump_signals{0}; ///< Принято сигналов выгрузки всеми самописцами
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "used in a signal handler");
+
+    void on_dump_signal(int) {
+      dump_signals.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  /*** Implementation flight recorder***/
+
+  /**
+   * @brief Выделяет кольцо, устанавливает обработчик сигнала и запускает поток выгрузки
+   *
+   * Страницы кольца заполняются сразу, чтобы запись не вызывала
+   * страничных прерываний. Обработчик сигнала остаётся установленным
+   * после закрытия сессии.
+   * @return optional<Error> Пустое значение в случае успеха,
+   *         либо объект Error с описанием ошибки
+   */
+  std::optional<Error>
+  Recorder_logging::open_session() {
+    std::lock_guard lock(mtx);
+    options.capacity &= ~std::size_t{7};
+    if (options.capacity < min_capacity) {
+      return Error(Error_code::OPEN_SESSION, "recorder capacity is too small");
+    }
+    if (options.dump_file.empty()) {
+      return Error(Error_code::OPEN_SESSION, "recorder dump file is not set");
+    }
+    if (!ring) {
+      ring.reset(new char[options.capacity]);
+      std::memset(ring.get(), 0, options.capacity);
+      head = tail = 0;
+    }
+    if (options.dump_signal) {
+      struct sigaction action{};
+      action.sa_handler = on_dump_signal;
+      action.sa_flags = SA_RESTART;
+      if (::sigaction(options.dump_signal, &action, nullptr)) {
+        return Error(Error_code::OPEN_SESSION, std::string("sigaction: ") + ::strerror(errno));
+      }
+    }
+    if (!dumper.joinable()) {
+      stopping = false;
+      // счётчик читается до запуска потока: сигнал сразу после открытия не теряется
+      dumper = std::thread(&Recorder_logging::run_dumper, this,
+        dump_signals.load(std::memory_order_relaxed));
+    }
+    return {};
+  }
+
+  /**
+   * @brief Останавливает поток выгрузки, невыгруженные записи отбрасываются
+   *
+   * Выгрузка, запрошенная до закрытия, выполняется
+   * @return optional<Error> Ошибка выгрузки потоком, если она была
+   */
+  std::optional<Error>
+  Recorder_logging::close_session() {
+    {
+      std::lock_guard lock(mtx);
+      stopping = true;
+    }
+    wake.notify_all();
+    if (dumper.joinable()) dumper.join();
+    std::lock_guard lock(mtx);
+    head = tail;
+    auto error = std::move(dump_error);
+    dump_error.reset();
+    return error;
+  }
+
+  /**
+   * @brief Копирует запись в кольцо
+   *
+   * Самые старые записи вытесняются. Запись, не помещающаяся до конца
+   * кольца, начинается с его начала, остаток отмечается переходом.
+   * Запись уровня не ниже trigger будит поток выгрузки.
+   * @param entry Объект Protocol, содержащий лог для записи
+   * @return optional<Error> Ошибка, если сессия не открыта или запись больше кольца
+   */
+  std::optional<Error>
+  Recorder_logging::write(const Logger_protocol::Protocol& entry) {
+    auto message = entry.get_message_view();
+    auto size = record_size(message.size());
+    bool triggered = options.trigger && entry.get_level() >= *options.trigger;
+    {
+      std::lock_guard lock(mtx);
+      if (!ring) return Error(Error_code::WRITE, "session is not open");
+      const auto capacity = options.capacity;
+      if (size > capacity) return Error(Error_code::WRITE, "record larger than recorder ring");
+      auto offset = tail % capacity;
+      if (offset + size > capacity) {
+        auto rest = capacity - offset;
+        while (tail + rest - head > capacity) drop_oldest();
+        std::memcpy(ring.get() + offset, &wrap_marker, sizeof(wrap_marker));
+        tail += rest;
+        offset = 0;
+      }
+      while (tail + size - head > capacity) drop_oldest();
+      Record_header header{static_cast<uint32_t>(message.size()),
+        static_cast<uint32_t>(entry.get_level()), entry.get_timestamp().count()};
+      std::memcpy(ring.get() + offset, &header, sizeof(header));
+      std::memcpy(ring.get() + offset + sizeof(header), message.data(), message.size());
+      tail += size;
+      if (triggered) dump_requested = true;
+    }
+    if (triggered) wake.notify_one();
+    return {};
+  }
+
+  /**
+   * @brief Вытесняет самую старую запись, вызывается под mtx при head < tail
+   */
+  void Recorder_logging::drop_oldest() {
+    auto offset = head % options.capacity;
+    uint32_t length;
+    std::memcpy(&length, ring.get() + offset, sizeof(length));
+    if (length == wrap_marker) {
+      head += options.capacity - offset;
+      return;
+    }
+    head += record_size(length);
+    overwritten.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Выгружает записи сразу, в вызывающем потоке
+   * @return optional<Error> Ошибка записи файла выгрузки
+   */
+  std::optional<Error>
+  Recorder_logging::flush() {
+    return dump();
+  }
+
+  /**
+   * @brief Выгружает записи кольца в dump_file
+   *
+   * Под блокировкой записи только копируются, кольцо освобождается;
+   * файл пишется без блокировки, запись в кольцо не ждёт диска
+   * @return optional<Error> Ошибка записи файла выгрузки
+   */
+  std::optional<Error>
+  Recorder_logging::dump() {
+    std::lock_guard dump_lock(dump_mtx);
+    std::string snapshot;
+    uint64_t start;
+    {
+      std::lock_guard lock(mtx);
+      if (!ring || head == tail) return {};
+      start = head;
+      auto size = static_cast<std::size_t>(tail - head);
+      auto offset = head % options.capacity;
+      auto first = std::min(size, options.capacity - offset);
+      snapshot.reserve(size);
+      snapshot.assign(ring.get() + offset, first);
+      snapshot.append(ring.get(), size - first);
+      head = tail;
+    }
+    std::ofstream out(options.dump_file, std::ios::app);
+    if (!out.is_open()) {
+      return Error(Error_code::WRITE, options.dump_file + ": " + ::strerror(errno));
+    }
+    for (std::size_t position = 0; position < snapshot.size();) {
+      Record_header header;
+      std::memcpy(&header.length, snapshot.data() + position, sizeof(header.length));
+      if (header.length == wrap_marker) {
+        position += options.capacity - (start + position) % options.capacity;
+        continue;
+      }
+      std::memcpy(&header, snapshot.data() + position, sizeof(header));
+      std::string_view message(snapshot.data() + position + sizeof(header), header.length);
+      Logger_protocol::print_log_entry(out, Logger_protocol::Protocol(message,
+        static_cast<Level>(header.level), Timestamp(header.time))) << '\n';
+      position += record_size(header.length);
+    }
+    out.flush();
+    if (out.fail()) {
+      return Error(Error_code::WRITE, options.dump_file + ": " + ::strerror(errno));
+    }
+    dumps.fetch_add(1, std::memory_order_relaxed);
+    return {};
+  }
+
+  /**
+   * @brief Поток выгрузки: по записи уровня trigger и по сигналу dump_signal
+   *
+   * Сигнал проверяется не реже signal_check_ms: обработчик сигнала только
+   * увеличивает счётчик. Ошибка выгрузки возвращается close_session
+   * @param seen Значение счётчика сигналов при открытии сессии
+   */
+  void Recorder_logging::run_dumper(uint64_t seen) {
+    std::unique_lock lock(mtx);
+    for (;;) {
+      wake.wait_for(lock, std::chrono::milliseconds(signal_check_ms),
+        [this] { return dump_requested || stopping; });
+      auto signals = dump_signals.load(std::memory_order_relaxed);
+      bool requested = dump_requested || (options.dump_signal && signals != seen);
+      seen = signals;
+      if (requested) {
+        dump_requested = false;
+        lock.unlock();
+        auto error = dump();
+        lock.lock();
+        if (error && !dump_error) dump_error = std::move(error);
+      }
+      if (stopping) return;
+    }
+  }
+
+  void Recorder_logging::add_statistics(Logging_statistics& statistics) const {
+    statistics.dumps = dumps.load(std::memory_order_relaxed);
+    statistics.overwritten = overwritten.load(std::memory_order_relaxed);
+  }
+
+  /*** Implementation flight recorder***/
+}
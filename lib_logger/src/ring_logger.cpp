@@ -0,0 +1,49 @@
+#include "include/shared_ring.hpp"
+
+namespace Logger {
+  /*** Implementation write shared ring***/
+
+  Ring_logging::Ring_logging(const Ring_options& options) : options(options) {}
+
+  Ring_logging::~Ring_logging() = default;
+
+  /**
+   * @brief Открывает кольцо в разделяемой памяти, создавая его при отсутствии
+   * @return optional<Error> Пустое значение в случае успеха,
+   *         либо объект Error с описанием ошибки
+   */
+  std::optional<Error>
+  Ring_logging::open_session() {
+    if (ring) return {};
+    auto opened = Shared_ring::open(options);
+    if (auto error = std::get_if<Error>(&opened)) {
+      return *error;
+    }
+    ring = std::move(std::get<std::unique_ptr<Shared_ring>>(opened));
+    return {};
+  }
+
+  /**
+   * @brief Отключается от кольца, кольцо остаётся для потребителя
+   * @return optional<Error> Всегда пустое значение
+   */
+  std::optional<Error>
+  Ring_logging::close_session() {
+    ring.reset();
+    return {};
+  }
+
+  /**
+   * @brief Записывает запись в кольцо
+   * @param entry Объект Protocol, содержащий лог для записи
+   * @return optional<Error> Пустое значение в случае успеха,
+   *         либо объект Error с описанием ошибки
+   */
+  std::optional<Error>
+  Ring_logging::write(const Logger_protocol::Protocol& entry) {
+    if (!ring) return Error(Error_code::WRITE, "session is not open");
+    return ring->push(entry);
+  }
+
+  /*** Implementation write shared ring***/
+}
@@ -0,0 +1,294 @@
+#include "include/shared_ring.hpp"
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <thread>
+
+namespace Logger {
+  namespace {
+    constexpr int open_timeout_ms = 1000; ///< Ожидание инициализации кольца создателем
+
+    /// Имя объекта shm_open должно начинаться с '/'
+    std::string shm_name(const std::string& name) {
+      return !name.empty() && name[0] == '/' ? name : '/' + name;
+    }
+
+    /// Контрольная сумма записи слота (FNV-1a), включает позицию записи
+    uint32_t slot_checksum(uint64_t position, uint32_t length, int64_t time, uint32_t level,
+        const char* message) {
+      uint32_t hash = 2166136261u;
+      auto mix = [&hash](const void* data, std::size_t size) {
+        auto bytes = static_cast<const unsigned char*>(data);
+        for (std::size_t i = 0; i < size; ++i) {
+          hash = (hash ^ bytes[i]) * 16777619u;
+        }
+      };
+      mix(&position, sizeof(position));
+      mix(&length, sizeof(length));
+      mix(&time, sizeof(time));
+      mix(&level, sizeof(level));
+      mix(message, length);
+      return hash;
+    }
+
+    char* slot_message(Shared_ring::Slot& slot) {
+      return reinterpret_cast<char*>(&slot) + sizeof(Shared_ring::Slot);
+    }
+
+    std::size_t ring_size(uint32_t slot_count, uint32_t slot_size) {
+      return sizeof(Shared_ring::Header) + static_cast<std::size_t>(slot_count) * slot_size;
+    }
+
+    Error system_error(const char* what) {
+      return Error(Error_code::OPEN_SESSION, std::string(what) + ": " + ::strerror(errno));
+    }
+  }
+
+  /**
+   * @brief Открывает кольцо, создавая его при отсутствии
+   *
+   * Создатель заполняет заголовок и номера слотов, затем публикует magic.
+   * Остальные участники ждут публикации не дольше секунды и используют
+   * размеры из заголовка.
+   *
+   * @param options Имя и размеры кольца
+   * @param consumer Открыть как потребитель (эксклюзивная блокировка)
+   * @return variant<unique_ptr<Shared_ring>, Error> Кольцо или ошибка открытия
+   */
+  std::variant<std::unique_ptr<Shared_ring>, Error>
+  Shared_ring::open(const Ring_options& options, bool consumer) {
+    auto name = shm_name(options.name);
+    if (!options.slot_count || (options.slot_count & (options.slot_count - 1)) ||
+        options.slot_size <= sizeof(Slot) || options.slot_size % alignof(Slot)) {
+      return Error(Error_code::OPEN_SESSION, "invalid ring geometry");
+    }
+    bool created = true;
+    int fd = ::shm_open(name.data(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd == -1 && errno == EEXIST) {
+      created = false;
+      fd = ::shm_open(name.data(), O_RDWR, 0600);
+    }
+    if (fd == -1) return system_error("shm_open");
+    auto fail = [fd](Error error) {
+      ::close(fd);
+      return error;
+    };
+    if (consumer && ::flock(fd, LOCK_EX | LOCK_NB)) {
+      return fail(Error(Error_code::OPEN_SESSION, "ring already has a consumer"));
+    }
+
+    uint32_t slot_count = options.slot_count, slot_size = options.slot_size;
+    if (created) {
+      if (::ftruncate(fd, static_cast<off_t>(ring_size(slot_count, slot_size)))) {
+        auto error = system_error("ftruncate");
+        ::shm_unlink(name.data());
+        return fail(error);
+      }
+    } else {
+      // ждём, пока создатель задаст размер и опубликует заголовок
+      auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(open_timeout_ms);
+      for (;;) {
+        struct stat info{};
+        if (::fstat(fd, &info)) return fail(system_error("fstat"));
+        if (static_cast<std::size_t>(info.st_size) >= sizeof(Header)) {
+          void* view = ::mmap(nullptr, sizeof(Header), PROT_READ, MAP_SHARED, fd, 0);
+          if (view == MAP_FAILED) return fail(system_error("mmap"));
+          auto header = static_cast<Header*>(view);
+          bool ready = header->magic.load(std::memory_order_acquire) == magic_value;
+          slot_count = header->slot_count;
+          slot_size = header->slot_size;
+          ::munmap(view, sizeof(Header));
+          if (ready) break;
+        }
+        if (std::chrono::steady_clock::now() >= deadline) {
+          return fail(Error(Error_code::OPEN_SESSION, "ring is not initialized"));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    }
+
+    auto size = ring_size(slot_count, slot_size);
+    void* memory = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (memory == MAP_FAILED) return fail(system_error("mmap"));
+    std::unique_ptr<Shared_ring> ring(new Shared_ring(fd, memory, size));
+    if (created) {
+      auto header = new (memory) Header{};
+      header->slot_count = slot_count;
+      header->slot_size = slot_size;
+      header->abandon_timeout_ms = options.abandon_timeout_ms;
+      for (uint64_t position = 0; position < slot_count; ++position) {
+        new (&ring->slot(position)) Slot{};
+        ring->slot(position).sequence.store(position, std::memory_order_relaxed);
+      }
+      header->magic.store(magic_value, std::memory_order_release);
+    }
+    return ring;
+  }
+
+  /**
+   * @brief Удаляет имя кольца, память освобождается после закрытия всеми участниками
+   * @param name Имя кольца
+   */
+  void Shared_ring::remove(const std::string& name) {
+    ::shm_unlink(shm_name(name).data());
+  }
+
+  Shared_ring::~Shared_ring() {
+    ::munmap(memory, size);
+    ::close(fd);
+  }
+
+  /**
+   * @brief Записывает запись в кольцо (производитель)
+   *
+   * Не блокируется и не выполняет системных вызовов, кроме пробуждения
+   * спящего потребителя
+   * @param entry Запись протокола
+   * @return optional<Error> Пустое значение при успехе, либо ошибка:
+   *         кольцо заполнено, сообщение длиннее слота или слот пропущен потребителем
+   */
+  std::optional<Error> Shared_ring::push(const Logger_protocol::Protocol& entry) {
+    auto message = entry.get_message_view();
+    if (message.size() > max_message()) {
+      return Error(Error_code::WRITE, "message too long for ring slot");
+    }
+    auto position = header->head.load(std::memory_order_relaxed);
+    Slot* target;
+    for (;;) {
+      target = &slot(position);
+      auto sequence = target->sequence.load(std::memory_order_acquire);
+      auto difference = static_cast<int64_t>(sequence - position);
+      if (!difference) {
+        if (header->head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (difference < 0) {
+        header->dropped.fetch_add(1, std::memory_order_relaxed);
+        return Error(Error_code::WRITE, "ring is full");
+      } else {
+        position = header->head.load(std::memory_order_relaxed);
+      }
+    }
+    target->length = static_cast<uint32_t>(message.size());
+    target->time = entry.get_timestamp().count();
+    target->level = static_cast<uint32_t>(entry.get_level());
+    std::memcpy(slot_message(*target), message.data(), message.size());
+    target->checksum = slot_checksum(position, target->length, target->time, target->level,
+      slot_message(*target));
+    auto expected = position;
+    if (!target->sequence.compare_exchange_strong(expected, position + 1,
+        std::memory_order_release, std::memory_order_relaxed)) {
+      return Error(Error_code::WRITE, "ring slot was abandoned");
+    }
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (header->consumer_waiting.load(std::memory_order_relaxed)) {
+      header->signal.fetch_add(1, std::memory_order_release);
+      ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&header->signal), FUTEX_WAKE, 1,
+        nullptr, nullptr, 0);
+    }
+    return {};
+  }
+
+  /**
+   * @brief Читает зафиксированные записи (потребитель)
+   *
+   * Поля и сообщение слота копируются в запись протокола (сообщение до
+   * Protocol::inline_capacity - внутри записи, длиннее - в буфер пула),
+   * контрольная сумма проверяется по копии: опоздавший производитель,
+   * дописывающий слот после проверки, не может подменить байты переданной
+   * записи. После обработки записи слот освобождается. Повреждённые записи и слоты
+   * аварийно завершившихся производителей пропускаются и учитываются в get_abandoned()
+   *
+   * @param on_entry Обработчик записи
+   * @param max_count Наибольшее количество записей за вызов
+   * @return size_t Количество прочитанных слотов
+   */
+  std::size_t Shared_ring::consume(const std::function<void(Logger_protocol::Protocol&&)>& on_entry,
+      std::size_t max_count) {
+    std::size_t count = 0;
+    auto position = header->tail.load(std::memory_order_relaxed);
+    while (count < max_count) {
+      auto& current = slot(position);
+      auto sequence = current.sequence.load(std::memory_order_acquire);
+      if (sequence != position + 1) {
+        if (sequence == position && skip_abandoned(position)) {
+          ++position;
+          ++count;
+          continue;
+        }
+        break;
+      }
+      stuck_position = UINT64_MAX;
+      // поля читаются один раз: проверяется и передаётся одно и то же значение
+      auto length = current.length;
+      auto time = current.time;
+      auto level = current.level;
+      auto checksum = current.checksum;
+      std::optional<Logger_protocol::Protocol> entry;
+      if (length <= max_message() && level <= static_cast<uint32_t>(Level::ERROR)) {
+        entry.emplace(std::string_view(slot_message(current), length), static_cast<Level>(level),
+          Timestamp(time));
+        if (checksum != slot_checksum(position, length, time, level, entry->get_message_view().data())) {
+          entry.reset();
+        }
+      }
+      if (entry) {
+        on_entry(std::move(entry.value()));
+      } else {
+        header->abandoned.fetch_add(1, std::memory_order_relaxed);
+      }
+      current.sequence.store(position + header->slot_count, std::memory_order_release);
+      header->tail.store(++position, std::memory_order_release);
+      ++count;
+    }
+    return count;
+  }
+
+  /**
+   * @brief Пропускает слот, зарезервированный и не зафиксированный дольше abandon_timeout_ms
+   * @param position Позиция потребителя
+   * @return true если слот пропущен
+   */
+  bool Shared_ring::skip_abandoned(uint64_t position) {
+    if (header->head.load(std::memory_order_acquire) <= position) return false; // кольцо пусто
+    auto now = std::chrono::steady_clock::now();
+    if (stuck_position != position) {
+      stuck_position = position;
+      stuck_since = now;
+      return false;
+    }
+    if (now - stuck_since < std::chrono::milliseconds(header->abandon_timeout_ms)) return false;
+    auto expected = position;
+    if (!slot(position).sequence.compare_exchange_strong(expected, position + header->slot_count,
+        std::memory_order_acq_rel)) {
+      return false; // производитель успел зафиксировать
+    }
+    header->abandoned.fetch_add(1, std::memory_order_relaxed);
+    header->tail.store(position + 1, std::memory_order_release);
+    stuck_position = UINT64_MAX;
+    return true;
+  }
+
+  /**
+   * @brief Ожидает новую запись (потребитель)
+   *
+   * Засыпает на futex, только если следующий слот не зафиксирован;
+   * производитель будит потребителя, увидев флаг ожидания
+   * @param timeout_ms Наибольшее время ожидания
+   */
+  void Shared_ring::wait(int timeout_ms) {
+    auto signal = header->signal.load(std::memory_order_acquire);
+    header->consumer_waiting.store(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto position = header->tail.load(std::memory_order_relaxed);
+    if (slot(position).sequence.load(std::memory_order_acquire) != position + 1) {
+      timespec timeout{timeout_ms / 1000, (timeout_ms % 1000) * 1000000L};
+      ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&header->signal), FUTEX_WAIT, signal,
+        &timeout, nullptr, 0);
+    }
+    header->consumer_waiting.store(0, std::memory_order_relaxed);
+  }
+}
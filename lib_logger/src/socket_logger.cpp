@@ -1,22 +1,139 @@
 #include "include/logger.hpp"
-#include <iostream>
+#include <algorithm>
 #include <memory>
 #include <string>
+#include <fcntl.h>
 #include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
 #include <variant>
 
 namespace Logger {
   /*** Implementation write socket***/
+  namespace {
+    /**
+     * @brief Подключает сокет, ожидая не дольше timeout_ms
+     *
+     * Подключение выполняется в неблокирующем режиме, готовность ждёт poll,
+     * результат - SO_ERROR; затем прежний режим дескриптора восстанавливается
+     * @return true при успехе, иначе errno - причина (ETIMEDOUT по истечении срока)
+     */
+    bool connect_within(int fd, const sockaddr* address, socklen_t size, int timeout_ms) {
+      if (timeout_ms <= 0) return !::connect(fd, address, size);
+      int flags = ::fcntl(fd, F_GETFL);
+      ::fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+      bool connected = !::connect(fd, address, size);
+      if (!connected && errno == EINPROGRESS) {
+        pollfd pfd{fd, POLLOUT, 0};
+        int ready = ::poll(&pfd, 1, timeout_ms);
+        if (!ready) errno = ETIMEDOUT;
+        if (ready > 0) {
+          int error = 0;
+          socklen_t length = sizeof(error);
+          ::getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length);
+          connected = !error;
+          errno = error;
+        }
+      }
+      int saved = errno;
+      ::fcntl(fd, F_SETFL, flags);
+      errno = saved;
+      return connected;
+    }
+  }
+
   /**
    * @brief Открывает сокет-сессию, устанавливая соединение с удалённым хостом
    *
-   * Ищет сетевые адреса по протоколу IPv4 по заданным параметрам и в случае успеха
-   * подключается по протоколу TCP
+   * Если хост - путь (содержит '/'), подключается к сокету домена UNIX,
+   * иначе по протоколу TCP/IPv4. Затем при необходимости согласует пачки, сжатие,
+   * время в наносекундах и подтверждения. В надёжном режиме сервер обязан
+   * подтвердить подтверждения, а неподтверждённые записи окна отправляются повторно
    * @return optional<Error> Возвращает пустой optional при успехе,
    * или объект Error при ошибке открытия сессии
    */
   std::optional<Error>
   Socket_logging::open_session() {
+    if (!options.source.empty() && !Transport::valid_source(options.source)) {
+      return Error(Error_code::OPEN_SESSION, "invalid source id");
+    }
+    auto connected = Socket::socket_connect(host, port, options.seqpacket, options.connect_timeout_ms);
+    if (auto error = std::get_if<Error>(&connected)) {
+      return *error;
+    }
+    fd = std::get<int>(connected);
+    if (auto error = Socket::set_send_timeout(fd, options.send_timeout_ms)) {
+      disconnect();
+      return error;
+    }
+    packet = options.seqpacket && host.find('/') != std::string::npos;
+    if (!options.batch_bytes && !options.compress && !options.nanoseconds && !options.reliable &&
+        options.source.empty() && !options.chunk_bytes) {
+      return {};
+    }
+    auto error = negotiate();
+    if (!error && options.reliable && !acknowledged) {
+      error = Error(Error_code::OPEN_SESSION, "server does not acknowledge records");
+    }
+    if (error) {
+      disconnect();
+      return error;
+    }
+    if (!options.reliable) return {};
+    // новое соединение считает записи с начала окна
+    connection_base = window_base;
+    batch.clear();
+    for (const auto& record : window) {
+      if (chunked && record.size() > options.chunk_bytes) {
+        if ((error = send_chunks(record))) break;
+        continue;
+      }
+      Transport::append_record(batch, record);
+      if (batch.size() >= options.batch_bytes && (error = send_batch())) break;
+    }
+    if (!error && !batch.empty()) error = send_batch();
+    if (error) {
+      disconnect();
+      return error;
+    }
+    retransmitted.fetch_add(window.size(), std::memory_order_relaxed);
+    return {};
+  }
+
+  /**
+   * @brief Подключается к серверу
+   *
+   * Если хост - путь (содержит '/'), подключается к сокету домена UNIX:
+   * тип SOCK_STREAM использует тот же префикс длины, что и TCP, при seqpacket
+   * каждый кадр - отдельный пакет без префикса. Иначе ищет адреса IPv4
+   * по заданным параметрам и подключается по протоколу TCP
+   * @param host IP-адрес, либо путь к сокету UNIX
+   * @param port Порт (для сокета UNIX не используется)
+   * @param seqpacket Тип SOCK_SEQPACKET для сокета UNIX
+   * @param timeout_ms Ожидание подключения к каждому адресу, 0 - без ограничения
+   * @return variant<int, Error> Дескриптор подключённого сокета или объект ошибки
+   */
+  std::variant<int, Error>
+  Socket::socket_connect(const std::string& host, const std::string& port, bool seqpacket,
+      int timeout_ms) {
+    if (host.find('/') != std::string::npos) {
+      sockaddr_un address{};
+      if (host.size() >= sizeof(address.sun_path)) {
+        return Error(Error_code::OPEN_SESSION, "socket path too long");
+      }
+      address.sun_family = AF_UNIX;
+      std::memcpy(address.sun_path, host.data(), host.size());
+      int fd = ::socket(AF_UNIX, seqpacket ? SOCK_SEQPACKET : SOCK_STREAM, 0);
+      if (fd == -1) {
+        return Error(Error_code::OPEN_SESSION, ::strerror(errno));
+      }
+      if (!connect_within(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address), timeout_ms)) {
+        Error error(Error_code::OPEN_SESSION, ::strerror(errno));
+        ::close(fd);
+        return error;
+      }
+      return fd;
+    }
     addrinfo  hints{};
     addrinfo  *result, *rp;
     hints.ai_family = AF_INET; ///< IPv4
@@ -25,29 +142,75 @@ namespace Logger {
     if (int res = ::getaddrinfo(host.data(), port.data(), &hints, &result) != 0) {
       return Error(Error_code::OPEN_SESSION, ::gai_strerror(res));
     }
+    int fd = -1;
     for (rp = result; rp != nullptr; rp = rp->ai_next) {
       fd = ::socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
       if (fd != -1) {
-        if (!::connect(fd,rp->ai_addr,rp->ai_addrlen)) {
+        if (connect_within(fd, rp->ai_addr, rp->ai_addrlen, timeout_ms)) {
           break;
         }
+        ::close(fd);
+        fd = -1;
       }
     }
     freeaddrinfo(result);
     if (rp == nullptr)
       return Error(Error_code::OPEN_SESSION, ::strerror(errno));
+    return fd;
+  }
+
+  /**
+   * @brief Согласует с сервером кадры с типом, сжатие и формат времени
+   *
+   * Отправляет кадр "hello" и ждёт "welcome" не дольше handshake_timeout_ms.
+   * Сервер прежней версии не отвечает - тогда сессия остаётся в прежнем формате
+   * (запрос согласования он отбросит как некорректную запись)
+   * @return optional<Error> Пустой optional при успехе или откате, объект Error при ошибке сокета
+   */
+  std::optional<Error>
+  Socket_logging::negotiate() {
+    framed = compress = nanoseconds = acknowledged = chunked = false;
+    auto sent = send_frame(Transport::make_handshake("hello", Transport::Handshake{options.compress,
+      options.nanoseconds, options.reliable, options.source, options.chunk_bytes > 0}));
+    if (auto error = std::get_if<Error>(&sent)) {
+      return Error(Error_code::OPEN_SESSION, error->get_err_message());
+    }
+    pollfd pfd{fd, POLLIN, 0};
+    if (::poll(&pfd, 1, options.handshake_timeout_ms) <= 0 || !(pfd.revents & POLLIN)) {
+      return {};
+    }
+    if (auto error = receive_frame(buffer)) {
+      return Error(Error_code::OPEN_SESSION, error->get_err_message());
+    }
+    if (auto reply = Transport::parse_handshake(buffer, "welcome")) {
+      framed = true;
+      compress = options.compress && reply->compress;
+      nanoseconds = options.nanoseconds && reply->nanoseconds;
+      acknowledged = options.reliable && reply->acknowledge;
+      chunked = options.chunk_bytes && reply->chunks;
+    }
     return {};
   }
 
   /**
    * @brief Закрывает сокет-сессию, закрывая соединение и дескриптор
    *
-   * Выполняет shutdown и close для сокета
+   * Выполняет shutdown и close для сокета. В надёжном режиме сначала ждёт
+   * подтверждения всех записей; неподтверждённые остаются в окне
+   * и будут отправлены повторно при следующем открытии сессии
    * @return optional<Error> Возвращает пустой optional при успехе, или объект Error при ошибке
   */
   std::optional<Error>
   Socket_logging::close_session() {
-    if (::shutdown(fd, SHUT_RDWR) || ::close(fd)) {
+    if (fd == -1 && window.empty()) return {};
+    auto flushed = flush();
+    if (!flushed && options.reliable) flushed = wait_acknowledged(0);
+    int result = fd == -1 ? 0 : ::shutdown(fd, SHUT_RDWR) | ::close(fd);
+    fd = -1;
+    acks.clear();
+    framed = compress = nanoseconds = acknowledged = chunked = packet = false;
+    if (flushed) return flushed;
+    if (result) {
       return Error(Error_code::CLOSE_SESSION, strerror(errno));
     }
     return {};
@@ -56,54 +219,326 @@ namespace Logger {
   /**
    * @brief Отправляет протокол лога в сокет
    *
-   * Сериализует объект Protocol в строку и отправляет через сокет
+   * Сериализует объект Protocol в строку и отправляет через сокет.
+   * После согласования запись добавляется в пачку, пачка отправляется
+   * при достижении batch_bytes или если она начата batch_delay_ms назад, запись длиннее chunk_bytes при согласованных
+   * частях отправляется частями. В надёжном режиме запись сохраняется в окне,
+   * ошибка соединения не возвращается, пока запись помещается в окно;
+   * при заполненном окне запись ждёт подтверждений
    * @param entry Объект Protocol лог-запись для отправки
    * @return optional<Error> Возвращает пустой optional при успехе, или объект Error при ошибке записи
    */
   std::optional<Error>
   Socket_logging::write(const Logger_protocol::Protocol& entry) {
-    auto entry_log_string = serialization_log(entry);
-    auto sent_data = Socket::socket_write(fd,entry_log_string);
+    buffer.clear();
+    serialization_log(entry, buffer, nanoseconds);
+    if (options.reliable) {
+      auto capacity = std::max<std::size_t>(options.window_records, 1);
+      if (window.size() >= capacity) {
+        if (auto error = flush()) return error;
+        if (auto error = wait_acknowledged(capacity - 1)) return error;
+      }
+      window.push_back(buffer);
+      unacknowledged.store(window.size(), std::memory_order_relaxed);
+    }
+    if (chunked && buffer.size() > options.chunk_bytes) {
+      auto error = send_chunks(buffer);
+      // в надёжном режиме запись уже в окне и будет отправлена после переподключения
+      if (options.reliable) {
+        if (error) reconnect();
+        return {};
+      }
+      return error;
+    }
+    if (framed || options.reliable) {
+      auto now = std::chrono::steady_clock::now();
+      if (batch.empty()) batch_started = now;
+      Transport::append_record(batch, buffer);
+      auto delay = std::chrono::milliseconds(options.batch_delay_ms);
+      if (batch.size() < options.batch_bytes && (delay.count() <= 0 || now - batch_started < delay)) {
+        return {};
+      }
+      auto error = flush();
+      // в надёжном режиме запись уже в окне и будет отправлена после переподключения
+      if (options.reliable) return {};
+      return error;
+    }
+    bytes_raw.fetch_add(buffer.size(), std::memory_order_relaxed);
+    bytes_sent.fetch_add(buffer.size(), std::memory_order_relaxed);
+    auto sent_data = send_frame(buffer);
     if (auto error = std::get_if<Error>(&sent_data)) {
       return Error(Error_code::WRITE, error->get_err_message());
     }
-    std::cout << std::get<int>(sent_data) << '\n';
     return {};
   }
 
+  /**
+   * @brief Отправляет накопленную пачку
+   *
+   * В надёжном режиме также принимает пришедшие подтверждения без ожидания;
+   * при ошибке сокета переподключается и отправляет окно повторно
+   * @return optional<Error> Пустой optional при успехе, или объект Error при ошибке записи
+   */
+  std::optional<Error>
+  Socket_logging::flush() {
+    if (!options.reliable) {
+      if (!framed || batch.empty()) return {};
+      return send_batch();
+    }
+    if (fd == -1 && window.empty()) return {};
+    if (fd != -1 && (batch.empty() || !send_batch()) && !receive_acks(0)) return {};
+    return reconnect();
+  }
+
+  /**
+   * @brief Отправляет пачку одним кадром
+   *
+   * Пачка не меньше compress_threshold сжимается, если сжатие согласовано
+   * и действительно уменьшает размер
+   * @return optional<Error> Пустой optional при успехе, или объект Error при ошибке записи
+   */
+  std::optional<Error>
+  Socket_logging::send_batch() {
+    frame.clear();
+    if (compress && batch.size() >= options.compress_threshold) {
+      frame.push_back(static_cast<char>(Transport::Frame_type::COMPRESSED));
+      uint32_t raw_size = ::htonl(static_cast<uint32_t>(batch.size()));
+      frame.append(reinterpret_cast<const char*>(&raw_size), sizeof(raw_size));
+      Compression::compress(batch, frame);
+      if (frame.size() >= batch.size() + 1) frame.clear();
+    }
+    if (frame.empty()) {
+      frame.push_back(static_cast<char>(Transport::Frame_type::BATCH));
+      frame.append(batch);
+    }
+    bytes_raw.fetch_add(batch.size(), std::memory_order_relaxed);
+    bytes_sent.fetch_add(frame.size(), std::memory_order_relaxed);
+    batch.clear();
+    auto sent_data = send_frame(frame);
+    if (auto error = std::get_if<Error>(&sent_data)) {
+      return Error(Error_code::WRITE, error->get_err_message());
+    }
+    return {};
+  }
+
+  /**
+   * @brief Отправляет запись частями по chunk_bytes
+   *
+   * Накопленная пачка отправляется раньше, чтобы сохранить порядок записей.
+   * Части не сжимаются; сервер учитывает запись по последней части
+   * @param record Сериализованная запись
+   * @return optional<Error> Пустой optional при успехе, или объект Error при ошибке записи
+   */
+  std::optional<Error>
+  Socket_logging::send_chunks(std::string_view record) {
+    if (!batch.empty()) {
+      if (auto error = send_batch()) return error;
+    }
+    bytes_raw.fetch_add(record.size(), std::memory_order_relaxed);
+    while (!record.empty()) {
+      auto part = record.substr(0, options.chunk_bytes);
+      record.remove_prefix(part.size());
+      Transport::append_chunk(frame, part, !record.empty());
+      bytes_sent.fetch_add(frame.size(), std::memory_order_relaxed);
+      auto sent_data = send_frame(frame);
+      if (auto error = std::get_if<Error>(&sent_data)) {
+        return Error(Error_code::WRITE, error->get_err_message());
+      }
+    }
+    return {};
+  }
+
+  /**
+   * @brief Переподключается и отправляет окно повторно (надёжный режим)
+   * @return optional<Error> Пустой optional при успехе, или объект Error, если сервер недоступен
+   */
+  std::optional<Error>
+  Socket_logging::reconnect() {
+    disconnect();
+    if (auto error = open_session()) {
+      disconnect();
+      return Error(Error_code::WRITE, error->get_err_message());
+    }
+    return {};
+  }
+
+  /**
+   * @brief Закрывает соединение, сохраняя окно и согласованные параметры
+   */
+  void Socket_logging::disconnect() {
+    if (fd != -1) ::close(fd);
+    fd = -1;
+    acks.clear();
+  }
+
+  /**
+   * @brief Принимает пришедшие подтверждения
+   * @param timeout_ms Ожидание первого подтверждения, 0 - не ждать
+   * @return optional<Error> Пустой optional при успехе, или объект Error,
+   *         если соединение закрыто или пришёл неожиданный кадр
+   */
+  std::optional<Error>
+  Socket_logging::receive_acks(int timeout_ms) {
+    pollfd pfd{fd, POLLIN, 0};
+    int ready = ::poll(&pfd, 1, timeout_ms);
+    if (ready < 0) {
+      if (errno == EINTR) return {};
+      return Error(Error_code::WRITE, strerror(errno));
+    }
+    if (!ready) return {};
+    char data[4096];
+    for (;;) {
+      auto size = ::recv(fd, data, sizeof(data), MSG_DONTWAIT);
+      if (size < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return {};
+        if (errno == EINTR) continue;
+        return Error(Error_code::WRITE, strerror(errno));
+      }
+      if (!size) return Error(Error_code::WRITE, "closed the connection");
+      if (packet) {
+        auto count = Transport::parse_ack(std::string_view(data, size));
+        if (!count) return Error(Error_code::WRITE, "unexpected frame");
+        acknowledge(*count);
+        continue;
+      }
+      // кадры потока: длина uint32_t в сетевом порядке, затем тело
+      acks.append(data, size);
+      std::size_t position = 0;
+      while (acks.size() - position >= sizeof(uint32_t)) {
+        uint32_t length;
+        std::memcpy(&length, acks.data() + position, sizeof(length));
+        length = ::ntohl(length);
+        if (acks.size() - position - sizeof(length) < length) break;
+        auto count = Transport::parse_ack(
+          std::string_view(acks).substr(position + sizeof(length), length));
+        if (!count) return Error(Error_code::WRITE, "unexpected frame");
+        acknowledge(*count);
+        position += sizeof(length) + length;
+      }
+      acks.erase(0, position);
+    }
+  }
+
+  /**
+   * @brief Освобождает подтверждённые записи окна
+   * @param count Сколько записей текущего соединения подтверждено (накопительно)
+   */
+  void Socket_logging::acknowledge(uint64_t count) {
+    auto confirmed = connection_base + count;
+    while (window_base < confirmed && !window.empty()) {
+      window.pop_front();
+      ++window_base;
+    }
+    unacknowledged.store(window.size(), std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Ждёт, пока в окне останется не больше pending записей
+   *
+   * Если подтверждений нет дольше ack_timeout_ms или соединение закрыто,
+   * переподключается один раз и отправляет окно повторно
+   * @param pending Допустимое число неподтверждённых записей
+   * @return optional<Error> Пустой optional при успехе, или объект Error
+   */
+  std::optional<Error>
+  Socket_logging::wait_acknowledged(std::size_t pending) {
+    const auto timeout = std::chrono::milliseconds(options.ack_timeout_ms);
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    bool reconnected = false;
+    while (window.size() > pending) {
+      auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+        deadline - std::chrono::steady_clock::now()).count();
+      if (fd != -1 && left > 0 && !receive_acks(static_cast<int>(left))) continue;
+      if (reconnected) return Error(Error_code::WRITE, "records are not acknowledged");
+      if (auto error = reconnect()) return error;
+      reconnected = true;
+      deadline = std::chrono::steady_clock::now() + timeout;
+    }
+    return {};
+  }
+
+  /**
+   * @brief Отправляет кадр: с префиксом длины, либо пакетом SOCK_SEQPACKET
+   * @param data Тело кадра
+   * @return variant<int, Error> Количество отправленных байт или объект ошибки
+   */
+  std::variant<int, Error>
+  Socket_logging::send_frame(std::string_view data) {
+    return packet ? Socket::packet_write(fd, data) : Socket::socket_write(fd, data);
+  }
+
+  /**
+   * @brief Принимает кадр: с префиксом длины, либо пакет SOCK_SEQPACKET
+   * @param[out] data Буфер кадра
+   * @return optional<Error> Пустой optional при успехе, или объект ошибки
+   */
+  std::optional<Error>
+  Socket_logging::receive_frame(std::string& data) {
+    return packet ? Socket::packet_read(fd, data) : Socket::socket_read(fd, data);
+  }
+
+  /**
+   * @brief Дополняет счётчики байтами, отправленными транспортом
+   * @param[out] statistics Счётчики логгера
+   */
+  void Socket_logging::add_statistics(Logging_statistics& statistics) const {
+    statistics.bytes_raw = bytes_raw.load(std::memory_order_relaxed);
+    statistics.bytes_sent = bytes_sent.load(std::memory_order_relaxed);
+    statistics.unacknowledged = unacknowledged.load(std::memory_order_relaxed);
+    statistics.retransmitted = retransmitted.load(std::memory_order_relaxed);
+  }
+
   /**
    * @brief Функция для записи данных в сокет
    *
    * Сначала отправляет размер сообщения (uint32_t в сетевом порядке байт), затем сами данные
    * @param fd Дескриптор открытого сокета
-   * @param data Указатель на строку с данными для отправки
+   * @param data Данные для отправки
    * @return variant<int, Error> Возвращает количество отправленных байт или объект ошибки
    */
   std::variant<int, Error>
-  Socket::socket_write(const int fd, std::shared_ptr<std::string> data) {
-    uint32_t message_size = ::htonl(static_cast<uint32_t>(data->size()));
+  Socket::socket_write(const int fd, std::string_view data) {
+    uint32_t message_size = ::htonl(static_cast<uint32_t>(data.size()));
     /// Блокируется пока не отправит размер сообщения
     int sent = ::send(fd, &message_size, sizeof(message_size), MSG_WAITALL | MSG_NOSIGNAL);
     if (sent <= 0) {
       return Error(Error_code::WRITE, strerror(errno));
     }
     /// Блокируется пока не отправит все данные
-    sent = ::send(fd, data->data(), data->size(), MSG_WAITALL | MSG_NOSIGNAL);
+    sent = ::send(fd, data.data(), data.size(), MSG_WAITALL | MSG_NOSIGNAL);
     if (sent <= 0) {
       return Error(Error_code::WRITE, strerror(errno));
     }
     return sent;
   }
 
+  /**
+   * @brief Функция для записи данных в сокет (совместимость со старым API)
+   *
+   * @param fd Дескриптор открытого сокета
+   * @param data Указатель на строку с данными для отправки
+   * @return variant<int, Error> Возвращает количество отправленных байт или объект ошибки
+   */
+  std::variant<int, Error>
+  Socket::socket_write(const int fd, std::shared_ptr<std::string> data) {
+    return socket_write(fd, std::string_view(*data));
+  }
+
   /**
    * @brief Функция для чтения данных из сокета
    *
-   * Сначала читает длину сообщения (uint32_t в сетевом порядке байт), затем само сообщение
+   * Сначала читает длину сообщения (uint32_t в сетевом порядке байт), затем само сообщение.
+   * Кадр длиннее max_size не читается: память под него не выделяется,
+   * возвращается ошибка, соединение после неё следует закрыть
+   * @tparam Buffer Тип строкового буфера (std::string или Memory::Pool_string)
    * @param fd Дескриптор открытого сокета
-   * @return variant<shared_ptr<string>, Error> Возвращает указатель на строку с данными или объект ошибки
+   * @param[out] buf Буфер для сообщения, память переиспользуется между вызовами
+   * @param max_size Наибольший размер кадра
+   * @return optional<Error> Пустой optional при успехе, или объект ошибки
    */
-  std::variant<std::shared_ptr<std::string>, Error>
-  Socket::socket_read(const int fd) {
+  template<typename Buffer>
+  static std::optional<Error>
+  read_frame(const int fd, Buffer& buf, std::size_t max_size) {
     uint32_t message_length{};
     /// Блокируется пока не получит размер сообщения
     int receive = ::recv(fd, &message_length, sizeof(message_length), MSG_WAITALL);
@@ -115,23 +550,148 @@ namespace Logger {
       return Error(
         Error_code::ERROR, strerror(errno));
     }
-    auto buf = std::make_shared<std::string>();
     message_length = ::ntohl(message_length);
+    if (message_length > max_size) return Transport::frame_too_large(message_length, max_size);
     /// может не выделить память
     try {
-        buf->resize(message_length);
+        buf.resize(message_length);
     }
     catch (const std::bad_alloc& ex) {
       return Error(Error_code::ERROR, ex.what());
     }
     /// Блокируется пока не получит все данные
-    receive = recv(fd, buf->data(), buf->size(), MSG_WAITALL);
+    receive = recv(fd, buf.data(), buf.size(), MSG_WAITALL);
     // если прочитанные данные не равны размеру сообщения
     // возвращаем ошибку
-    if (receive != message_length) {
+    if (receive != static_cast<int>(message_length)) {
       return Error(Error_code::ERROR, "not all data received");
     }
+    return {};
+  }
+
+  /**
+   * @brief Функция для чтения данных из сокета
+   * @param fd Дескриптор открытого сокета
+   * @param[out] buf Буфер для сообщения, память переиспользуется между вызовами
+   * @param max_size Наибольший размер кадра
+   * @return optional<Error> Пустой optional при успехе, или объект ошибки
+   */
+  std::optional<Error>
+  Socket::socket_read(const int fd, std::string& buf, std::size_t max_size) {
+    return read_frame(fd, buf, max_size);
+  }
+
+  /**
+   * @brief Функция для чтения данных из сокета в буфер из пула
+   * @param fd Дескриптор открытого сокета
+   * @param[out] buf Буфер для сообщения, память выделяется из Memory::Buffer_pool
+   * @param max_size Наибольший размер кадра
+   * @return optional<Error> Пустой optional при успехе, или объект ошибки
+   */
+  std::optional<Error>
+  Socket::socket_read(const int fd, Memory::Pool_string& buf, std::size_t max_size) {
+    return read_frame(fd, buf, max_size);
+  }
+
+  /**
+   * @brief Функция для чтения данных из сокета (совместимость со старым API)
+   *
+   * @param fd Дескриптор открытого сокета
+   * @return variant<shared_ptr<string>, Error> Возвращает указатель на строку с данными или объект ошибки
+   */
+  std::variant<std::shared_ptr<std::string>, Error>
+  Socket::socket_read(const int fd) {
+    auto buf = std::make_shared<std::string>();
+    if (auto error = socket_read(fd, *buf)) {
+      return error.value();
+    }
     return buf;
   }
+
+  /**
+   * @brief Функция для записи пакета в сокет SOCK_SEQPACKET
+   *
+   * Граница пакета сохраняется, поэтому префикс длины не нужен.
+   * Размер пакета ограничен буфером отправки сокета (SO_SNDBUF)
+   * @param fd Дескриптор открытого сокета
+   * @param data Данные для отправки
+   * @return variant<int, Error> Возвращает количество отправленных байт или объект ошибки
+   */
+  std::variant<int, Error>
+  Socket::packet_write(const int fd, std::string_view data) {
+    auto sent = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+    if (sent < 0) {
+      return Error(Error_code::WRITE, strerror(errno));
+    }
+    return static_cast<int>(sent);
+  }
+
+  /**
+   * @brief Функция для чтения пакета из сокета SOCK_SEQPACKET
+   *
+   * Размер пакета определяется заранее (MSG_PEEK | MSG_TRUNC). recv возвращает 0
+   * и для пакета нулевой длины, и после закрытия соединения: закрытие
+   * определяется по POLLRDHUP, пустой пакет принимается как пустой кадр
+   * @param fd Дескриптор открытого сокета
+   * @param[out] buf Буфер для пакета, память переиспользуется между вызовами
+   * @param max_size Наибольший размер пакета, больший пакет отбрасывается с ошибкой
+   * @return optional<Error> Пустой optional при успехе, или объект ошибки
+   */
+  std::optional<Error>
+  Socket::packet_read(const int fd, std::string& buf, std::size_t max_size) {
+    auto size = ::recv(fd, nullptr, 0, MSG_PEEK | MSG_TRUNC);
+    if (size < 0) return Error(Error_code::ERROR, strerror(errno));
+    if (!size) {
+      if (peer_closed(fd)) return Error(Error_code::ERROR, "closed the connection");
+      ::recv(fd, nullptr, 0, 0); // пустой пакет
+      buf.clear();
+      return {};
+    }
+    if (static_cast<std::size_t>(size) > max_size) {
+      char skipped;
+      ::recv(fd, &skipped, sizeof(skipped), 0); // пакет отбрасывается целиком
+      return Transport::frame_too_large(static_cast<std::size_t>(size), max_size);
+    }
+    try {
+      buf.resize(static_cast<std::size_t>(size));
+    }
+    catch (const std::bad_alloc& ex) {
+      return Error(Error_code::ERROR, ex.what());
+    }
+    if (::recv(fd, buf.data(), buf.size(), 0) != size) {
+      return Error(Error_code::ERROR, "not all data received");
+    }
+    return {};
+  }
+
+  /**
+   * @brief Ограничивает ожидание отправки в сокет
+   *
+   * Отправка, не завершившаяся за timeout_ms, возвращает ошибку EAGAIN
+   * @param fd Дескриптор сокета
+   * @param timeout_ms Срок в миллисекундах, 0 - без ограничения
+   * @return optional<Error> Ошибка setsockopt
+   */
+  std::optional<Error> Socket::set_send_timeout(const int fd, int timeout_ms) {
+    if (timeout_ms <= 0) return {};
+    timeval timeout{timeout_ms / 1000, static_cast<suseconds_t>(timeout_ms % 1000) * 1000};
+    if (::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout))) {
+      return Error(Error_code::OPEN_SESSION, ::strerror(errno));
+    }
+    return {};
+  }
+
+  /**
+   * @brief Отличает закрытие соединения от пакета нулевой длины
+   *
+   * Для SOCK_SEQPACKET recv возвращает 0 в обоих случаях; после закрытия
+   * собеседником poll сообщает POLLRDHUP
+   * @param fd Дескриптор сокета
+   * @return true, если соединение закрыто или poll завершился ошибкой
+   */
+  bool Socket::peer_closed(const int fd) {
+    pollfd closed{fd, POLLRDHUP, 0};
+    return ::poll(&closed, 1, 0) != 0;
+  }
   /*** Implementation write socket***/
 }
@@ -0,0 +1,186 @@
+#include "include/token_index.hpp"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+namespace Logger::Token_index {
+  namespace {
+    constexpr std::size_t segment_header = 24; ///< offset, length, слов фильтра, хешей
+    constexpr uint32_t max_filter_words = 1u << 24; ///< Ограничение при разборе повреждённого индекса
+
+    void put32(std::string& out, uint32_t value) {
+      value = ::htonl(value);
+      out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void put64(std::string& out, uint64_t value) {
+      value = ::htobe64(value);
+      out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    uint32_t get32(const char* data) {
+      uint32_t value;
+      std::memcpy(&value, data, sizeof(value));
+      return ::ntohl(value);
+    }
+
+    uint64_t get64(const char* data) {
+      uint64_t value;
+      std::memcpy(&value, data, sizeof(value));
+      return ::be64toh(value);
+    }
+
+    std::optional<Error> write_all(int fd, std::string_view data) {
+      while (!data.empty()) {
+        auto written = ::write(fd, data.data(), data.size());
+        if (written == -1) {
+          if (errno == EINTR) continue;
+          return Error(Error_code::WRITE, std::string("token index: ") + ::strerror(errno));
+        }
+        data.remove_prefix(static_cast<std::size_t>(written));
+      }
+      return {};
+    }
+  }
+
+  /**
+   * @brief Хеш токена: FNV-1a с перемешиванием splitmix64
+   *
+   * Перемешивание нужно фильтру: обе половины хеша используются
+   * как независимые хеши (двойное хеширование)
+   */
+  uint64_t hash_token(std::string_view token) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (unsigned char c : token) {
+      hash = (hash ^ c) * 0x100000001b3ull;
+    }
+    hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ull;
+    hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebull;
+    return hash ^ (hash >> 31);
+  }
+
+  Bloom_filter Bloom_filter::build(std::vector<uint64_t>& hashes) {
+    std::sort(hashes.begin(), hashes.end());
+    hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+    Bloom_filter filter;
+    filter.hash_count = default_hashes;
+    filter.words.assign(std::max<std::size_t>(1, (hashes.size() * bits_per_token + 63) / 64), 0);
+    auto bits = filter.bit_count();
+    for (auto hash : hashes) {
+      uint64_t low = static_cast<uint32_t>(hash), step = (hash >> 32) | 1;
+      for (uint32_t i = 0; i < filter.hash_count; ++i) {
+        auto bit = (low + i * step) % bits;
+        filter.words[bit / 64] |= uint64_t{1} << (bit % 64);
+      }
+    }
+    return filter;
+  }
+
+  bool Bloom_filter::may_contain(uint64_t hash) const {
+    auto bits = bit_count();
+    if (!bits) return true;
+    uint64_t low = static_cast<uint32_t>(hash), step = (hash >> 32) | 1;
+    for (uint32_t i = 0; i < hash_count; ++i) {
+      auto bit = (low + i * step) % bits;
+      if (!(words[bit / 64] & (uint64_t{1} << (bit % 64)))) return false;
+    }
+    return true;
+  }
+
+  void Bloom_filter::serialize(std::string& out) const {
+    put32(out, static_cast<uint32_t>(words.size()));
+    put32(out, hash_count);
+    for (auto word : words) put64(out, word);
+  }
+
+  std::optional<Bloom_filter> Bloom_filter::deserialize(std::string_view& data) {
+    if (data.size() < 8) return {};
+    auto count = get32(data.data());
+    auto hashes = get32(data.data() + 4);
+    if (!count || count > max_filter_words || !hashes || data.size() - 8 < uint64_t{count} * 8) return {};
+    Bloom_filter filter;
+    filter.hash_count = hashes;
+    filter.words.resize(count);
+    for (uint32_t i = 0; i < count; ++i) filter.words[i] = get64(data.data() + 8 + i * 8);
+    data.remove_prefix(8 + std::size_t{count} * 8);
+    return filter;
+  }
+
+  std::variant<std::vector<Segment>, Error> read_index(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return Error(Error_code::OPEN_SESSION, path + ": " + ::strerror(errno));
+    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (content.size() < sizeof(magic) || content.compare(0, sizeof(magic), magic, sizeof(magic))) {
+      return Error(Error_code::OPEN_SESSION, path + ": not a token index");
+    }
+    std::string_view data(content);
+    data.remove_prefix(sizeof(magic));
+    std::vector<Segment> segments;
+    while (data.size() >= segment_header) {
+      Segment segment;
+      segment.offset = get64(data.data());
+      segment.length = get64(data.data() + 8);
+      auto rest = data.substr(16);
+      auto filter = Bloom_filter::deserialize(rest);
+      if (!filter) break;
+      segment.filter = std::move(*filter);
+      segments.push_back(std::move(segment));
+      data = rest;
+    }
+    return segments;
+  }
+
+  /**
+   * @brief Открывает индекс журнала для дозаписи сегментов
+   *
+   * Индекс, не соответствующий журналу (чужой файл или сегменты за концом
+   * журнала - журнал был усечён или заменён), начинается заново.
+   * Первый сегмент начинается с текущего конца журнала
+   * @param log_file Путь к журналу
+   * @param log_size Размер журнала при открытии
+   * @param segment_bytes Наименьший размер сегмента
+   * @return variant<unique_ptr<Builder>, Error> Построитель или ошибка открытия индекса
+   */
+  std::variant<std::unique_ptr<Builder>, Error>
+  Builder::open(const std::string& log_file, uint64_t log_size, std::size_t segment_bytes) {
+    auto path = index_path(log_file);
+    bool valid = false;
+    if (auto segments = read_index(path); auto list = std::get_if<std::vector<Segment>>(&segments)) {
+      valid = list->empty() || list->back().offset + list->back().length <= log_size;
+    }
+    int fd = ::open(path.data(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd == -1) return Error(Error_code::OPEN_SESSION, path + ": " + ::strerror(errno));
+    std::unique_ptr<Builder> builder(new Builder(fd, segment_bytes, log_size));
+    if (!valid) {
+      if (::ftruncate(fd, 0)) return Error(Error_code::OPEN_SESSION, path + ": " + ::strerror(errno));
+      if (auto error = write_all(fd, std::string_view(magic, sizeof(magic)))) return *error;
+    }
+    return builder;
+  }
+
+  std::optional<Error> Builder::add(std::string_view line) {
+    for_each_token(line, [this](std::string_view token) { hashes.push_back(hash_token(token)); });
+    length += line.size();
+    if (length < segment_bytes) return {};
+    return finish();
+  }
+
+  /**
+   * @brief Строит фильтр текущего сегмента и дописывает его одной записью
+   *
+   * Следующий сегмент начинается сразу за текущим
+   */
+  std::optional<Error> Builder::finish() {
+    if (!length) return {};
+    buffer.clear();
+    put64(buffer, offset);
+    put64(buffer, length);
+    Bloom_filter::build(hashes).serialize(buffer);
+    offset += length;
+    length = 0;
+    hashes.clear();
+    ++segments;
+    return write_all(fd, buffer);
+  }
+}
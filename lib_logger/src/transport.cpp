@@ -0,0 +1,344 @@
+#include "include/logger.hpp"
+#include <algorithm>
+#include <cctype>
+#include <arpa/inet.h>
+#include <endian.h>
+
+namespace Logger {
+  /*** LZ compression ***/
+
+  namespace {
+    constexpr std::size_t min_match = 4; ///< Минимальная длина совпадения
+    constexpr std::size_t last_literals = 5; ///< Последние байты всегда литералы
+    constexpr std::size_t match_limit = 12; ///< Совпадение не начинается ближе к концу
+    constexpr std::size_t max_offset = 65535;
+    constexpr int hash_log = 12;
+
+    uint32_t read32(const char* ptr) {
+      uint32_t value;
+      std::memcpy(&value, ptr, sizeof(value));
+      return value;
+    }
+
+    uint32_t hash32(uint32_t sequence) {
+      return (sequence * 2654435761u) >> (32 - hash_log);
+    }
+
+    /// Дописывает длину сверх 15 байтами по 255
+    void write_length(std::string& out, std::size_t length) {
+      while (length >= 255) {
+        out.push_back(static_cast<char>(255));
+        length -= 255;
+      }
+      out.push_back(static_cast<char>(length));
+    }
+
+    /// Дописывает последовательность: литералы и совпадение (match_length 0 - без совпадения)
+    void write_sequence(std::string& out, const char* literals, std::size_t literal_length,
+        std::size_t offset, std::size_t match_length) {
+      std::size_t match_code = match_length ? match_length - min_match : 0;
+      out.push_back(static_cast<char>(
+        (std::min<std::size_t>(literal_length, 15) << 4) |
+        std::min<std::size_t>(match_code, 15)));
+      if (literal_length >= 15) write_length(out, literal_length - 15);
+      out.append(literals, literal_length);
+      if (!match_length) return;
+      out.push_back(static_cast<char>(offset & 0xff));
+      out.push_back(static_cast<char>(offset >> 8));
+      if (match_code >= 15) write_length(out, match_code - 15);
+    }
+
+    /// Читает длину сверх 15
+    bool read_length(const unsigned char*& in, const unsigned char* end, std::size_t& length) {
+      unsigned char byte;
+      do {
+        if (in == end) return false;
+        byte = *in++;
+        length += byte;
+      } while (byte == 255);
+      return true;
+    }
+  }
+
+  /**
+   * @brief Сжимает данные в блок формата LZ4
+   *
+   * Жадный поиск совпадений по хеш-таблице 4-байтовых последовательностей
+   *
+   * @param input Исходные данные
+   * @param[out] out Буфер, в конец которого дописывается сжатый блок
+   */
+  void Compression::compress(std::string_view input, std::string& out) {
+    const char* base = input.data();
+    const char* end = base + input.size();
+    const char* anchor = base;
+    if (input.size() > match_limit) {
+      uint32_t table[1u << hash_log];
+      std::fill(std::begin(table), std::end(table), UINT32_MAX);
+      const char* limit = end - match_limit;
+      const char* ip = base;
+      while (ip < limit) {
+        auto sequence = read32(ip);
+        auto& slot = table[hash32(sequence)];
+        const char* ref = slot == UINT32_MAX ? nullptr : base + slot;
+        slot = static_cast<uint32_t>(ip - base);
+        if (!ref || static_cast<std::size_t>(ip - ref) > max_offset || read32(ref) != sequence) {
+          ++ip;
+          continue;
+        }
+        std::size_t length = min_match;
+        while (ip + length < end - last_literals && ref[length] == ip[length]) ++length;
+        write_sequence(out, anchor, ip - anchor, ip - ref, length);
+        ip += length;
+        anchor = ip;
+      }
+    }
+    write_sequence(out, anchor, end - anchor, 0, 0);
+  }
+
+  /**
+   * @brief Распаковывает блок формата LZ4
+   *
+   * @param input Сжатый блок
+   * @param size Размер исходных данных
+   * @param[out] out Буфер, в конец которого дописываются исходные данные
+   * @return optional<Error> Пустое значение при успехе, либо ошибка повреждённого блока
+   */
+  std::optional<Error>
+  Compression::decompress(std::string_view input, std::size_t size, std::string& out) {
+    auto in = reinterpret_cast<const unsigned char*>(input.data());
+    auto in_end = in + input.size();
+    auto start = out.size();
+    out.resize(start + size);
+    auto op = out.data() + start;
+    auto op_begin = op;
+    auto op_end = op + size;
+    auto corrupted = [&out, start]{
+      out.resize(start);
+      return Error(Error_code::ERROR, "corrupted compressed block");
+    };
+    while (in < in_end) {
+      unsigned token = *in++;
+      std::size_t literal_length = token >> 4;
+      if (literal_length == 15 && !read_length(in, in_end, literal_length)) return corrupted();
+      if (literal_length > static_cast<std::size_t>(in_end - in) ||
+          literal_length > static_cast<std::size_t>(op_end - op)) {
+        return corrupted();
+      }
+      std::memcpy(op, in, literal_length);
+      in += literal_length;
+      op += literal_length;
+      if (in == in_end) break; // последняя последовательность - только литералы
+      if (in_end - in < 2) return corrupted();
+      std::size_t offset = in[0] | (in[1] << 8);
+      in += 2;
+      std::size_t match_length = token & 15;
+      if (match_length == 15 && !read_length(in, in_end, match_length)) return corrupted();
+      match_length += min_match;
+      if (!offset || offset > static_cast<std::size_t>(op - op_begin) ||
+          match_length > static_cast<std::size_t>(op_end - op)) {
+        return corrupted();
+      }
+      // совпадение может перекрывать копируемые данные - копируем побайтно
+      const char* ref = op - offset;
+      for (std::size_t i = 0; i < match_length; ++i) op[i] = ref[i];
+      op += match_length;
+    }
+    if (op != op_end) return corrupted();
+    return {};
+  }
+
+  /*** LZ compression ***/
+
+  /*** Transport framing ***/
+
+  /**
+   * @brief Формирует кадр согласования
+   *
+   * Формат: control_marker, слово ("hello" - клиент, "welcome" - сервер),
+   * затем параметры "<ключ>=<значение>" через пробел
+   *
+   * @param word Слово кадра
+   * @param handshake Параметры
+   * @return string Тело кадра
+   */
+  std::string Transport::make_handshake(std::string_view word, const Handshake& handshake) {
+    std::string out(1, control_marker);
+    out.append(word);
+    if (handshake.compress) out.append(" compress=lz");
+    if (handshake.nanoseconds) out.append(" time=ns");
+    if (handshake.acknowledge) out.append(" ack=1");
+    if (!handshake.source.empty()) out.append(" source=").append(handshake.source);
+    if (handshake.chunks) out.append(" chunk=1");
+    return out;
+  }
+
+  /**
+   * @brief Разбирает кадр согласования
+   *
+   * Неизвестные параметры пропускаются для совместимости с новыми версиями
+   *
+   * @param frame Тело кадра
+   * @param word Ожидаемое слово кадра
+   * @return optional<Handshake> Параметры, либо пустое значение, если это не кадр согласования
+   */
+  std::optional<Transport::Handshake>
+  Transport::parse_handshake(std::string_view frame, std::string_view word) {
+    if (frame.empty() || frame[0] != control_marker) return {};
+    frame.remove_prefix(1);
+    if (frame.substr(0, word.size()) != word) return {};
+    frame.remove_prefix(word.size());
+    Handshake handshake;
+    while (!frame.empty()) {
+      auto position = frame.find(' ');
+      auto item = frame.substr(0, position);
+      frame = position == std::string_view::npos ? std::string_view{} : frame.substr(position + 1);
+      if (item == "compress=lz") handshake.compress = true;
+      if (item == "time=ns") handshake.nanoseconds = true;
+      if (item == "ack=1") handshake.acknowledge = true;
+      if (item == "chunk=1") handshake.chunks = true;
+      if (item.substr(0, 7) == "source=" && valid_source(item.substr(7))) {
+        handshake.source = item.substr(7);
+      }
+    }
+    return handshake;
+  }
+
+  /**
+   * @brief Проверяет идентификатор источника
+   *
+   * Допустимы латинские буквы, цифры и символы "._-:@/", длина
+   * от 1 до max_source_length
+   * @param source Идентификатор
+   * @return true если идентификатор можно передать при согласовании
+   */
+  bool Transport::valid_source(std::string_view source) {
+    if (source.empty() || source.size() > max_source_length) return false;
+    return std::all_of(source.begin(), source.end(), [](unsigned char symbol) {
+      return std::isalnum(symbol) || (symbol && std::strchr("._-:@/", symbol));
+    });
+  }
+
+  /**
+   * @brief Добавляет запись в тело пачки
+   * @param[out] batch Тело пачки
+   * @param record Сериализованная запись
+   */
+  void Transport::append_record(std::string& batch, std::string_view record) {
+    uint32_t size = ::htonl(static_cast<uint32_t>(record.size()));
+    batch.append(reinterpret_cast<const char*>(&size), sizeof(size));
+    batch.append(record);
+  }
+
+  /**
+   * @brief Формирует кадр подтверждения
+   * @param count Сколько записей соединения принято и обработано (накопительно)
+   * @return string Тело кадра
+   */
+  std::string Transport::make_ack(uint64_t count) {
+    std::string out(1, static_cast<char>(Frame_type::ACK));
+    count = ::htobe64(count);
+    out.append(reinterpret_cast<const char*>(&count), sizeof(count));
+    return out;
+  }
+
+  /**
+   * @brief Разбирает кадр подтверждения
+   * @param frame Тело кадра
+   * @return optional<uint64_t> Количество подтверждённых записей, либо пустое значение
+   */
+  std::optional<uint64_t> Transport::parse_ack(std::string_view frame) {
+    uint64_t count;
+    if (frame.size() != 1 + sizeof(count) || frame[0] != static_cast<char>(Frame_type::ACK)) return {};
+    std::memcpy(&count, frame.data() + 1, sizeof(count));
+    return ::be64toh(count);
+  }
+
+  /**
+   * @brief Ошибка кадра, превышающего ограничение размера
+   * @param size Размер кадра из префикса длины или пакета
+   * @param max_size Ограничение
+   * @return Error Ошибка с обоими размерами
+   */
+  Error Transport::frame_too_large(std::size_t size, std::size_t max_size) {
+    return Error(Error_code::ERROR, "frame too large: " + std::to_string(size) +
+      " bytes, limit " + std::to_string(max_size));
+  }
+
+  /**
+   * @brief Дописывает кадр части записи
+   * @param[out] frame Буфер кадра, очищается
+   * @param data Часть сериализованной записи
+   * @param more За частью следуют другие части записи
+   */
+  void Transport::append_chunk(std::string& frame, std::string_view data, bool more) {
+    frame.clear();
+    frame.push_back(static_cast<char>(Frame_type::CHUNK));
+    frame.push_back(more ? '\x01' : '\x00');
+    frame.append(data);
+  }
+
+  /**
+   * @brief Разбирает кадр части записи
+   * @param frame Тело кадра
+   * @return optional<Chunk> Часть, либо пустое значение, если это не кадр части
+   */
+  std::optional<Transport::Chunk> Transport::parse_chunk(std::string_view frame) {
+    if (frame.size() < 2 || frame[0] != static_cast<char>(Frame_type::CHUNK)) return {};
+    if (frame[1] != '\x00' && frame[1] != '\x01') return {};
+    return Chunk{frame[1] == '\x01', frame.substr(2)};
+  }
+
+  /**
+   * @brief Разбирает кадр с типом и передаёт записи обработчику
+   *
+   * @param frame Тело кадра
+   * @param scratch Буфер распаковки, переиспользуется между кадрами
+   * @param on_record Обработчик записи, представление действительно до возврата
+   * @return optional<Error> Пустое значение при успехе, либо ошибка формата
+   */
+  std::optional<Error>
+  Transport::decode_frame(std::string_view frame, std::string& scratch,
+      const std::function<void(std::string_view)>& on_record) {
+    if (frame.empty()) return Error(Error_code::ERROR, "empty frame");
+    auto type = static_cast<Frame_type>(frame[0]);
+    frame.remove_prefix(1);
+    std::string_view body;
+    switch (type) {
+      case Frame_type::RECORD:
+        on_record(frame);
+        return {};
+      case Frame_type::BATCH:
+        body = frame;
+        break;
+      case Frame_type::COMPRESSED: {
+        uint32_t size;
+        if (frame.size() < sizeof(size)) return Error(Error_code::ERROR, "short compressed frame");
+        std::memcpy(&size, frame.data(), sizeof(size));
+        size = ::ntohl(size);
+        if (size > max_batch_size) return Error(Error_code::ERROR, "batch too large");
+        scratch.clear();
+        if (auto error = Compression::decompress(frame.substr(sizeof(size)), size, scratch)) {
+          return error;
+        }
+        body = scratch;
+        break;
+      }
+      default:
+        return Error(Error_code::ERROR, "unknown frame type");
+    }
+    while (!body.empty()) {
+      uint32_t size;
+      if (body.size() < sizeof(size)) return Error(Error_code::ERROR, "truncated batch");
+      std::memcpy(&size, body.data(), sizeof(size));
+      size = ::ntohl(size);
+      body.remove_prefix(sizeof(size));
+      if (size > body.size()) return Error(Error_code::ERROR, "truncated batch");
+      on_record(body.substr(0, size));
+      body.remove_prefix(size);
+    }
+    return {};
+  }
+
+  /*** Transport framing ***/
+}
@@ -0,0 +1,231 @@
+#include "async_io.hpp"
+
+#include <cassert>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace Async = Logger::Async;
+
+namespace {
+  std::unique_ptr<Async::Executor> make_executor() {
+    auto created = Async::Executor::create();
+    assert(std::holds_alternative<std::unique_ptr<Async::Executor>>(created));
+    return std::move(std::get<std::unique_ptr<Async::Executor>>(created));
+  }
+
+  int listen_unix(const std::string& path) {
+    ::unlink(path.data());
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    assert(fd != -1);
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.data(), path.size());
+    assert(!::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)));
+    assert(!::listen(fd, SOMAXCONN));
+    return fd;
+  }
+}
+
+void test_executor_timers() {
+  auto executor = make_executor();
+  std::vector<int> order;
+  auto sleeper = [&](int id, int ms) -> Async::Task<void> {
+    co_await executor->sleep_for(std::chrono::milliseconds(ms));
+    order.push_back(id);
+  };
+  executor->spawn(sleeper(3, 30));
+  executor->spawn(sleeper(1, 10));
+  executor->spawn(sleeper(2, 20));
+  assert(executor->task_count() == 3);
+  assert(!executor->run()); // все сопрограммы завершились
+  assert((order == std::vector<int>{1, 2, 3}));
+  assert(!executor->task_count());
+
+  /* ожидание со сроком: дескриптор не готов - false */
+  int pair[2];
+  assert(!::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, pair));
+  bool first = true, second = false;
+  // кадр сопрограммы-лямбды ссылается на объект лямбды: он должен её пережить
+  auto waiter = [&]() -> Async::Task<void> {
+    first = co_await executor->readable(pair[0], std::chrono::milliseconds(10));
+    assert(::write(pair[1], "x", 1) == 1);
+    second = co_await executor->readable(pair[0], std::chrono::milliseconds(1000));
+  };
+  executor->spawn(waiter());
+  assert(!executor->run());
+  assert(!first && second);
+  ::close(pair[0]);
+  ::close(pair[1]);
+
+  /* истёкшее ожидание снимает дескриптор с epoll: закрытие собеседника позже
+     не возобновляет сопрограмму, ожидающую другое событие */
+  assert(!::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, pair));
+  auto slept = std::chrono::steady_clock::duration{};
+  bool timed_out = false;
+  auto abandoned = [&]() -> Async::Task<void> {
+    timed_out = !co_await executor->readable(pair[0], std::chrono::milliseconds(10));
+    ::close(pair[1]);
+    auto start = std::chrono::steady_clock::now();
+    co_await executor->sleep_for(std::chrono::milliseconds(50));
+    slept = std::chrono::steady_clock::now() - start;
+    /* дескриптор снова можно ждать: регистрация добавляет его заново */
+    assert(co_await executor->readable(pair[0], std::chrono::milliseconds(1000)));
+  };
+  executor->spawn(abandoned());
+  assert(!executor->run());
+  assert(timed_out && slept >= std::chrono::milliseconds(50));
+  ::close(pair[0]);
+
+  /* stop() из другого потока; незавершённая сопрограмма уничтожается с исполнителем */
+  struct Guard {
+    bool& destroyed;
+    ~Guard() { destroyed = true; }
+  };
+  bool destroyed = false;
+  auto endless = [&]() -> Async::Task<void> {
+    Guard guard{destroyed};
+    co_await executor->sleep_for(std::chrono::hours(1));
+  };
+  executor->spawn(endless());
+  std::thread stopper([&executor] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    executor->stop();
+  });
+  assert(!executor->run());
+  stopper.join();
+  assert(executor->task_count() == 1 && !destroyed);
+  executor.reset();
+  assert(destroyed);
+}
+
+void test_async_frames() {
+  auto executor = make_executor();
+  for (bool packet : {false, true}) {
+    int pair[2];
+    assert(!::socketpair(AF_UNIX, (packet ? SOCK_SEQPACKET : SOCK_STREAM) | SOCK_NONBLOCK, 0, pair));
+    // кадры больше буфера сокета: запись ждёт читателя
+    std::vector<std::string> frames;
+    for (std::size_t i = 0; i < 64; ++i) {
+      frames.push_back(std::string(packet ? i * 512 + 1 : i * 16384, static_cast<char>('a' + i % 26)));
+    }
+    std::size_t received = 0;
+    auto writer = [&]() -> Async::Task<void> {
+      for (const auto& frame : frames) {
+        assert(!co_await Async::write_frame(*executor, pair[1], frame, packet));
+      }
+    };
+    auto reader = [&]() -> Async::Task<void> {
+      std::string frame;
+      for (const auto& expected : frames) {
+        assert(!co_await Async::read_frame(*executor, pair[0], frame, packet));
+        assert(frame == expected);
+        ++received;
+      }
+      ::close(pair[1]);
+      assert(co_await Async::read_frame(*executor, pair[0], frame, packet)); // соединение закрыто
+    };
+    executor->spawn(writer());
+    executor->spawn(reader());
+    assert(!executor->run());
+    assert(received == frames.size());
+    ::close(pair[0]);
+  }
+}
+
+void test_async_sender() {
+  const std::string path = "/tmp/test_logger_async.sock";
+  int listen_fd = listen_unix(path);
+  auto executor = make_executor();
+
+  /* сервер: согласование и пачки, один обработчик-сопрограмма на подключение */
+  constexpr int clients = 1000, per_client = 20;
+  uint64_t records = 0, sourced = 0;
+  int handled = 0;
+  auto handle = [&](int fd) -> Async::Task<void> {
+    std::string frame, scratch, source;
+    bool framed = false;
+    while (!co_await Async::read_frame(*executor, fd, frame)) {
+      if (!framed) {
+        auto hello = Logger::Transport::parse_handshake(frame, "hello");
+        assert(hello);
+        source = hello->source;
+        framed = true;
+        auto welcome = Logger::Transport::make_handshake("welcome", *hello);
+        assert(!co_await Async::write_frame(*executor, fd, welcome));
+        continue;
+      }
+      auto error = Logger::Transport::decode_frame(frame, scratch, [&](std::string_view record) {
+        assert(Logger::Logger_protocol::deserialization_log(record));
+        ++records;
+        if (source.rfind("client-", 0) == 0) ++sourced;
+      });
+      assert(!error);
+    }
+    ::close(fd);
+    ++handled;
+  };
+  auto server = [&]() -> Async::Task<void> {
+    for (int i = 0; i < clients; ++i) {
+      auto accepted = co_await Async::accept(*executor, listen_fd);
+      assert(std::holds_alternative<int>(accepted));
+      executor->spawn(handle(std::get<int>(accepted)));
+    }
+  };
+  executor->spawn(server());
+
+  /* клиенты: все подключения одного потока одновременно */
+  uint64_t bytes_raw = 0, bytes_sent = 0;
+  auto client = [&](int id) -> Async::Task<void> {
+    Logger::Socket_options options;
+    options.batch_bytes = 512;
+    options.compress = true;
+    options.nanoseconds = true;
+    options.source = "client-" + std::to_string(id);
+    Async::Socket_sender sender(*executor, path, "", options);
+    assert(!co_await sender.open());
+    for (int i = 0; i < per_client; ++i) {
+      Logger::Logger_protocol::Protocol entry("async record " + std::to_string(i),
+        Logger::Level::INFO, Logger::Clock::now());
+      assert(!co_await sender.write(entry));
+    }
+    assert(!co_await sender.close());
+    bytes_raw += sender.get_bytes_raw();
+    bytes_sent += sender.get_bytes_sent();
+  };
+  for (int id = 0; id < clients; ++id) executor->spawn(client(id));
+  auto start = std::chrono::steady_clock::now();
+  assert(!executor->run());
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  assert(handled == clients);
+  assert(records == static_cast<uint64_t>(clients) * per_client && sourced == records);
+  assert(bytes_sent < bytes_raw); // пачки сжаты
+  std::cout << "async: " << clients << " connections, " << records << " records in "
+            << elapsed.count() << " s on one thread\n";
+
+  /* надёжный режим не поддерживается */
+  Logger::Socket_options reliable;
+  reliable.reliable = true;
+  Async::Socket_sender sender(*executor, path, "", reliable);
+  bool rejected = false;
+  auto open = [&]() -> Async::Task<void> {
+    rejected = static_cast<bool>(co_await sender.open());
+  };
+  executor->spawn(open());
+  assert(!executor->run());
+  assert(rejected);
+  ::close(listen_fd);
+  ::unlink(path.data());
+}
+
+int main() {
+  test_executor_timers();
+  test_async_frames();
+  test_async_sender();
+  std::cout << "All async tests passed!" << std::endl;
+  return 0;
+}
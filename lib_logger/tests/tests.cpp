@@ -1,12 +1,27 @@
 #include "logger.hpp"
+#include "archive.hpp"
+#include "basic_logging.hpp"
+#include "shared_ring.hpp"
+#include "token_index.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <csignal>
+#include <cstdlib>
 #include <ctime>
 #include <string>
 #include <sstream>
 #include <optional>
 #include <memory>
 #include <iostream>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
 
 
 void test_create_log_entry_with_level() {
@@ -69,6 +84,116 @@ void test_serialization_and_deserialization() {
   assert(*deserialized->get_message() == *msg);
 }
 
+void test_nanosecond_timestamps() {
+  using Logger::Logger_protocol::Protocol;
+  /* часы согласованы с time(), грубые отстают не больше чем на тик */
+  auto now = Logger::Clock::now();
+  auto seconds = std::chrono::duration_cast<std::chrono::seconds>(now).count();
+  assert(std::abs(seconds - ::time(nullptr)) <= 1);
+  assert(now - Logger::Clock::coarse_now() < std::chrono::milliseconds(100));
+
+  /* время и уровень не мешают друг другу, в том числе у длинных сообщений */
+  Logger::Timestamp stamp(1700000000123456789);
+  std::string large(Protocol::inline_capacity + 100, 'q');
+  Protocol entry(large, Logger::Level::ERROR, stamp);
+  assert(entry.get_timestamp() == stamp);
+  assert(entry.get_time() == 1700000000);
+  assert(entry.get_level() == Logger::Level::ERROR);
+  assert(entry.get_message_view() == large);
+
+  /* по умолчанию сериализуются секунды, формат прежней версии */
+  std::string wire;
+  Logger::Logger_protocol::serialization_log(entry, wire);
+  assert(wire == large + " 2 1700000000");
+  auto legacy = Logger::Logger_protocol::deserialization_log(wire);
+  assert(legacy && legacy->get_timestamp() == std::chrono::seconds(1700000000));
+
+  wire.clear();
+  Logger::Logger_protocol::serialization_log(Protocol("x", Logger::Level::WARN, stamp), wire, true);
+  assert(wire == "x 1 1700000000.123456789");
+  auto precise = Logger::Logger_protocol::deserialization_log(wire);
+  assert(precise && precise->get_timestamp() == stamp);
+  assert(precise->get_level() == Logger::Level::WARN && precise->get_message_view() == "x");
+  /* укороченная дробная часть - доли секунды */
+  auto short_fraction = Logger::Logger_protocol::deserialization_log("x 0 12.5");
+  assert(short_fraction && short_fraction->get_timestamp() == std::chrono::milliseconds(12500));
+  assert(!Logger::Logger_protocol::deserialization_log("x 0 12."));
+  assert(!Logger::Logger_protocol::deserialization_log("x 0 12.1234567890"));
+  assert(!Logger::Logger_protocol::deserialization_log("x 0 12.5a"));
+  /* уровень вне INFO..ERROR не помещается в 2 бита Protocol */
+  assert(Logger::Logger_protocol::deserialization_log("x 2 12"));
+  for (const char* level : {"3", "4", "5", "-1"}) {
+    assert(!Logger::Logger_protocol::deserialization_log(std::string("x ") + level + " 12"));
+  }
+
+  /* формат времени согласуется при подключении */
+  auto hello = Logger::Transport::make_handshake("hello", {false, true, false, "", false});
+  auto parsed = Logger::Transport::parse_handshake(hello, "hello");
+  assert(parsed && parsed->nanoseconds && !parsed->compress);
+
+  /* в файле дробная часть пишется, только если она есть */
+  std::ostringstream with_fraction, without_fraction;
+  Logger::Logger_protocol::print_log_entry(with_fraction, entry);
+  assert(with_fraction.str().size() > 10 &&
+    with_fraction.str().compare(with_fraction.str().size() - 10, 10, ".123456789") == 0);
+  Logger::Logger_protocol::print_log_entry(without_fraction, *legacy);
+  assert(without_fraction.str().find('.') == std::string::npos);
+}
+
+void test_protocol_storage_and_move() {
+  time_t t = time(nullptr);
+  std::string small("short");
+  std::string large(Logger::Logger_protocol::Protocol::inline_capacity + 10, 'x');
+
+  Logger::Logger_protocol::Protocol inline_entry(small, Logger::Level::INFO, t);
+  Logger::Logger_protocol::Protocol external_entry(large, Logger::Level::ERROR, t);
+  assert(inline_entry.get_message_view() == small);
+  assert(external_entry.get_message_view() == large);
+  assert(external_entry.get_level() == Logger::Level::ERROR);
+  assert(external_entry.get_time() == t);
+
+  /* перемещение передаёт буфер, исходная запись становится пустой */
+  const char* buffer = external_entry.get_message_view().data();
+  Logger::Logger_protocol::Protocol moved(std::move(external_entry));
+  assert(moved.get_message_view().data() == buffer);
+  assert(external_entry.get_message_view().empty());
+
+  /* клон владеет собственной копией */
+  auto copy = moved.clone();
+  assert(copy.get_message_view() == large);
+  assert(copy.get_message_view().data() != buffer);
+  assert(copy.get_level() == Logger::Level::ERROR);
+}
+
+void test_buffer_pool_reuse() {
+  auto& pool = Logger::Memory::Buffer_pool::instance();
+  assert(pool.size_class(1) == 0);
+  assert(pool.size_class(65) == 1);
+  assert(pool.size_class(Logger::Memory::Buffer_pool::max_block + 1) ==
+         Logger::Memory::Buffer_pool::class_count);
+
+  /* буфер, освобождённый другим потоком, выделяется повторно */
+  void* block = pool.allocate(300);
+  std::thread writer([&]{ pool.deallocate(block, 300); });
+  writer.join();
+  void* reused = pool.allocate(500);
+  assert(reused == block);
+  pool.deallocate(reused, 500);
+
+  /* в установившемся режиме нет системных выделений */
+  std::string large(1000, 'z');
+  for (int i = 0; i < 4; ++i) {
+    Logger::Logger_protocol::Protocol entry(large, Logger::Level::INFO, 0);
+  }
+  auto before = pool.system_allocations();
+  for (int i = 0; i < 100; ++i) {
+    Logger::Logger_protocol::Protocol entry(large, Logger::Level::INFO, 0);
+    std::thread consumer([moved = std::move(entry)]{});
+    consumer.join();
+  }
+  assert(pool.system_allocations() == before);
+}
+
 void test_print_log_entry() {
   // фиксируем время
   std::tm tm{};
@@ -137,6 +262,1026 @@ void test_file_logging_write() {
   std::remove(test_filename.data());
 }
 
+void test_file_durability() {
+  const std::string test_filename{"test_log_durability.txt"};
+  std::remove(test_filename.data());
+
+  /* синхронный режим: потоки делят fdatasync, каждая запись сохранена
+     к возврату log_write */
+  constexpr int threads = 4, per_thread = 200;
+  {
+    Logger::File_options options;
+    options.durability = Logger::Durability::SYNC;
+    Logger::Logging log(test_filename, Logger::Level::INFO, options);
+    assert(!log.open_session());
+    std::vector<std::thread> writers;
+    for (int t = 0; t < threads; ++t) {
+      writers.emplace_back([&log, t] {
+        for (int i = 0; i < per_thread; ++i) {
+          auto error = log.log_write("w" + std::to_string(t) + "-" + std::to_string(i) + " 1",
+            ::time(nullptr));
+          assert(!error);
+        }
+      });
+    }
+    for (auto& writer : writers) writer.join();
+    auto statistics = log.get_statistics();
+    assert(statistics.syncs >= 1 && statistics.syncs <= threads * per_thread);
+    std::cout << "durability: " << threads * per_thread << " records, "
+              << statistics.syncs << " fdatasync\n";
+    assert(!log.close_session());
+  }
+  std::ifstream ifs(test_filename);
+  std::vector<int> seen(threads);
+  std::string line;
+  int lines = 0;
+  while (std::getline(ifs, line)) {
+    ++lines;
+    int t = line[1] - '0', i = std::stoi(line.substr(3));
+    assert(i == seen[t]++); // порядок записей потока сохраняется
+  }
+  assert(lines == threads * per_thread);
+  ifs.close();
+  std::remove(test_filename.data());
+
+  /* периодический режим: фоновый fdatasync без участия пишущего */
+  {
+    Logger::File_options options;
+    options.durability = Logger::Durability::PERIODIC;
+    options.sync_interval_ms = 10;
+    Logger::Logging log(test_filename, Logger::Level::INFO, options);
+    assert(!log.open_session());
+    assert(!log.log_write("periodic 1", ::time(nullptr)));
+    for (int i = 0; i < 200 && !log.get_statistics().syncs; ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    assert(log.get_statistics().syncs == 1);
+    assert(!log.close_session()); // новых записей нет - без fdatasync
+    assert(log.get_statistics().syncs == 1);
+  }
+  std::remove(test_filename.data());
+}
+
+void test_duplicate_suppression() {
+  const std::string test_filename{"test_log_suppression.txt"};
+  std::remove(test_filename.data());
+  Logger::Logging log(test_filename, Logger::Level::INFO);
+  log.set_suppression(10);
+  assert(!log.open_session());
+  time_t t = 1000;
+  for (int i = 0; i < 5; ++i) {
+    assert(!log.log_write(std::string("disk full ERROR"), t + i));
+  }
+  assert(!log.log_write(std::string("other message"), t + 5));
+  /* окно закрылось - запись о повторах, затем новое окно */
+  assert(!log.log_write(std::string("disk full ERROR"), t + 10));
+  assert(!log.log_write(std::string("disk full ERROR"), t + 11));
+  assert(!log.close_session());
+
+  std::ifstream ifs(test_filename);
+  std::vector<std::string> lines;
+  for (std::string line; std::getline(ifs, line);) lines.push_back(line);
+  assert(lines.size() == 5);
+  assert(lines[0].rfind("disk full ERROR", 0) == 0);
+  assert(lines[1].rfind("other message INFO", 0) == 0);
+  assert(lines[2].rfind("disk full (repeated 4 times) ERROR", 0) == 0);
+  assert(lines[3].rfind("disk full ERROR", 0) == 0);
+  /* при закрытии сессии записываются счётчики открытых окон */
+  assert(lines[4].rfind("disk full (repeated 1 times) ERROR", 0) == 0);
+  std::remove(test_filename.data());
+
+  /* серия повторов закончилась: flush() закрывает истёкшее окно без новой записи */
+  Logger::Logging idle(test_filename, Logger::Level::INFO);
+  idle.set_suppression(10);
+  assert(!idle.open_session());
+  auto now = std::time(nullptr);
+  for (int i = 0; i < 3; ++i) {
+    assert(!idle.log_write(std::string("storm ERROR"), now - 20));
+  }
+  std::ifstream flushed(test_filename);
+  lines.clear();
+  for (std::string line; std::getline(flushed, line);) lines.push_back(line);
+  assert(lines.size() == 1);
+  assert(!idle.flush());
+  flushed.clear();
+  for (std::string line; std::getline(flushed, line);) lines.push_back(line);
+  assert(lines.size() == 2);
+  assert(lines[1].rfind("storm (repeated 2 times) ERROR", 0) == 0);
+  assert(!idle.close_session());
+  std::remove(test_filename.data());
+
+  /* несколько потоков пишут через один фильтр */
+  Logger::Logging shared(test_filename, Logger::Level::INFO);
+  shared.set_suppression(3600, 1024);
+  assert(!shared.open_session());
+  std::vector<std::thread> writers;
+  for (int thread = 0; thread < 4; ++thread) {
+    writers.emplace_back([&shared, thread]{
+      for (int i = 0; i < 1000; ++i) {
+        auto text = "repeat " + std::to_string(i % 8) + " WARN";
+        assert(!shared.log_write(std::move(text), time_t{1000 + thread}));
+      }
+    });
+  }
+  for (auto& writer : writers) writer.join();
+  assert(!shared.close_session());
+  auto statistics = shared.get_statistics();
+  auto warn = static_cast<std::size_t>(Logger::Level::WARN);
+  assert(statistics.written[warn] == 8 && statistics.suppressed[warn] == 4000 - 8);
+  std::remove(test_filename.data());
+}
+
+void test_rate_policy() {
+  const std::string test_filename{"test_log_rate.txt"};
+  std::remove(test_filename.data());
+  Logger::Logging log(test_filename, Logger::Level::INFO);
+  assert(!log.open_session());
+
+  Logger::Rate_policy policy;
+  auto& info = policy.levels[static_cast<int>(Logger::Level::INFO)];
+  info.sample = 3;
+  auto& warn = policy.levels[static_cast<int>(Logger::Level::WARN)];
+  warn.rate = 0.001;
+  warn.burst = 2;
+  auto& error = policy.levels[static_cast<int>(Logger::Level::ERROR)];
+  error.sample = 100;
+  error.always_keep = true;
+  log.set_rate_policy(policy);
+
+  for (int i = 0; i < 9; ++i) {
+    assert(!log.log_write(std::string("info"), 0));
+    assert(!log.log_write(std::string("warn WARN"), 0));
+    assert(!log.log_write(std::string("error ERROR"), 0));
+  }
+  auto statistics = log.get_statistics();
+  assert(statistics.written[0] == 3 && statistics.sampled[0] == 6);
+  assert(statistics.written[1] == 2 && statistics.rate_limited[1] == 7);
+  assert(statistics.written[2] == 9);
+
+  /* замена политики во время работы */
+  log.set_rate_policy(Logger::Rate_policy{});
+  assert(!log.log_write(std::string("warn WARN"), 0));
+  assert(log.get_statistics().written[1] == 3);
+  assert(!log.close_session());
+  std::remove(test_filename.data());
+
+  /* несколько писателей и замена политики во время записи */
+  Logger::Logging shared(test_filename, Logger::Level::INFO);
+  assert(!shared.open_session());
+  warn.burst = 5;
+  shared.set_rate_policy(policy);
+  std::atomic<bool> done{false};
+  std::thread swapper([&]{
+    while (!done) shared.set_rate_policy(policy);
+  });
+  std::vector<std::thread> writers;
+  for (int thread = 0; thread < 4; ++thread) {
+    writers.emplace_back([&shared]{
+      for (int i = 0; i < 3000; ++i) {
+        assert(!shared.log_write(std::string("info"), 0));
+        assert(!shared.log_write(std::string("warn WARN"), 0));
+      }
+    });
+  }
+  for (auto& writer : writers) writer.join();
+  done = true;
+  swapper.join();
+  statistics = shared.get_statistics();
+  assert(statistics.written[0] == 4000 && statistics.sampled[0] == 8000);
+  assert(statistics.written[1] == 5 && statistics.rate_limited[1] == 11995);
+  assert(!shared.close_session());
+  std::remove(test_filename.data());
+}
+
+void test_compression_round_trip() {
+  std::string input;
+  for (int i = 0; i < 200; ++i) {
+    input += "1700000000 INFO request handled id=" + std::to_string(i % 7) + " status=ok\n";
+  }
+  input += "tail";
+  std::string compressed, output;
+  Logger::Compression::compress(input, compressed);
+  assert(compressed.size() < input.size() / 4);
+  assert(!Logger::Compression::decompress(compressed, input.size(), output));
+  assert(output == input);
+
+  /* короткие и несжимаемые данные */
+  for (std::string small : {std::string{}, std::string("abc"), std::string("0123456789abcdef")}) {
+    compressed.clear();
+    output.clear();
+    Logger::Compression::compress(small, compressed);
+    assert(!Logger::Compression::decompress(compressed, small.size(), output));
+    assert(output == small);
+  }
+
+  /* повреждённый блок и неверный размер */
+  compressed.clear();
+  Logger::Compression::compress(input, compressed);
+  output.clear();
+  assert(Logger::Compression::decompress(compressed, input.size() + 1, output));
+  assert(output.empty());
+  assert(Logger::Compression::decompress(compressed.substr(0, compressed.size() / 2), input.size(), output));
+  compressed[compressed.size() / 2] = '\xff';
+  Logger::Compression::decompress(compressed, input.size(), output);
+}
+
+void test_transport_frames() {
+  namespace Transport = Logger::Transport;
+  auto hello = Transport::make_handshake("hello", Transport::Handshake{true, false, false, "", false});
+  auto parsed = Transport::parse_handshake(hello + " future=1", "hello");
+  assert(parsed && parsed->compress);
+  assert(!Transport::parse_handshake(hello, "welcome"));
+  assert(!Transport::parse_handshake("1700000000 0 hello", "hello"));
+
+  /* идентификатор источника: допустимый передаётся, недопустимый отбрасывается */
+  Transport::Handshake with_source;
+  with_source.source = "web-01.eu:api";
+  parsed = Transport::parse_handshake(Transport::make_handshake("hello", with_source), "hello");
+  assert(parsed && parsed->source == "web-01.eu:api" && !parsed->compress);
+  parsed = Transport::parse_handshake(Transport::make_handshake("hello", {}) + " source=a&b", "hello");
+  assert(parsed && parsed->source.empty());
+  assert(!Transport::valid_source(""));
+  assert(!Transport::valid_source(std::string(Transport::max_source_length + 1, 'a')));
+  assert(Transport::valid_source(std::string(Transport::max_source_length, 'a')));
+
+  std::string batch;
+  std::vector<std::string> records{"first", "", std::string(1000, 'x')};
+  for (const auto& record : records) Transport::append_record(batch, record);
+
+  std::string scratch;
+  std::vector<std::string> decoded;
+  auto collect = [&decoded](std::string_view record) { decoded.emplace_back(record); };
+  assert(!Transport::decode_frame('B' + batch, scratch, collect));
+  assert(decoded == records);
+
+  std::string frame(1, 'Z');
+  uint32_t raw_size = htonl(static_cast<uint32_t>(batch.size()));
+  frame.append(reinterpret_cast<const char*>(&raw_size), sizeof(raw_size));
+  Logger::Compression::compress(batch, frame);
+  decoded.clear();
+  assert(!Transport::decode_frame(frame, scratch, collect));
+  assert(decoded == records);
+
+  decoded.clear();
+  assert(!Transport::decode_frame("Rsingle", scratch, collect));
+  assert(decoded.size() == 1 && decoded[0] == "single");
+  assert(Transport::decode_frame('B' + batch.substr(0, batch.size() - 1), scratch, collect));
+  assert(Transport::decode_frame("X", scratch, collect));
+}
+
+void test_unix_socket_logging() {
+  const std::string path = "/tmp/test_logger_lib.sock";
+  for (int type : {SOCK_STREAM, SOCK_SEQPACKET}) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.data(), path.size());
+    int listen_fd = ::socket(AF_UNIX, type, 0);
+    ::unlink(path.data());
+    assert(!::bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)));
+    assert(!::listen(listen_fd, 1));
+
+    Logger::Socket_options options;
+    options.seqpacket = type == SOCK_SEQPACKET;
+    Logger::Logging log(path, "", Logger::Level::INFO, options);
+    assert(!log.open_session());
+    assert(!log.log_write(std::string("first"), 1));
+    assert(!log.log_write(std::string("second ERROR"), 2));
+    assert(!log.close_session());
+
+    int fd = ::accept(listen_fd, nullptr, nullptr);
+    assert(fd != -1);
+    std::string frame;
+    auto read = [&]{
+      return options.seqpacket ? Logger::Socket::packet_read(fd, frame)
+        : Logger::Socket::socket_read(fd, frame);
+    };
+    assert(!read());
+    auto entry = Logger::Logger_protocol::deserialization_log(frame);
+    assert(entry && entry->get_message_view() == "first");
+    assert(!read());
+    entry = Logger::Logger_protocol::deserialization_log(frame);
+    assert(entry && entry->get_level() == Logger::Level::ERROR);
+    assert(read());
+    ::close(fd);
+    ::close(listen_fd);
+  }
+
+  /* пачка, начатая batch_delay_ms назад, отправляется без flush() и закрытия */
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  std::memcpy(address.sun_path, path.data(), path.size());
+  int listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  ::unlink(path.data());
+  assert(!::bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)));
+  assert(!::listen(listen_fd, 1));
+  std::atomic<int> delivered{0};
+  std::thread server([&]{
+    int fd = ::accept(listen_fd, nullptr, nullptr);
+    assert(fd != -1);
+    std::string frame, scratch;
+    assert(!Logger::Socket::socket_read(fd, frame));
+    auto hello = Logger::Transport::parse_handshake(frame, "hello");
+    assert(hello);
+    Logger::Socket::socket_write(fd, Logger::Transport::make_handshake("welcome", *hello));
+    while (!Logger::Socket::socket_read(fd, frame)) {
+      assert(!Logger::Transport::decode_frame(frame, scratch, [&](std::string_view) { ++delivered; }));
+    }
+    ::close(fd);
+  });
+  Logger::Socket_options delayed;
+  delayed.batch_bytes = 64 * 1024;
+  delayed.batch_delay_ms = 20;
+  Logger::Logging log(path, "", Logger::Level::INFO, delayed);
+  assert(!log.open_session());
+  assert(!log.log_write(std::string("early"), 1));
+  std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  assert(!log.log_write(std::string("late"), 2));
+  for (int i = 0; i < 200 && delivered < 2; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  assert(delivered == 2);
+  assert(!log.close_session());
+  server.join();
+  ::close(listen_fd);
+  ::unlink(path.data());
+}
+
+void test_reliable_socket_logging() {
+  namespace Transport = Logger::Transport;
+  assert(Transport::parse_ack(Transport::make_ack(1ull << 40)) == (1ull << 40));
+  assert(!Transport::parse_ack("A123"));
+
+  const std::string path = "/tmp/test_logger_reliable.sock";
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  std::memcpy(address.sun_path, path.data(), path.size());
+  int listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  ::unlink(path.data());
+  assert(!::bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)));
+  assert(!::listen(listen_fd, 2));
+
+  /* первое соединение подтверждает 3 записи из 5 и обрывается */
+  std::vector<std::string> received;
+  std::thread server([&]{
+    for (int connection = 0; connection < 2; ++connection) {
+      int fd = ::accept(listen_fd, nullptr, nullptr);
+      assert(fd != -1);
+      std::string frame, scratch;
+      assert(!Logger::Socket::socket_read(fd, frame));
+      auto hello = Transport::parse_handshake(frame, "hello");
+      assert(hello && hello->acknowledge);
+      Logger::Socket::socket_write(fd, Transport::make_handshake("welcome", *hello));
+      uint64_t count = 0;
+      while (!Logger::Socket::socket_read(fd, frame)) {
+        assert(!Transport::decode_frame(frame, scratch, [&](std::string_view record) {
+          ++count;
+          received.emplace_back(Logger::Logger_protocol::deserialization_log(record)->get_message_view());
+        }));
+        Logger::Socket::socket_write(fd, Transport::make_ack(connection ? count : std::min<uint64_t>(count, 3)));
+        if (!connection && count >= 5) break;
+      }
+      ::close(fd);
+    }
+  });
+
+  Logger::Socket_options options;
+  options.reliable = true;
+  options.ack_timeout_ms = 2000;
+  Logger::Logging log(path, "", Logger::Level::INFO, options);
+  assert(!log.open_session());
+  for (int i = 0; i < 10; ++i) {
+    assert(!log.log_write(std::string("r") + std::to_string(i), 1));
+  }
+  assert(!log.close_session());
+  server.join();
+  ::close(listen_fd);
+  ::unlink(path.data());
+
+  /* доставка не менее одного раза: неподтверждённые записи отправлены повторно */
+  for (int i = 0; i < 10; ++i) {
+    assert(std::count(received.begin(), received.end(), "r" + std::to_string(i)) >= 1);
+  }
+  assert(std::count(received.begin(), received.end(), "r3") == 2);
+  auto statistics = log.get_statistics();
+  assert(statistics.retransmitted >= 2 && statistics.unacknowledged == 0);
+}
+
+void test_flight_recorder() {
+  const std::string dump_filename{"test_recorder_dump.txt"};
+  std::remove(dump_filename.data());
+  auto read_dump = [&dump_filename] {
+    std::vector<std::string> lines;
+    std::ifstream ifs(dump_filename);
+    for (std::string line; std::getline(ifs, line);) lines.push_back(line);
+    return lines;
+  };
+
+  /* маленькое кольцо: старые записи вытесняются, длины разные - с переходами */
+  Logger::Recorder_options options;
+  options.capacity = 1024;
+  options.dump_file = dump_filename;
+  {
+    Logger::Logging log(options, Logger::Level::INFO);
+    assert(!log.open_session());
+    constexpr int count = 300;
+    for (int i = 0; i < count; ++i) {
+      auto message = "rec" + std::to_string(i) + std::string(static_cast<std::size_t>(i % 37), 'x');
+      assert(!log.log_write(message + " INFO", ::time(nullptr)));
+    }
+    assert(read_dump().empty()); // запись не выполняет ввода-вывода
+    assert(!log.flush());
+    auto lines = read_dump();
+    assert(!lines.empty() && lines.size() < static_cast<std::size_t>(count));
+    auto statistics = log.get_statistics();
+    assert(statistics.dumps == 1);
+    assert(statistics.overwritten == count - lines.size());
+    // выгружены последние записи по порядку
+    for (std::size_t i = 0; i < lines.size(); ++i) {
+      auto expected = "rec" + std::to_string(count - lines.size() + i);
+      assert(lines[i].compare(0, expected.size(), expected) == 0);
+      assert(lines[i].find(" INFO ") != std::string::npos);
+    }
+    assert(!log.flush()); // кольцо пусто - файл не дописывается
+    assert(log.get_statistics().dumps == 1);
+
+    /* запись уровня ERROR выгружает кольцо потоком выгрузки */
+    std::remove(dump_filename.data());
+    assert(!log.log_write("before INFO", ::time(nullptr)));
+    assert(!log.log_write("failure ERROR", ::time(nullptr)));
+    for (int i = 0; i < 200 && log.get_statistics().dumps < 2; ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    lines = read_dump();
+    assert(lines.size() == 2);
+    assert(lines[0].rfind("before INFO ", 0) == 0 && lines[1].rfind("failure ERROR ", 0) == 0);
+    assert(log.log_write(std::string(options.capacity, 'y') + " INFO", ::time(nullptr)));
+    assert(!log.close_session());
+  }
+
+  /* выгрузка по сигналу */
+  std::remove(dump_filename.data());
+  options.trigger.reset();
+  options.dump_signal = SIGUSR1;
+  {
+    Logger::Logging log(options, Logger::Level::INFO);
+    assert(!log.open_session());
+    assert(!log.log_write("signalled ERROR", ::time(nullptr)));
+    ::raise(SIGUSR1);
+    for (int i = 0; i < 200 && !log.get_statistics().dumps; ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    auto lines = read_dump();
+    assert(lines.size() == 1 && lines[0].rfind("signalled ERROR ", 0) == 0);
+    assert(!log.close_session());
+  }
+  std::remove(dump_filename.data());
+}
+
+void test_shared_ring() {
+  Logger::Ring_options options;
+  options.name = "/test_logger_lib_ring";
+  options.slot_count = 8;
+  options.slot_size = 128;
+  options.abandon_timeout_ms = 50;
+  Logger::Shared_ring::remove(options.name);
+  auto open = [&options](bool consumer) {
+    auto opened = Logger::Shared_ring::open(options, consumer);
+    assert(std::holds_alternative<std::unique_ptr<Logger::Shared_ring>>(opened));
+    return std::move(std::get<std::unique_ptr<Logger::Shared_ring>>(opened));
+  };
+  auto consumer = open(true);
+  assert(std::holds_alternative<Logger::Error>(Logger::Shared_ring::open(options, true)));
+
+  /* несколько производителей через Logging */
+  constexpr int producers = 4, per_producer = 500;
+  std::vector<int> received(producers);
+  std::vector<std::thread> threads;
+  for (int id = 0; id < producers; ++id) {
+    threads.emplace_back([&options, id]{
+      Logger::Logging log(options, Logger::Level::INFO);
+      assert(!log.open_session());
+      for (int i = 0; i < per_producer; ++i) {
+        std::string message = "producer " + std::to_string(id);
+        while (log.log_write(std::string(message), i)) std::this_thread::yield();
+      }
+      assert(!log.close_session());
+    });
+  }
+  int total = 0;
+  while (total < producers * per_producer) {
+    total += consumer->consume([&received](Logger::Logger_protocol::Protocol&& entry) {
+      auto message = entry.get_message_view();
+      ++received[message.back() - '0'];
+    });
+    if (total < producers * per_producer) consumer->wait(10);
+  }
+  for (auto& thread : threads) thread.join();
+  for (int count : received) assert(count == per_producer);
+  assert(consumer->get_dropped() > 0); // кольцо из 8 слотов заполнялось
+
+  /* перезапуск потребителя продолжает с сохранённой позиции */
+  auto producer = open(false);
+  for (int i = 0; i < 3; ++i) {
+    assert(!producer->push(Logger::Logger_protocol::Protocol("restart", Logger::Level::WARN, i)));
+  }
+  assert(consumer->consume([](Logger::Logger_protocol::Protocol&&) {}, 1) == 1);
+  consumer.reset();
+  consumer = open(true);
+  std::vector<time_t> times;
+  auto collect = [&times](Logger::Logger_protocol::Protocol&& entry) {
+    times.push_back(entry.get_time());
+  };
+  consumer->consume(collect);
+  assert((times == std::vector<time_t>{1, 2}));
+
+  /* слот аварийно завершившегося производителя и повреждённая запись */
+  int fd = ::shm_open(options.name.data(), O_RDWR, 0600);
+  auto size = sizeof(Logger::Shared_ring::Header) + options.slot_count * options.slot_size;
+  auto memory = static_cast<char*>(::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+  auto header = reinterpret_cast<Logger::Shared_ring::Header*>(memory);
+  auto position = header->head.fetch_add(1); // резерв без фиксации
+  assert(!producer->push(Logger::Logger_protocol::Protocol("after crash", Logger::Level::INFO, 7)));
+  assert(!producer->push(Logger::Logger_protocol::Protocol("corrupted", Logger::Level::INFO, 8)));
+  auto corrupted = memory + sizeof(Logger::Shared_ring::Header) +
+    ((position + 2) % options.slot_count) * options.slot_size + sizeof(Logger::Shared_ring::Slot);
+  corrupted[0] = 'C';
+  times.clear();
+  assert(!consumer->consume(collect));
+  std::this_thread::sleep_for(std::chrono::milliseconds(options.abandon_timeout_ms * 2));
+  consumer->consume(collect);
+  assert((times == std::vector<time_t>{7}));
+  assert(consumer->get_abandoned() == 2);
+
+  /* обработчик получает проверенную копию: запись в слот после проверки её не меняет */
+  assert(!producer->push(Logger::Logger_protocol::Protocol("intact", Logger::Level::INFO, 9)));
+  auto late = memory + sizeof(Logger::Shared_ring::Header) +
+    ((position + 3) % options.slot_count) * options.slot_size + sizeof(Logger::Shared_ring::Slot);
+  bool seen = false;
+  consumer->consume([&](Logger::Logger_protocol::Protocol&& entry) {
+    std::memcpy(late, "TORN!!", 6);
+    assert(entry.get_message_view() == "intact");
+    seen = true;
+  });
+  assert(seen);
+  ::munmap(memory, size);
+  ::close(fd);
+  Logger::Shared_ring::remove(options.name);
+}
+
+void test_basic_logging() {
+  const std::string facade_file{"test_log_facade.txt"}, basic_file{"test_log_basic.txt"};
+  std::remove(facade_file.data());
+  std::remove(basic_file.data());
+
+  /* вывод совпадает с File_logging, уровень фильтруется так же */
+  {
+    Logger::Logging facade(facade_file, Logger::Level::WARN);
+    Logger::Basic_logging<Logger::File_sink, Logger::Text_format> basic(
+      Logger::File_sink(basic_file), Logger::Level::WARN);
+    assert(!facade.open_session() && !basic.open_session());
+    auto base = Logger::Clock::from_seconds(::time(nullptr));
+    const char* messages[] = {"disk full ERROR", "skipped INFO", "slow WARN", "same second WARN"};
+    Logger::Timestamp offsets[] = {Logger::Timestamp(0), Logger::Timestamp(1),
+      Logger::Timestamp(250000000), std::chrono::seconds(1)};
+    for (std::size_t i = 0; i < std::size(messages); ++i) {
+      assert(!facade.log_write(std::string(messages[i]), base + offsets[i]));
+      assert(!basic.log_write(std::string(messages[i]), base + offsets[i]));
+    }
+    auto statistics = basic.get_statistics();
+    assert(statistics.written[0] == 0 && statistics.written[1] == 2 && statistics.written[2] == 1);
+    assert(!facade.close_session() && !basic.close_session());
+  }
+  std::ifstream facade_in(facade_file), basic_in(basic_file);
+  std::stringstream facade_text, basic_text;
+  facade_text << facade_in.rdbuf();
+  basic_text << basic_in.rdbuf();
+  assert(!basic_text.str().empty() && basic_text.str() == facade_text.str());
+  std::remove(facade_file.data());
+  std::remove(basic_file.data());
+
+  /* несколько приёмников одной записью; запись без открытой сессии - ошибка */
+  Logger::Basic_logging tee{Logger::Tee_sink(Logger::File_sink(basic_file), Logger::Null_sink()),
+    Logger::Level::INFO};
+  assert(tee.log_write(std::string("closed INFO"), ::time(nullptr)));
+  assert(!tee.open_session());
+  assert(!tee.log_write(std::string("tee INFO"), ::time(nullptr)));
+  assert(!tee.close_session());
+  std::ifstream tee_in(basic_file);
+  std::string line;
+  std::getline(tee_in, line);
+  assert(line.rfind("tee INFO ", 0) == 0);
+  assert(tee.get_sink().get<1>().get_bytes() > 2 * line.size()); // "closed INFO" тоже
+  std::remove(basic_file.data());
+
+  /* замер: виртуальная сессия Logging против прямых вызовов Basic_logging */
+  constexpr int records = 200000;
+  std::vector<Logger::Logger_protocol::Protocol> entries;
+  auto now = Logger::Clock::now();
+  for (int i = 0; i < records; ++i) {
+    entries.emplace_back("benchmark record " + std::to_string(i % 100), Logger::Level::INFO,
+      now + std::chrono::microseconds(i));
+  }
+  auto measure = [&](auto& log) {
+    assert(!log.open_session());
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& entry : entries) assert(!log.log_write(entry));
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    assert(!log.close_session());
+    return elapsed.count() * 1e9 / records;
+  };
+  Logger::Logging facade(facade_file, Logger::Level::INFO);
+  Logger::Basic_logging<Logger::File_sink> basic(Logger::File_sink(basic_file), Logger::Level::INFO);
+  Logger::Basic_logging<Logger::Null_sink> null(Logger::Null_sink(), Logger::Level::INFO);
+  auto facade_ns = measure(facade), basic_ns = measure(basic), null_ns = measure(null);
+  std::cout << "basic logging: Logging(file) " << facade_ns << " ns, Basic_logging<File_sink> "
+            << basic_ns << " ns, Basic_logging<Null_sink> " << null_ns << " ns per record\n";
+  std::remove(facade_file.data());
+  std::remove(basic_file.data());
+}
+
+void test_output_formats() {
+  using Logger::Logger_protocol::Entry_formatter;
+  using Logger::Logger_protocol::Protocol;
+  assert(Logger::parse_output_format("json") == Logger::Output_format::JSON);
+  assert(Logger::parse_output_format("logfmt") == Logger::Output_format::LOGFMT);
+  assert(!Logger::parse_output_format("xml"));
+
+  /* TEXT совпадает с print_log_entry */
+  Entry_formatter text(Logger::Output_format::TEXT), json(Logger::Output_format::JSON),
+    logfmt(Logger::Output_format::LOGFMT);
+  auto time = Logger::Clock::from_seconds(1754839845) + Logger::Timestamp(5000);
+  for (auto stamp : {time, Logger::Clock::from_seconds(1754839845)}) {
+    Protocol entry("plain text", Logger::Level::WARN, stamp);
+    std::ostringstream expected;
+    Logger::Logger_protocol::print_log_entry(expected, entry);
+    std::string out;
+    text.format(out, entry);
+    assert(out == expected.str());
+  }
+
+  std::string out;
+  json.format(out, Protocol("disk \"sda\" full", Logger::Level::ERROR, time));
+  assert(out == R"({"time":"2025-08-10T15:30:45.000005000Z","level":"ERROR","msg":"disk \"sda\" full"})");
+  out.clear();
+  logfmt.format(out, Protocol("started", Logger::Level::INFO, time));
+  assert(out == "time=2025-08-10T15:30:45.000005000Z level=INFO msg=started");
+  out.clear();
+  logfmt.format(out, Protocol("a=b c", Logger::Level::INFO, time));
+  assert(out.substr(out.find(" msg=")) == " msg=\"a=b c\"");
+  out.clear();
+  logfmt.format(out, Protocol("", Logger::Level::INFO, time));
+  assert(out.substr(out.find(" msg=")) == " msg=\"\"");
+
+  /* экранирование в каждой позиции, в том числе на границах блоков по 16 байт */
+  auto reference = [](std::string_view text) {
+    std::string escaped;
+    for (unsigned char c : text) {
+      char buffer[8];
+      if (c == '"' || c == '\\') {
+        escaped += '\\';
+        escaped += static_cast<char>(c);
+      } else if (c == '\n') {
+        escaped += "\\n";
+      } else if (c == '\r') {
+        escaped += "\\r";
+      } else if (c == '\t') {
+        escaped += "\\t";
+      } else if (c < 0x20) {
+        std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+        escaped += buffer;
+      } else {
+        escaped += static_cast<char>(c);
+      }
+    }
+    return escaped;
+  };
+  const std::string specials = "\"\\\n\r\t\x01\x1f";
+  for (std::size_t length : {1, 15, 16, 17, 31, 33, 70}) {
+    for (std::size_t position = 0; position < length; ++position) {
+      for (char special : specials) {
+        std::string message(length, 'x');
+        message[position] = special;
+        message[length - 1 - position % length] = "\xd0\xaf"[position % 2]; // байты UTF-8 не экранируются
+        out.clear();
+        json.format(out, Protocol(message, Logger::Level::INFO, time));
+        auto begin = out.find("\"msg\":\"") + 7;
+        assert(out.substr(begin, out.size() - begin - 2) == reference(message));
+      }
+    }
+  }
+
+  /* файл в формате JSON lines */
+  const std::string test_filename{"test_log_json.txt"};
+  std::remove(test_filename.data());
+  {
+    Logger::File_options options;
+    options.format = Logger::Output_format::JSON;
+    Logger::Logging log(test_filename, Logger::Level::INFO, options);
+    assert(!log.open_session());
+    assert(!log.log_write(std::string("say \"hi\" WARN"), time));
+    assert(!log.close_session());
+  }
+  std::ifstream ifs(test_filename);
+  std::string line;
+  std::getline(ifs, line);
+  assert(line == R"({"time":"2025-08-10T15:30:45.000005000Z","level":"WARN","msg":"say \"hi\""})");
+  ifs.close();
+  std::remove(test_filename.data());
+
+  /* замер: структурированный вывод против текста */
+  constexpr int records = 200000;
+  std::vector<Protocol> entries;
+  auto now = Logger::Clock::now();
+  for (int i = 0; i < records; ++i) {
+    entries.emplace_back("user " + std::to_string(i % 100) + " logged in from 10.0.0.1 port 22",
+      Logger::Level::INFO, now + std::chrono::microseconds(i));
+  }
+  auto measure = [&](auto format) {
+    Logger::Basic_logging<Logger::Null_sink, decltype(format)> log(Logger::Null_sink(),
+      Logger::Level::INFO);
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& entry : entries) assert(!log.log_write(entry));
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() * 1e9 / records;
+  };
+  auto text_ns = measure(Logger::Text_format()), json_ns = measure(Logger::Json_format()),
+    logfmt_ns = measure(Logger::Logfmt_format());
+  std::cout << "output formats: text " << text_ns << " ns, json " << json_ns << " ns, logfmt "
+            << logfmt_ns << " ns per record\n";
+}
+
+void test_archive() {
+  namespace Archive = Logger::Archive;
+  const std::string path{"test_log_archive.lga"};
+  std::remove(path.data());
+
+  /* записи с неупорядоченным временем, блоки по 4096 записей */
+  constexpr int records = 50000;
+  std::vector<Logger::Logger_protocol::Protocol> entries;
+  auto base = Logger::Clock::from_seconds(1754839845);
+  std::size_t text_bytes = 0;
+  for (int i = 0; i < records; ++i) {
+    auto time = base + std::chrono::milliseconds(i) - std::chrono::milliseconds(i % 7 == 3 ? 5 : 0);
+    entries.emplace_back("request " + std::to_string(i % 500) + " served in " +
+      std::to_string(i % 13) + " ms", static_cast<Logger::Level>(i % 3), time);
+    text_bytes += entries.back().get_message_view().size() + 36;
+  }
+  entries.emplace_back("", Logger::Level::ERROR, base); // пустое сообщение
+  {
+    Archive::Writer_options options;
+    options.block_records = 4096;
+    auto created = Archive::Writer::create(path, options);
+    assert(std::holds_alternative<std::unique_ptr<Archive::Writer>>(created));
+    auto& writer = std::get<std::unique_ptr<Archive::Writer>>(created);
+    for (const auto& entry : entries) assert(!writer->write(entry));
+    std::ifstream unfinished(path);
+    assert(!unfinished.is_open()); // до close() архив не виден
+    assert(!writer->close());
+    assert(writer->get_records() == entries.size() && writer->get_blocks() == 13);
+    std::cout << "archive: " << entries.size() << " records, " << writer->get_bytes()
+              << " bytes (text ~" << text_bytes << ")\n";
+    assert(writer->get_bytes() < text_bytes / 4);
+  }
+
+  auto opened = Archive::Reader::open(path);
+  assert(std::holds_alternative<std::unique_ptr<Archive::Reader>>(opened));
+  auto& reader = std::get<std::unique_ptr<Archive::Reader>>(opened);
+  assert(reader->blocks().size() == 13);
+  Archive::Block block;
+  std::size_t index = 0;
+  for (const auto& info : reader->blocks()) {
+    assert(!reader->read(info, Archive::ALL, block));
+    assert(block.times.size() == info.count && block.levels.size() == info.count);
+    uint32_t levels[3]{};
+    std::size_t offset = 0;
+    for (uint32_t i = 0; i < info.count; ++i, ++index) {
+      const auto& entry = entries[index];
+      assert(block.times[i] == entry.get_timestamp() && block.levels[i] == entry.get_level());
+      assert(block.times[i] >= info.min_time && block.times[i] <= info.max_time);
+      assert(std::string_view(block.messages).substr(offset, block.lengths[i]) == entry.get_message_view());
+      offset += block.lengths[i];
+      ++levels[static_cast<int>(block.levels[i])];
+    }
+    assert(std::equal(std::begin(levels), std::end(levels), std::begin(info.levels)));
+  }
+  assert(index == entries.size());
+
+  /* только выбранные столбцы; текст не читается */
+  const auto& second = reader->blocks()[1];
+  assert(!reader->read(second, Archive::LEVEL | Archive::LENGTH, block));
+  assert(block.times.empty() && block.messages.empty() && block.levels.size() == second.count);
+  assert(second.overlaps(second.max_time, second.max_time + std::chrono::seconds(1)));
+  assert(!second.overlaps(second.max_time + Logger::Timestamp(1), second.max_time + std::chrono::seconds(1)));
+
+  /* повреждённый заголовок блока: количество записей не сходится
+     с размерами столбцов */
+  auto corrupt_field = [&](std::size_t offset, uint32_t value) {
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(static_cast<std::streamoff>(sizeof(Archive::magic) + offset));
+    const char bytes[] = {static_cast<char>(value >> 24), static_cast<char>(value >> 16),
+      static_cast<char>(value >> 8), static_cast<char>(value)};
+    file.write(bytes, sizeof(bytes));
+  };
+  const auto& first = reader->blocks()[0];
+  corrupt_field(0, 0xFFFFFFFF); // count
+  assert(std::holds_alternative<Logger::Error>(Archive::Reader::open(path)));
+  corrupt_field(0, first.count);
+  corrupt_field(36, first.sizes[1] + 1); // размер столбца уровней
+  assert(std::holds_alternative<Logger::Error>(Archive::Reader::open(path)));
+  corrupt_field(36, first.sizes[1]);
+  assert(std::holds_alternative<std::unique_ptr<Archive::Reader>>(Archive::Reader::open(path)));
+
+  /* обрезанный архив и файл другого формата */
+  ::truncate(path.data(), 100);
+  assert(std::holds_alternative<Logger::Error>(Archive::Reader::open(path)));
+  {
+    std::ofstream text(path);
+    text << "hello INFO 2025-08-10 15:30:45\n";
+  }
+  assert(std::holds_alternative<Logger::Error>(Archive::Reader::open(path)));
+  std::remove(path.data());
+
+  /* без close() временный файл удаляется */
+  {
+    auto created = Archive::Writer::create(path);
+    assert(!std::get<std::unique_ptr<Archive::Writer>>(created)->write(entries[0]));
+  }
+  std::ifstream abandoned(path + ".tmp");
+  assert(!abandoned.is_open());
+}
+
+void test_token_index() {
+  namespace Token_index = Logger::Token_index;
+  const std::string test_filename{"test_log_tokens.txt"};
+  const auto index_file = Token_index::index_path(test_filename);
+  std::remove(test_filename.data());
+  std::remove(index_file.data());
+
+  /* токены: буквы, цифры, '_' и UTF-8; остальное - разделители */
+  std::vector<std::string> tokens;
+  Token_index::for_each_token("user=id_42, \"ошибка\" -7 ", [&](std::string_view token) {
+    tokens.emplace_back(token);
+  });
+  assert((tokens == std::vector<std::string>{"user", "id_42", "ошибка", "7"}));
+
+  /* фильтр без ложноотрицательных ответов, ложноположительных ~1% */
+  std::vector<uint64_t> hashes;
+  for (int i = 0; i < 1000; ++i) hashes.push_back(Token_index::hash_token("t" + std::to_string(i)));
+  auto filter = Token_index::Bloom_filter::build(hashes);
+  assert(filter.bit_count() >= 1000 * Token_index::Bloom_filter::bits_per_token);
+  int false_positives = 0;
+  for (int i = 0; i < 1000; ++i) {
+    assert(filter.may_contain(Token_index::hash_token("t" + std::to_string(i))));
+    false_positives += filter.may_contain(Token_index::hash_token("u" + std::to_string(i)));
+  }
+  assert(false_positives < 40);
+  std::string serialized;
+  filter.serialize(serialized);
+  std::string_view view(serialized);
+  auto restored = Token_index::Bloom_filter::deserialize(view);
+  assert(restored && view.empty() && restored->may_contain(Token_index::hash_token("t7")));
+
+  /* File_logging строит сегменты по мере записи */
+  constexpr int records = 5000;
+  Logger::File_options options;
+  options.index_segment_bytes = 16384;
+  for (int session = 0; session < 2; ++session) {
+    Logger::Logging log(test_filename, Logger::Level::INFO, options);
+    assert(!log.open_session());
+    for (int i = session * records / 2; i < (session + 1) * records / 2; ++i) {
+      assert(!log.log_write("request id_" + std::to_string(i) + " served INFO", 1754839845));
+    }
+    assert(!log.close_session());
+  }
+  auto read = Token_index::read_index(index_file);
+  auto& segments = std::get<std::vector<Token_index::Segment>>(read);
+  std::ifstream ifs(test_filename, std::ios::binary);
+  std::string content((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+  ifs.close();
+  assert(segments.size() > 10);
+  uint64_t end = 0;
+  for (const auto& segment : segments) {
+    assert(segment.offset == end && segment.length > 0); // сегменты подряд, из целых строк
+    assert(segment.offset == 0 || content[segment.offset - 1] == '\n');
+    end = segment.offset + segment.length;
+  }
+  assert(end == content.size());
+  std::size_t candidates = 0;
+  auto needle = Token_index::hash_token("id_1234");
+  for (const auto& segment : segments) {
+    auto text = std::string_view(content).substr(segment.offset, segment.length);
+    if (text.find("id_1234 ") != std::string_view::npos) assert(segment.filter.may_contain(needle));
+    candidates += segment.filter.may_contain(needle);
+  }
+  assert(candidates <= 2);
+
+  /* журнал усечён: индекс не соответствует и начинается заново */
+  ::truncate(test_filename.data(), 0);
+  {
+    Logger::Logging log(test_filename, Logger::Level::INFO, options);
+    assert(!log.open_session());
+    assert(!log.log_write("fresh start INFO", 1754839845));
+    assert(!log.close_session());
+  }
+  read = Token_index::read_index(index_file);
+  assert(std::get<std::vector<Token_index::Segment>>(read).size() == 1);
+  assert(std::get<std::vector<Token_index::Segment>>(read)[0].offset == 0);
+  std::remove(test_filename.data());
+  std::remove(index_file.data());
+}
+
+void test_bounded_frames() {
+  namespace Transport = Logger::Transport;
+  /* кадр части: флаг продолжения и данные */
+  std::string frame;
+  Transport::append_chunk(frame, "part", true);
+  auto chunk = Transport::parse_chunk(frame);
+  assert(chunk && chunk->more && chunk->data == "part");
+  Transport::append_chunk(frame, "", false);
+  chunk = Transport::parse_chunk(frame);
+  assert(chunk && !chunk->more && chunk->data.empty());
+  assert(!Transport::parse_chunk("C\x02x") && !Transport::parse_chunk("Bx"));
+  Transport::Handshake request;
+  request.chunks = true;
+  auto parsed = Transport::parse_handshake(Transport::make_handshake("hello", request), "hello");
+  assert(parsed && parsed->chunks);
+
+  /* кадр больше ограничения: ошибка без выделения памяти под него */
+  for (int type : {SOCK_STREAM, SOCK_SEQPACKET}) {
+    int pair[2];
+    assert(!::socketpair(AF_UNIX, type, 0, pair));
+    auto write = [&](std::string_view data) {
+      return type == SOCK_SEQPACKET ? Logger::Socket::packet_write(pair[0], data)
+        : Logger::Socket::socket_write(pair[0], data);
+    };
+    auto read = [&](std::string& buffer, std::size_t max_size) {
+      return type == SOCK_SEQPACKET ? Logger::Socket::packet_read(pair[1], buffer, max_size)
+        : Logger::Socket::socket_read(pair[1], buffer, max_size);
+    };
+    assert(std::holds_alternative<int>(write(std::string(1000, 'x'))));
+    assert(std::holds_alternative<int>(write("small")));
+    std::string buffer;
+    auto error = read(buffer, 100);
+    assert(error && error->get_err_message() == "frame too large: 1000 bytes, limit 100");
+    assert(buffer.capacity() < 1000);
+    if (type == SOCK_SEQPACKET) { // пакет отброшен, следующий читается
+      assert(!read(buffer, 100) && buffer == "small");
+    }
+    ::close(pair[0]);
+    ::close(pair[1]);
+  }
+
+  /* длинная запись уходит частями не больше chunk_bytes + 2 */
+  const std::string path = "/tmp/test_logger_chunks.sock";
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  std::memcpy(address.sun_path, path.data(), path.size());
+  int listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  ::unlink(path.data());
+  assert(!::bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)));
+  assert(!::listen(listen_fd, 1));
+  const std::string large(10000, 'L');
+  std::vector<std::string> records;
+  std::size_t chunks = 0;
+  std::thread server([&]{
+    int fd = ::accept(listen_fd, nullptr, nullptr);
+    assert(fd != -1);
+    std::string frame, scratch, assembled;
+    assert(!Logger::Socket::socket_read(fd, frame));
+    auto hello = Transport::parse_handshake(frame, "hello");
+    assert(hello && hello->chunks);
+    Logger::Socket::socket_write(fd, Transport::make_handshake("welcome", *hello));
+    while (!Logger::Socket::socket_read(fd, frame, 1026)) {
+      if (auto part = Transport::parse_chunk(frame)) {
+        ++chunks;
+        assembled.append(part->data);
+        if (!part->more) records.push_back(std::exchange(assembled, {}));
+        continue;
+      }
+      assert(!Transport::decode_frame(frame, scratch, [&](std::string_view record) {
+        records.emplace_back(record);
+      }));
+    }
+    ::close(fd);
+  });
+  Logger::Socket_options options;
+  options.chunk_bytes = 1024;
+  options.batch_bytes = 512;
+  Logger::Logging log(path, "", Logger::Level::INFO, options);
+  assert(!log.open_session());
+  assert(!log.log_write(std::string("before"), 1));
+  assert(!log.log_write(std::string(large), 2));
+  assert(!log.log_write(std::string("after"), 3));
+  assert(!log.close_session());
+  server.join();
+  ::close(listen_fd);
+  ::unlink(path.data());
+  assert(records.size() == 3 && chunks == 10);
+  assert(Logger::Logger_protocol::deserialization_log(records[0])->get_message_view() == "before");
+  assert(Logger::Logger_protocol::deserialization_log(records[1])->get_message_view() == large);
+  assert(Logger::Logger_protocol::deserialization_log(records[2])->get_message_view() == "after");
+}
+
 int main() {
   test_create_log_entry_with_level();
   test_create_log_entry_without_level();
@@ -145,7 +1290,24 @@ int main() {
   test_extract_last_number_not_number();
   test_extract_last_number_empty_string();
   test_serialization_and_deserialization();
+  test_protocol_storage_and_move();
+  test_buffer_pool_reuse();
+  test_nanosecond_timestamps();
   test_print_log_entry();
   test_file_logging_write();
+  test_file_durability();
+  test_duplicate_suppression();
+  test_rate_policy();
+  test_compression_round_trip();
+  test_transport_frames();
+  test_unix_socket_logging();
+  test_reliable_socket_logging();
+  test_bounded_frames();
+  test_shared_ring();
+  test_flight_recorder();
+  test_basic_logging();
+  test_output_formats();
+  test_archive();
+  test_token_index();
     return 0;
 }